@@ -47,35 +47,15 @@
 #include "lsm_testing_ble.h"
 #include "hal_pin_analog_input.h"
 #include "simple_adc.h"
+#include "motion_features.h"
+#if FEATURE_BENCH == 1
+#include "profiler_timer.h"
+#endif
 
 #define SMOKE_DETECT_PIN 2
 
 #define ANI_SMOKE_PIN PIN_TO_ANALOG_INPUT(SMOKE_DETECT_PIN)
 
-int16_t x_data, y_data, z_data;
-
-static uint32_t my_sqrt (uint32_t num)
-{
-    float xn, xm, flag, temp;
-    xn = 0;
-    xm = 800;
-    flag = 0;
-    while (flag == 0)
-    {
-        xn = (xm + (num / xm)) / 2;
-        if (xn == xm)
-        {
-            flag = 1;
-        }
-        else
-        {
-            xm = xn;
-        }
-    }
-    temp = xn * 1000;
-    return (uint32_t) temp;
-}
-
 bool compare_percent (uint32_t data, uint32_t ref, float per)
 {
     if ((ref - (ref * per / 100)) <= data && data <= (ref + (ref * per / 100)))
@@ -102,36 +82,55 @@ uint32_t avg_uint32_x100 (uint32_t * p_arr, uint32_t no_of_entries)
 
 static mod_ble_data_t ble_data;
 
-void lsm_100ms_handler ()
+/** Peak resultant acceleration in centi-g in the latest block from the FIFO */
+static volatile uint32_t block_max_res_acce = 0;
+
+void lsm_block_handler (const LSM6DS3_accel_sample_t * p_samples, uint32_t sample_cnt)
 {
-    
-    LSM6DS3_read_accl_data (&x_data, &y_data, &z_data);
-    x_data = (LSM6DS3_accelData_in_g(x_data));
-    x_data = (x_data * ((x_data > 0) - (x_data < 0)));
-    y_data = (LSM6DS3_accelData_in_g(y_data) );
-    y_data = (y_data * ((y_data > 0) - (y_data < 0)));
-    z_data = (LSM6DS3_accelData_in_g(z_data) );
-    z_data = (z_data * ((z_data > 0) - (z_data < 0)));
+    motion_features_t features;
+#if FEATURE_BENCH == 1
+    volatile int16_t conv_data;
+    uint32_t conv_ticks, feature_ticks;
+
+    PROFILER_TIMER->TASKS_CAPTURE[2] = 1;
+    for(uint32_t i = 0; i < sample_cnt; i++)
+    {
+        conv_data = LSM6DS3_accelData_in_g(p_samples[i].x);
+        conv_data = LSM6DS3_accelData_in_g(p_samples[i].y);
+        conv_data = LSM6DS3_accelData_in_g(p_samples[i].z);
+    }
+    (void) conv_data;
+    PROFILER_TIMER->TASKS_CAPTURE[3] = 1;
+    conv_ticks = PROFILER_TIMER->CC[3] - PROFILER_TIMER->CC[2];
+    PROFILER_TIMER->TASKS_CAPTURE[2] = 1;
+#endif
+
+    motion_features_calc ((const int16_t *) p_samples, sample_cnt,
+        LSM6DS3_accel_mg_per_lsb_q15 (), &features);
+
+#if FEATURE_BENCH == 1
+    PROFILER_TIMER->TASKS_CAPTURE[3] = 1;
+    feature_ticks = PROFILER_TIMER->CC[3] - PROFILER_TIMER->CC[2];
+    //Profiler timer runs at 16 MHz, CPU at 64 MHz
+    log_printf("%s conversion %d, features %d cycles per sample\n",
+        (LSM6DS3_FLOAT_CONV == 1)? "Float" : "Q15",
+        (conv_ticks * 4) / sample_cnt, (feature_ticks * 4) / sample_cnt);
+#endif
+
+    log_printf("Mag %d mg, peak %d mg, peaks %d, activity %d\n", features.mag_mean_mg,
+        features.mag_peak_mg, features.peak_cnt, features.activity);
+    block_max_res_acce = features.mag_peak_mg / 10;
 }
 
 void ms_timer_handler ()
 {
-    static uint32_t curr_res_acce = 0;
-    static uint32_t max_res_acce = 0;
     static uint32_t res_acce_loc = 0;
     static uint32_t arr_smoke_val[10];
     static uint32_t curr_avg_smoke_val_x100 = 0;
-    lsm_100ms_handler ();
-    curr_res_acce = my_sqrt ((x_data * x_data) + (y_data * y_data) + (z_data * z_data))/1000;
     arr_smoke_val[res_acce_loc] = simple_adc_get_value (SIMPLE_ADC_GAIN1_6, ANI_SMOKE_PIN);
-    if(curr_res_acce > max_res_acce)
-    {
-        max_res_acce = curr_res_acce;
-    }
     if(res_acce_loc == 9)
     {   
-        ble_data.avg_acce = max_res_acce;
-        max_res_acce = 0;
+        ble_data.avg_acce = block_max_res_acce;
         curr_avg_smoke_val_x100 = avg_uint32_x100 (arr_smoke_val, 10);
         ble_data.avg_smoke = curr_avg_smoke_val_x100 / 100;
     }
@@ -205,7 +204,11 @@ int main(void)
 
     ms_timer_init(APP_IRQ_PRIORITY_LOWEST);
     lfclk_init (LFCLK_SRC_Xtal);
+#if FEATURE_BENCH == 1
+    profiler_timer_init ();
+#endif
     LSM6DS3_init();
+    LSM6DS3_FIFO_stream_start (APP_IRQ_PRIORITY_LOW, lsm_block_handler);
     {
         lsm_ble_stack_init ();
         lsm_ble_gap_params_init ();
@@ -48,6 +48,9 @@
 #include "radio_drv.h"
 #include "cc1x_utils.h"
 #include "cc112x_def.h"
+#if RF_BENCH == 1
+#include "rf_bench.h"
+#endif
 
 
 /**
@@ -65,13 +68,6 @@ uint16_t start_pkt_no = 0;
 
 int32_t rssi_sum = 0;
 
-/**
-* @brief Preemption priority IRQ
-*/
-#define GPIOTE_CHANNEL_USED 0
-
-#define GPIO_PIN GPIO0
-
 #define TEST_DURATION_S 100
 
 #define TEST_DURATION_MS TEST_DURATION_S*1000
@@ -132,6 +128,25 @@ void ms_timer_10ms (void)
 {
 }
 
+#if RF_BENCH == 1
+#if RF_BENCH_PAYLOAD_LEN > RADIO_PKT_MAX_LEN
+#error "RF_BENCH_PAYLOAD_LEN must fit in a packet of the radio driver"
+#endif
+
+/** Interval at which the benchmark statistics are updated over BLE */
+#define BENCH_UPDATE_MS     1000
+
+void bench_update_handler (void)
+{
+    rf_bench_stats_t stats;
+    rf_bench_stats_get (&stats);
+    log_printf ("Rx %d, corrupt %d, lost %d, PER %d.%02d %%, %d B/s, gap %d +- %d us\n",
+        stats.rx_cnt, stats.corrupt_cnt, stats.lost_cnt, stats.per_x100/100,
+        stats.per_x100%100, stats.throughput_bps, stats.gap_mean_us, stats.gap_jitter_us);
+    rf_rx_ble_update_bench_stats (&stats);
+}
+#endif
+
 void on_connect ()
 {
     is_connected = true;
@@ -154,71 +169,24 @@ void slumber(void)
     }
 }
 
-void start_rx(void)
+void radio_evt_handler (radio_evt_t evt)
 {
-    bool break_now = false;
-    do{
-//        S2LPGpioInit(&xGpioIRQ);
-//        S2LPCmdStrobeRx();
-
-//        S2LPGpioIrqGetStatus((S2LPIrqs*) &irqs);
-//        log_printf ("Rx? I0x%X S0x%X", irqs, g_xStatus);
-//        if(g_xStatus.MC_STATE == MC_STATE_RX)
-//        if(radio_check_status_flag (MARC_NO_FAILURE))
-        {
-            break_now = true;
-//            log_printf(" Yay\n");
-        }
-        radio_receive_on (); 
-//        else
-//        {
-//            log_printf(" Nay\n");
-//            log_printf("Reset..!!");
-//            uint8_t is_sd_enabled;
-//            sd_softdevice_is_enabled(&is_sd_enabled);
-//            if(is_sd_enabled == 0)
-//            {
-//                sd_nvic_SystemReset();
-//            }
-//            else
-//            {
-//                NVIC_SystemReset ();
-//            }
-//        }
-
-    } while(break_now == false);
-}
+    radio_pkt_t * p_pkt;
 
-void GPIOTE_IRQHandler ()
-{
-    NRF_GPIOTE->EVENTS_IN[GPIOTE_CHANNEL_USED] = 0;
-//    log_printf("%s\n",__func__);
-    if(radio_check_status_flag (MARC_NO_FAILURE) )
+    if(evt == RADIO_EVT_RX_DROPPED)
     {
-//        hal_nop_delay_ms(100);
-//        rx_started = true;
-//        log_printf("Data Recieved : %d dBm\n", S2LPRadioGetRssidBm ());
-//            if(rx_started == false)
-//            {
-//                ms_timer_start (MS_TIMER1, MS_REPEATED_CALL, MS_TIMER_TICKS_MS(50), ms_timer_handler);
-//            }
-//            rx_started = true;
+        log_printf ("*** Data not ready.\n");
+    }
 
+    while((p_pkt = radio_pkt_get ()) != NULL)
+    {
         hal_gpio_pin_toggle (LED_BLUE);
-        
-        /* Read the RX FIFO */
-//        S2LPSpiReadFifo(cRxData, (uint8_t *)&current_pkt_no);
-        
-        cRxData = sizeof(vectcRxBuff);
-        radio_read (vectcRxBuff, (uint8_t *)&cRxData);
-        /* Flush the RX FIFO */
-//        for(uint32_t i =0; i < cRxData; i++)
-//        {
-//            log_printf("%x  ", vectcRxBuff[i]);
-//        }
-//        log_printf("\n");
-
-        current_pkt_no = vectcRxBuff[0] | (vectcRxBuff[1] << 8);
+#if RF_BENCH == 1
+        rf_bench_stats_add (p_pkt->data, p_pkt->len, p_pkt->rssi,
+            p_pkt->crc_ok, ms_timer_get_current_count ());
+#endif
+
+        current_pkt_no = p_pkt->data[0] | (p_pkt->data[1] << 8);
         pkt_no++;
         if(is_timer_on == false)
         {
@@ -229,26 +197,17 @@ void GPIOTE_IRQHandler ()
             start_pkt_no = current_pkt_no;
         }
         log_printf("Test Val : %d\n", current_pkt_no);
-//        S2LPGpioIrqClearStatus();
-        log_printf("RSSI : %d\n", (int8_t)radio_get_rssi ());
+        log_printf("RSSI : %d, LQI : %d\n", p_pkt->rssi, p_pkt->lqi);
 //        if(is_connected)
         {
-            ble_data.rf_rx_rssi = (uint8_t)radio_get_rssi ();
+            ble_data.rf_rx_rssi = (uint8_t) p_pkt->rssi;
             ble_data.pkt_no = current_pkt_no;
-            ble_data.CRC_ERR = (uint8_t) radio_check_status_flag (MARC_PKT_DISC_CRC);
+            ble_data.CRC_ERR = (p_pkt->crc_ok == false);
             rf_rx_ble_update_status_byte (&ble_data);
         }
         rssi_sum += ble_data.rf_rx_rssi;
+        radio_pkt_release ();
     }
-    else
-    {
-//        uint32_t irqs;
-//        S2LPGpioIrqGetStatus((S2LPIrqs*) &irqs);
-//        S2LPRefreshStatus();
-        log_printf ("*** Data not ready.\n");
-    }
-
-    start_rx();
 }
 /**
  * @brief Function for application main entry.
@@ -273,16 +232,19 @@ int main(void)
 //    hal_gpio_pin_set (SDN);
 //    hal_nop_delay_ms (1);
 //    hal_gpio_pin_clear (SDN);
+#if RF_BENCH == 1
+    radio_init(RF_BENCH_RADIO_CFG);
+    radio_set_freq (915000);
+    set_rf_packet_length (RF_BENCH_PAYLOAD_LEN);
+    rf_bench_stats_start ();
+#else
     radio_init(4);
     radio_set_freq (915000);
     set_rf_packet_length (2);
+#endif
 
     hal_gpio_cfg_output (LNA_EN_PIN, 1);
-    hal_gpio_cfg_input (GPIO_PIN, HAL_GPIO_PULL_DOWN);
-    NRF_GPIOTE->CONFIG[GPIOTE_CHANNEL_USED] = ((GPIOTE_CONFIG_MODE_Event << GPIOTE_CONFIG_MODE_Pos) & GPIOTE_CONFIG_MODE_Msk) |
-        ((GPIOTE_CONFIG_POLARITY_HiToLo << GPIOTE_CONFIG_POLARITY_Pos)&GPIOTE_CONFIG_POLARITY_Msk) |
-        ((GPIO_PIN << GPIOTE_CONFIG_PSEL_Pos) & GPIOTE_CONFIG_PSEL_Msk);
-    NRF_GPIOTE->INTENSET = (GPIOTE_INTENSET_IN0_Enabled<<GPIOTE_INTENSET_IN0_Pos)&GPIOTE_INTENSET_IN0_Msk;
+    radio_evt_init (APP_IRQ_PRIORITY_LOW, radio_evt_handler);
 
 //    S2LPGpioInit(&xGpioIRQ);  
 //    S2LPRadioInit(&xRadioInit);
@@ -315,13 +277,12 @@ int main(void)
     ble_data.rf_rx_rssi = 0;
     rf_rx_ble_update_status_byte (&ble_data);
 
-    start_rx();
+    radio_receive_async ();
+#if RF_BENCH == 1
+    ms_timer_start (MS_TIMER1, MS_REPEATED_CALL, MS_TIMER_TICKS_MS(BENCH_UPDATE_MS), bench_update_handler);
+#endif
 
     log_printf("Here..!!\n");
-    NRF_GPIOTE->EVENTS_IN[GPIOTE_CHANNEL_USED] = 0;
-    NVIC_SetPriority (GPIOTE_IRQn, APP_IRQ_PRIORITY_LOW);
-    NVIC_ClearPendingIRQ (GPIOTE_IRQn);
-    NVIC_EnableIRQ (GPIOTE_IRQn);
     while(1)
     {
         slumber ();
@@ -48,6 +48,8 @@ const uint8_t device_name[] = { DEVICE_NAME_CHAR };
 #define BTDONGLE_UUID_SYSINFO         0xdc71
 /** The 16 bit UUID of the read-write Config characteristic */
 #define BTDONGLE_UUID_CONFIG          0xdc72
+/** The 16 bit UUID of the read-only benchmark statistics characteristic */
+#define BTDONGLE_UUID_BENCH           0xdc73
 
 /**< Interval between advertisement packets (0.5 seconds). */
 #define ADVERTISING_INTERVAL       MSEC_TO_UNITS(500, UNIT_0_625_MS)
@@ -89,6 +91,12 @@ uint16_t h_rf_rx_service;
  * the system information containing @ref rf_rx_dev_info*/
 ble_gatts_char_handles_t h_status_byte;
 
+#if RF_BENCH == 1
+/** Handle to specify the attribute of the characteristic with the
+ * benchmark statistics @ref rf_bench_stats_t */
+ble_gatts_char_handles_t h_bench_stats;
+#endif
+
 /** Handle to specify the attribute of the characteristic with the
  * configuration parameters which are specified @ref rf_rx_config_t */
 //ble_gatts_char_handles_t h_config_char;
@@ -288,6 +296,17 @@ void rf_rx_ble_service_init(void)
         h_rf_rx_service, &char_md, &attr_char_value, &h_status_byte);
     APP_ERROR_CHECK(err_code);
 
+#if RF_BENCH == 1
+    /**** Create the read-only benchmark statistics characteristic *****/
+    ble_uuid.uuid = (BTDONGLE_UUID_BENCH);
+
+    attr_char_value.init_len = sizeof(rf_bench_stats_t);
+    attr_char_value.max_len = sizeof(rf_bench_stats_t);
+
+    err_code = sd_ble_gatts_characteristic_add(
+        h_rf_rx_service, &char_md, &attr_char_value, &h_bench_stats);
+    APP_ERROR_CHECK(err_code);
+#endif
 }
 
 void rf_rx_ble_gap_params_init(void)
@@ -398,3 +417,19 @@ void rf_rx_ble_update_status_byte (mod_ble_data_t * status_byte)
 //    err_code = sd_ble_gatts_hvx (h_conn, &params);
 //    APP_ERROR_CHECK(err_code);
 }
+
+#if RF_BENCH == 1
+void rf_rx_ble_update_bench_stats (rf_bench_stats_t * p_stats)
+{
+    uint32_t err_code;
+    ble_gatts_value_t val =
+    {
+        .len = sizeof(rf_bench_stats_t),
+        .offset = 0,
+        .p_value =(uint8_t *) p_stats
+    };
+    err_code = sd_ble_gatts_value_set(h_conn,
+            h_bench_stats.value_handle, &val);
+    APP_ERROR_CHECK(err_code);
+}
+#endif
@@ -23,6 +23,9 @@
 #include "stdbool.h"
 #include "ble.h"
 #include "dev_id_fw_ver.h"
+#if RF_BENCH == 1
+#include "rf_bench.h"
+#endif
 
 typedef struct
 {
@@ -82,4 +85,12 @@ bool rf_rx_is_bt_on ();
 
 void rf_rx_ble_update_status_byte(mod_ble_data_t * status_byte);
 
+#if RF_BENCH == 1
+/**
+ * @brief Function to update the benchmark statistics read by the host
+ * @param p_stats Pointer to the statistics of the ongoing run
+ */
+void rf_rx_ble_update_bench_stats(rf_bench_stats_t * p_stats);
+#endif
+
 #endif /* BT_DONGLE_BLE_H */
@@ -46,6 +46,12 @@
 #include "cc1x_utils.h"
 #include "cc112x_def.h"
 #include "spi_rf_nrf52.h"
+#if RF_BENCH == 1
+#include "rf_bench.h"
+#endif
+#if RF_LBT == 1
+#include "radio_lbt.h"
+#endif
 
 /**
 * @brief Radio structure fitting
@@ -94,10 +100,6 @@
 //    .IRQ_TX_DATA_SENT = 1,
 //};
 
-#define GPIOTE_CHANNEL_USED 0
-
-#define GPIO_PIN GPIO0
-
 
 
 /**
@@ -106,6 +108,67 @@
 //S2LPIrqs xIrqStatus;
 //volatile uint8_t arr_test[2];
 volatile uint16_t test_cnt;
+
+#if RF_LBT == 1
+static void log_lbt_stats (void)
+{
+    radio_lbt_stats_t stats;
+    radio_lbt_stats_get (&stats);
+    log_printf("LBT req %d tx %d busy %d fail %d, access %d us max %d us\n",
+        stats.req_cnt, stats.tx_cnt, stats.busy_cnt, stats.fail_cnt,
+        stats.access_mean_us, stats.access_max_us);
+}
+
+void radio_lbt_done_handler (radio_lbt_result_t result)
+{
+    if(result == RADIO_LBT_CHANNEL_BUSY)
+    {
+        log_printf("Channel busy, packet dropped\n");
+    }
+}
+#endif
+
+/** Send a packet directly or once the channel is clear, 0 if accepted */
+static int rf_send (uint8_t * p_data, uint32_t len)
+{
+#if RF_LBT == 1
+    return (radio_lbt_send (p_data, len) == true) ? 0 : -1;
+#else
+    return radio_send_async (p_data, len);
+#endif
+}
+
+#if RF_BENCH == 1
+#if RF_BENCH_PAYLOAD_LEN > RADIO_PKT_MAX_LEN
+#error "RF_BENCH_PAYLOAD_LEN must fit in a packet of the radio driver"
+#endif
+
+void ms_timer_handler ()
+{
+    uint8_t pkt[RF_BENCH_PAYLOAD_LEN];
+
+    if(test_cnt == RF_BENCH_PKT_CNT)
+    {
+        ms_timer_stop (MS_TIMER1);
+        log_printf("Benchmark done, %d packets\n", test_cnt);
+#if RF_LBT == 1
+        log_lbt_stats ();
+#endif
+        return;
+    }
+
+    rf_bench_pkt_fill (pkt, sizeof(pkt), test_cnt);
+    if(rf_send (pkt, sizeof(pkt)) == 0)
+    {
+        test_cnt++;
+    }
+    else
+    {
+        //Sent in the next interval, the packet is late but not lost
+        log_printf("Radio busy\n");
+    }
+}
+#else
 void ms_timer_handler ()
 {
 //    log_printf("%s \n",__func__);
@@ -119,7 +182,16 @@ void ms_timer_handler ()
 //    radio_send ((uint8_t *)arr_test, sizeof(arr_test));
     
     test_cnt++;
-    radio_send ((uint8_t *)&test_cnt, sizeof(test_cnt));
+    if(rf_send ((uint8_t *)&test_cnt, sizeof(test_cnt)) != 0)
+    {
+        log_printf("Radio busy\n");
+    }
+#if RF_LBT == 1
+    if((test_cnt % 32) == 0)
+    {
+        log_lbt_stats ();
+    }
+#endif
 //    radio_transmit ();
 //    radio_prepare ((unsigned char *)arr_test, (uint16_t)sizeof(arr_test));
     
@@ -131,6 +203,7 @@ void ms_timer_handler ()
 //    S2LPGpioInit(&xGpioIRQ);  
 //    S2LPCmdStrobeTx();
 }
+#endif
 
 /** @brief Configure the RGB LED pins as output and turn off LED */
 static void rgb_led_init(void)
@@ -183,19 +256,12 @@ void ms_timer_10ms (void)
 //}
 //
 
-void GPIOTE_IRQHandler ()
+void radio_evt_handler (radio_evt_t evt)
 {
-    log_printf("%s\n",__func__);
-    NRF_GPIOTE->EVENTS_IN[GPIOTE_CHANNEL_USED] = 0;
-    hal_gpio_pin_toggle (LED_RED);
-//    S2LPGpioInit(&xGpioIRQ);  
-    if(radio_check_status_flag (MARC_NO_FAILURE) )
+    if(evt == RADIO_EVT_TX_DONE)
     {
+        hal_gpio_pin_toggle (LED_RED);
         log_printf("Data sent\n");
-//        hal_gpio_pin_clear (PA_EN_PIN);
-            trxSpiCmdStrobe (SFTX);
-
-//        S2LPGpioIrqClearStatus();
     }
 }
 /**
@@ -218,26 +284,30 @@ int main(void)
     test_cnt = 0;
 //    S2LPSpiInit ();
 
+#if RF_BENCH == 1
+    radio_init(RF_BENCH_RADIO_CFG);
+    radio_set_freq (915000);
+    set_rf_packet_length (RF_BENCH_PAYLOAD_LEN);
+#else
     radio_init(4);
     radio_set_freq (915000);
 //    set_rf_packet_length ((unsigned char)sizeof(arr_test));
 //    radio_prepare ((unsigned char *)&test_cnt, (uint16_t)sizeof(test_cnt));
     set_rf_packet_length (sizeof(test_cnt));
+#endif
     log_printf("Here..!!\n");
     hal_gpio_cfg_output (PA_EN_PIN, 1);
 
-    hal_gpio_cfg_input (GPIO_PIN, HAL_GPIO_PULL_DISABLED);
-    NRF_GPIOTE->CONFIG[GPIOTE_CHANNEL_USED] = ((GPIOTE_CONFIG_MODE_Event << GPIOTE_CONFIG_MODE_Pos) & GPIOTE_CONFIG_MODE_Msk) |
-        ((GPIOTE_CONFIG_POLARITY_HiToLo << GPIOTE_CONFIG_POLARITY_Pos)&GPIOTE_CONFIG_POLARITY_Msk) |
-        ((GPIO_PIN << GPIOTE_CONFIG_PSEL_Pos) & GPIOTE_CONFIG_PSEL_Msk);
-    NRF_GPIOTE->INTENSET = (GPIOTE_INTENSET_IN0_Enabled<<GPIOTE_INTENSET_IN0_Pos)&GPIOTE_INTENSET_IN0_Msk;
+    radio_evt_init (APP_IRQ_PRIORITY_LOW, radio_evt_handler);
+#if RF_LBT == 1
+    radio_lbt_init (radio_lbt_done_handler);
+#endif
 
+#if RF_BENCH == 1
+    ms_timer_start (MS_TIMER1, MS_REPEATED_CALL, MS_TIMER_TICKS_MS(RF_BENCH_INTERVAL_MS), ms_timer_handler);
+#else
         ms_timer_start (MS_TIMER1, MS_REPEATED_CALL, MS_TIMER_TICKS_MS(1000), ms_timer_handler);
-
-    NRF_GPIOTE->EVENTS_IN[GPIOTE_CHANNEL_USED] = 0;
-    NVIC_SetPriority (GPIOTE_IRQn, APP_IRQ_PRIORITY_LOW);
-    NVIC_ClearPendingIRQ (GPIOTE_IRQn);
-    NVIC_EnableIRQ (GPIOTE_IRQn);
+#endif
 
 //    ms_timer_start (MS_TIMER2, MS_REPEATED_CALL, MS_TIMER_TICKS_MS(10), ms_timer_10ms);
     while(1)
@@ -58,6 +58,10 @@
 #include "sensepi_ble.h"
 #include "sensepi_cam_trigger.h"
 #include "dev_id_fw_ver.h"
+#include "adv_telemetry.h"
+#include "nvm_logger.h"
+#include "trigger_log.h"
+#include "ble_conn_params.h"
 #include "sensepi_store_config.h"
 #include "hal_nvmc.h"
 
@@ -86,9 +90,18 @@ const uint8_t app_device_name[] = { APP_DEVICE_NAME_CHAR };
                            0x02, BLE_GAP_AD_TYPE_TX_POWER_LEVEL, 0   ,     \
                            0x11, BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME,  \
                            'x', 'x','x', 'x', 'x', 'x' , 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',   \
-                           0x04, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, 0 ,  0 , 0 \
+                           0x09, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, 0 ,  0 , 0 ,  \
+                           0, 0, 0, 0, 0 \
                        }
 
+/** Position of the telemetry in the scan response payload, after the
+ *  firmware version in the manufacturer specific data */
+#define SCAN_RSP_TELEMETRY_POS      26
+
+/** Battery value below which it is flagged as low in the telemetry. The 8 bit
+ *  value is VDD*255/3.6, so this is about 2.2 V */
+#define BATTERY_LOW_VAL             156
+
 /** The WDT bites if not fed every 301 sec (5 min)
  * @warning All the tick intervals must be lower than this*/
 #define WDT_PERIOD_MS              301000
@@ -96,6 +109,9 @@ const uint8_t app_device_name[] = { APP_DEVICE_NAME_CHAR };
 /** Flag to specify if the Watchdog timer is used or not */
 #define ENABLE_WDT                 1
 
+/** ID of the log of the triggers in the NVM logger */
+#define TRIGGER_LOG_NVM_ID         0
+
 /** The interval at which the PIR sensor's signal is sampled.
  * 20 Hz interval is chosen so that as per Nyquist's criterion
  * signals up to 10 Hz can be sensed. */
@@ -118,7 +134,8 @@ const uint8_t app_device_name[] = { APP_DEVICE_NAME_CHAR };
 /** The slow tick interval in ms in the Connected mode */
 #define CONN_SLOW_TICK_INTERVAL_MS  1100
 
-/** The time in ms (min*sec*ms) to timeout of the Connected mode*/
+/** The time in ms (min*sec*ms) to timeout of the Connected mode, even if
+ *  the link is in use. An idle link is dropped by ble_conn_params earlier. */
 #define CONN_TIMEOUT_MS             (10*60*1000)
 
 /** Defines the states possible in the SensePi device */
@@ -189,6 +206,14 @@ void prepare_init_ble_adv()
     //Add in the firmware version
     memcpy(&app_scan_rsp_data[23], fw_ver_get(), sizeof(fw_ver_t));
 
+    //Add the telemetry
+    uint8_t battery = aa_aaa_battery_status();
+    adv_telemetry_set_battery(battery);
+    trigger_log_set_battery(battery);
+    adv_telemetry_set_flags(ADV_TELEMETRY_FLAG_LOW_BATT,
+            (battery < BATTERY_LOW_VAL));
+    adv_telemetry_encode(&app_scan_rsp_data[SCAN_RSP_TELEMETRY_POS]);
+
     //Add the device ID
     memcpy(&app_scan_rsp_data[5], dev_id_get(), sizeof(dev_id_t));
     
@@ -239,6 +264,7 @@ static void ble_evt_handler(ble_evt_t * evt)
  */
 static void get_sensepi_config_t(sensepi_config_t *config)
 {
+    adv_telemetry_set_flags(ADV_TELEMETRY_FLAG_DEFAULT_CFG, false);
     log_printf("Trig mode %d, PIR ope time %08x, PIR mode %08x, PIR amp %d, PIR thres %d, \
              PIR int trig time %04d, Timer oper %x, Timer mode %x, timer interval %04d \n",
             config->trig_conf, config->pir_conf.oper_time, config->pir_conf.mode,
@@ -257,6 +283,7 @@ void next_interval_handler(uint32_t interval)
 {
     log_printf("in %d\n", interval);
     button_ui_add_tick(interval);
+    adv_telemetry_add_tick(interval);
     switch(current_state)
     {
     case SENSING:
@@ -266,11 +293,20 @@ void next_interval_handler(uint32_t interval)
     }
         break;
     case ADVERTISING:
+    {
+        uint8_t telemetry[ADV_TELEMETRY_LEN];
+        if(adv_telemetry_encode(telemetry))
+        {
+            sensepi_ble_adv_update_scan_rsp(SCAN_RSP_TELEMETRY_POS,
+                    telemetry, ADV_TELEMETRY_LEN);
+        }
+    }
         break;
     case CONNECTED:
     {
         conn_count += interval;
-        if(conn_count > MS_TIMER_TICKS_MS(CONN_TIMEOUT_MS))
+        if((ble_conn_params_add_ticks(interval) == true) ||
+                (conn_count > MS_TIMER_TICKS_MS(CONN_TIMEOUT_MS)))
         {
             sensepi_ble_disconn();
         }
@@ -462,10 +498,12 @@ void boot_pwr_config(void)
     if(NRF_POWER->RESETREAS & POWER_RESETREAS_DOG_Msk)
     {
         log_printf("watchdog bite, ");
+        adv_telemetry_set_flags(ADV_TELEMETRY_FLAG_WDT_RESET, true);
     }
     if(NRF_POWER->RESETREAS & POWER_RESETREAS_LOCKUP_Msk)
     {
         log_printf("CPU lockup, ");
+        adv_telemetry_set_flags(ADV_TELEMETRY_FLAG_CPU_LOCKUP, true);
     }
     if(NRF_POWER->RESETREAS & POWER_RESETREAS_OFF_Msk)
     {
@@ -503,6 +541,7 @@ void load_last_config()
 {
     if(sensepi_store_config_is_memory_empty())
     {
+        adv_telemetry_set_flags(ADV_TELEMETRY_FLAG_DEFAULT_CFG, true);
         sensepi_store_config_write (&sensepi_ble_default_config);
     }
     sensepi_cam_trigger_update (sensepi_store_config_get_last_config ());
@@ -556,6 +595,10 @@ int main(void)
         irq_msg_init(&cb);
     }
     sensepi_cam_trigger_init(&sensepi_cam_trigger_default_config);
+#if TRIGGER_LOG == 1
+    nvm_logger_mod_init();
+    trigger_log_init(TRIGGER_LOG_NVM_ID);
+#endif
 
     current_state = ADVERTISING; //So that a state change happens
     irq_msg_push(MSG_STATE_CHANGE, (void *)SENSING);
@@ -569,6 +612,7 @@ int main(void)
         hal_wdt_feed();
 #endif
         device_tick_process();
+        trigger_log_process();
         irq_msg_process();
         slumber();
     }
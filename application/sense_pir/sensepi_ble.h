@@ -201,6 +201,16 @@ void sensepi_ble_adv_init(sensepi_ble_adv_data_t * sensepi_ble_adv_data);
  */
 void sensepi_ble_adv_start(void);
 
+/**
+ * @brief Function to change a part of the scan response data while
+ *  advertising, without stopping it. Used for the telemetry of the device.
+ * @param offset Offset in the scan response data given at init
+ * @param p_data Pointer to the new bytes
+ * @param len Number of bytes to be changed
+ */
+void sensepi_ble_adv_update_scan_rsp(uint32_t offset, const uint8_t * p_data,
+        uint32_t len);
+
 #endif /* APPLICATION_SENSE_PIR_SENSEPI_BLE_H_ */
 
 /**
@@ -26,6 +26,7 @@
 #include "ms_timer.h"
 #include "led_ui.h"
 #include "out_pattern_gen.h"
+#include "cam_trigger_plan.h"
 #include "log.h"
 
 #include "hal_pin_analog_input.h"
@@ -42,6 +43,8 @@
 
 #include "boards.h"
 #include "sensepi_store_config.h"
+#include "adv_telemetry.h"
+#include "trigger_log.h"
 
 #define DEBUG_PRINT 0
 
@@ -85,24 +88,12 @@
 /** Mask to separate INPUT2 from rest of the data */
 #define INPUT2_MSK 0xFF000000
 
-/** Number of transitions required for single shot operation */
-#define SINGLE_SHOT_TRANSITIONS 2
 /** Ticks duration required for single shot operation */
 #define SINGLE_SHOT_DURATION MS_TIMER_TICKS_MS(250)
-/** Number of transitions required for bulb operation */
-#define BULB_SHOT_TRANSITIONS 2
-/** Number of transitions required for focus operation */
-#define FOCUS_TRANSITIONS 2
-/** Number of transitions required for Video operation triggered by Timer */
-#define TIMER_VIDEO_TRANSITIONS 3
 /** Ticks duration of trigger pulse to start a video */
 #define VIDEO_START_PULSE MS_TIMER_TICKS_MS(250)
-/** Ticks duration of trigger pulse to end a video */
-#define VIDEO_END_PULSE MS_TIMER_TICKS_MS(300)
-/** Number of maximum extensions for Video */
-#define NO_OF_VIDEO_EXTN_ALLOWED 3
-/** Duration for which PIR will be active for video extension */
-#define VIDEO_PIR_ON 2000
+/** Time in ms left between the end of a video and the next timer trigger */
+#define TIMER_VIDEO_MARGIN_MS 1000
 
 /**
  * @brief Enum of different types of camera triggering.
@@ -131,23 +122,16 @@ typedef enum
 {
     PIR_IDLE,
     TIMER_IDLE,
-    VIDEO_IDLE,
     MAX_STATES,
 }
 cam_trig_state_t;
-/** Renaming to use memory location for out_gen_config[TIMER_IDLE] to store a
- *  config for extension as both extension and timer cannot be operated
- *  simultaneously. Renaming is done to avoid confusion.  */
-#define VIDEO_ETXN_CONFIG TIMER_IDLE
 
 /** Copy of configuration to be shared across module */
 static sensepi_cam_trigger_init_config_t config;
 /** PIR configuration which will be used to enable PIR */
 static pir_sense_cfg config_pir;
-/** Array of out_gen_config_t to store pre-calculated configs */
-static out_gen_config_t out_gen_config[MAX_STATES];
-/** Video Extension time in ticks */
-static uint32_t video_extn_ticks;
+/** Array of plans compiled for the PIR and the timer */
+static cam_trigger_plan_t plan[MAX_STATES];
 /** Flag to keep status of PIR's expected state */
 static bool pir_on_flag = false;
 /** The amount of time since starting the SENSING state */
@@ -158,14 +142,6 @@ static bool sense_feedback = false;
 static bool is_light_sense_on = false;
 /** Array which is to be passed while stopping out_gen module */
 static const bool out_gen_end_all_on[OUT_GEN_MAX_NUM_OUT] = {1,1,1,1};
-/** Array which is partially copied while generating out_gen_config for multi-shot */
-static const bool multishot_generic[OUT_GEN_MAX_NUM_OUT][OUT_GEN_MAX_TRANSITIONS] =
-    {
-            {0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1},
-            {0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1},
-            {0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1},
-            {0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1}
-    };
 
 /*PIR related functions*/
 /**
@@ -178,12 +154,7 @@ void pir_set_state(bool state);
  */
 void pir_handler(int32_t adc_val);
 /**
- * @brief PIR handler for Video mode
- * @param adc_val
- */
-void pir_handler_video(int32_t adc_val);
-/**
- * @brief Function to update the out_gen_configs for PIR.
+ * @brief Function to update the plan for PIR.
  */
 void out_gen_config_updater_pir(void);
 
@@ -198,16 +169,23 @@ void timer_set_state(bool state);
  */
 void timer_handler(void);
 /**
- * @brief Function to update the out_gen_configs for Timer.
+ * @brief Function to update the plan for Timer.
  */
 void out_gen_config_updater_timer(void);
 
-/*out_pattern_gen related functions*/
+/*cam_trigger_plan related functions*/
 /**
- * @brief Handler for out pattern generation done.
- * @param out_gen_state State from which handler is called.
+ * @brief Function to fill the description of a plan from the mode of PIR or Timer
+ * @param config_mode Mode with the inputs as sent by the application
+ * @param p_desc Pointer to the description to be filled
  */
-void out_gen_done_handler(uint32_t out_gen_state);
+void plan_desc_fill(uint32_t config_mode, cam_trigger_plan_desc_t * p_desc);
+/**
+ * @brief Handler for the events of the running plan.
+ * @param evt Event of the plan
+ * @param context State for which the plan is compiled.
+ */
+void plan_handler(cam_trigger_plan_evt_t evt, uint32_t context);
 
 /*Light Sense related functions*/
 /**
@@ -242,65 +220,6 @@ void module_manager_start_check(void);
  */
 void module_manager_disable_all(void);
 
-/**
- * @brief Functions to generate out_gen_config according to selected camera
- * trigger mode.
- * @{
- */
-/**
- * @brief Function to click one shot per trigger
- * @param data_process_mode mode for which we have to generate the out_gen_config
- */
-void out_gen_config_single_shot(cam_trig_state_t data_process_mode);
-/**
- * @brief Function to click multiple shots per trigger
- * @param data_process_mode mode for which we have to generate the out_gen_config
- * @param burst_duration Time duration between two shots
- * @param burst_num Number of shots per trigger
- */
-void out_gen_config_multi_shot(cam_trig_state_t data_process_mode, 
-                     uint32_t burst_duration, uint32_t burst_num);
-/**
- * @brief Function to take photo in bulb mode.
- * @param data_process_mode mode for which we have to generate the out_gen_config
- * @param bulb_time Time duration for half press signal
- */
-void out_gen_config_bulb_expo(cam_trig_state_t data_process_mode, uint32_t bulb_time);
-/**
- * @brief Function to do focus only
- * @param data_process_mode mode for which we have to generate the out_gen_config
- */
-void out_gen_config_focus_only(cam_trig_state_t data_process_mode);
-/**
- * @brief Dummy mode which will do nothing i.e keep the signals high
- * @param data_process_mode mode for which we have to generate the out_gen_config
- */
-void out_gen_config_none(cam_trig_state_t data_process_mode);
-//Suggest some good name for this function.
-/**
- * @brief Function to create out_gen_config for the video length for which
- * PIR will be enabled and if no motion is detected during this time video will
- * end
- */
-void out_gen_config_part_video_end();
-/**
- * @brief Function to generate out_gen_config required for extension length
- * @param extn_len Extension length provided by application in sec.
- */
-void out_gen_config_part_video_extn(uint32_t extn_len);
-/**
- * @brief Function to generate out_gen_config required to start a video after PIR
- * triggering with length=video_len-@ref VIDEO_PIR_ON.
- * @param video_len Length of the video without any extensions
- */
-void out_gen_config_part_video_start(uint32_t video_len);
-/**
- * @brief Function to record video of fix length on Timer Triggering
- * @param data_process_mode mode for which we have to generate the out_gen_config
- * @param video_len Video Length in sec.
- */
-void out_gen_config_full_video(cam_trig_state_t data_process_mode, uint32_t video_len);
-
 //function definitions
 /**
  * @brief Function to print expected pattern output from out_gen_pattern
@@ -341,52 +260,26 @@ void pir_handler(int32_t adc_val)
     log_printf("%s", __func__);
     log_printf(" %d\n", adc_val);
     pir_set_state(false);
-    if(out_gen_is_on() == false)
+    if(cam_trigger_plan_is_on() == false)
     {
         if(sense_feedback == true)
         {
             led_ui_single_start(LED_SEQ_PIR_PULSE, LED_UI_HIGH_PRIORITY, true);
         }
-        out_gen_start(&out_gen_config[PIR_IDLE]);
+        adv_telemetry_trig_add();
+        trigger_log_add(TRIGGER_LOG_SRC_PIR,
+                (config.config_sensepi->pir_conf.mode & MODE_MSK), adc_val);
+        cam_trigger_plan_start(&plan[PIR_IDLE], PIR_IDLE);
     }
-}
-
-void pir_handler_video(int32_t adc_val)
-{
-    log_printf("%s", __func__);
-    log_printf(" %d\n", adc_val);
-    pir_set_state(false);
-    static uint32_t no_of_extn_remain;
-    if(out_gen_is_on() == false)
-    {
-        if(sense_feedback == true)
-        {
-            led_ui_single_start(LED_SEQ_PIR_PULSE, LED_UI_HIGH_PRIORITY, true);
-        }
-        no_of_extn_remain = NO_OF_VIDEO_EXTN_ALLOWED;
-        out_gen_start(&out_gen_config[PIR_IDLE]);
-    }
-    else if(no_of_extn_remain > 0)
+    else
     {
-        uint32_t ticks_done = out_gen_get_ticks ();
-        if(ticks_done < video_extn_ticks)
-        {
-            out_gen_config[VIDEO_ETXN_CONFIG].transitions_durations[0] = 
-                (video_extn_ticks  - ticks_done);
-        }
-        else
-        {
-            out_gen_config[VIDEO_ETXN_CONFIG].transitions_durations[0] = 
-                video_extn_ticks;
-        }
-        out_gen_start(&out_gen_config[VIDEO_ETXN_CONFIG]);
-        no_of_extn_remain--;
+        //Extends a video if it is in its last part
+        cam_trigger_plan_extend();
     }
 }
 
-void out_gen_config_updater_pir()
+void plan_desc_fill(uint32_t config_mode, cam_trigger_plan_desc_t * p_desc)
 {
-    uint32_t config_mode = config.config_sensepi->pir_conf.mode;
     uint32_t mode = ((config_mode & MODE_MSK) 
             >> (MODE_POS * SIZE_OF_BYTE));
     uint32_t input1 = ((config_mode & INPUT1_MSK) 
@@ -394,48 +287,62 @@ void out_gen_config_updater_pir()
     uint32_t input2 = ((config_mode & INPUT2_MSK) 
             >> (INPUT2_POS * SIZE_OF_BYTE));
     uint32_t single_input = config_mode>> (INPUT1_POS * SIZE_OF_BYTE);
+
+    p_desc->press_ticks = SINGLE_SHOT_DURATION;
     switch((operational_mode_t)mode)
     {
         case MODE_SINGLE_SHOT:
         {
-            out_gen_config_single_shot(PIR_IDLE);
+            p_desc->mode = CAM_TRIGGER_PLAN_SINGLE_SHOT;
             break;
         }
         case MODE_MULTISHOT:
         {
-            out_gen_config_multi_shot(PIR_IDLE, input1, input2);
+            p_desc->mode = CAM_TRIGGER_PLAN_MULTI_SHOT;
+            p_desc->shot_interval_ticks = MS_TIMER_TICKS_MS(input1 * 100);
+            p_desc->shot_cnt = input2;
             break;
         }
         case MODE_BULB :
         {
             //Using both input 1 and input 2
-            out_gen_config_bulb_expo(PIR_IDLE, single_input);
+            p_desc->mode = CAM_TRIGGER_PLAN_LONG_PRESS;
+            p_desc->len_ticks = MS_TIMER_TICKS_MS(single_input * 100);
             break;
         }
         case MODE_VIDEO :
         {
-            if(input2 == 0)
-            {
-                out_gen_config_full_video (PIR_IDLE, input1);
-            }
-            else
-            {
-                out_gen_config_part_video_start(input1);
-                out_gen_config_part_video_extn(input2);
-                out_gen_config_part_video_end(input2);
-            }
+            p_desc->mode = CAM_TRIGGER_PLAN_VIDEO;
+            p_desc->press_ticks = VIDEO_START_PULSE;
+            p_desc->len_ticks = MS_TIMER_TICKS_MS(input1 * 1000);
+            p_desc->extn_ticks = MS_TIMER_TICKS_MS(input2 * 1000);
             break;
         }
         case MODE_FOCUS :
         {
-            out_gen_config_focus_only(PIR_IDLE);
+            p_desc->mode = CAM_TRIGGER_PLAN_HALF_PRESS;
             break;
         }
         case MODE_NONE:
         {
-            out_gen_config_none(PIR_IDLE);
+            p_desc->mode = CAM_TRIGGER_PLAN_NO_PRESS;
         }
-    }   
+    }
+}
+
+void out_gen_config_updater_pir()
+{
+    cam_trigger_plan_desc_t desc = 
+    {
+        .itt_ticks = MS_TIMER_TICKS_MS(config.config_sensepi->pir_conf.intr_trig_timer * 100),
+    };
+
+    plan_desc_fill(config.config_sensepi->pir_conf.mode, &desc);
+    if(cam_trigger_plan_compile(&desc, &plan[PIR_IDLE]) == false)
+    {
+        log_printf("PIR plan is not as configured\n");
+    }
+    debug_print_bool_array(plan[PIR_IDLE].start.next_out, "PIR plan");
 }
 
 void timer_set_state(bool state)
@@ -457,87 +364,60 @@ void timer_set_state(bool state)
 
 void timer_handler()
 {
-    if(out_gen_is_on () == false)
+    if(cam_trigger_plan_is_on () == false)
     {
-        out_gen_start(&out_gen_config[TIMER_IDLE]);
+        adv_telemetry_trig_add();
+        trigger_log_add(TRIGGER_LOG_SRC_TIMER,
+                (config.config_sensepi->timer_conf.mode & MODE_MSK), 0);
+        cam_trigger_plan_start(&plan[TIMER_IDLE], TIMER_IDLE);
     }
 }
 
 void out_gen_config_updater_timer(void)
 {
-    uint32_t config_mode = config.config_sensepi->timer_conf.mode;
-    uint32_t mode = ((config_mode & MODE_MSK) 
-            >> (MODE_POS * SIZE_OF_BYTE));
-    uint32_t input1 = ((config_mode & INPUT1_MSK) 
-            >> (INPUT1_POS * SIZE_OF_BYTE));
-    uint32_t input2 = ((config_mode & INPUT2_MSK) 
-            >> (INPUT2_POS * SIZE_OF_BYTE));
-    uint32_t single_input = config_mode>> (INPUT1_POS * SIZE_OF_BYTE);
-    switch((operational_mode_t)mode)
+    uint32_t interval_ms = config.config_sensepi->timer_conf.timer_interval * 100;
+    //The next trigger of the timer starts the next plan
+    cam_trigger_plan_desc_t desc = 
     {
-        case MODE_SINGLE_SHOT:
-        {
-            out_gen_config_single_shot(TIMER_IDLE);
-            break;
-        }
-        case MODE_MULTISHOT:
-        {
-            out_gen_config_multi_shot(TIMER_IDLE, input1, input2);
-            break;
-        }
-        case MODE_BULB :
-        {
-            //Using both input 1 and input 2
-            out_gen_config_bulb_expo(TIMER_IDLE, single_input);
-            break;
-        }
-        case MODE_VIDEO :
-        {
-            out_gen_config_full_video(TIMER_IDLE,input1);
-            break;
-        }
-        case MODE_FOCUS :
-        {
-            out_gen_config_focus_only(TIMER_IDLE);
-            break;
-        }
-        case MODE_NONE:
-        {
-            out_gen_config_none(PIR_IDLE);
-        }
-    }   
+        .itt_ticks = 0,
+    };
+
+    plan_desc_fill(config.config_sensepi->timer_conf.mode, &desc);
+    //A video is not extended and must end before the next trigger
+    desc.extn_ticks = 0;
+    if((desc.mode == CAM_TRIGGER_PLAN_VIDEO) && (interval_ms > TIMER_VIDEO_MARGIN_MS) &&
+       (desc.len_ticks > MS_TIMER_TICKS_MS(interval_ms - TIMER_VIDEO_MARGIN_MS)))
+    {
+        desc.len_ticks = MS_TIMER_TICKS_MS(interval_ms - TIMER_VIDEO_MARGIN_MS);
+    }
+    if(cam_trigger_plan_compile(&desc, &plan[TIMER_IDLE]) == false)
+    {
+        log_printf("Timer plan is not as configured\n");
+    }
+    debug_print_bool_array(plan[TIMER_IDLE].start.next_out, "Timer plan");
 }
 
-void out_gen_done_handler (uint32_t out_gen_state)
+void plan_handler(cam_trigger_plan_evt_t evt, uint32_t context)
 {
     log_printf("%s",__func__);
-    log_printf(" %d\n", out_gen_state);
-    switch((cam_trig_state_t)out_gen_state)
+    log_printf(" %d %d\n", evt, context);
+    switch(evt)
     {
-        case PIR_IDLE :
+        case CAM_TRIGGER_PLAN_EVT_EXTN_OPEN :
         {
+            //PIR to sense motion to extend the video
             pir_set_state(pir_on_flag);
             break;
         }
-        case TIMER_IDLE : 
+        case CAM_TRIGGER_PLAN_EVT_DONE :
         {
-            if(config.config_sensepi->trig_conf == PIR_AND_TIMER)
+            if((context == PIR_IDLE) || 
+               (config.config_sensepi->trig_conf == PIR_AND_TIMER))
             {
                 pir_set_state(pir_on_flag);
             }
             break;
         }
-        case VIDEO_IDLE :
-        {
-            out_gen_start(&out_gen_config[VIDEO_IDLE]);
-            pir_set_state(pir_on_flag);
-            break;
-        }
-        case MAX_STATES : 
-        {
-            log_printf("Something went seriously wrong..!!\n");
-            break;
-        }
     }
 }
 
@@ -634,268 +514,6 @@ void module_manager_disable_all(void)
     light_sense_set_state(false);
 }
 
-void out_gen_config_single_shot(cam_trig_state_t data_process_mode)
-{
-    log_printf("%s\n", __func__);
-    uint32_t number_of_transition = SINGLE_SHOT_TRANSITIONS;
-    int32_t time_remain;
-
-    if(data_process_mode == PIR_IDLE)
-    {
-        time_remain = MS_TIMER_TICKS_MS(config.config_sensepi->pir_conf.intr_trig_timer * 100) 
-            - (SINGLE_SHOT_DURATION); 
-        if((int32_t)time_remain <= 0)
-        {
-            time_remain = 0;
-        }
-    }
-    else if(data_process_mode == TIMER_IDLE)
-    {
-        time_remain = 0;
-    }
-
-    out_gen_config_t local_out_gen_config = 
-    {
-        .num_transitions = number_of_transition,
-        .done_handler = out_gen_done_handler,
-        .out_gen_state = data_process_mode,
-        .transitions_durations = { SINGLE_SHOT_DURATION, time_remain },
-        .next_out = {{0, 1, 1},
-                     {0, 1, 1}},
-    };
-
-    debug_print_bool_array(local_out_gen_config.next_out, "single shot");
-    memcpy(&out_gen_config[data_process_mode],&local_out_gen_config,
-           sizeof(out_gen_config_t));
-}
-
-void out_gen_config_multi_shot(cam_trig_state_t data_process_mode, 
-                     uint32_t burst_duration, uint32_t burst_num)
-{
-    log_printf("%s\n", __func__);
-    int32_t time_remain;
-    uint32_t number_of_transition = SINGLE_SHOT_TRANSITIONS * burst_num;
-    //Time for trigger pulse and time till next trigger for each burst
-    uint32_t repeat_delay_array[SINGLE_SHOT_TRANSITIONS] = {SINGLE_SHOT_DURATION,
-            MS_TIMER_TICKS_MS(burst_duration * 100) - SINGLE_SHOT_DURATION};
-    out_gen_config_t local_out_gen_config = 
-    {
-        .num_transitions = number_of_transition,
-        .done_handler = out_gen_done_handler,
-        .out_gen_state = data_process_mode,
-    };
-
-    for(uint32_t i = 0; i< burst_num; i++)
-    {
-        memcpy(local_out_gen_config.transitions_durations + i*SINGLE_SHOT_TRANSITIONS,
-                repeat_delay_array, SINGLE_SHOT_TRANSITIONS*sizeof(uint32_t));
-
-        for(uint32_t j = 0; j < NUM_PIN_OUT; j++)
-        {
-            memcpy(*(local_out_gen_config.next_out +j),*(multishot_generic + j),
-                    burst_num* SINGLE_SHOT_TRANSITIONS*sizeof(bool));
-            //An extra '1' at the end for the remaining of the inter-trigger time
-            local_out_gen_config.next_out[j][burst_num* SINGLE_SHOT_TRANSITIONS] = 1;
-        }
-    }
-
-    if(data_process_mode == PIR_IDLE)
-    {
-        time_remain = MS_TIMER_TICKS_MS(config.config_sensepi->pir_conf.intr_trig_timer * 100)
-            - SINGLE_SHOT_DURATION*burst_num -
-            (MS_TIMER_TICKS_MS(burst_duration * 100) - SINGLE_SHOT_DURATION)*(burst_num - 1);  
-        if((int32_t)time_remain <= 0)
-        {
-            time_remain = 1;
-        }
-   }
-    else if(data_process_mode == TIMER_IDLE)
-    {
-        time_remain = 1;
-    }
-    // Last interval for the '1' signal till 'time till next trigger' elapses
-    local_out_gen_config.transitions_durations[number_of_transition-1] = time_remain;
-            
-
-    debug_print_bool_array(local_out_gen_config.next_out, "multi shot");
-    memcpy(&out_gen_config[data_process_mode], &local_out_gen_config,
-           sizeof(out_gen_config_t));
-}
-
-void out_gen_config_bulb_expo(cam_trig_state_t data_process_mode, uint32_t bulb_time)
-{
-    log_printf("%s\n", __func__);
-    int32_t time_remain;
-    uint32_t number_of_transition = BULB_SHOT_TRANSITIONS;
-    uint32_t bulb_time_ticks = MS_TIMER_TICKS_MS((bulb_time*100));
-
-    if(data_process_mode == PIR_IDLE)
-    {
-        time_remain = MS_TIMER_TICKS_MS(config.config_sensepi->pir_conf.intr_trig_timer * 100)
-            - bulb_time_ticks ;
-        if((int32_t)time_remain <= 0)
-        {
-            time_remain = 1;
-        }
-    }
-    else if(data_process_mode == TIMER_IDLE)
-    {
-        time_remain = 0;
-    }
-
-    out_gen_config_t local_out_gen_config = 
-    {
-        .num_transitions = number_of_transition,
-        .done_handler = out_gen_done_handler,
-        .out_gen_state = data_process_mode,
-        .transitions_durations = 
-            {bulb_time_ticks, time_remain},
-        .next_out = { {0, 1, 1},
-                      {0, 1, 1} },
-    };
-
-    debug_print_bool_array(local_out_gen_config.next_out, "bulb mode");
-    memcpy(&out_gen_config[data_process_mode],&local_out_gen_config,
-           sizeof(out_gen_config_t));
-}
-
-void out_gen_config_full_video(cam_trig_state_t data_process_mode, uint32_t video_len)
-{
-    int32_t time_remain;
-    video_len = video_len*1000;
-    if(data_process_mode == TIMER_IDLE)
-    {
-        time_remain = config.config_sensepi->timer_conf.timer_interval*100 -
-            video_len - VIDEO_START_PULSE -VIDEO_END_PULSE;
-    }
-    video_len = (time_remain < 0) ?
-        (config.config_sensepi->timer_conf.timer_interval*100 - 1000) :
-        video_len;
-    out_gen_config_t local_out_gen_config =
-    {
-        .num_transitions = TIMER_VIDEO_TRANSITIONS,
-        .next_out = {{0,1,0,1},
-            {1,1,1,1}},
-        .transitions_durations = {VIDEO_START_PULSE,
-                    MS_TIMER_TICKS_MS(video_len),
-                    VIDEO_END_PULSE},
-        .done_handler = out_gen_done_handler,
-        .out_gen_state = data_process_mode,
-
-    };
-    debug_print_bool_array(local_out_gen_config.next_out, "Timer video mode");
-    memcpy(&out_gen_config[data_process_mode],&local_out_gen_config,
-           sizeof(out_gen_config_t));
-
-   
-}
-
-void out_gen_config_part_video_start(uint32_t video_len)
-{
-    config_pir.handler = pir_handler_video;
-    video_len = video_len * 1000;
-    int video_len_check = video_len  - VIDEO_PIR_ON;
-    video_len = (video_len_check <= 0) ? 0 : video_len_check;
-    out_gen_config_t local_out_gen_config =
-    {
-        .num_transitions = SINGLE_SHOT_TRANSITIONS,
-        .next_out = {{0,1,1}
-        ,{1,1,1}},
-        .transitions_durations = {VIDEO_START_PULSE, 
-                                    (MS_TIMER_TICKS_MS(video_len))},
-        .done_handler = out_gen_done_handler,
-        .out_gen_state = VIDEO_IDLE,
-    };
-    debug_print_bool_array(local_out_gen_config.next_out, "PIR video mode");
-    memcpy(&out_gen_config[PIR_IDLE],&local_out_gen_config,
-           sizeof(out_gen_config_t));    
-}
-
-void out_gen_config_part_video_extn (uint32_t extn_len)
-{
-    video_extn_ticks = MS_TIMER_TICKS_MS(extn_len * 1000);
-    out_gen_config_t local_out_gen_config = 
-    {
-        .num_transitions = 1,
-        .next_out = {{1,1}, {1,1}},
-        .transitions_durations = {video_extn_ticks},
-        .done_handler = out_gen_done_handler,
-        .out_gen_state = VIDEO_IDLE,
-    };
-    debug_print_bool_array(local_out_gen_config.next_out, "PIR video extension");
-    memcpy(&out_gen_config[VIDEO_ETXN_CONFIG],&local_out_gen_config,
-           sizeof(out_gen_config_t));    
-    
-}
-
-void out_gen_config_part_video_end()
-{
-    out_gen_config_t local_out_gen_config = 
-    {
-        .num_transitions = SINGLE_SHOT_TRANSITIONS,
-        .next_out = {{1,0,1},
-            {1,1,1}},
-        .transitions_durations = {MS_TIMER_TICKS_MS(VIDEO_PIR_ON), VIDEO_END_PULSE,},
-        .done_handler = out_gen_done_handler,
-        .out_gen_state = PIR_IDLE,
-    };
-    debug_print_bool_array(local_out_gen_config.next_out, "PIR video mode");
-    memcpy(&out_gen_config[VIDEO_IDLE],&local_out_gen_config,
-           sizeof(out_gen_config_t)); 
-}
-
-void out_gen_config_focus_only(cam_trig_state_t data_process_mode)
-{
-    log_printf("%s\n", __func__);
-    int32_t time_remain;
-    uint32_t number_of_transition = FOCUS_TRANSITIONS;
-
-    if(data_process_mode == PIR_IDLE)
-    {
-        time_remain =  MS_TIMER_TICKS_MS(config.config_sensepi->pir_conf.intr_trig_timer * 100)
-            - SINGLE_SHOT_DURATION ;
-        if((int32_t)time_remain <= 0)
-        {
-            time_remain = 1;
-        }
-    }
-    else if(data_process_mode == TIMER_IDLE)
-    {
-        time_remain = 1;
-    }
-
-    out_gen_config_t local_out_gen_config = 
-    {
-        .num_transitions = number_of_transition,
-        .done_handler = out_gen_done_handler,
-        .out_gen_state = data_process_mode,
-        .transitions_durations =
-        {SINGLE_SHOT_DURATION ,time_remain},
-        .next_out = { {0, 1, 1},
-                      {1, 1, 1} },
-    };
-    
-    debug_print_bool_array(local_out_gen_config.next_out, "focus mode");
-    memcpy(&out_gen_config[data_process_mode],&local_out_gen_config,
-           sizeof(out_gen_config_t));
-}
-
-void out_gen_config_none(cam_trig_state_t data_process_mode)
-{
-    out_gen_config_t local_out_gen_config =
-    {
-        .num_transitions = 1,
-        .done_handler = out_gen_done_handler,
-        .out_gen_state = data_process_mode,
-        .transitions_durations = {1},
-        .next_out = { {1},
-                      {1} },
-    };
-
-    memcpy(&out_gen_config[data_process_mode],&local_out_gen_config,
-           sizeof(out_gen_config_t));
-}
-
 void sensepi_cam_trigger_init(sensepi_cam_trigger_init_config_t * config_sensepi_cam_trigger)
 {
     log_printf("%s\n", __func__);
@@ -913,6 +531,7 @@ void sensepi_cam_trigger_init(sensepi_cam_trigger_init_config_t * config_sensepi
     memcpy(&config_pir, &local_config_pir, sizeof(pir_sense_cfg));
     out_gen_init(NUM_PIN_OUT, config.signal_out_pin_array, 
                  (bool *) out_gen_end_all_on);
+    cam_trigger_plan_init(plan_handler);
 }
 
 void sensepi_cam_trigger_update(sensepi_config_t * update_config)
@@ -1009,7 +628,7 @@ void sensepi_cam_trigger_stop()
 {
     log_printf("%s\n",__func__);
     module_manager_disable_all();
-    out_gen_stop((bool *) out_gen_end_all_on);
+    cam_trigger_plan_stop((bool *) out_gen_end_all_on);
     led_ui_type_stop_all(LED_UI_SINGLE_SEQ);
 }
 
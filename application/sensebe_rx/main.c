@@ -57,9 +57,16 @@
 #include "sensebe_rx_mod.h"
 #include "sensebe_store_config.h"
 #include "dev_id_fw_ver.h"
+#include "adv_telemetry.h"
+#include "adv_beacon.h"
+#include "radio_trigger.h"
+#include "nvm_logger.h"
+#include "trigger_log.h"
+#include "ble_conn_params.h"
 #include "led_seq.h"
 #include "led_ui.h"
 #include "cam_trigger.h"
+#include "latency_trace.h"
 /* ----- Defines ----- */
 
 /**< Name of device, to be included in the advertising data. */
@@ -85,9 +92,24 @@ const uint8_t app_device_name[] = { APP_DEVICE_NAME_CHAR };
                            0x02, BLE_GAP_AD_TYPE_TX_POWER_LEVEL, 0   ,     \
                            0x11, BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME,  \
                            'x', 'x','x', 'x', 'x', 'x' , 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x',   \
-                           0x04, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, 0 ,  0 , 0 \
+                           0x09, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, 0 ,  0 , 0 ,  \
+                           0, 0, 0, 0, 0 \
                        }
 
+/** Position of the telemetry in the scan response payload, after the
+ *  firmware version in the manufacturer specific data */
+#define SCAN_RSP_TELEMETRY_POS      26
+
+/** Battery value below which it is flagged as low in the telemetry. The 8 bit
+ *  value is VDD*255/3.6, so this is about 2.2 V */
+#define BATTERY_LOW_VAL             156
+
+/** The interval in ms of the beacons of the telemetry in the Sense mode */
+#define SENSE_BEACON_INTERVAL_MS    10000
+
+/** The interval in ms at which the battery is read in the Sense mode */
+#define SENSE_BATTERY_INTERVAL_MS   300000
+
 /** The WDT bites if not fed every 301 sec (5 min)
  * @warning All the tick intervals must be lower than this*/
 #define WDT_PERIOD_MS              301000
@@ -95,6 +117,9 @@ const uint8_t app_device_name[] = { APP_DEVICE_NAME_CHAR };
 /** Flag to specify if the Watchdog timer is used or not */
 #define ENABLE_WDT                 1
 
+/** ID of the log of the triggers in the NVM logger */
+#define TRIGGER_LOG_NVM_ID         0
+
 /** The fast tick interval in ms in the Sense mode */
 #define SENSE_FAST_TICK_INTERVAL_MS      60
 /** The slow tick interval in ms in the Sense mode */
@@ -110,7 +135,8 @@ const uint8_t app_device_name[] = { APP_DEVICE_NAME_CHAR };
 /** The slow tick interval in ms in the Connected mode */
 #define CONN_SLOW_TICK_INTERVAL_MS  1100
 
-/** The time in ms (min*sec*ms) to timeout of the Connected mode*/
+/** The time in ms (min*sec*ms) to timeout of the Connected mode, even if
+ *  the link is in use. An idle link is dropped by ble_conn_params earlier. */
 #define CONN_TIMEOUT_MS             (10*60*1000)
 
 /** Defines the states possible in the SensePi device */
@@ -130,6 +156,9 @@ sense_states current_state;
 /** To keep track of the amount of time in the connected state */
 static uint32_t conn_count;
 
+/** To keep track of the time since the battery was read in the Sense mode */
+static uint32_t battery_count;
+
 static sensebe_config_t sensebe_ble_default_config = {
     .tssp_conf.oper_time.day_or_night = 1,
     .tssp_conf.oper_time.threshold = 0b0000000,
@@ -178,17 +207,60 @@ void wdt_prior_reset_callback(void){
     log_printf("WDT reset\n");
 }
 
+/** Read the battery for the telemetry and the trigger log */
+static void battery_update(void)
+{
+    uint8_t battery = aa_aaa_battery_status();
+    adv_telemetry_set_battery(battery);
+    trigger_log_set_battery(battery);
+    adv_telemetry_set_flags(ADV_TELEMETRY_FLAG_LOW_BATT,
+            (battery < BATTERY_LOW_VAL));
+    battery_count = 0;
+}
+
+/**
+ * @brief Add the firmware version and the device ID to the scan response
+ *  payload, which is also the payload of the beacons in the Sense mode
+ * @param p_scan_rsp_data Pointer to the payload of @ref APP_SCAN_RSP_DATA
+ */
+static void scan_rsp_data_fill(uint8_t * p_scan_rsp_data)
+{
+    memcpy(&p_scan_rsp_data[23], fw_ver_get(), sizeof(fw_ver_t));
+    memcpy(&p_scan_rsp_data[5], dev_id_get(), sizeof(dev_id_t));
+}
+
+/** Start the beacons of the telemetry in the Sense mode, while the
+ *  SoftDevice is disabled. The radio is shared with radio_trigger. */
+static void sense_beacon_start(void)
+{
+    uint8_t beacon_data[] = APP_SCAN_RSP_DATA;
+    scan_rsp_data_fill(beacon_data);
+
+    adv_beacon_config_t beacon_config =
+    {
+        .p_adv_data = beacon_data,
+        .adv_len = ARRAY_SIZE(beacon_data),
+        .telemetry_pos = SCAN_RSP_TELEMETRY_POS,
+        .interval_ticks = MS_TIMER_TICKS_MS(SENSE_BEACON_INTERVAL_MS),
+        .radio_claim = radio_trigger_radio_lend,
+        .radio_release = radio_trigger_radio_take_back
+    };
+
+    battery_update();
+    adv_beacon_start(&beacon_config);
+}
+
 void prepare_init_ble_adv()
 {
     uint8_t app_adv_data[] = APP_ADV_DATA;
     uint8_t app_scan_rsp_data[] = APP_SCAN_RSP_DATA;
 
-    //Add in the firmware version
-    memcpy(&app_scan_rsp_data[23], fw_ver_get(), sizeof(fw_ver_t));
+    scan_rsp_data_fill(app_scan_rsp_data);
+
+    //Add the telemetry
+    battery_update();
+    adv_telemetry_encode(&app_scan_rsp_data[SCAN_RSP_TELEMETRY_POS]);
 
-    //Add the device ID
-    memcpy(&app_scan_rsp_data[5], dev_id_get(), sizeof(dev_id_t));
-    
     sensebe_ble_adv_data_t app_adv_data_struct =
     {
         .adv_data = app_adv_data,
@@ -236,6 +308,7 @@ static void ble_evt_handler(ble_evt_t * evt)
  */
 static void get_sensebe_config_t(sensebe_config_t *config)
 {
+    adv_telemetry_set_flags(ADV_TELEMETRY_FLAG_DEFAULT_CFG, false);
     sensebe_tx_rx_update_config (config);
 }
 
@@ -248,6 +321,7 @@ void next_interval_handler(uint32_t interval)
 {
     log_printf("in %d\n", interval);
     button_ui_add_tick(interval);
+    adv_telemetry_add_tick(interval);
     switch(current_state)
     {
     case SENSING:
@@ -255,14 +329,30 @@ void next_interval_handler(uint32_t interval)
         log_printf("Nxt Evt Hndlr : SENSING\n");
         sensebe_tx_rx_add_ticks (interval);
 
+        //For the telemetry of the beacons
+        battery_count += interval;
+        if(battery_count >= MS_TIMER_TICKS_MS(SENSE_BATTERY_INTERVAL_MS))
+        {
+            battery_update();
+        }
+
     }
         break;
     case ADVERTISING:
+    {
+        uint8_t telemetry[ADV_TELEMETRY_LEN];
+        if(adv_telemetry_encode(telemetry))
+        {
+            sensebe_ble_adv_update_scan_rsp(SCAN_RSP_TELEMETRY_POS,
+                    telemetry, ADV_TELEMETRY_LEN);
+        }
+    }
         break;
     case CONNECTED:
     {
         conn_count += interval;
-        if(conn_count > MS_TIMER_TICKS_MS(CONN_TIMEOUT_MS))
+        if((ble_conn_params_add_ticks(interval) == true) ||
+                (conn_count > MS_TIMER_TICKS_MS(CONN_TIMEOUT_MS)))
         {
             sensebe_ble_disconn();
         }
@@ -302,11 +392,14 @@ void state_change_handler(uint32_t new_state)
            
             device_tick_init(&tick_cfg);
             sensebe_tx_rx_start();
+            sense_beacon_start();
 
         }
         break;
     case ADVERTISING:
         {
+            //The radio is freed before the SoftDevice is enabled
+            adv_beacon_stop();
             sensebe_tx_rx_stop ();
             conn_count = 0;
 
@@ -468,10 +561,12 @@ void boot_pwr_config(void)
     if(NRF_POWER->RESETREAS & POWER_RESETREAS_DOG_Msk)
     {
         log_printf("watchdog bite, ");
+        adv_telemetry_set_flags(ADV_TELEMETRY_FLAG_WDT_RESET, true);
     }
     if(NRF_POWER->RESETREAS & POWER_RESETREAS_LOCKUP_Msk)
     {
         log_printf("CPU lockup, ");
+        adv_telemetry_set_flags(ADV_TELEMETRY_FLAG_CPU_LOCKUP, true);
     }
     if(NRF_POWER->RESETREAS & POWER_RESETREAS_OFF_Msk)
     {
@@ -509,6 +604,7 @@ void load_last_config()
 {
     if(sensebe_store_config_is_memory_empty())
     {
+        adv_telemetry_set_flags(ADV_TELEMETRY_FLAG_DEFAULT_CFG, true);
         sensebe_store_config_write (&sensebe_ble_default_config);
     }
     sensebe_tx_rx_update_config (sensebe_store_config_get_last_config ());
@@ -553,6 +649,9 @@ int main(void)
 
     button_ui_init(BUTTON_PIN, APP_IRQ_PRIORITY_LOW,
             button_handler);
+#if SIMPLE_ADC_ASYNC == 1
+    simple_adc_async_init(APP_IRQ_PRIORITY_LOW);
+#endif
 
     {
         irq_msg_callbacks cb =
@@ -561,6 +660,11 @@ int main(void)
     }  
 
     sensebe_tx_rx_init(&default_sensebe_tx_rx_config);
+    latency_trace_init();
+#if TRIGGER_LOG == 1
+    nvm_logger_mod_init();
+    trigger_log_init(TRIGGER_LOG_NVM_ID);
+#endif
 
     current_state = ADVERTISING; //So that a state change happens
     irq_msg_push(MSG_STATE_CHANGE, (void *)SENSING);
@@ -575,6 +679,7 @@ int main(void)
         hal_wdt_feed();
 #endif
         device_tick_process();
+        trigger_log_process();
         irq_msg_process();
         slumber();
     }
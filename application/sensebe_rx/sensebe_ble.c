@@ -27,7 +27,9 @@
 #include "sensebe_ble.h"
 #include "log.h"
 #include "evt_sd_handler.h"
+#include "ble_conn_params.h"
 #include "string.h"
+#include "hal_clocks.h"
 
 #if ISR_MANAGER == 1
 #include "isr_manager.h"
@@ -53,14 +55,6 @@ const uint8_t device_name[] = { DEVICE_NAME_CHAR };
 
 /**< Interval between advertisement packets (0.5 seconds). */
 #define ADVERTISING_INTERVAL       MSEC_TO_UNITS(500, UNIT_0_625_MS)
-/**< Minimum acceptable connection interval (0.2 seconds). */
-#define MIN_CONN_INTERVAL          MSEC_TO_UNITS(200, UNIT_1_25_MS)
-/**< Maximum acceptable connection interval (0.5 second). */
-#define MAX_CONN_INTERVAL          MSEC_TO_UNITS(500, UNIT_1_25_MS)
-/**< Slave latency (number of skippable conn events by the slave). */
-#define SLAVE_LATENCY              0
-/**< Connection supervisory timeout (4 seconds). */
-#define CONN_SUP_TIMEOUT           MSEC_TO_UNITS(4000, UNIT_10_MS)
 
 
 
@@ -82,6 +76,15 @@ ble_gatts_char_handles_t h_sysinfo_char;
  * configuration parameters which are specified @ref sensebe_config_t */
 ble_gatts_char_handles_t h_config_char;
 
+/** Two buffers each for the advertising and the scan response data, as the
+ *  SoftDevice needs new buffers to change the data while advertising */
+static uint8_t adv_data_buf[2][BLE_GAP_ADV_SET_DATA_SIZE_MAX];
+static uint8_t scan_rsp_buf[2][BLE_GAP_ADV_SET_DATA_SIZE_MAX];
+/** Index of the buffers given to the SoftDevice */
+static uint32_t adv_buf_idx;
+/** The advertising data given to the SoftDevice */
+static ble_gap_adv_data_t adv_payload;
+
 /** Handler to pass the BLE SoftDevice events to the application */
 void (* sensebe_ble_sd_evt)(ble_evt_t * evt);
 /** Handler to pass the received SenseBe configuration to the application */
@@ -110,6 +113,8 @@ void SWI1_IRQHandler(void)
 static void ble_evt_handler(ble_evt_t * evt)
 {
     uint32_t err_code;
+
+    ble_conn_params_on_ble_evt(evt);
     switch(evt->header.evt_id)
     {
     case BLE_GAP_EVT_CONNECTED:
@@ -218,6 +223,8 @@ void sensebe_ble_stack_init(void)
     uint32_t err_code;
     const nrf_clock_lf_cfg_t cfg = BOARD_LFCLKSRC_STRUCT;
 
+    //The SoftDevice can't be enabled with the POWER_CLOCK interrupt enabled
+    hfclk_xtal_sd_enable_prepare();
     err_code = sd_softdevice_enable(&cfg, app_error_fault_handler);
     APP_ERROR_CHECK(err_code);
 
@@ -346,7 +353,6 @@ void sensebe_ble_service_init(void)
 void sensebe_ble_gap_params_init(void)
 {
     uint32_t                err_code;
-    ble_gap_conn_params_t   gap_conn_params;
     ble_gap_conn_sec_mode_t sec_mode;
 
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&sec_mode);
@@ -355,15 +361,9 @@ void sensebe_ble_gap_params_init(void)
         &sec_mode, (const uint8_t *)device_name, sizeof(device_name));
     APP_ERROR_CHECK(err_code);
 
-    memset(&gap_conn_params, 0, sizeof(gap_conn_params));
-
-    gap_conn_params.min_conn_interval = MIN_CONN_INTERVAL;
-    gap_conn_params.max_conn_interval = MAX_CONN_INTERVAL;
-    gap_conn_params.slave_latency     = SLAVE_LATENCY;
-    gap_conn_params.conn_sup_timeout  = CONN_SUP_TIMEOUT;
-
-    err_code = sd_ble_gap_ppcp_set(&gap_conn_params);
-    APP_ERROR_CHECK(err_code);
+    //Preferred parameters are those of an idle link, the short interval
+    //is requested when the app is reading or writing
+    ble_conn_params_init();
 }
 
 void sensebe_ble_adv_init(sensebe_ble_adv_data_t * sensebe_ble_adv_data)
@@ -371,12 +371,17 @@ void sensebe_ble_adv_init(sensebe_ble_adv_data_t * sensebe_ble_adv_data)
     h_adv = BLE_GAP_ADV_SET_HANDLE_NOT_SET;
     uint32_t err_code;
     
-    ble_gap_adv_data_t adv_payload;
-
-    adv_payload.adv_data.p_data = sensebe_ble_adv_data->adv_data;
+    //The data is copied as it must be valid as long as it is advertised
+    adv_buf_idx = 0;
+    memcpy(adv_data_buf[0], sensebe_ble_adv_data->adv_data,
+            sensebe_ble_adv_data->adv_len);
+    memcpy(scan_rsp_buf[0], sensebe_ble_adv_data->scan_rsp_data,
+            sensebe_ble_adv_data->scan_rsp_len);
+
+    adv_payload.adv_data.p_data = adv_data_buf[0];
     adv_payload.adv_data.len = sensebe_ble_adv_data->adv_len;
 
-    adv_payload.scan_rsp_data.p_data = sensebe_ble_adv_data->scan_rsp_data;
+    adv_payload.scan_rsp_data.p_data = scan_rsp_buf[0];
     adv_payload.scan_rsp_data.len = sensebe_ble_adv_data->scan_rsp_len;
 
     ble_gap_adv_params_t adv_params;
@@ -418,3 +423,30 @@ void sensebe_ble_adv_start(void)
     APP_ERROR_CHECK(err_code);
 }
 
+void sensebe_ble_adv_update_scan_rsp(uint32_t offset, const uint8_t * p_data,
+        uint32_t len)
+{
+    uint32_t err_code;
+    uint32_t next_idx = adv_buf_idx ^ 1;
+
+    if((h_adv == BLE_GAP_ADV_SET_HANDLE_NOT_SET) ||
+            ((offset + len) > adv_payload.scan_rsp_data.len))
+    {
+        return;
+    }
+
+    memcpy(adv_data_buf[next_idx], adv_data_buf[adv_buf_idx],
+            adv_payload.adv_data.len);
+    memcpy(scan_rsp_buf[next_idx], scan_rsp_buf[adv_buf_idx],
+            adv_payload.scan_rsp_data.len);
+    memcpy(&scan_rsp_buf[next_idx][offset], p_data, len);
+
+    adv_payload.adv_data.p_data = adv_data_buf[next_idx];
+    adv_payload.scan_rsp_data.p_data = scan_rsp_buf[next_idx];
+
+    //Only the data is changed, advertising goes on with the same parameters
+    err_code = sd_ble_gap_adv_set_configure(&h_adv,
+            (ble_gap_adv_data_t const *)&adv_payload, NULL);
+    APP_ERROR_CHECK(err_code);
+    adv_buf_idx = next_idx;
+}
@@ -30,10 +30,16 @@
 #include "device_tick.h"
 #include "cam_trigger.h"
 #include "simple_adc.h"
+#include "aa_aaa_battery_check.h"
+#include "common_util.h"
 #include "string.h"
-#include "hal_nop_delay.h"
 #include "tssp_ir_tx.h"
+#include "tssp_ir_code.h"
 #include "radio_trigger.h"
+#include "adv_telemetry.h"
+#include "adv_beacon.h"
+#include "trigger_log.h"
+#include "latency_trace.h"
 
 /***********MACROS***********/
 /** Time upto which LED feedback is to be given in motion detection mode */
@@ -44,6 +50,8 @@
 #define MAX_ADC_OUTPUT 4096
 /** Cycle time after which light conditions has to be checked */
 #define LIGHT_SENSE_INTERVAL_TICKS MS_TIMER_TICKS_MS(300000)
+/** Time for the light sense module to settle after it is enabled */
+#define LIGHT_SENSE_SETTLE_TICKS MS_TIMER_TICKS_MS(3)
 /** Number of pulses required for sync while module is in motion sync mode.  */
 #define PULSE_REQ_FOR_SYNC 4
 /** On time for TSSP receiver while module is in motion sync mode */
@@ -51,6 +59,24 @@
 /** Off time for TSSP receiver while module is in motion sync mode */
 #define MOTION_SYNC_OFF_TIME 800
 
+/** Wake up interval of the radio receiver in the SenseBe Tx */
+#define RADIO_LISTEN_INTERVAL_MS 50
+/** Listen window of the radio receiver in the SenseBe Tx */
+#define RADIO_LISTEN_WINDOW_US 1000
+/** Margin of the TSSP ticks between pulses for the coded beam, whose pulses
+ *  are delayed from the ticks of the transmitter by up to the code span */
+#if TSSP_IR_CODE_ID != 0
+#define SYNC_CODE_MARGIN_TICKS TSSP_DETECT_TICKS_US(TSSP_IR_CODE_SPAN_US)
+#else
+#define SYNC_CODE_MARGIN_TICKS 0
+#endif
+
+#if LATENCY_BENCH == 1
+/** Minimum time between two detections injected in latency benchmark mode,
+ *  long enough for the camera trigger at the SenseBe Tx to complete */
+#define LATENCY_BENCH_INTERVAL_MS 5000
+#endif
+
 /***********ENUMS***********/
 /** List of states for Motion Detection module. */
 typedef enum
@@ -114,12 +140,18 @@ TSSP_DETECT_TICKS_MS(MOD_FREQ1), TSSP_DETECT_TICKS_MS(MOD_FREQ2), TSSP_DETECT_TI
 static bool arr_is_light_ok [MAX_MODS];
 /**Array of flags to keep track if light check is required or not*/
 static bool arr_is_light_sense_req [MAX_MODS];
+/** The light sense module is enabled and its reading is due */
+static volatile bool is_light_sense_pending;
+/** ms timer count when the light sense module was enabled */
+static volatile uint32_t light_sense_en_count;
 /**Array of module status flag*/
 static bool arr_is_mod_on[MAX_MODS];
 /**Global TSSP configuration which is to be modified and reused.*/
 static tssp_detect_config_t tssp_detect_config;
 /**Global variable to store synchronization time for TSSP detect module*/
 static uint32_t tssp_detect_sync_time;
+/**TSSP ticks of the module frequency which was validated last*/
+static uint32_t validated_sync_ticks;
 /**Global variable used to keep track of motion detection module's state*/
 static motion_detection_states_t motion_state = MOTION_SYNC;
 /**Global variable used to store value after which timer trigger should be generated*/
@@ -128,6 +160,22 @@ static uint32_t timer_module_value = 0;
 static uint32_t light_check_sense_pin = 0;
 /**Global variable to store pin number of Light sensor control pin*/
 static uint32_t light_check_en_pin = 0;
+#if SIMPLE_ADC_ASYNC == 1
+static void light_sense_adc_handler (const uint32_t * p_vals, uint32_t cnt);
+/**Inputs read on each light check, the light sense pin and the battery*/
+static simple_adc_input_cfg_t light_sense_inputs[] =
+{
+    {SIMPLE_ADC_GAIN1_6, ANALOG_VDD},
+    {SIMPLE_ADC_GAIN1_6, ANALOG_VDD},
+};
+/**Request to read the light and the battery together*/
+static const simple_adc_req_t light_sense_req =
+{
+    .p_inputs = light_sense_inputs,
+    .input_cnt = ARRAY_SIZE(light_sense_inputs),
+    .handler = light_sense_adc_handler,
+};
+#endif
 
 /***********FUNCTIONS***********/
 /** Motion Detection Module Related Functions. */
@@ -226,6 +274,9 @@ void add_ticks_feedback (uint32_t interval);
  */
 void module_tick_handler ();
 
+/** Period of the module tick in ms timer ticks */
+static uint32_t module_tick_ticks;
+
 
 /*******************Definitions*******************/
 void add_ticks_feedback (uint32_t interval)
@@ -275,17 +326,22 @@ void timer_trigger_handler ()
 {   
     if(cam_trigger_is_on () == false)
     {
+        adv_telemetry_trig_add ();
+        trigger_log_add (TRIGGER_LOG_SRC_TIMER, MOD_TIMER, 0);
         cam_trigger (MOD_TIMER);
     }
 }
 
 void window_detect_handler ()
 {
+    latency_trace_mark (LATENCY_TRACE_DETECT);
     led_ui_stop_seq (LED_UI_LOOP_SEQ, LED_SEQ_DETECT_PULSE);
     led_ui_single_start (LED_SEQ_DETECT_WINDOW, LED_UI_MID_PRIORITY, true);
     motion_state = MOTION_SYNC;
     arr_state_change[motion_state] ();
     tssp_detect_pulse_detect ();
+    adv_telemetry_trig_add ();
+    trigger_log_add (TRIGGER_LOG_SRC_TSSP, MOD_MOTION, 0);
     cam_trigger (MOD_MOTION);
     radio_trigger_yell ();
 }
@@ -306,8 +362,10 @@ bool validate_and_sync (uint32_t ticks)
 {
     for(uint32_t freq_cmp = 0; freq_cmp < MAX_MOD_FREQ; freq_cmp++)
     {
-        if(compare_margin (ticks, arr_sync_validation_ticks[freq_cmp], TSSP_DETECT_TICKS_MS(1)))
+        if(compare_margin (ticks, arr_sync_validation_ticks[freq_cmp],
+            TSSP_DETECT_TICKS_MS(1) + SYNC_CODE_MARGIN_TICKS))
         {
+            validated_sync_ticks = arr_sync_validation_ticks[freq_cmp];
             return true;
         }
     }
@@ -345,12 +403,22 @@ bool three_window_sync (uint32_t ticks)
     flag = (validate_and_sync (pulse_diff_window[0])
         && validate_and_sync (pulse_diff_window[1])
         && validate_and_sync (pulse_diff_window[2])
-        && compare_margin (pulse_diff_window[1], pulse_diff_window[0], TSSP_DETECT_TICKS_MS(2))
-        && compare_margin (pulse_diff_window[2], pulse_diff_window[1], TSSP_DETECT_TICKS_MS(2)));
+        && compare_margin (pulse_diff_window[1], pulse_diff_window[0],
+            TSSP_DETECT_TICKS_MS(2) + 2*SYNC_CODE_MARGIN_TICKS)
+        && compare_margin (pulse_diff_window[2], pulse_diff_window[1],
+            TSSP_DETECT_TICKS_MS(2) + 2*SYNC_CODE_MARGIN_TICKS));
     
     if(flag == true)
     {
-        tssp_detect_sync_time = pulse_diff_window[1];
+        if(TSSP_IR_CODE_ID != 0)
+        {
+            //The transmitter ticks at its module frequency, the pulses vary by their slots
+            tssp_detect_sync_time = validated_sync_ticks;
+        }
+        else
+        {
+            tssp_detect_sync_time = pulse_diff_window[1];
+        }
         pulse_diff_window[0] = 0;
         pulse_diff_window[1] = 0;
         pulse_diff_window[2] = 0;
@@ -405,37 +473,77 @@ void light_check (oper_time_t oper_time, uint32_t light_intensity, uint32_t modu
     }
 }
 
+/** Check the light for the modules which need it and disable the light sense */
+static void light_sense_update (uint32_t light_intensity)
+{
+    //motion light check
+    if(arr_is_light_sense_req[MOD_MOTION])
+    {
+        light_check (sensebe_config.tssp_conf.oper_time, light_intensity, MOD_MOTION);
+    }
+    
+    //timer light check
+    if(arr_is_light_sense_req[MOD_TIMER])
+    {
+        light_check (sensebe_config.timer_conf.oper_time, light_intensity, MOD_TIMER);
+    }
+
+    //Disable light sense module
+    hal_gpio_pin_clear (light_check_en_pin);
+}
+
+#if SIMPLE_ADC_ASYNC == 1
+static void light_sense_adc_handler (const uint32_t * p_vals, uint32_t cnt)
+{
+    light_sense_update (MAX_ADC_OUTPUT - p_vals[0]);
+    trigger_log_set_battery (aa_aaa_battery_status_from_adc (p_vals[1]));
+}
+#endif
+
 void light_sense_add_ticks (uint32_t interval)
 {
     static uint32_t timepassed = 0;
     timepassed += interval;
-    if(timepassed >= LIGHT_SENSE_INTERVAL_TICKS)
+    if((timepassed >= LIGHT_SENSE_INTERVAL_TICKS) && (is_light_sense_pending == false))
     {
-        static uint32_t light_intensity;
-        //Enable light sense module
+        //Enable light sense module, it is read at a module tick once settled
         hal_gpio_pin_set (light_check_en_pin);
-        //Take light reading
-        hal_nop_delay_ms (3);
-        light_intensity = (MAX_ADC_OUTPUT - simple_adc_get_value (SIMPLE_ADC_GAIN1_6,
-                                                light_check_sense_pin));
-        //motion light check
-        if(arr_is_light_sense_req[MOD_MOTION])
-        {
-            light_check (sensebe_config.tssp_conf.oper_time, light_intensity, MOD_MOTION);
-        }
-        
-        //timer light check
-        if(arr_is_light_sense_req[MOD_TIMER])
-        {
-            light_check (sensebe_config.timer_conf.oper_time, light_intensity, MOD_TIMER);
-        }
-                
-        //Disable light sense module
-        hal_gpio_pin_clear (light_check_en_pin);
+        light_sense_en_count = ms_timer_get_current_count ();
+        is_light_sense_pending = true;
         timepassed = 0;
     }
 }
 
+/** Take the light reading at a module tick, once the light sense module
+ *  enabled has settled */
+static void light_sense_module_tick (void)
+{
+    if((is_light_sense_pending == false) ||
+       (((ms_timer_get_current_count () + (1<<24) - light_sense_en_count) & 0xFFFFFF)
+        < LIGHT_SENSE_SETTLE_TICKS))
+    {
+        return;
+    }
+    is_light_sense_pending = false;
+#if SIMPLE_ADC_ASYNC == 1
+    //The light sense module is disabled from the handler of the reading
+    if(simple_adc_request (&light_sense_req) == false)
+    {
+        hal_gpio_pin_clear (light_check_en_pin);
+    }
+#else
+    light_sense_update (MAX_ADC_OUTPUT - simple_adc_get_value (SIMPLE_ADC_GAIN1_6,
+                                            light_check_sense_pin));
+#endif
+}
+
+/** Disable the light sense module and drop the reading pending, if any */
+static void light_sense_stop (void)
+{
+    is_light_sense_pending = false;
+    hal_gpio_pin_clear (light_check_en_pin);
+}
+
 void motion_module_start ()
 {
     oper_time_t motion_oper_time = sensebe_config.tssp_conf.oper_time;
@@ -466,8 +574,11 @@ void motion_module_start ()
         .comm_direction = RADIO_TRIGGER_Tx,
         .comm_freq = 95,
         .irq_priority = APP_IRQ_PRIORITY_HIGH,
+        .ack_en = true,
         .tx_on_freq_us = 500,
         .tx_on_time_ms = 125,
+        .listen_interval_ms = RADIO_LISTEN_INTERVAL_MS,
+        .listen_window_us = RADIO_LISTEN_WINDOW_US,
     };
     radio_trigger_init (&radio_init);
     
@@ -477,6 +588,7 @@ void motion_module_start ()
 
     tssp_detect_config.window_duration_ticks =
         sensebe_config.tssp_conf.detect_window;
+    tssp_detect_config.code_unit_id = TSSP_IR_CODE_ID;
     tssp_detect_init (&tssp_detect_config);
 
     motion_state = MOTION_SYNC;
@@ -594,8 +706,41 @@ void timer_module_stop ()
     arr_is_light_ok[MOD_TIMER] = false;
 }
 
+#if LATENCY_BENCH == 1
+/**
+ * @brief Function to inject a detection in latency benchmark mode and to
+ *  schedule the next one. The interval has a random part as long as the
+ *  listen interval of the receiver so that the detections are spread
+ *  uniformly over its wake up cycle.
+ */
+void latency_bench_handler ()
+{
+    static uint32_t rand_state;
+    if(rand_state == 0)
+    {
+        rand_state = NRF_FICR->DEVICEADDR[0] | 1;
+    }
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+
+    light_sense_module_tick ();
+    if(arr_is_mod_on[MOD_MOTION] == true)
+    {
+        window_detect_handler ();
+    }
+    ms_timer_start (SENSEBE_OPERATION_MS_TIMER, MS_SINGLE_CALL,
+        MS_TIMER_TICKS_MS(LATENCY_BENCH_INTERVAL_MS)
+        + (rand_state % MS_TIMER_TICKS_MS(RADIO_LISTEN_INTERVAL_MS)),
+        latency_bench_handler);
+}
+#endif
+
 void module_tick_handler ()
 {
+    light_sense_module_tick ();
+    //No ms timer is left for the beacons, they are paced by the module tick
+    adv_beacon_add_ticks (module_tick_ticks);
     if(arr_is_mod_on[MOD_TIMER] == true)
     {
         timer_module_add_mod_ticks ();
@@ -612,6 +757,9 @@ void sensebe_tx_rx_init (sensebe_tx_rx_config_t * sensebe_rx_detect_config)
     
     //Assign Enable and sense pins
     light_check_sense_pin = sensebe_rx_detect_config->light_sense_config.photodiode_pin;
+#if SIMPLE_ADC_ASYNC == 1
+    light_sense_inputs[0].pin = (simple_adc_input_t) light_check_sense_pin;
+#endif
     hal_gpio_cfg_input (light_check_sense_pin, HAL_GPIO_PULL_DOWN);
     light_check_en_pin = sensebe_rx_detect_config->light_sense_config.photodiode_en_pin;
     hal_gpio_cfg_output (light_check_en_pin, 0);
@@ -675,9 +823,15 @@ void sensebe_tx_rx_start (void)
     }
     
     
+#if LATENCY_BENCH == 1
+    //Detections are injected periodically instead of the module ticks
+    ms_timer_start (SENSEBE_OPERATION_MS_TIMER, MS_SINGLE_CALL,
+        MS_TIMER_TICKS_MS(LATENCY_BENCH_INTERVAL_MS), latency_bench_handler);
+#else
+    module_tick_ticks = MS_TIMER_TICKS_MS(arr_module_tick_duration[sensebe_config.speed]);
     ms_timer_start (SENSEBE_OPERATION_MS_TIMER, MS_REPEATED_CALL,
-        MS_TIMER_TICKS_MS(arr_module_tick_duration[sensebe_config.speed])
-        , module_tick_handler);
+        module_tick_ticks, module_tick_handler);
+#endif
     
     light_sense_add_ticks (LIGHT_SENSE_INTERVAL_TICKS);
 }
@@ -690,6 +844,7 @@ void sensebe_tx_rx_stop (void)
     motion_module_stop ();
     timer_module_stop ();
     ms_timer_stop (SENSEBE_OPERATION_MS_TIMER);
+    light_sense_stop ();
 }
 
 void sensebe_tx_rx_add_ticks (uint32_t interval)
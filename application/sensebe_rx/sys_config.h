@@ -43,6 +43,10 @@
 #define HAL_UART_PERIPH_USED 0
 
 #define HAL_RADIO_PERIPH_USED 0
+/** Radio shared with the BLE advertising module for the beacons */
+#define RADIO_PERIPH_USED_BLE_ADV 0
+/** Only non-connectable beacons, as no TIMER is left for the us timer */
+#define BLE_ADV_SCANNABLE 0
 
 /** RTC used for MS_TIMER module */
 #define RTC_USED_MS_TIMER 1
@@ -55,7 +59,8 @@
 /** MS_TIMER used for SenseBe TxRx module */
 #define MS_TIMER_USED_SENSBE_TX_RX 2
 
-#define MS_TIMER_USED_SENSEBE_RADIO_CONTROL 3
+/** MS timer used by radio trigger module for low duty cycle listening */
+#define MS_TIMER_USED_RADIO_TRIGGER 3
 /** 1st PPI channel used for TSSP detect module */
 #define PPI_CH_USED_TSSP_DETECT_1 0
 /** 2nd PPI channel used for TSSP detect module */
@@ -70,6 +75,8 @@
 #define PPI_CH_USED_TSSP_IR_TX_4 5
 /** PPI channel for future use */
 #define PPI_CH_USED_EXTRA 6
+/** PPI channel used to start the sampling of the Simple ADC module */
+#define PPI_CH_USED_SIMPLE_ADC 7
 /** GPIOTE PORT channel used for button_ui */
 #define GPIOTE_CH_USED_BUTTON_UI_PORT 
 /** GPIOTE channel used for TSSP detect module */
@@ -89,6 +96,8 @@
 #define TIMER_USED_EXTRA 0 //Shared with softdevices
 /** 1st Channel from 1st timer used for TSSP IR transmission module */
 #define TIMER_CHANNEL_USED_TSSP_IR_TX_1_1 0
+/** 2nd Channel from 1st timer used for TSSP IR transmission module in coded mode */
+#define TIMER_CHANNEL_USED_TSSP_IR_TX_1_2 1
 /** 1st Channel from 2nd timer used for TSSP IR transmission module */
 #define TIMER_CHANNEL_USED_TSSP_IR_TX_2_1 0
 /** 2nd Channel from 2nd timer used for TSSP IR transmission module */
@@ -96,6 +105,12 @@
 #define TIMER_CHANNEL_USED_RADIO_TRIGGER_0 0 
 #define TIMER_CHANNEL_USED_RADIO_TRIGGER_1 1
 #define TIMER_CHANNEL_USED_RADIO_TRIGGER_2 2
+#define TIMER_CHANNEL_USED_RADIO_TRIGGER_3 3
+
+/** Pin toggled when a motion is detected, for latency measurement */
+#define LATENCY_TRACE_PIN_DETECT GPIO1_PIN
+/** Pin toggled when the radio trigger starts transmitting, for latency measurement */
+#define LATENCY_TRACE_PIN_RADIO_TX GPIO2_PIN
 
 /** Event Generator Unit used for TSSP detect module */
 #define EGU_USED_TSSP_DETECT 0
@@ -22,6 +22,10 @@
 #if SYS_CFG_PRESENT == 1
 #include "sys_config.h"
 
+#if defined RADIO_PERIPH_USED_BLE_ADV
+#include "ble_adv.h"
+#endif
+
 void HardFault_IRQHandler (void)
 {
     while(1);
@@ -29,16 +33,24 @@ void HardFault_IRQHandler (void)
 
 void POWER_CLOCK_IRQHandler (void)
 {
+    hal_clocks_Handler ();
+//Clear events
+    NRF_CLOCK->EVENTS_HFCLKSTARTED = 0;
 }
 
 void RADIO_IRQHandler (void)
 {
-#if defined HAL_RADIO_PERIPH_USED
-    hal_radio_Handler ();
+#if defined RADIO_PERIPH_USED_BLE_ADV
+    //The radio is shared, an advertising event clears its events as they come
+    if(ble_adv_is_event_ongoing ())
+    {
+        ble_adv_radio_Handler ();
+        return;
+    }
 #endif
 
-#if defined RADIO_PERIPH_USED_BLE_ADV
-    ble_adv_radio_Handler ();
+#if defined HAL_RADIO_PERIPH_USED
+    hal_radio_Handler ();
 #endif
     NRF_RADIO->EVENTS_ADDRESS = 0;
     NRF_RADIO->EVENTS_BCMATCH = 0;
@@ -46,7 +58,8 @@ void RADIO_IRQHandler (void)
     NRF_RADIO->EVENTS_CRCOK = 0;
     NRF_RADIO->EVENTS_DEVMATCH = 0;
     NRF_RADIO->EVENTS_DEVMISS = 0;
-    NRF_RADIO->EVENTS_DISABLED = 0;
+    //DISABLED is cleared by the radio modules as they take it, one coming
+    //after their check would be lost if it was cleared here
     NRF_RADIO->EVENTS_END = 0;
     NRF_RADIO->EVENTS_PAYLOAD = 0;
     NRF_RADIO->EVENTS_READY = 0;
@@ -155,6 +168,9 @@ void GPIOTE_IRQHandler (void)
 
 void SAADC_IRQHandler (void)
 {
+#if SIMPLE_ADC_ASYNC == 1
+    simple_adc_saadc_Handler ();
+#endif
 //Clear events
 }
 
@@ -20,6 +20,8 @@
 #define TEMPLATE_ISR_MANAGE_H
 
 //Drivers for hal level Irq management
+void hal_clocks_Handler (void);
+
 void hal_gpio_Handler (void);
 
 void hal_pwm_Handler (void);
@@ -48,6 +50,8 @@ void ms_timer_rtc_Handler (void);
 
 void pir_sense_saadc_Handler (void);
 
+void simple_adc_saadc_Handler (void);
+
 void tssp_detect_swi_Handler (void);
 
 void tssp_detect_rtc_Handler (void);
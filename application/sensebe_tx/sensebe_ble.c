@@ -27,7 +27,12 @@
 #include "sensebe_ble.h"
 #include "log.h"
 #include "evt_sd_handler.h"
+#include "ble_conn_params.h"
 #include "string.h"
+#include "hal_clocks.h"
+#if BLE_LOG_XFER == 1
+#include "ble_log_xfer.h"
+#endif
 
 #if ISR_MANAGER == 1
 #include "isr_manager.h"
@@ -50,17 +55,17 @@ const uint8_t device_name[] = { DEVICE_NAME_CHAR };
 #define SENSEBE_UUID_SYSINFO         0xdc61
 /** The 16 bit UUID of the read-write Config characteristic */
 #define SENSEBE_UUID_CONFIG          0xdc62
+/** The 16 bit UUID of the write-only Config TLV characteristic */
+#define SENSEBE_UUID_CONFIG_TLV      0xdc63
+
+#ifndef APP_RAM_START
+/** Start of the RAM of the application after that of the SoftDevice, set by
+ *  the Makefile to the RAM origin of the linker script in use */
+#define APP_RAM_START                0x20001c00
+#endif
 
 /**< Interval between advertisement packets (0.5 seconds). */
 #define ADVERTISING_INTERVAL       MSEC_TO_UNITS(500, UNIT_0_625_MS)
-/**< Minimum acceptable connection interval (0.2 seconds). */
-#define MIN_CONN_INTERVAL          MSEC_TO_UNITS(200, UNIT_1_25_MS)
-/**< Maximum acceptable connection interval (0.5 second). */
-#define MAX_CONN_INTERVAL          MSEC_TO_UNITS(500, UNIT_1_25_MS)
-/**< Slave latency (number of skippable conn events by the slave). */
-#define SLAVE_LATENCY              0
-/**< Connection supervisory timeout (4 seconds). */
-#define CONN_SUP_TIMEOUT           MSEC_TO_UNITS(4000, UNIT_10_MS)
 
 
 
@@ -82,10 +87,25 @@ ble_gatts_char_handles_t h_sysinfo_char;
  * configuration parameters which are specified @ref sensebe_config_t */
 ble_gatts_char_handles_t h_config_char;
 
+/** Handle to specify the attribute of the characteristic to which the
+ * changed fields of the configuration are written as TLV */
+ble_gatts_char_handles_t h_config_tlv_char;
+
+/** Two buffers each for the advertising and the scan response data, as the
+ *  SoftDevice needs new buffers to change the data while advertising */
+static uint8_t adv_data_buf[2][BLE_GAP_ADV_SET_DATA_SIZE_MAX];
+static uint8_t scan_rsp_buf[2][BLE_GAP_ADV_SET_DATA_SIZE_MAX];
+/** Index of the buffers given to the SoftDevice */
+static uint32_t adv_buf_idx;
+/** The advertising data given to the SoftDevice */
+static ble_gap_adv_data_t adv_payload;
+
 /** Handler to pass the BLE SoftDevice events to the application */
 void (* sensebe_ble_sd_evt)(ble_evt_t * evt);
 /** Handler to pass the received SenseBe configuration to the application */
 void (* sensebe_config_t_update)(sensebe_config_t * cfg);
+/** Handler to pass the received partial configuration to the application */
+void (* sensebe_config_tlv_update)(const uint8_t * p_tlv, uint32_t len);
 
 sensebe_sysinfo curr_sysinfo;
 
@@ -110,6 +130,17 @@ void SWI1_IRQHandler(void)
 static void ble_evt_handler(ble_evt_t * evt)
 {
     uint32_t err_code;
+
+    ble_conn_params_on_ble_evt(evt);
+
+#if BLE_LOG_XFER == 1
+    if(ble_log_xfer_on_ble_evt(evt))
+    {
+        sensebe_ble_sd_evt(evt);
+        return;
+    }
+#endif
+
     switch(evt->header.evt_id)
     {
     case BLE_GAP_EVT_CONNECTED:
@@ -120,9 +151,19 @@ static void ble_evt_handler(ble_evt_t * evt)
         break;
     case BLE_GATTS_EVT_WRITE:
     {
-        sensebe_config_t * config =
-                (sensebe_config_t *) evt->evt.gatts_evt.params.write.data;
-        sensebe_config_t_update(config);
+        if(evt->evt.gatts_evt.params.write.handle ==
+                h_config_char.value_handle)
+        {
+            sensebe_config_t * config =
+                    (sensebe_config_t *) evt->evt.gatts_evt.params.write.data;
+            sensebe_config_t_update(config);
+        }
+        else if(evt->evt.gatts_evt.params.write.handle ==
+                h_config_tlv_char.value_handle)
+        {
+            sensebe_config_tlv_update(evt->evt.gatts_evt.params.write.data,
+                    evt->evt.gatts_evt.params.write.len);
+        }
         break;
     }
     case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
@@ -167,10 +208,12 @@ static void soc_evt_handler(uint32_t evt_id)
 }
 
 void sensebe_ble_init(void (*ble_sd_evt)(ble_evt_t * evt),
-        void (* config_update)(sensebe_config_t * cfg))
+        void (* config_update)(sensebe_config_t * cfg),
+        void (* config_tlv)(const uint8_t * p_tlv, uint32_t len))
 {
     sensebe_ble_sd_evt = ble_sd_evt;
     sensebe_config_t_update = config_update;
+    sensebe_config_tlv_update = config_tlv;
 }
 
 void sensebe_ble_disconn(void)
@@ -218,10 +261,15 @@ void sensebe_ble_stack_init(void)
     uint32_t err_code;
     const nrf_clock_lf_cfg_t cfg = BOARD_LFCLKSRC_STRUCT;
 
+    //The SoftDevice can't be enabled with the POWER_CLOCK interrupt enabled
+    hfclk_xtal_sd_enable_prepare();
     err_code = sd_softdevice_enable(&cfg, app_error_fault_handler);
     APP_ERROR_CHECK(err_code);
 
-    uint32_t app_ram_start = 0x20001c00;
+    uint32_t app_ram_start = APP_RAM_START;
+#if BLE_LOG_XFER == 1
+    ble_log_xfer_cfg_set(app_ram_start);
+#endif
     log_printf("Init %x", app_ram_start);
     err_code = sd_ble_enable(&app_ram_start);
     log_printf(" RAM needed %x\n", app_ram_start);
@@ -341,12 +389,53 @@ void sensebe_ble_service_init(void)
     err_code = sd_ble_gatts_characteristic_add(
         h_sensebe_service, &char_md, &attr_char_value,&h_config_char);
     APP_ERROR_CHECK(err_code);
+
+    /**** Create the write-only TLV characterisitc *****/
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.read = 0;
+    char_md.char_props.write = 1;
+    char_md.char_props.write_wo_resp = 1;
+    char_md.p_char_user_desc = NULL;
+    char_md.p_char_pf = NULL;
+    char_md.p_user_desc_md = NULL;
+    char_md.p_cccd_md = NULL;
+    char_md.p_sccd_md = NULL;
+
+    ble_uuid.type = uuid_type;
+    ble_uuid.uuid = (SENSEBE_UUID_CONFIG_TLV);
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+    attr_md.vloc = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth = 0;
+    attr_md.wr_auth = 0;
+    attr_md.vlen = 1;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len = 0;
+    attr_char_value.init_offs = 0;
+    attr_char_value.max_len = SENSEBE_CONFIG_TLV_MAX_LEN;
+    attr_char_value.p_value = NULL;
+
+    err_code = sd_ble_gatts_characteristic_add(
+        h_sensebe_service, &char_md, &attr_char_value,&h_config_tlv_char);
+    APP_ERROR_CHECK(err_code);
+
+#if BLE_LOG_XFER == 1
+    /**** Create the log transfer service on the same base UUID *****/
+    ble_log_xfer_service_init(uuid_type);
+#endif
 }
 
 void sensebe_ble_gap_params_init(void)
 {
     uint32_t                err_code;
-    ble_gap_conn_params_t   gap_conn_params;
     ble_gap_conn_sec_mode_t sec_mode;
 
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&sec_mode);
@@ -355,15 +444,9 @@ void sensebe_ble_gap_params_init(void)
         &sec_mode, (const uint8_t *)device_name, sizeof(device_name));
     APP_ERROR_CHECK(err_code);
 
-    memset(&gap_conn_params, 0, sizeof(gap_conn_params));
-
-    gap_conn_params.min_conn_interval = MIN_CONN_INTERVAL;
-    gap_conn_params.max_conn_interval = MAX_CONN_INTERVAL;
-    gap_conn_params.slave_latency     = SLAVE_LATENCY;
-    gap_conn_params.conn_sup_timeout  = CONN_SUP_TIMEOUT;
-
-    err_code = sd_ble_gap_ppcp_set(&gap_conn_params);
-    APP_ERROR_CHECK(err_code);
+    //Preferred parameters are those of an idle link, the short interval
+    //is requested when the app is reading or writing
+    ble_conn_params_init();
 }
 
 void sensebe_ble_adv_init(sensebe_ble_adv_data_t * sensebe_ble_adv_data)
@@ -371,12 +454,17 @@ void sensebe_ble_adv_init(sensebe_ble_adv_data_t * sensebe_ble_adv_data)
     h_adv = BLE_GAP_ADV_SET_HANDLE_NOT_SET;
     uint32_t err_code;
     
-    ble_gap_adv_data_t adv_payload;
-
-    adv_payload.adv_data.p_data = sensebe_ble_adv_data->adv_data;
+    //The data is copied as it must be valid as long as it is advertised
+    adv_buf_idx = 0;
+    memcpy(adv_data_buf[0], sensebe_ble_adv_data->adv_data,
+            sensebe_ble_adv_data->adv_len);
+    memcpy(scan_rsp_buf[0], sensebe_ble_adv_data->scan_rsp_data,
+            sensebe_ble_adv_data->scan_rsp_len);
+
+    adv_payload.adv_data.p_data = adv_data_buf[0];
     adv_payload.adv_data.len = sensebe_ble_adv_data->adv_len;
 
-    adv_payload.scan_rsp_data.p_data = sensebe_ble_adv_data->scan_rsp_data;
+    adv_payload.scan_rsp_data.p_data = scan_rsp_buf[0];
     adv_payload.scan_rsp_data.len = sensebe_ble_adv_data->scan_rsp_len;
 
     ble_gap_adv_params_t adv_params;
@@ -414,7 +502,39 @@ void sensebe_ble_adv_init(sensebe_ble_adv_data_t * sensebe_ble_adv_data)
 void sensebe_ble_adv_start(void)
 {
     uint32_t err_code;
+#if BLE_LOG_XFER == 1
+    //Connect with the configuration of the larger MTU and TX queue
+    err_code = sd_ble_gap_adv_start(h_adv, BLE_LOG_XFER_CONN_CFG_TAG);
+#else
     err_code = sd_ble_gap_adv_start(h_adv, BLE_CONN_CFG_TAG_DEFAULT);
+#endif
     APP_ERROR_CHECK(err_code);
 }
 
+void sensebe_ble_adv_update_scan_rsp(uint32_t offset, const uint8_t * p_data,
+        uint32_t len)
+{
+    uint32_t err_code;
+    uint32_t next_idx = adv_buf_idx ^ 1;
+
+    if((h_adv == BLE_GAP_ADV_SET_HANDLE_NOT_SET) ||
+            ((offset + len) > adv_payload.scan_rsp_data.len))
+    {
+        return;
+    }
+
+    memcpy(adv_data_buf[next_idx], adv_data_buf[adv_buf_idx],
+            adv_payload.adv_data.len);
+    memcpy(scan_rsp_buf[next_idx], scan_rsp_buf[adv_buf_idx],
+            adv_payload.scan_rsp_data.len);
+    memcpy(&scan_rsp_buf[next_idx][offset], p_data, len);
+
+    adv_payload.adv_data.p_data = adv_data_buf[next_idx];
+    adv_payload.scan_rsp_data.p_data = scan_rsp_buf[next_idx];
+
+    //Only the data is changed, advertising goes on with the same parameters
+    err_code = sd_ble_gap_adv_set_configure(&h_adv,
+            (ble_gap_adv_data_t const *)&adv_payload, NULL);
+    APP_ERROR_CHECK(err_code);
+    adv_buf_idx = next_idx;
+}
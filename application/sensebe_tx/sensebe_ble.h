@@ -192,6 +192,27 @@ typedef struct
     ir_tx_conf_t ir_tx_conf;
 }__attribute__ ((packed)) sensebe_config_t ;
 
+/**
+ * @brief IDs of the fields of @ref sensebe_config_t for the partial writes
+ *  to the Config TLV characteristic. Each entry is the ID, the length of the
+ *  field and the field as laid out in @ref sensebe_config_t.
+ */
+typedef enum
+{
+    SENSEBE_CFG_ID_TRIG_CONF = 1,   ///< trig_conf, 1 byte with the short enums
+    SENSEBE_CFG_ID_CAM_TIMER,       ///< cam_trigs[TIMER_ALL], 4 bytes
+    SENSEBE_CFG_ID_CAM_RADIO,       ///< cam_trigs[RADIO_ALL], 4 bytes
+    SENSEBE_CFG_ID_SPEED,           ///< speed, 1 byte with the short enums
+    SENSEBE_CFG_ID_TIMER_CONF,      ///< timer_conf, 3 bytes
+    SENSEBE_CFG_ID_IR_TX_CONF,      ///< ir_tx_conf, 2 bytes
+    SENSEBE_CFG_ID_MAX,
+}sensebe_config_id_t;
+
+/** Maximum length of a write to the Config TLV characteristic, enough for
+ *  all the fields */
+#define SENSEBE_CONFIG_TLV_MAX_LEN  (sizeof(sensebe_config_t) +     \
+                                    2*(SENSEBE_CFG_ID_MAX - 1))
+
 typedef struct
 {
     uint8_t * adv_data;
@@ -206,9 +227,12 @@ sensebe_ble_adv_data_t;
  *  and the configuration received from the mobile app
  * @param ble_sd_evt Handler to send the BLE events to the application
  * @param config_update Handler to send SensePi config to the application
+ * @param config_tlv Handler to send the partial config in TLV format,
+ *  see @ref sensebe_config_id_t
  */
 void sensebe_ble_init(void (*ble_sd_evt)(ble_evt_t * evt), 
-        void (* config_update)(sensebe_config_t * cfg));
+        void (* config_update)(sensebe_config_t * cfg),
+        void (* config_tlv)(const uint8_t * p_tlv, uint32_t len));
 
 /**
  * @brief Updates the characteristic that stores the sysinfo
@@ -238,7 +262,8 @@ void sensebe_ble_stack_init(void);
  *  the SensePi device. There is a read-only characteristic
  *  that provides all the info from the device and a
  *  read-write characteristic that is used to set the
- *  operational configuration of the device.
+ *  operational configuration of the device. A write-only
+ *  characteristic takes a part of the configuration as TLV.
  */
 void sensebe_ble_service_init(void);
 
@@ -260,6 +285,16 @@ void sensebe_ble_adv_init(sensebe_ble_adv_data_t * sensebe_ble_adv_data);
  */
 void sensebe_ble_adv_start(void);
 
+/**
+ * @brief Function to change a part of the scan response data while
+ *  advertising, without stopping it. Used for the telemetry of the device.
+ * @param offset Offset in the scan response data given at init
+ * @param p_data Pointer to the new bytes
+ * @param len Number of bytes to be changed
+ */
+void sensebe_ble_adv_update_scan_rsp(uint32_t offset, const uint8_t * p_data,
+        uint32_t len);
+
 #endif /* APPLICATION_SENSEBE_BLE_H_ */
 
 /**
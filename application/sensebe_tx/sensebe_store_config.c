@@ -24,14 +24,15 @@
 #include "nrf_util.h"
 #include "nrf_assert.h"
 #include "common_util.h"
+#include "string.h"
 
 #include "log.h"
 
 /**Address of first memory location of last page available for application*/
 #define LAST_APP_PAGE_ADDR 0x27000
-/**Size of config in unit of size of pointer*/
+/**Size of config in unit of size of pointer in the earlier format*/
 #define CONFIG_SIZE_TO_POINTER 6 
-/**Number of configurations to be stored*/
+/**Number of configurations to be stored in the earlier format*/
 #define NO_OF_CONFIGS 165
 /**Word size*/
 #define WORD_SIZE 4
@@ -43,18 +44,39 @@
 #define CONFIG_FW_VER_LOC LAST_CONFIG_END_ADDR+CONFIG_SIZE_TO_POINTER+0x2
 /** Reset value or any flash register */
 #define MEM_RESET_VALUE 0xFFFFFFFF
-/** Memory full flag*/
-#define MEM_FULL LAST_CONFIG_END_ADDR
 
 /**
- * @brief Function to get the next location where firmware will store latest 
- * configuration.
- * 
- * @return Free memory location address in uint32_t format. 
- * @retval 0xFFFFFFFF memory is full and firmware will now clear all the 
- * previously saved configurations. 
+ * The configuration is stored as a journal of records. Each record is a
+ * header word followed by the bytes of the config from an offset, padded to
+ * a word. The first record has the full config and the later ones have only
+ * the bytes that changed, so that tweaking one field writes a couple of words.
+ *  |31  (bits) 16|15 (bits) 8|7 (bits) 0|
+ *  |:-----------:|:---------:|:--------:|
+ *  |Record tag   |Offset     |Length    |
+ */
+#define RECORD_TAG          0xC5F0
+#define RECORD_HDR(offset, len)  ((RECORD_TAG << 16) | ((offset) << 8) | (len))
+#define RECORD_IS_VALID(hdr)     (((hdr) >> 16) == RECORD_TAG)
+#define RECORD_OFFSET(hdr)       (((hdr) >> 8) & 0xFF)
+#define RECORD_LEN(hdr)          ((hdr) & 0xFF)
+/** Words taken by a record with len bytes of the config */
+#define RECORD_WORDS(len)        (1 + CEIL_DIV((len), WORD_SIZE))
+
+/** The config as per the records in flash */
+static sensebe_config_t last_config;
+
+/**
+ * @brief Function to go through the journal and build the last config.
+ * @param p_config Pointer where the config is built, NULL to only find the end
+ * @return Address of the first free word after the records
  */
-static uint32_t get_next_location (void);
+static uint32_t * journal_replay (sensebe_config_t * p_config);
+
+/**
+ * @brief Function to convert the earlier format of full configs in fixed
+ * slots to the journal, keeping the last config.
+ */
+static void convert_old_format (void);
 
 /**
  * @brief Function to erase all the previously return configurations.
@@ -68,57 +90,110 @@ static void clear_all_config (void);
  */
 static void update_fw_ver (void);
 
-static uint32_t get_next_location (void)
+static uint32_t * journal_replay (sensebe_config_t * p_config)
 {
-    log_printf("%s\n",__func__);
     uint32_t * p_mem_loc = (uint32_t *) LAST_APP_PAGE_ADDR;
     while(p_mem_loc < (uint32_t *)LAST_CONFIG_END_ADDR)
     {
-        if(*(p_mem_loc) == MEM_RESET_VALUE)
+        uint32_t hdr = *p_mem_loc;
+        if(RECORD_IS_VALID(hdr) == false)
         {
-            return (uint32_t)p_mem_loc;
+            break;
         }
-        p_mem_loc += CONFIG_SIZE_TO_POINTER;
+        if((p_config != NULL) &&
+            ((RECORD_OFFSET(hdr) + RECORD_LEN(hdr)) <= sizeof(sensebe_config_t)))
+        {
+            memcpy ((uint8_t *)p_config + RECORD_OFFSET(hdr), p_mem_loc + 1,
+                    RECORD_LEN(hdr));
+        }
+        p_mem_loc += RECORD_WORDS(RECORD_LEN(hdr));
     }
-    return MEM_FULL;
-    
+    return p_mem_loc;
+}
+
+static void record_write (uint32_t * p_mem_loc, uint32_t offset,
+        void * p_data, uint32_t len)
+{
+    //Word aligned copy, as the data is read in words for the flash
+    uint32_t record[RECORD_WORDS(sizeof(sensebe_config_t))];
+
+    record[0] = RECORD_HDR(offset, len);
+    memcpy (&record[1], p_data, len);
+    hal_nvmc_write_data (p_mem_loc, record, WORD_SIZE + len);
 }
 
 bool sensebe_store_config_is_memory_empty (void)
 {
     log_printf("%s\n",__func__);
-    if(get_next_location () == LAST_APP_PAGE_ADDR)
-    {
-        return true;
-    }
-    else
-    {
-        return false;
-    }
+    return (*((uint32_t *) LAST_APP_PAGE_ADDR) == MEM_RESET_VALUE);
 }
 
 void sensebe_store_config_write (sensebe_config_t* latest_config)
 {
     log_printf("%s\n",__func__);
-    uint32_t * p_mem_loc = (uint32_t *) get_next_location();
-    if(p_mem_loc == (uint32_t *)MEM_FULL)
+    uint8_t * p_new = (uint8_t *) latest_config;
+    uint8_t * p_last = (uint8_t *) &last_config;
+    uint32_t first = 0, len = sizeof(sensebe_config_t);
+    uint32_t * p_mem_loc = journal_replay (&last_config);
+
+    if(p_mem_loc != (uint32_t *) LAST_APP_PAGE_ADDR)
     {
-        clear_all_config ();
-        p_mem_loc = (uint32_t *) get_next_location();
+        //Only the bytes from the first to the last change are recorded
+        while((first < sizeof(sensebe_config_t)) && (p_new[first] == p_last[first]))
+        {
+            first++;
+        }
+        if(first == sizeof(sensebe_config_t))
+        {
+            return;
+        }
+        uint32_t last = sizeof(sensebe_config_t) - 1;
+        while(p_new[last] == p_last[last])
+        {
+            last--;
+        }
+        len = last - first + 1;
     }
-    hal_nvmc_write_data(p_mem_loc, latest_config, sizeof(sensebe_config_t));
 
+    if((p_mem_loc + RECORD_WORDS(len)) > (uint32_t *)LAST_CONFIG_END_ADDR)
+    {
+        //Journal full, start again with the full config
+        clear_all_config ();
+        update_fw_ver ();
+        p_mem_loc = (uint32_t *) LAST_APP_PAGE_ADDR;
+        first = 0;
+        len = sizeof(sensebe_config_t);
+    }
+    log_printf("Config record offset %d, len %d\n", first, len);
+    record_write (p_mem_loc, first, p_new + first, len);
+    memcpy (&last_config, latest_config, sizeof(sensebe_config_t));
 }
 
 sensebe_config_t * sensebe_store_config_get_last_config ()
 {
     log_printf("%s\n",__func__);
-    uint32_t * p_mem_loc = (uint32_t*)get_next_location();
-    if(p_mem_loc != (uint32_t*)LAST_APP_PAGE_ADDR)
+    memset (&last_config, 0xFF, sizeof(sensebe_config_t));
+    journal_replay (&last_config);
+    return &last_config;
+}
+
+static void convert_old_format (void)
+{
+    sensebe_config_t config;
+    uint32_t * p_mem_loc = (uint32_t *) LAST_APP_PAGE_ADDR;
+
+    //The last slot which is written has the last config
+    while(((p_mem_loc + CONFIG_SIZE_TO_POINTER) < (uint32_t *)LAST_CONFIG_END_ADDR)
+            && (*(p_mem_loc + CONFIG_SIZE_TO_POINTER) != MEM_RESET_VALUE))
     {
-        p_mem_loc -= CONFIG_SIZE_TO_POINTER;
+        p_mem_loc += CONFIG_SIZE_TO_POINTER;
     }
-    return (sensebe_config_t*) p_mem_loc;
+    memcpy (&config, p_mem_loc, sizeof(sensebe_config_t));
+
+    clear_all_config ();
+    update_fw_ver ();
+    record_write ((uint32_t *) LAST_APP_PAGE_ADDR, 0, &config,
+            sizeof(sensebe_config_t));
 }
 
 static void clear_all_config (void)
@@ -141,6 +216,12 @@ void sensebe_store_config_check_fw_ver ()
         clear_all_config ();
         update_fw_ver ();
     }
+
+    if((sensebe_store_config_is_memory_empty () == false) &&
+            (RECORD_IS_VALID(*((uint32_t *) LAST_APP_PAGE_ADDR)) == false))
+    {
+        convert_old_format ();
+    }
 }
 
 static void update_fw_ver ()  // make it as hal_nvmc_write
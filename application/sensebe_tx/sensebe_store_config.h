@@ -39,11 +39,11 @@
 bool sensebe_store_config_is_memory_empty (void);
 
 /**
- * @brief Function to write the sensebe_config_t at address location received 
- * from @ref get_next_location().
+ * @brief Function to store the sensebe_config_t. Only the bytes from the first
+ * to the last one which differ from the stored config are written as a record.
  * 
- * @note all the previously stored configurations will be erased if return value 
- * of @ref sensebe_store_config_get_next_location() is 0xFFFFFFFF 
+ * @note all the previously stored configurations will be erased once the page
+ * is full and the full config is written as the first record.
  * @param latest_config pointer to sensebe_config_t which is to be stored in memory.
  */
 void sensebe_store_config_write (sensebe_config_t * latest_config);
@@ -51,19 +51,19 @@ void sensebe_store_config_write (sensebe_config_t * latest_config);
 /**
  * @breif Function to get the last sensebe_config_t stored in flash. 
  * 
- * @Warning This function cannot differentiate between single stored config and \
- * empty flash page. So make sure that there is at least one configuration \
- * stored in memory. Use @ref sensebe_store_config_is_memory_empty() function for 
- * that
+ * @Warning The config is built from the records in flash, so make sure that \
+ * there is at least one configuration stored in memory. Use \
+ * @ref sensebe_store_config_is_memory_empty() function for that
  * 
- * @return pointer to last sensebe_config_t stored in flash.
+ * @return pointer to a copy in RAM of the last sensebe_config_t stored.
  */
 sensebe_config_t * sensebe_store_config_get_last_config (void);
 
 /**
  * @brief Function to check the major number of firmware if latest major number \
  * firmware version is greater than respective previous number then it'll \
- * initiate reset for stored configs.
+ * initiate reset for stored configs. Configs stored in the earlier format of \
+ * full configs are converted to records keeping the last one.
  * 
  */
 void sensebe_store_config_check_fw_ver ();
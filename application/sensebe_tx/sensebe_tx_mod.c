@@ -30,10 +30,16 @@
 #include "device_tick.h"
 #include "cam_trigger.h"
 #include "simple_adc.h"
+#include "aa_aaa_battery_check.h"
 #include "string.h"
-#include "hal_nop_delay.h"
 #include "tssp_ir_tx.h"
+#include "tssp_ir_code.h"
 #include "radio_trigger.h"
+#include "adv_telemetry.h"
+#include "adv_beacon.h"
+#include "trigger_log.h"
+#include "config_tlv.h"
+#include "common_util.h"
 
 /***********MACROS***********/
 /** Time upto which LED feedback is to be given in motion detection mode */
@@ -44,6 +50,8 @@
 #define MAX_ADC_OUTPUT 4096
 /** Cycle time after which light conditions has to be checked */
 #define LIGHT_SENSE_INTERVAL_TICKS MS_TIMER_TICKS_MS(300000)
+/** Time for the light sense module to settle after it is enabled */
+#define LIGHT_SENSE_SETTLE_TICKS MS_TIMER_TICKS_MS(3)
 /** Number of pulses required for sync while module is in motion sync mode.  */
 #define PULSE_REQ_FOR_SYNC 4
 /** On time for TSSP receiver while module is in motion sync mode */
@@ -51,7 +59,14 @@
 /** Off time for TSSP receiver while module is in motion sync mode */
 #define MOTION_SYNC_OFF_TIME 800
 
+/** Bit of a field in the masks of changed fields, the field table is in the
+ *  order of the IDs */
+#define CFG_CHANGED(id) (1UL << ((id) - SENSEBE_CFG_ID_TRIG_CONF))
+
+/** Interval at which the radio receiver wakes up to listen for a trigger */
 #define RADIO_ON_FREQ_MS 50
+/** Duration for which the radio receiver listens at each wake up */
+#define RADIO_LISTEN_WINDOW_US 1000
 
 /***********ENUMS***********/
 /** List of all submodules which are being managed by this module */
@@ -115,6 +130,10 @@ static uint32_t arr_module_tick_duration[] = {MOD_FREQ0, MOD_FREQ1, MOD_FREQ2, M
 static bool arr_is_light_ok [MAX_MODS];
 /**Array of flags to keep track if light check is required or not*/
 static bool arr_is_light_sense_req [MAX_MODS];
+/** The light sense module is enabled and its reading is due */
+static volatile bool is_light_sense_pending;
+/** ms timer count when the light sense module was enabled */
+static volatile uint32_t light_sense_en_count;
 /**Array of module status flag*/
 static bool arr_is_mod_on[MAX_MODS];
 /**Global variable used to store value after which timer trigger should be generated*/
@@ -130,10 +149,78 @@ static uint32_t ir_pwr1 = 0, ir_pwr2 =0;
 static uint32_t light_check_sense_pin = 0;
 /**Global variable to store pin number of Light sensor control pin*/
 static uint32_t light_check_en_pin = 0;
-
-static uint32_t radio_mod_ticks_freq = 0;
+#if SIMPLE_ADC_ASYNC == 1
+static void light_sense_adc_handler (const uint32_t * p_vals, uint32_t cnt);
+/**Inputs read on each light check, the light sense pin and the battery*/
+static simple_adc_input_cfg_t light_sense_inputs[] =
+{
+    {SIMPLE_ADC_GAIN1_6, ANALOG_VDD},
+    {SIMPLE_ADC_GAIN1_6, ANALOG_VDD},
+};
+/**Request to read the light and the battery together*/
+static const simple_adc_req_t light_sense_req =
+{
+    .p_inputs = light_sense_inputs,
+    .input_cnt = ARRAY_SIZE(light_sense_inputs),
+    .handler = light_sense_adc_handler,
+};
+#endif
+/**Mask of the config fields changed since they were last applied, all of
+ * them to begin with*/
+static uint32_t cfg_changed = UINT32_MAX;
+
+static bool is_trig_conf_valid (const uint8_t * p_val);
+static bool is_cam_oper_valid (const uint8_t * p_val);
+static bool is_speed_valid (const uint8_t * p_val);
+static bool is_timer_conf_valid (const uint8_t * p_val);
+
+/**Fields of the config which can be written as TLV, in the order of IDs*/
+static const config_tlv_field_t config_fields[] =
+{
+    CONFIG_TLV_FIELD(SENSEBE_CFG_ID_TRIG_CONF, sensebe_config_t,
+            trig_conf, is_trig_conf_valid),
+    CONFIG_TLV_FIELD(SENSEBE_CFG_ID_CAM_TIMER, sensebe_config_t,
+            cam_trigs[TIMER_ALL], is_cam_oper_valid),
+    CONFIG_TLV_FIELD(SENSEBE_CFG_ID_CAM_RADIO, sensebe_config_t,
+            cam_trigs[RADIO_ALL], is_cam_oper_valid),
+    CONFIG_TLV_FIELD(SENSEBE_CFG_ID_SPEED, sensebe_config_t,
+            speed, is_speed_valid),
+    CONFIG_TLV_FIELD(SENSEBE_CFG_ID_TIMER_CONF, sensebe_config_t,
+            timer_conf, is_timer_conf_valid),
+    CONFIG_TLV_FIELD(SENSEBE_CFG_ID_IR_TX_CONF, sensebe_config_t,
+            ir_tx_conf, NULL),
+};
 
 /***********FUNCTIONS***********/
+/** Validation of the config fields written as TLV */
+static bool is_trig_conf_valid (const uint8_t * p_val)
+{
+    trigger_conf_t trig_conf;
+    memcpy (&trig_conf, p_val, sizeof(trig_conf));
+    return (trig_conf <= MOTION_AND_TIMER);
+}
+
+static bool is_cam_oper_valid (const uint8_t * p_val)
+{
+    cam_oper_t cam_oper;
+    memcpy (&cam_oper, p_val, sizeof(cam_oper));
+    return (cam_oper.mode <= CAM_TRIGGER_NO_PRESS);
+}
+
+static bool is_speed_valid (const uint8_t * p_val)
+{
+    device_speed_t speed;
+    memcpy (&speed, p_val, sizeof(speed));
+    return (speed <= SLOWMO);
+}
+
+static bool is_timer_conf_valid (const uint8_t * p_val)
+{
+    timer_conf_t timer_conf;
+    memcpy (&timer_conf, p_val, sizeof(timer_conf));
+    return (timer_conf.timer_interval != 0);
+}
+
 /** Timer Module Related Functions. */
 /**Function to start timer module*/
 void timer_module_start (void);
@@ -149,8 +236,6 @@ void timer_trigger_handler ();
 
 void radio_module_start ();
 
-void radio_module_add_mod_ticks ();
-
 void radio_module_stop ();
 
 void radio_module_trigger_handler (void * p_trig, uint32_t len);
@@ -214,6 +299,9 @@ void add_ticks_feedback (uint32_t interval);
  */
 void module_tick_handler ();
 
+/** Period of the module tick in ms timer ticks */
+static uint32_t module_tick_ticks;
+
 
 /*******************Definitions*******************/
 void add_ticks_feedback (uint32_t interval)
@@ -282,6 +370,8 @@ void timer_trigger_handler ()
 {   
     if(cam_trigger_is_on () == false)
     {
+        adv_telemetry_trig_add ();
+        trigger_log_add (TRIGGER_LOG_SRC_TIMER, MOD_TIMER, 0);
         cam_trigger (MOD_TIMER);
     }
 }
@@ -307,36 +397,76 @@ void light_check (oper_time_t oper_time, uint32_t light_intensity, uint32_t modu
     }
 }
 
+/** Check the light for the modules which need it and disable the light sense */
+static void light_sense_update (uint32_t light_intensity)
+{
+    //timer light check
+    if(arr_is_light_sense_req[MOD_TIMER])
+    {
+        light_check (sensebe_config.timer_conf.oper_time, light_intensity, MOD_TIMER);
+    }
+    
+    if(arr_is_light_sense_req[MOD_IR_TX])
+    {
+        light_check (sensebe_config.ir_tx_conf.oper_time, light_intensity, MOD_IR_TX);
+    }
+
+    //Disable light sense module
+    hal_gpio_pin_clear (light_check_en_pin);
+}
+
+#if SIMPLE_ADC_ASYNC == 1
+static void light_sense_adc_handler (const uint32_t * p_vals, uint32_t cnt)
+{
+    light_sense_update (MAX_ADC_OUTPUT - p_vals[0]);
+    trigger_log_set_battery (aa_aaa_battery_status_from_adc (p_vals[1]));
+}
+#endif
+
 void light_sense_add_ticks (uint32_t interval)
 {
     static uint32_t timepassed = 0;
     timepassed += interval;
-    if(timepassed >= LIGHT_SENSE_INTERVAL_TICKS)
+    if((timepassed >= LIGHT_SENSE_INTERVAL_TICKS) && (is_light_sense_pending == false))
     {
-        static uint32_t light_intensity;
-        //Enable light sense module
+        //Enable light sense module, it is read at a module tick once settled
         hal_gpio_pin_set (light_check_en_pin);
-        //Take light reading
-        hal_nop_delay_ms (3);
-        light_intensity = (MAX_ADC_OUTPUT - simple_adc_get_value (SIMPLE_ADC_GAIN1_6,
-                                                light_check_sense_pin));
-        //timer light check
-        if(arr_is_light_sense_req[MOD_TIMER])
-        {
-            light_check (sensebe_config.timer_conf.oper_time, light_intensity, MOD_TIMER);
-        }
-        
-        if(arr_is_light_sense_req[MOD_IR_TX])
-        {
-            light_check (sensebe_config.ir_tx_conf.oper_time, light_intensity, MOD_IR_TX);
-        }
-        
-        //Disable light sense module
-        hal_gpio_pin_clear (light_check_en_pin);
+        light_sense_en_count = ms_timer_get_current_count ();
+        is_light_sense_pending = true;
         timepassed = 0;
     }
 }
 
+/** Take the light reading at a module tick, once the light sense module
+ *  enabled has settled */
+static void light_sense_module_tick (void)
+{
+    if((is_light_sense_pending == false) ||
+       (((ms_timer_get_current_count () + (1<<24) - light_sense_en_count) & 0xFFFFFF)
+        < LIGHT_SENSE_SETTLE_TICKS))
+    {
+        return;
+    }
+    is_light_sense_pending = false;
+#if SIMPLE_ADC_ASYNC == 1
+    //The light sense module is disabled from the handler of the reading
+    if(simple_adc_request (&light_sense_req) == false)
+    {
+        hal_gpio_pin_clear (light_check_en_pin);
+    }
+#else
+    light_sense_update (MAX_ADC_OUTPUT - simple_adc_get_value (SIMPLE_ADC_GAIN1_6,
+                                            light_check_sense_pin));
+#endif
+}
+
+/** Disable the light sense module and drop the reading pending, if any */
+static void light_sense_stop (void)
+{
+    is_light_sense_pending = false;
+    hal_gpio_pin_clear (light_check_en_pin);
+}
+
 void radio_module_start ()
 {
     arr_is_mod_on[MOD_RADIO] = 1;
@@ -345,33 +475,32 @@ void radio_module_start ()
         .comm_direction = RADIO_TRIGGER_Rx,
         .comm_freq = 95,
         .irq_priority = APP_IRQ_PRIORITY_HIGH,
+        .ack_en = true,
         .radio_trigger_rx_callback = radio_module_trigger_handler,
         .rx_on_time_ms = 2,
+        .listen_interval_ms = RADIO_ON_FREQ_MS,
+        .listen_window_us = RADIO_LISTEN_WINDOW_US,
     };
     radio_trigger_init (&radio_init);
     
-    cam_trigger_config_t cam_trigg = 
-    {
-        .setup_number = MOD_RADIO,
-        .pre_focus_en = sensebe_config.cam_trigs[RADIO_ALL].pre_focus,
-        .trig_duration_100ms = 15,
-        .trig_mode = sensebe_config.cam_trigs[RADIO_ALL].mode,
-        .trig_param1 = sensebe_config.cam_trigs[RADIO_ALL].larger_value,
-        .trig_param2 = sensebe_config.cam_trigs[RADIO_ALL].smaller_value,
-    };
-    cam_trigger_set_trigger (&cam_trigg);
-    
-}
-
-void radio_module_add_mod_ticks ()
-{
-    static uint32_t radio_cnt = 0;
-    radio_cnt++;
-    if(radio_cnt >= radio_mod_ticks_freq)
+    //The setup is kept by cam_trigger, so computed only on a change
+    if(cfg_changed & CFG_CHANGED(SENSEBE_CFG_ID_CAM_RADIO))
     {
-        radio_trigger_listen ();
-        radio_cnt = 0;
+        cam_trigger_config_t cam_trigg =
+        {
+            .setup_number = MOD_RADIO,
+            .pre_focus_en = sensebe_config.cam_trigs[RADIO_ALL].pre_focus,
+            .trig_duration_100ms = 15,
+            .trig_mode = sensebe_config.cam_trigs[RADIO_ALL].mode,
+            .trig_param1 = sensebe_config.cam_trigs[RADIO_ALL].larger_value,
+            .trig_param2 = sensebe_config.cam_trigs[RADIO_ALL].smaller_value,
+        };
+        cam_trigger_set_trigger (&cam_trigg);
+        cfg_changed &= ~CFG_CHANGED(SENSEBE_CFG_ID_CAM_RADIO);
     }
+    
+    //Receiver wakes up on its own every RADIO_ON_FREQ_MS
+    radio_trigger_listen ();
 }
 
 void radio_module_stop ()
@@ -384,6 +513,8 @@ void radio_module_trigger_handler (void * p_trig, uint32_t len)
 {
     uint32_t * buff = (uint32_t *)p_trig;
     log_printf("%s : %d\n", __func__, buff[0]);
+    adv_telemetry_trig_add ();
+    trigger_log_add (TRIGGER_LOG_SRC_RADIO, buff[0], 0);
     cam_trigger (buff[0]);
 }
 
@@ -401,16 +532,20 @@ void timer_module_start ()
     {
         arr_is_light_sense_req[MOD_TIMER] = true;
     }      
-    cam_trigger_config_t timer_cam_trig_config = 
-    {
-        .setup_number = MOD_TIMER,
-        .trig_duration_100ms = 0,
-        .trig_mode = sensebe_config.cam_trigs[TIMER_ALL].mode,
-        .trig_param1 = sensebe_config.cam_trigs[TIMER_ALL].larger_value,
-        .trig_param2 = sensebe_config.cam_trigs[TIMER_ALL].smaller_value,
-        .pre_focus_en = (bool)sensebe_config.cam_trigs[TIMER_ALL].pre_focus,
-    };
-    cam_trigger_set_trigger (&timer_cam_trig_config);
+    if(cfg_changed & CFG_CHANGED(SENSEBE_CFG_ID_CAM_TIMER))
+    {
+        cam_trigger_config_t timer_cam_trig_config =
+        {
+            .setup_number = MOD_TIMER,
+            .trig_duration_100ms = 0,
+            .trig_mode = sensebe_config.cam_trigs[TIMER_ALL].mode,
+            .trig_param1 = sensebe_config.cam_trigs[TIMER_ALL].larger_value,
+            .trig_param2 = sensebe_config.cam_trigs[TIMER_ALL].smaller_value,
+            .pre_focus_en = (bool)sensebe_config.cam_trigs[TIMER_ALL].pre_focus,
+        };
+        cam_trigger_set_trigger (&timer_cam_trig_config);
+        cfg_changed &= ~CFG_CHANGED(SENSEBE_CFG_ID_CAM_TIMER);
+    }
     
     timer_module_value = sensebe_config.timer_conf.timer_interval * 100;
     
@@ -502,6 +637,9 @@ void ir_tx_module_stop ()
 
 void module_tick_handler ()
 {
+    light_sense_module_tick ();
+    //No ms timer is left for the beacons, they are paced by the module tick
+    adv_beacon_add_ticks (module_tick_ticks);
     if(arr_is_mod_on[MOD_TIMER] == true)
     {
         timer_module_add_mod_ticks ();
@@ -510,10 +648,6 @@ void module_tick_handler ()
     {
         ir_tx_module_add_mod_ticks ();
     }
-    if(arr_is_mod_on[MOD_RADIO] == true)
-    {
-        radio_module_add_mod_ticks ();
-    }
 }
 
 void sensebe_tx_rx_init (sensebe_tx_config_t * sensebe_tx_init)
@@ -522,6 +656,9 @@ void sensebe_tx_rx_init (sensebe_tx_config_t * sensebe_tx_init)
         
     //Assign Enable and sense pins
     light_check_sense_pin = sensebe_tx_init->light_sense_config.photodiode_pin;
+#if SIMPLE_ADC_ASYNC == 1
+    light_sense_inputs[0].pin = (simple_adc_input_t) light_check_sense_pin;
+#endif
     hal_gpio_cfg_input (light_check_sense_pin, HAL_GPIO_PULL_DOWN);
     light_check_en_pin = sensebe_tx_init->light_sense_config.photodiode_en_pin;
     hal_gpio_cfg_output (light_check_en_pin, 0);
@@ -541,6 +678,7 @@ void sensebe_tx_rx_init (sensebe_tx_config_t * sensebe_tx_init)
     
     tssp_ir_tx_init (sensebe_tx_init->tx_transmit_config.tx_en_pin,
                      sensebe_tx_init->tx_transmit_config.tx_in_pin);
+    tssp_ir_tx_code_set (TSSP_IR_CODE_ID);
     
     ir_pwr1 = sensebe_tx_init->tx_transmit_config.tx_pwr1;
     ir_pwr2 = sensebe_tx_init->tx_transmit_config.tx_pwr2;
@@ -592,14 +730,15 @@ void sensebe_tx_rx_start (void)
         ir_tx_module_stop ();
     }
     
-    radio_mod_ticks_freq = RADIO_ON_FREQ_MS/
-        arr_module_tick_duration[sensebe_config.ir_tx_conf.ir_tx_speed];
-    
+    module_tick_ticks = MS_TIMER_TICKS_MS(arr_module_tick_duration[sensebe_config.ir_tx_conf.ir_tx_speed]);
     ms_timer_start (SENSEBE_OPERATION_MS_TIMER, MS_REPEATED_CALL,
-        MS_TIMER_TICKS_MS(arr_module_tick_duration[sensebe_config.ir_tx_conf.ir_tx_speed])
-        , module_tick_handler);
+        module_tick_ticks, module_tick_handler);
     
     light_sense_add_ticks (LIGHT_SENSE_INTERVAL_TICKS);
+
+    //Setups of the modules not started stay pending till they are started
+    cfg_changed &= (CFG_CHANGED(SENSEBE_CFG_ID_CAM_TIMER) |
+            CFG_CHANGED(SENSEBE_CFG_ID_CAM_RADIO));
 }
 
 void sensebe_tx_rx_stop (void)
@@ -610,6 +749,7 @@ void sensebe_tx_rx_stop (void)
     ir_tx_module_stop ();
     radio_module_stop ();
     ms_timer_stop (SENSEBE_OPERATION_MS_TIMER);
+    light_sense_stop ();
 }
 
 void sensebe_tx_rx_add_ticks (uint32_t interval)
@@ -634,9 +774,27 @@ void sensebe_tx_rx_add_ticks (uint32_t interval)
 
 void sensebe_tx_rx_update_config (sensebe_config_t * update_sensebe_config)
 {
+    cfg_changed |= config_tlv_diff (config_fields, ARRAY_SIZE(config_fields),
+            &sensebe_config, update_sensebe_config);
     memcpy (&sensebe_config, update_sensebe_config, sizeof(sensebe_config_t));
 }
 
+bool sensebe_tx_rx_update_config_tlv (const uint8_t * p_tlv, uint32_t len)
+{
+    uint32_t changed;
+    config_tlv_err_t err;
+
+    err = config_tlv_apply (config_fields, ARRAY_SIZE(config_fields),
+            p_tlv, len, &sensebe_config, &changed);
+    if(err != CONFIG_TLV_OK)
+    {
+        log_printf("%s : error %d\n", __func__, err);
+        return false;
+    }
+    cfg_changed |= changed;
+    return true;
+}
+
 sensebe_config_t * sensebe_tx_rx_last_config ()
 {
     return &sensebe_config;
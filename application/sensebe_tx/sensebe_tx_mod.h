@@ -118,6 +118,17 @@ void sensebe_tx_rx_add_ticks (uint32_t interval);
  */
 void sensebe_tx_rx_update_config (sensebe_config_t * update_sensebe_config);
 
+/**
+ * @brief Function to update some fields of the SenseBe Tx configuration. Only
+ *  the fields in the data are checked and only the camera trigger setups
+ *  which changed are computed again on the next start.
+ *
+ * @param p_tlv Pointer to the fields in TLV format, see @ref sensebe_config_id_t
+ * @param len Length of the data
+ * @return True if all the fields are valid and applied, false if none are
+ */
+bool sensebe_tx_rx_update_config_tlv (const uint8_t * p_tlv, uint32_t len);
+
 /**
  * @brief Function to get last config which is being used.
  * @return Configuration pointer to the configuration which is being used.
@@ -29,6 +29,9 @@ void HardFault_IRQHandler (void)
 
 void POWER_CLOCK_IRQHandler (void)
 {
+    hal_clocks_Handler ();
+//Clear events
+    NRF_CLOCK->EVENTS_HFCLKSTARTED = 0;
 }
 
 void RADIO_IRQHandler (void)
@@ -46,7 +49,8 @@ void RADIO_IRQHandler (void)
     NRF_RADIO->EVENTS_CRCOK = 0;
     NRF_RADIO->EVENTS_DEVMATCH = 0;
     NRF_RADIO->EVENTS_DEVMISS = 0;
-    NRF_RADIO->EVENTS_DISABLED = 0;
+    //DISABLED is cleared by the radio modules as they take it, one coming
+    //after their check would be lost if it was cleared here
     NRF_RADIO->EVENTS_END = 0;
     NRF_RADIO->EVENTS_PAYLOAD = 0;
     NRF_RADIO->EVENTS_READY = 0;
@@ -155,6 +159,9 @@ void GPIOTE_IRQHandler (void)
 
 void SAADC_IRQHandler (void)
 {
+#if SIMPLE_ADC_ASYNC == 1
+    simple_adc_saadc_Handler ();
+#endif
 //Clear events
 }
 
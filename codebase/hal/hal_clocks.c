@@ -19,6 +19,25 @@
 #include "hal_clocks.h"
 #include "log.h"
 #include "nrf_peripherals.h"
+#include "nrf_util.h"
+#include "stddef.h"
+
+#if ISR_MANAGER == 1
+#include "isr_manager.h"
+#endif
+
+/** Value of HFCLKSTAT when the HF clock runs from the crystal */
+#define HFCLK_XTAL_RUNNING                                      \
+      ((CLOCK_HFCLKSTAT_STATE_Running << CLOCK_HFCLKSTAT_STATE_Pos) | \
+      (CLOCK_HFCLKSTAT_SRC_Xtal << CLOCK_HFCLKSTAT_SRC_Pos))
+
+/** Modules which have the HF crystal requested, a bit for each user */
+static volatile uint32_t xtal_users;
+/** Modules waiting for their ready handler to be called */
+static volatile uint32_t xtal_waiting;
+static void (* volatile xtal_ready_handlers[HFCLK_XTAL_USER_MAX])(void);
+/** Set from the start of the crystal till its started event is handled */
+static volatile bool is_xtal_starting = false;
 
 void lfclk_init(lfclk_src_t lfclk_src)
 {
@@ -63,36 +82,164 @@ void lfclk_init(lfclk_src_t lfclk_src)
 #endif
 }
 
+bool lfclk_rc_calibration_start(void)
+{
+    if(((NRF_CLOCK->LFCLKSTAT & CLOCK_LFCLKSTAT_SRC_Msk) != LFCLK_SRC_RC) ||
+       (hfclk_xtal_is_running() == false))
+    {
+        return false;
+    }
+
+    NRF_CLOCK->EVENTS_DONE = 0;
+    (void) NRF_CLOCK->EVENTS_DONE;
+    NRF_CLOCK->TASKS_CAL = 1;
+    return true;
+}
+
+bool lfclk_rc_calibration_is_done(void)
+{
+    return (NRF_CLOCK->EVENTS_DONE != 0);
+}
+
 void lfclk_deinit(void)
 {
     NRF_CLOCK->TASKS_LFCLKSTOP = 1;
 }
 
+void hfclk_xtal_request(hfclk_xtal_user_t user, void (* ready_handler)(void))
+{
+    bool is_ready;
+
+    CRITICAL_REGION_ENTER();
+    xtal_users |= (1 << user);
+    is_ready = hfclk_xtal_is_running();
+    if(is_ready == false)
+    {
+        if(ready_handler != NULL)
+        {
+            xtal_ready_handlers[user] = ready_handler;
+            xtal_waiting |= (1 << user);
+        }
+        if(is_xtal_starting == false)
+        {
+            is_xtal_starting = true;
+            NRF_CLOCK->EVENTS_HFCLKSTARTED = 0;
+            (void) NRF_CLOCK->EVENTS_HFCLKSTARTED;
+            NRF_CLOCK->INTENSET = CLOCK_INTENSET_HFCLKSTARTED_Msk;
+            NVIC_SetPriority(POWER_CLOCK_IRQn, HFCLK_XTAL_IRQ_PRIORITY);
+            NVIC_ClearPendingIRQ(POWER_CLOCK_IRQn);
+            NVIC_EnableIRQ(POWER_CLOCK_IRQn);
+            NRF_CLOCK->TASKS_HFCLKSTART = 1;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    if(is_ready && (ready_handler != NULL))
+    {
+        ready_handler();
+    }
+}
+
+/**
+ * @brief Function to disable the POWER_CLOCK interrupt once the crystal has
+ *  started or is stopped, as the SoftDevice can't be enabled with it enabled
+ */
+static void xtal_irq_disable(void)
+{
+    NRF_CLOCK->INTENCLR = CLOCK_INTENCLR_HFCLKSTARTED_Msk;
+    NVIC_DisableIRQ(POWER_CLOCK_IRQn);
+    NVIC_ClearPendingIRQ(POWER_CLOCK_IRQn);
+}
+
+/**
+ * @brief Function to call the ready handlers once the crystal has started
+ */
+static void xtal_started(void)
+{
+    uint32_t waiting;
+
+    CRITICAL_REGION_ENTER();
+    xtal_irq_disable();
+    is_xtal_starting = false;
+    waiting = xtal_waiting;
+    xtal_waiting = 0;
+    CRITICAL_REGION_EXIT();
+
+    for(uint32_t user = 0; user < HFCLK_XTAL_USER_MAX; user++)
+    {
+        if(waiting & (1 << user))
+        {
+            xtal_ready_handlers[user]();
+        }
+    }
+}
+
+void hfclk_xtal_release(hfclk_xtal_user_t user)
+{
+    CRITICAL_REGION_ENTER();
+    xtal_users &= ~(1 << user);
+    xtal_waiting &= ~(1 << user);
+    if(xtal_users == 0)
+    {
+        //Stopping while it starts up is allowed
+        xtal_irq_disable();
+        is_xtal_starting = false;
+        NRF_CLOCK->TASKS_HFCLKSTOP = 1;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+bool hfclk_xtal_is_running(void)
+{
+    return (NRF_CLOCK->HFCLKSTAT == HFCLK_XTAL_RUNNING);
+}
+
+#if ISR_MANAGER == 1
+void hal_clocks_Handler(void)
+#else
+void POWER_CLOCK_IRQHandler(void)
+#endif
+{
+    if(NRF_CLOCK->EVENTS_HFCLKSTARTED == 0)
+    {
+        return;
+    }
+#if ISR_MANAGER == 0
+    NRF_CLOCK->EVENTS_HFCLKSTARTED = 0;
+    (void) NRF_CLOCK->EVENTS_HFCLKSTARTED;
+#endif
+    xtal_started();
+}
+
+void hfclk_xtal_sd_enable_prepare(void)
+{
+    /* A start in progress is completed here, so that its ready handlers are
+     * called before the interrupt is given up to the SoftDevice */
+    while(is_xtal_starting)
+    {
+        if(NRF_CLOCK->EVENTS_HFCLKSTARTED != 0)
+        {
+            NRF_CLOCK->EVENTS_HFCLKSTARTED = 0;
+            (void) NRF_CLOCK->EVENTS_HFCLKSTARTED;
+            xtal_started();
+        }
+    }
+    xtal_irq_disable();
+}
+
 void hfclk_xtal_init_blocking(void)
 {
-    /* Check if 16 MHz crystal oscillator is already running. */
-    if(NRF_CLOCK->HFCLKSTAT !=
-      ((CLOCK_HFCLKSTAT_STATE_Running << CLOCK_HFCLKSTAT_STATE_Pos) |
-      (CLOCK_HFCLKSTAT_SRC_Xtal << CLOCK_HFCLKSTAT_SRC_Pos)))
+    hfclk_xtal_request(HFCLK_XTAL_USER_APP, NULL);
+    if(hfclk_xtal_is_running() == false)
     {
-        NRF_CLOCK->INTENSET = CLOCK_INTENSET_HFCLKSTARTED_Msk;
         // Enable wake-up on event
         SCB->SCR |= SCB_SCR_SEVONPEND_Msk;
-
-        NRF_CLOCK->EVENTS_HFCLKSTARTED = 0;
-        (void) NRF_CLOCK->EVENTS_HFCLKSTARTED;
-        NRF_CLOCK->TASKS_HFCLKSTART = 1;
-        /* Wait for the external oscillator to start up. */
-        while (NRF_CLOCK->EVENTS_HFCLKSTARTED == 0)
+        /* Wait for the external oscillator to start up. The status is
+         * checked as the event is cleared in the interrupt handler */
+        while (hfclk_xtal_is_running() == false)
         {
             __WFE();
         }
-        /* Clear the event and the pending interrupt */
-        NRF_CLOCK->EVENTS_HFCLKSTARTED = 0;
-        (void) NRF_CLOCK->EVENTS_HFCLKSTARTED;
-        NVIC_ClearPendingIRQ(POWER_CLOCK_IRQn);
-        NRF_CLOCK->INTENCLR = CLOCK_INTENCLR_HFCLKSTARTED_Msk;
-
         // Enable wake-up on only enabled interrupts
         SCB->SCR &= (~(SCB_SCR_SEVONPEND_Msk));
     }
@@ -100,36 +247,20 @@ void hfclk_xtal_init_blocking(void)
 
 void hfclk_xtal_init_nonblocking(void)
 {
-    /* Check if 16 MHz crystal oscillator is already running. */
-    if(NRF_CLOCK->HFCLKSTAT !=
-      ((CLOCK_HFCLKSTAT_STATE_Running << CLOCK_HFCLKSTAT_STATE_Pos) |
-      (CLOCK_HFCLKSTAT_SRC_Xtal << CLOCK_HFCLKSTAT_SRC_Pos)))
-    {
-        NRF_CLOCK->TASKS_HFCLKSTART = 1;
-    }
+    hfclk_xtal_request(HFCLK_XTAL_USER_APP, NULL);
 }
 
 void hfclk_block_till_xtal(void)
 {
-    /* Check if 16 MHz crystal oscillator is already running. */
-    if(NRF_CLOCK->HFCLKSTAT !=
-      ((CLOCK_HFCLKSTAT_STATE_Running << CLOCK_HFCLKSTAT_STATE_Pos) |
-      (CLOCK_HFCLKSTAT_SRC_Xtal << CLOCK_HFCLKSTAT_SRC_Pos)))
+    /* Wait for the external oscillator to start up. The started event is
+     * left for the interrupt handler to call the ready handlers. */
+    while (hfclk_xtal_is_running() == false)
     {
-        /* Wait for the external oscillator to start up. */
-        while (NRF_CLOCK->HFCLKSTAT !=
-            ((CLOCK_HFCLKSTAT_STATE_Running << CLOCK_HFCLKSTAT_STATE_Pos) |
-            (CLOCK_HFCLKSTAT_SRC_Xtal << CLOCK_HFCLKSTAT_SRC_Pos)))
-        {
 
-        }
-        /* Clear the event and the pending interrupt */
-        NRF_CLOCK->EVENTS_HFCLKSTARTED = 0;
-        (void) NRF_CLOCK->EVENTS_HFCLKSTARTED;
     }
 }
 
 void hfclk_xtal_deinit(void)
 {
-    NRF_CLOCK->TASKS_HFCLKSTOP = 1;
+    hfclk_xtal_release(HFCLK_XTAL_USER_APP);
 }
@@ -25,12 +25,48 @@
  *
  * @defgroup group_clocks Clocks HAL
  * @brief Hardware abstraction layer of the high frequency and low frequency clock.
+ *
+ * The HF crystal oscillator is shared by the modules which need an accurate
+ *  HF clock. Each of them requests it with @ref hfclk_xtal_request and
+ *  releases it with @ref hfclk_xtal_release, and the crystal is stopped only
+ *  when no module has it requested. A module can pass a handler to its
+ *  request which is called once the crystal is running, from the POWER_CLOCK
+ *  interrupt if it is still starting up, so that it need not wait for an
+ *  assumed startup time or block for it. The init and deinit functions of the
+ *  HF crystal are a request and release of the application. These must all
+ *  be used only while the SoftDevice is disabled, as the CLOCK peripheral is
+ *  restricted when it is enabled. The POWER_CLOCK interrupt is enabled only
+ *  while the crystal starts up, @ref hfclk_xtal_sd_enable_prepare must be
+ *  called before the SoftDevice is enabled.
  * @{
  */
 
 #include "stdbool.h"
 #include "nrf.h"
 
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+#ifndef HFCLK_XTAL_IRQ_PRIORITY
+/** Priority of the POWER_CLOCK interrupt from which the handlers of the
+ *  requests of the HF crystal are called */
+#define HFCLK_XTAL_IRQ_PRIORITY     APP_IRQ_PRIORITY_HIGH
+#endif
+
+/** The modules which request the HF crystal oscillator */
+typedef enum {
+    HFCLK_XTAL_USER_APP,            ///< Application, with the init and deinit functions
+    HFCLK_XTAL_USER_RADIO,          ///< Radio HAL
+    HFCLK_XTAL_USER_RADIO_TRIGGER,  ///< Radio trigger module, for its timeline
+    HFCLK_XTAL_USER_BLE_ADV,        ///< BLE advertising module
+    HFCLK_XTAL_USER_US_TIMER,       ///< us timer module
+    HFCLK_XTAL_USER_TSSP_IR_TX,     ///< TSSP IR transmission module, for its carrier
+    HFCLK_XTAL_USER_AUX_CLK,        ///< Auxiliary clock module
+    HFCLK_XTAL_USER_TIME_TRACKER,   ///< Time tracker module, for the LF RC calibration
+    HFCLK_XTAL_USER_MAX,            ///< Not a user, used to find the number of users
+} hfclk_xtal_user_t;
+
 /** The possible sources for Low frequency clock's 32 kHz input
  */
 typedef enum {
@@ -48,6 +84,21 @@ typedef enum {
  */
 void lfclk_init(lfclk_src_t lfclk_src);
 
+/** @brief Function to start a calibration of the LF RC oscillator against
+ *  the HF crystal oscillator, only if the LF clock is from the RC oscillator
+ *  and the HF crystal oscillator is already running.
+ * @return True if the calibration is started, which is done in about 17 ms
+ * @warning The HF crystal oscillator must be kept running till the
+ *  calibration is done, which can be checked with @ref lfclk_rc_calibration_is_done
+ */
+bool lfclk_rc_calibration_start(void);
+
+/** @brief Function to know if the last calibration of the LF RC oscillator
+ *  is done
+ * @return True if the calibration started last is done
+ */
+bool lfclk_rc_calibration_is_done(void);
+
 /** @brief Function to de-initialize the LF clock.
  * Saves a bit of power as LF clock is not running, but RTC or WDT cannot run
  * @warning Might be better to leave it on as it consumes little power.
@@ -55,13 +106,44 @@ void lfclk_init(lfclk_src_t lfclk_src);
  */
 void lfclk_deinit(void);
 
+/** @brief Function to request the crystal oscillator for the HF clock. The
+ *  crystal is started if it is not running and the HF clock runs from the
+ *  RC oscillator till then. Requesting again without a release is allowed.
+ * @param user The module requesting the crystal
+ * @param ready_handler Handler called once the crystal is running, right
+ *  away if it already is, else from the POWER_CLOCK interrupt. NULL if the
+ *  module need not know.
+ * @warning Beware of errata 68 in nRF52 */
+void hfclk_xtal_request(hfclk_xtal_user_t user, void (* ready_handler)(void));
+
+/** @brief Function to release the crystal oscillator requested by a module.
+ *  The crystal is stopped if no other module has it requested. The ready
+ *  handler of the module is not called if the crystal is still starting.
+ * @param user The module which had requested the crystal
+ */
+void hfclk_xtal_release(hfclk_xtal_user_t user);
+
+/** @brief Function to give up the POWER_CLOCK interrupt before the
+ *  SoftDevice is enabled, which fails if the interrupt is enabled. If the
+ *  crystal is starting, this waits for it and calls the ready handlers.
+ *  The crystal is left running for the modules which have it requested.
+ */
+void hfclk_xtal_sd_enable_prepare(void);
+
+/** @brief Function to know if the HF clock is running from the crystal
+ * @return True if the crystal oscillator is running
+ */
+bool hfclk_xtal_is_running(void);
+
 /** @brief Function to start the crystal oscillator to be used for HF clock.
- *  This function blocks until the crystal oscillator starts.
+ *  This function blocks until the crystal oscillator starts. It is the
+ *  request of the application.
  * @warning Beware of errata 68 in nRF52 */
 void hfclk_xtal_init_blocking(void);
 
 /** @brief Function to initialize the HF clock to use the crystal.
- *  This function returns immediately after triggering the start task. */
+ *  This function returns immediately after triggering the start task. It is
+ *  the request of the application. */
 void hfclk_xtal_init_nonblocking(void);
 
 /** @brief Blocks until the HF crystal oscillator is running
@@ -72,7 +154,8 @@ void hfclk_block_till_xtal(void);
 
 /** @brief Function to de-initialize the HF clock from using the crystal.
  * RC oscillator will be used to generate HF clock. More power and not accurate.
- * Starts quick though.*/
+ * Starts quick though. It is the release of the application, so the crystal
+ * keeps running if another module has it requested.*/
 void hfclk_xtal_deinit(void);
 
 
@@ -20,6 +20,7 @@
 #include "string.h"
 
 #include "hal_radio.h"
+#include "hal_clocks.h"
 #include "nrf.h"
 
 #if ISR_MANAGER == 1
@@ -47,6 +48,9 @@
 /** Static radio address (used in first iteration) */
 #define ADDR 0x8E89BE35
 
+/** Interframe spacing between a packet and its reply in us */
+#define TIFS_US 150
+
 /** Position of length parameter in payload */
 #define LEN_OFFSET 0
 
@@ -67,6 +71,19 @@ typedef struct
 /** Global variable to store payload */
 static payload_t payload_buff;
 
+/** Global variable to store received payload */
+static payload_t rx_payload_buff;
+
+/** Flag to check if the ongoing radio operation is a transmission */
+static volatile bool is_tx = false;
+
+/** Flag to check if the radio has to be turned around to RX after transmission */
+static volatile bool is_turnaround_pending = false;
+
+/** Flag to check if every reception is to be replied to, with the radio
+ *  turned around between RX and TX by the shorts */
+static volatile bool is_reply_en = false;
+
 /** Function pointer buffer for transmission done function pointer */
 void (* pb_tx_done_handler) (void * buff, uint32_t len);
 /** Function pointer buffer for reception done function pointer */
@@ -83,13 +100,8 @@ void hal_radio_init (hal_radio_config_t * radio_init_config)
         pb_rx_done_handler = radio_init_config->rx_done_handler;
     }
     
-    /**Enable HF Clock*/
-    if(NRF_CLOCK->HFCLKSTAT !=
-      ((CLOCK_HFCLKSTAT_STATE_Running << CLOCK_HFCLKSTAT_STATE_Pos) |
-      (CLOCK_HFCLKSTAT_SRC_Xtal << CLOCK_HFCLKSTAT_SRC_Pos)))
-    {
-        NRF_CLOCK->TASKS_HFCLKSTART = 1;
-    }
+    /**Enable HF Clock, till the radio is deinitialized*/
+    hfclk_xtal_request (HFCLK_XTAL_USER_RADIO, NULL);
     
     //Power on Radio
     NRF_RADIO->POWER = RADIO_POWER_POWER_Enabled;
@@ -120,8 +132,9 @@ void hal_radio_init (hal_radio_config_t * radio_init_config)
 
 
 
-    NRF_RADIO->BASE0 = (ADDR << 8) & 0xFFFFFF00;
-    NRF_RADIO->PREFIX0 = (ADDR >> 24) & 0xFF;
+    uint32_t addr = (radio_init_config->addr != 0) ? radio_init_config->addr : ADDR;
+    NRF_RADIO->BASE0 = (addr << 8) & 0xFFFFFF00;
+    NRF_RADIO->PREFIX0 = (addr >> 24) & 0xFF;
     NRF_RADIO->CRCINIT = 0x012345;
 
     NRF_RADIO->TXADDRESS =((0<<RADIO_TXADDRESS_TXADDRESS_Pos)&RADIO_TXADDRESS_TXADDRESS_Msk);    
@@ -134,8 +147,10 @@ void hal_radio_init (hal_radio_config_t * radio_init_config)
     NRF_RADIO->INTENSET |= ((RADIO_INTENSET_CRCERROR_Enabled 
         << RADIO_INTENSET_CRCERROR_Pos) & RADIO_INTENSET_CRCERROR_Msk)
         | ((RADIO_INTENSET_END_Enabled << RADIO_INTENSET_END_Pos) & RADIO_INTENSET_END_Msk)
-        | ((RADIO_INTENSET_CRCOK_Enabled << RADIO_INTENSET_CRCOK_Pos) & RADIO_INTENSET_CRCOK_Msk);
+        | ((RADIO_INTENSET_CRCOK_Enabled << RADIO_INTENSET_CRCOK_Pos) & RADIO_INTENSET_CRCOK_Msk)
+        | ((RADIO_INTENSET_DISABLED_Enabled << RADIO_INTENSET_DISABLED_Pos) & RADIO_INTENSET_DISABLED_Msk);
     NRF_RADIO->SHORTS = SHORT_READY_START | SHORT_END_DIS;
+    NRF_RADIO->TIFS = TIFS_US;
     NRF_RADIO->PACKETPTR = (uint32_t) &payload_buff;
     NVIC_SetPriority (RADIO_IRQn, radio_init_config->irq_priority);
     NVIC_EnableIRQ (RADIO_IRQn);
@@ -147,17 +162,108 @@ void hal_radio_set_tx_payload_data (void * p_payload, uint32_t len)
     memcpy (payload_buff.p_payload, p_payload, len);
 }
 
+/**
+ * @brief Function to bring the radio to disabled state, which is the only
+ *  state from which TX or RX can be enabled.
+ */
+static void radio_disable_wait (void)
+{
+    if(NRF_RADIO->STATE != RADIO_STATE_STATE_Disabled)
+    {
+        NRF_RADIO->SHORTS = SHORT_READY_START | SHORT_END_DIS;
+        NRF_RADIO->TASKS_DISABLE = 1;
+        while(NRF_RADIO->STATE != RADIO_STATE_STATE_Disabled);
+    }
+    //Events of the previous operation are not of any use now
+    NRF_RADIO->EVENTS_ADDRESS = 0;
+    NRF_RADIO->EVENTS_END = 0;
+    NRF_RADIO->EVENTS_DISABLED = 0;
+}
+
 void hal_radio_start_tx ()
 {
+    radio_disable_wait ();
+    is_tx = true;
+    is_turnaround_pending = false;
+    is_reply_en = false;
+    NRF_RADIO->PACKETPTR = (uint32_t) &payload_buff;
     NRF_RADIO->TASKS_TXEN = 1;
     
 }
 
+void hal_radio_start_tx_rx ()
+{
+    radio_disable_wait ();
+    is_tx = true;
+    is_turnaround_pending = true;
+    is_reply_en = false;
+    NRF_RADIO->PACKETPTR = (uint32_t) &payload_buff;
+    NRF_RADIO->SHORTS = SHORT_READY_START | SHORT_END_DIS | SHORT_DIS_RXEN;
+    NRF_RADIO->TASKS_TXEN = 1;
+}
+
 void hal_radio_start_rx ()
 {
+    radio_disable_wait ();
+    is_tx = false;
+    is_turnaround_pending = false;
+    is_reply_en = false;
+    NRF_RADIO->PACKETPTR = (uint32_t) &rx_payload_buff;
+    NRF_RADIO->TASKS_RXEN = 1;
+}
+
+void hal_radio_start_rx_reply ()
+{
+    radio_disable_wait ();
+    is_tx = false;
+    is_turnaround_pending = false;
+    is_reply_en = true;
+    NRF_RADIO->PACKETPTR = (uint32_t) &rx_payload_buff;
+    NRF_RADIO->SHORTS = SHORT_READY_START | SHORT_END_DIS | SHORT_DIS_TXEN;
     NRF_RADIO->TASKS_RXEN = 1;
 }
 
+void hal_radio_cancel_reply ()
+{
+    //The radio ramping up for the reply is brought back to RX by the short
+    NRF_RADIO->SHORTS = SHORT_READY_START | SHORT_END_DIS | SHORT_DIS_RXEN;
+    NRF_RADIO->TASKS_DISABLE = 1;
+}
+
+/**
+ * @brief Function called once the radio is disabled. When the radio is
+ *  turned around by a short, it is ramping up for the next operation by now,
+ *  so the packet pointer and the short after that operation are set here.
+ */
+static void radio_disabled_handler (void)
+{
+    switch(NRF_RADIO->STATE)
+    {
+        case RADIO_STATE_STATE_RxRu :
+        case RADIO_STATE_STATE_RxIdle :
+        case RADIO_STATE_STATE_Rx :
+            //The RX must not overwrite the TX payload and must not loop
+            //back to TX unless it is to be replied to
+            NRF_RADIO->PACKETPTR = (uint32_t) &rx_payload_buff;
+            NRF_RADIO->SHORTS = (is_reply_en == true) ?
+                (SHORT_READY_START | SHORT_END_DIS | SHORT_DIS_TXEN) :
+                (SHORT_READY_START | SHORT_END_DIS);
+            is_turnaround_pending = false;
+            is_tx = false;
+            break;
+        case RADIO_STATE_STATE_TxRu :
+        case RADIO_STATE_STATE_TxIdle :
+        case RADIO_STATE_STATE_Tx :
+            //Only a reply is sent by a short, after which RX follows
+            NRF_RADIO->PACKETPTR = (uint32_t) &payload_buff;
+            NRF_RADIO->SHORTS = SHORT_READY_START | SHORT_END_DIS | SHORT_DIS_RXEN;
+            is_tx = true;
+            break;
+        default :
+            break;
+    }
+}
+
 void hal_radio_stop ()
 {
     NRF_RADIO->TASKS_DISABLE = 1;
@@ -171,6 +277,7 @@ void hal_radio_deinit ()
     NRF_RADIO->TASKS_DISABLE = 1;
     NRF_RADIO->POWER = (RADIO_POWER_POWER_Disabled << RADIO_POWER_POWER_Pos) &
         RADIO_POWER_POWER_Msk;
+    hfclk_xtal_release (HFCLK_XTAL_USER_RADIO);
 }
 
 bool hal_radio_is_on ()
@@ -178,6 +285,36 @@ bool hal_radio_is_on ()
     return (NRF_RADIO->STATE != RADIO_STATE_STATE_Disabled) ? true : false;
 }
 
+bool hal_radio_is_packet_ongoing ()
+{
+    switch(NRF_RADIO->STATE)
+    {
+        case RADIO_STATE_STATE_TxRu :
+        case RADIO_STATE_STATE_TxIdle :
+        case RADIO_STATE_STATE_Tx :
+        case RADIO_STATE_STATE_TxDisable :
+            return true;
+        case RADIO_STATE_STATE_Rx :
+            return (NRF_RADIO->EVENTS_ADDRESS == 1) ? true : false;
+        default :
+            return false;
+    }
+}
+
+uint32_t hal_radio_get_rssi ()
+{
+    if(NRF_RADIO->STATE != RADIO_STATE_STATE_Rx)
+    {
+        return 127;
+    }
+    NRF_RADIO->EVENTS_RSSIEND = 0;
+    NRF_RADIO->TASKS_RSSISTART = 1;
+    //Sampling takes 0.25 us
+    while(NRF_RADIO->EVENTS_RSSIEND == 0);
+    NRF_RADIO->EVENTS_RSSIEND = 0;
+    return NRF_RADIO->RSSISAMPLE;
+}
+
 
 #if ISR_MANAGER == 1
 void hal_radio_Handler ()
@@ -192,7 +329,7 @@ void RADIO_IRQHandler ()
 #endif
         if(pb_rx_done_handler != NULL)
         {
-            pb_rx_done_handler (payload_buff.p_payload, payload_buff.payload_len - 1);
+            pb_rx_done_handler (rx_payload_buff.p_payload, rx_payload_buff.payload_len - 1);
         }
     }
     if(NRF_RADIO->EVENTS_CRCERROR == 1)
@@ -200,16 +337,27 @@ void RADIO_IRQHandler ()
 #if ISR_MANAGER == false
         NRF_RADIO->EVENTS_CRCERROR = 0;
 #endif
-        
+        if(is_reply_en == true)
+        {
+            hal_radio_cancel_reply ();
+        }
     }
     if(NRF_RADIO->EVENTS_END == 1)
     {
 #if ISR_MANAGER == false
         NRF_RADIO->EVENTS_END = 0;
 #endif
-        if(pb_tx_done_handler != NULL)
+        if((is_tx == true) && (pb_tx_done_handler != NULL))
         {
             pb_tx_done_handler (payload_buff.p_payload, payload_buff.payload_len - 1);
         }
     }
+    if(NRF_RADIO->EVENTS_DISABLED == 1)
+    {
+        //Cleared here also with the ISR manager, as the DISABLED of the END to
+        //DISABLE short can come after this check and must not be lost
+        NRF_RADIO->EVENTS_DISABLED = 0;
+        (void) NRF_RADIO->EVENTS_DISABLED;
+        radio_disabled_handler ();
+    }
 }
@@ -42,6 +42,8 @@ typedef struct
     uint32_t freq;
     /** IRQ Priority level */
     app_irq_priority_t irq_priority;
+    /** 32 bit radio address (prefix byte and 3 byte base), default address is used if 0 */
+    uint32_t addr;
     /** Pointer to the function which is to be called once transmission is done */
     void (* tx_done_handler) (void * p_buff, uint32_t len);
     /** Pointer to the function which is to be called once reception is done */
@@ -49,7 +51,8 @@ typedef struct
 }hal_radio_config_t;
 
 /**
- * @brief Function to Initiate Radio peripheral
+ * @brief Function to Initiate Radio peripheral. The HF crystal is requested
+ *  till @ref hal_radio_deinit, the radio must be started only once it runs.
  * @param radio_init_config Configuration used to initiate the radio peripheral
  */
 void hal_radio_init (hal_radio_config_t * radio_init_config);
@@ -66,18 +69,45 @@ void hal_radio_set_tx_payload_data (void * p_payload, uint32_t len);
  */
 void hal_radio_start_tx ();
 
+/**
+ * @brief Function to start data transmission followed by reception
+ * @details The radio is turned around from TX to RX by the DISABLED to RXEN
+ *  short without CPU intervention, so that a reply like an acknowledgement
+ *  can be received right after the transmission.
+ */
+void hal_radio_start_tx_rx ();
+
 /**
  * @brief Function to start data reception
  */
 void hal_radio_start_rx ();
 
+/**
+ * @brief Function to start data reception in which every packet received is
+ *  replied to
+ * @details The radio is turned around from RX to TX by the DISABLED to TXEN
+ *  short, so that the reply is sent the interframe spacing after the end of
+ *  the received packet, and back to RX after the reply. The reply is the
+ *  payload set with @ref hal_radio_set_tx_payload_data from the reception
+ *  done handler. A packet with a CRC error is not replied to.
+ */
+void hal_radio_start_rx_reply ();
+
+/**
+ * @brief Function to not reply to the packet just received, to be called from
+ *  the reception done handler after @ref hal_radio_start_rx_reply. The radio
+ *  goes back to RX.
+ */
+void hal_radio_cancel_reply ();
+
 /**
  * @brief Function to stop radio peripheral
  */
 void hal_radio_stop ();
 
 /**
- * @brief Function to de-initiate the radio peripheral. 
+ * @brief Function to de-initiate the radio peripheral and release the HF
+ *  crystal.
  */
 void hal_radio_deinit ();
 
@@ -89,6 +119,19 @@ void hal_radio_deinit ();
  */
 bool hal_radio_is_on ();
 
+/**
+ * @brief Function to check if a packet is on air for the radio, i.e. it is
+ *  transmitting or it has matched an address while receiving.
+ * @return True if a packet is being transmitted or received
+ */
+bool hal_radio_is_packet_ongoing ();
+
+/**
+ * @brief Function to sample the received signal strength on the channel
+ * @return RSSI in -dBm, 127 if radio is not receiving
+ */
+uint32_t hal_radio_get_rssi ();
+
 //For future development
 
 /***/
@@ -24,6 +24,7 @@
 #include "stddef.h"
 #include "nrf_assert.h"
 #include "log.h"
+#include "CBUF.h"
 
 #if ISR_MANAGER == 1
 #include "isr_manager.h"
@@ -53,6 +54,39 @@ static uint32_t intr_enabled = 0;
 /** Status flag */
 static volatile bool mod_is_busy = false;
 
+/** Size of the transfer queue, used by CBUF */
+#define xfer_queue_SIZE HAL_SPIM_QUEUE_SIZE
+
+/** Transfers waiting for the ongoing one to finish */
+static volatile struct
+{
+    uint32_t m_getIdx;
+    uint32_t m_putIdx;
+    const hal_spim_xfer_t * m_entry[xfer_queue_SIZE];
+}xfer_queue;
+
+/** Ongoing transfer */
+static const hal_spim_xfer_t * p_curr_xfer = NULL;
+
+/** Segment of the ongoing transfer */
+static const hal_spim_seg_t * p_curr_seg = NULL;
+
+/** Number of segments left after the ongoing one */
+static uint32_t seg_left = 0;
+
+/** Transfer used by @ref hal_spim_tx_rx and @ref hal_spim_tx_rx_seg with
+ *  the settings given at init */
+static hal_spim_xfer_t default_xfer;
+
+/** Segment used by @ref hal_spim_tx_rx */
+static hal_spim_seg_t default_seg;
+
+/** Set while the default transfer is queued or ongoing */
+static volatile bool is_default_busy = false;
+
+/** Function to be called when the transfer from @ref hal_spim_tx_rx_seg is done */
+static void (*seg_done) (void) = NULL;
+
 /** Function pointer buffers */
 void (*rx_done) (uint32_t last_byte_no);
 void (*tx_done) (uint32_t last_byte_no);
@@ -68,6 +102,10 @@ void hal_spim_init (hal_spim_init_t * spim_init)
     SPIM_ID->PSEL.MOSI = spim_init->mosi_pin;
     SPIM_ID->PSEL.SCK = spim_init->sck_pin;
     csBar = spim_init->csBar_pin;
+    default_xfer.csBar_pin = spim_init->csBar_pin;
+    default_xfer.freq = spim_init->freq;
+    default_xfer.spi_mode = spim_init->spi_mode;
+    default_xfer.byte_order = spim_init->byte_order;
     intr_enabled = spim_init->en_intr;
     SPIM_ID->INTENSET = spim_init->en_intr | SPIM_INTENSET_END_Msk;
         NVIC_SetPriority (SPIM_IRQN, APP_IRQ_PRIORITY_MID);
@@ -91,21 +129,41 @@ void hal_spim_init (hal_spim_init_t * spim_init)
     }
     SPIM_ID->TXD.LIST = 1;
     SPIM_ID->RXD.LIST = 1;
+    CBUF_Init (xfer_queue);
     mod_is_busy = false;
 }
 
 void hal_spim_deinit ()
 {
+    CRITICAL_REGION_ENTER();
+    NVIC_DisableIRQ (SPIM_IRQN);
     SPIM_ID->ENABLE = (SPIM_ENABLE_ENABLE_Disabled << SPIM_ENABLE_ENABLE_Pos) &
         SPIM_ENABLE_ENABLE_Msk;
     SPIM_ID->INTENCLR = intr_enabled;
     SPIM_ID->TASKS_SUSPEND = 1;
     SPIM_ID->TASKS_STOP = 1;
+    //Release the device of an ongoing transfer and drop the queued ones
+    if((mod_is_busy == true) && (p_curr_xfer != NULL)
+            && (p_curr_xfer->csBar_pin != HAL_SPIM_CS_NONE))
+    {
+        hal_gpio_pin_set (p_curr_xfer->csBar_pin);
+    }
+    CBUF_Init (xfer_queue);
+    p_curr_xfer = NULL;
+    seg_left = 0;
+    is_default_busy = false;
     mod_is_busy = true;
-    NVIC_DisableIRQ (SPIM_IRQN);    
+    CRITICAL_REGION_EXIT();
 }
 
-void hal_spim_tx_rx (void * p_tx_data, uint32_t tx_len, void * p_rx_data, uint32_t rx_len)
+/**
+ * @brief Function to program the EasyDMA pointers and start a transaction
+ * @param p_tx_data Pointer to the data which is to be sent
+ * @param tx_len Number of bytes which are to be sent
+ * @param p_rx_data Pointer to the location where received data is to be stored.
+ * @param rx_len Number of received bytes which are to be stored
+ */
+static void spim_start (const void * p_tx_data, uint32_t tx_len, void * p_rx_data, uint32_t rx_len)
 {
     if(p_tx_data == NULL)
     {
@@ -115,7 +173,6 @@ void hal_spim_tx_rx (void * p_tx_data, uint32_t tx_len, void * p_rx_data, uint32
     {
         ASSERT(rx_len == 0);
     }
-    hal_gpio_pin_clear (csBar);
 
     SPIM_ID->EVENTS_ENDTX = 0;
     SPIM_ID->TXD.PTR = (uint32_t) p_tx_data;
@@ -127,16 +184,151 @@ void hal_spim_tx_rx (void * p_tx_data, uint32_t tx_len, void * p_rx_data, uint32
 
     SPIM_ID->ENABLE = (SPIM_ENABLE_ENABLE_Enabled << SPIM_ENABLE_ENABLE_Pos) &
         SPIM_ENABLE_ENABLE_Msk;
-    mod_is_busy = true;
     SPIM_ID->TASKS_START = 1;
     (void) SPIM_ID->TASKS_START;
 }
 
+/**
+ * @brief Function to apply the settings of a transfer and start its first segment
+ * @param p_xfer Transfer which is to be started
+ */
+static void spim_xfer_start (const hal_spim_xfer_t * p_xfer)
+{
+    p_curr_xfer = p_xfer;
+    p_curr_seg = p_xfer->p_seg;
+    seg_left = p_xfer->seg_cnt - 1;
+
+    SPIM_ID->CONFIG = p_xfer->byte_order | ((p_xfer->spi_mode)<<1);
+    SPIM_ID->FREQUENCY = p_xfer->freq;
+    if(p_xfer->csBar_pin != HAL_SPIM_CS_NONE)
+    {
+        hal_gpio_pin_clear (p_xfer->csBar_pin);
+    }
+    spim_start (p_curr_seg->p_tx, p_curr_seg->tx_len,
+                p_curr_seg->p_rx, p_curr_seg->rx_len);
+}
+
+bool hal_spim_queue_xfer (const hal_spim_xfer_t * p_xfer)
+{
+    bool is_queued = true;
+    ASSERT(p_xfer->seg_cnt != 0);
+
+    CRITICAL_REGION_ENTER();
+    if(mod_is_busy == false)
+    {
+        mod_is_busy = true;
+        spim_xfer_start (p_xfer);
+    }
+    else if(CBUF_IsFull (xfer_queue))
+    {
+        is_queued = false;
+    }
+    else
+    {
+        CBUF_Push (xfer_queue, p_xfer);
+    }
+    CRITICAL_REGION_EXIT();
+
+    return is_queued;
+}
+
+/**
+ * @brief Function called when the transfer from @ref hal_spim_tx_rx or
+ *  @ref hal_spim_tx_rx_seg is done
+ * @param p_context Not used
+ */
+static void default_xfer_done (void * p_context)
+{
+    is_default_busy = false;
+    if(seg_done != NULL)
+    {
+        seg_done ();
+    }
+}
+
+/**
+ * @brief Function to claim the default transfer before its settings are changed
+ * @return True if it was free, false if it is still queued or ongoing
+ */
+static bool default_xfer_claim (void)
+{
+    bool is_free;
+
+    CRITICAL_REGION_ENTER();
+    is_free = (is_default_busy == false);
+    is_default_busy = true;
+    CRITICAL_REGION_EXIT();
+
+    return is_free;
+}
+
+/**
+ * @brief Function to queue the default transfer once it is claimed and set up
+ * @return True if it is started or queued
+ */
+static bool default_xfer_queue (void)
+{
+    if(hal_spim_queue_xfer (&default_xfer) == false)
+    {
+        is_default_busy = false;
+        return false;
+    }
+    return true;
+}
+
+bool hal_spim_tx_rx (void * p_tx_data, uint32_t tx_len, void * p_rx_data, uint32_t rx_len)
+{
+    if(default_xfer_claim () == false)
+    {
+        return false;
+    }
+    default_seg.p_tx = p_tx_data;
+    default_seg.tx_len = tx_len;
+    default_seg.p_rx = p_rx_data;
+    default_seg.rx_len = rx_len;
+    seg_done = NULL;
+    default_xfer.p_seg = &default_seg;
+    default_xfer.seg_cnt = 1;
+    default_xfer.done_handler = default_xfer_done;
+    return default_xfer_queue ();
+}
+
+bool hal_spim_tx_rx_seg (const hal_spim_seg_t * p_seg, uint32_t seg_cnt,
+                         void (* done_handler) (void))
+{
+    if(default_xfer_claim () == false)
+    {
+        return false;
+    }
+    seg_done = done_handler;
+    default_xfer.p_seg = p_seg;
+    default_xfer.seg_cnt = seg_cnt;
+    default_xfer.done_handler = default_xfer_done;
+    return default_xfer_queue ();
+}
+
 uint32_t hal_spim_is_busy ()
 {
     return (uint32_t)mod_is_busy;
 }
 
+bool hal_spim_is_irq_blocked (void)
+{
+    uint32_t exc_no = __get_IPSR ();
+
+    if(__get_PRIMASK () != 0)
+    {
+        return true;
+    }
+    //Thread mode is preempted by any interrupt
+    if(exc_no == 0)
+    {
+        return false;
+    }
+    return (NVIC_GetPriority ((IRQn_Type) ((int32_t) exc_no - 16))
+            <= NVIC_GetPriority (SPIM_IRQN));
+}
+
 #if ISR_MANAGER == 1
 void hal_spim_Handler (void)
 #else
@@ -148,8 +340,36 @@ void SPIM_IRQ_Handler (void)
 #if ISR_MANAGER == 0
         SPIM_ID->EVENTS_END = 0;
 #endif
-        mod_is_busy = false;
-        hal_gpio_pin_set (csBar);
+        if(seg_left != 0)
+        {
+            seg_left--;
+            p_curr_seg++;
+            spim_start (p_curr_seg->p_tx, p_curr_seg->tx_len,
+                        p_curr_seg->p_rx, p_curr_seg->rx_len);
+        }
+        else
+        {
+            const hal_spim_xfer_t * p_done_xfer = p_curr_xfer;
+            if(p_done_xfer->csBar_pin != HAL_SPIM_CS_NONE)
+            {
+                hal_gpio_pin_set (p_done_xfer->csBar_pin);
+            }
+
+            //Next transfer goes out before the callback of this one is run
+            if(CBUF_IsEmpty (xfer_queue))
+            {
+                mod_is_busy = false;
+            }
+            else
+            {
+                spim_xfer_start (CBUF_Pop (xfer_queue));
+            }
+
+            if(p_done_xfer->done_handler != NULL)
+            {
+                p_done_xfer->done_handler (p_done_xfer->p_context);
+            }
+        }
     }
     if(SPIM_ID->EVENTS_ENDTX == 1 && ((intr_enabled & HAL_SPIM_TX_DONE) != 0))
     {
@@ -32,6 +32,7 @@
 
 #include "nrf.h"
 #include "nrf_util.h"
+#include "stdbool.h"
 
 #if SYS_CFG_PRESENT == 1
 #include "sys_config.h"
@@ -45,6 +46,14 @@
 #endif
 
 
+#ifndef HAL_SPIM_QUEUE_SIZE
+/** Number of transfers which can wait for the SPIM, must be a power of 2 */
+#define HAL_SPIM_QUEUE_SIZE 8
+#endif
+
+/** CS Bar pin number for a transfer which does not need a CS Bar */
+#define HAL_SPIM_CS_NONE 0xFFFFFFFF
+
 /** Enum containing list of all the possible transmission frequencies */
 typedef enum
 {
@@ -121,6 +130,44 @@ typedef struct
     void (*rx_done_handler )(uint32_t bytes_last_rx);
 }hal_spim_init_t;
 
+/** Segment of a transfer. The segments of a transfer are clocked out back to
+ *  back with CS Bar held low, so a header and a payload kept in different
+ *  buffers go out as one SPI transaction without being copied together. */
+typedef struct
+{
+    /** Data which is to be sent, must be in RAM. Can be NULL if tx_len is 0 */
+    const void * p_tx;
+    /** Number of bytes which are to be sent, 0x00 is sent after these */
+    uint32_t tx_len;
+    /** Location where received data is to be stored, can be NULL if rx_len is 0 */
+    void * p_rx;
+    /** Number of received bytes which are to be stored */
+    uint32_t rx_len;
+}hal_spim_seg_t;
+
+/** A transfer to one of the devices on the SPI bus. Transfers are queued and
+ *  sent one after the other, each with the settings of its own device. */
+typedef struct
+{
+    /** CS Bar Pin No, which should already be configured as an output set high.
+     *  @ref HAL_SPIM_CS_NONE if the device does not need one */
+    uint32_t csBar_pin;
+    /** Clock Frequency */
+    hal_spim_freq_t freq;
+    /** SPI mode of the device */
+    hal_spim_spi_mode_t spi_mode;
+    /** Byte Order of the device */
+    hal_spim_byte_order_t byte_order;
+    /** Pointer to the array of segments of the transfer */
+    const hal_spim_seg_t * p_seg;
+    /** Number of segments in the array */
+    uint32_t seg_cnt;
+    /** Function to be called from the interrupt when the transfer is done, can be NULL */
+    void (* done_handler) (void * p_context);
+    /** Parameter passed to the done_handler */
+    void * p_context;
+}hal_spim_xfer_t;
+
 /**
  * @brief Function to Initiate the SPIM module
  * @param spim_init Settings which is to be used to initiate the SPIM module. 
@@ -128,24 +175,63 @@ typedef struct
 void hal_spim_init (hal_spim_init_t * spim_init);
 
 /**
- * @brief Function to start communication
+ * @brief Function to start communication with the device whose settings were
+ *  given at init. This is queued behind any other transfers.
  * @param p_tx_data Pointer to the data which is to be sent
  * @param tx_len Number of bytes which are to be sent
  * @param p_rx_data Pointer to the location where received data is to be stored.
  * @param rx_len Number of received bytes which are to be stored
+ * @return True if the transfer is started or queued, false if the previous
+ *  transfer with the init settings is not done yet or the queue is full
+ */
+bool hal_spim_tx_rx (void * p_tx_data, uint32_t tx_len, void * p_rx_data, uint32_t rx_len);
+
+/**
+ * @brief Function to queue a transfer. It is started right away if the SPIM
+ *  is free, else from the END interrupt of the transfer before it.
+ * @param p_xfer Pointer to the transfer, which along with its segments must
+ *  remain valid till its done_handler is called
+ * @return True if the transfer is started or queued, false if the queue is full
+ */
+bool hal_spim_queue_xfer (const hal_spim_xfer_t * p_xfer);
+
+/**
+ * @brief Function to start a transfer made of multiple segments
+ * @param p_seg Pointer to the array of segments, which must remain valid till
+ *  the transfer is done
+ * @param seg_cnt Number of segments in the array
+ * @param done_handler Function to be called from the interrupt once the
+ *  whole transfer is done and CS Bar is released, can be NULL
+ * @note The next segment is started from the END interrupt, so the gap
+ *  between segments is the interrupt latency. CS Bar stays low meanwhile.
+ *  This uses the device settings given at init and is queued like
+ *  @ref hal_spim_tx_rx.
+ * @return True if the transfer is started or queued, false if the previous
+ *  transfer with the init settings is not done yet or the queue is full
  */
-void hal_spim_tx_rx (void * p_tx_data, uint32_t tx_len, void * p_rx_data, uint32_t rx_len);
+bool hal_spim_tx_rx_seg (const hal_spim_seg_t * p_seg, uint32_t seg_cnt,
+                         void (* done_handler) (void));
 
 /**
  * @brief Function to check if SIPM module is available or not
  * @return Status of hal_spim module
- * @retval true hal_spim module is not available
+ * @retval true hal_spim module has a transfer ongoing or queued
  * @retval false hal_spim module is available
  */
 uint32_t hal_spim_is_busy ();
 
 /**
- * @brief Function to de-initialize the SPIM module
+ * @brief Function to check if the SPIM interrupt can preempt the caller. A
+ *  caller which it can't preempt must not wait for a transfer to be done.
+ * @return True if the caller runs with interrupts disabled or at a priority
+ *  equal to or higher than the SPIM interrupt
+ */
+bool hal_spim_is_irq_blocked (void);
+
+/**
+ * @brief Function to de-initialize the SPIM module. The ongoing transfer is
+ *  stopped and the queued ones are dropped, without their done_handler
+ *  being called.
  */
 void hal_spim_deinit ();
 
@@ -18,7 +18,10 @@
 
 #include "hal_twim.h"
 #include "stdbool.h"
+#include "stddef.h"
 #include "common_util.h"
+#include "nrf_assert.h"
+#include "CBUF.h"
 
 #if ISR_MANAGER == 1
 #include "isr_manager.h"
@@ -29,11 +32,42 @@ static struct {
     uint32_t sda;
     twim_transfer_t current_transfer;
     void (*handler)(twim_err_t err, twim_transfer_t transfer);
-    bool transfer_finished;
+    volatile bool transfer_finished;
     bool on;
     uint8_t evt_mask;
+    /** Ongoing transaction */
+    const hal_twim_xfer_t * p_xfer;
+    /** Index of the ongoing step in the script of the transaction */
+    uint32_t op_idx;
+    /** Error of the ongoing transaction */
+    twim_err_t err;
 }twim_status;
 
+/** Size of the transaction queue, used by CBUF */
+#define xfer_queue_SIZE HAL_TWIM_QUEUE_SIZE
+
+/** Transactions waiting for the ongoing one to finish */
+static volatile struct
+{
+    uint32_t m_getIdx;
+    uint32_t m_putIdx;
+    const hal_twim_xfer_t * m_entry[xfer_queue_SIZE];
+}xfer_queue;
+
+static void default_xfer_done (twim_err_t err, void * p_context);
+
+/** Step used by the transfer calls to the slave given at init */
+static hal_twim_op_t default_op;
+
+/** Transaction used by the transfer calls to the slave given at init */
+static hal_twim_xfer_t default_xfer =
+{
+    .p_ops = &default_op,
+    .op_cnt = 1,
+    .done_handler = default_xfer_done,
+    .p_context = NULL,
+};
+
 /** @anchor twim_defines
  * @name Defines for the specific RTC peripheral used for ms timer
  * @{*/
@@ -53,12 +87,13 @@ static struct {
          (void) (x); \
     }while(0)
 
-static inline void send_event(twim_transfer_t txfr)
+static void default_xfer_done (twim_err_t err, void * p_context)
 {
     //This works because the masks are 1 shifts of the transfer types
-    if(twim_status.evt_mask | (1 << txfr))
+    if((err != TWIM_ERR_NONE) ||
+        (twim_status.evt_mask & (1 << twim_status.current_transfer)))
     {
-        twim_status.handler(TWIM_ERR_NONE, twim_status.current_transfer);
+        twim_status.handler(err, twim_status.current_transfer);
     }
 }
 
@@ -75,28 +110,69 @@ static void clear_all_events(void)
 
 static void handle_error(void)
 {
-
-    TWIM_ID->INTENCLR = TWIM_INTENCLR_STOPPED_Msk;
-    (void)TWIM_ID->INTENCLR;
-
-    twim_err_t err;
     if((TWIM_ID->ERRORSRC & TWIM_ERRORSRC_ANACK_Msk))
     {
         TWIM_ID->ERRORSRC = TWIM_ERRORSRC_ANACK_Msk;
-        err = TWIM_ERR_ADRS_NACK;
+        twim_status.err = TWIM_ERR_ADRS_NACK;
     }
 
     if((TWIM_ID->ERRORSRC & TWIM_ERRORSRC_DNACK_Msk))
     {
         TWIM_ID->ERRORSRC = TWIM_ERRORSRC_DNACK_Msk;
-        err = TWIM_ERR_DATA_NACK;
+        twim_status.err = TWIM_ERR_DATA_NACK;
     }
-    twim_status.handler(err, twim_status.current_transfer);
-    /**TODO The stop will not generate an interrupt only when
-    its at the end of this function. WHY??? */
+    //The STOPPED event after this ends the transaction with the error
     TWIM_ID->TASKS_STOP = 1;
 }
 
+/**
+ * @brief Start a step of the ongoing transaction. The shorts end every step
+ *  with a stop condition, so the STOPPED event marks the end of the step.
+ * @param p_op Pointer to the step
+ */
+static void op_start (const hal_twim_op_t * p_op)
+{
+    clear_all_events();
+    TWIM_ID->TXD.PTR = (uint32_t) p_op->p_tx;
+    TWIM_ID->TXD.MAXCNT = p_op->tx_len;
+    TWIM_ID->RXD.PTR = (uint32_t) p_op->p_rx;
+    TWIM_ID->RXD.MAXCNT = p_op->rx_len;
+
+    if(p_op->tx_len == 0)
+    {
+        TWIM_ID->SHORTS = TWIM_SHORTS_LASTRX_STOP_Msk;
+        TWIM_ID->TASKS_STARTRX = 1;
+    }
+    else if(p_op->rx_len == 0)
+    {
+        TWIM_ID->SHORTS = TWIM_SHORTS_LASTTX_STOP_Msk;
+        TWIM_ID->TASKS_STARTTX = 1;
+    }
+    else
+    {
+        TWIM_ID->SHORTS = TWIM_SHORTS_LASTTX_STARTRX_Msk |
+                TWIM_SHORTS_LASTRX_STOP_Msk;
+        TWIM_ID->TASKS_STARTTX = 1;
+    }
+}
+
+/**
+ * @brief Start the first step of a transaction
+ * @param p_xfer Pointer to the transaction
+ */
+static void xfer_start (const hal_twim_xfer_t * p_xfer)
+{
+    twim_status.p_xfer = p_xfer;
+    twim_status.op_idx = 0;
+    twim_status.err = TWIM_ERR_NONE;
+    TWIM_ID->ADDRESS = p_xfer->address;
+
+    //Error is always set, as its required to recover from an error
+    TWIM_ID->INTEN = TWIM_INTENSET_ERROR_Msk | TWIM_INTENSET_STOPPED_Msk;
+    (void)TWIM_ID->INTEN;
+    op_start (p_xfer->p_ops);
+}
+
 void hal_twim_init(hal_twim_init_config_t * config)
 {
     //Configure as strong drive low and disconnect high with pull-ups
@@ -118,8 +194,10 @@ void hal_twim_init(hal_twim_init_config_t * config)
 
     TWIM_ID->FREQUENCY = config->frequency;
     TWIM_ID->ADDRESS = config->address;
+    default_xfer.address = config->address;
     //Use EasyDMA
     TWIM_ID->TXD.LIST = TWIM_TXD_LIST_LIST_Msk;
+    TWIM_ID->RXD.LIST = TWIM_RXD_LIST_LIST_Msk;
 
     clear_all_events();
     NVIC_ClearPendingIRQ(TWIM_IRQN);
@@ -130,6 +208,7 @@ void hal_twim_init(hal_twim_init_config_t * config)
     twim_status.evt_mask = config->evt_mask;
     twim_status.handler = config->evt_handler;
     twim_status.transfer_finished = true;
+    CBUF_Init (xfer_queue);
     twim_status.on = true;
 }
 
@@ -139,6 +218,7 @@ void hal_twim_uninit(void)
         return;
     }
     twim_status.on = false;
+    TWIM_ID->INTEN = 0;
     TWIM_ID->ENABLE = TWIM_ENABLE_ENABLE_Disabled << TWIM_ENABLE_ENABLE_Pos;
 
     NVIC_ClearPendingIRQ(TWIM_IRQN);
@@ -159,114 +239,96 @@ void hal_twim_uninit(void)
             | (GPIO_PIN_CNF_DIR_Input      << GPIO_PIN_CNF_DIR_Pos));
 
     TWIM_ID->ADDRESS = 0;
+    CBUF_Init (xfer_queue);
+    twim_status.transfer_finished = true;
 }
 
-static twim_ret_status initial_txfr_check(void){
+bool hal_twim_queue_xfer(const hal_twim_xfer_t * p_xfer)
+{
+    bool is_queued = true;
+    ASSERT(p_xfer->op_cnt != 0);
+
     if(twim_status.on == false)
     {
-        return TWIM_UNINIT;
+        return false;
     }
 
-    //Starting from a previous transfer where TWIM_TRANSFER_DONE_MSK wasn't set
-    if(TWIM_ID->EVENTS_STOPPED)
+    CRITICAL_REGION_ENTER();
+    if(twim_status.transfer_finished == true)
     {
-        twim_status.transfer_finished = true;
-        return TWIM_STARTED;
+        twim_status.transfer_finished = false;
+        xfer_start (p_xfer);
     }
-
-    if(twim_status.transfer_finished == false)
+    else if(CBUF_IsFull (xfer_queue))
     {
-        return TWIM_BUSY;
+        is_queued = false;
     }
-    return TWIM_STARTED;
-}
-
-twim_ret_status hal_twim_tx(uint8_t * tx_ptr, uint32_t tx_len)
-{
-    twim_ret_status check_val = initial_txfr_check();
-    if(check_val != TWIM_STARTED)
+    else
     {
-        return check_val;
+        CBUF_Push (xfer_queue, p_xfer);
     }
+    CRITICAL_REGION_EXIT();
 
-    clear_all_events();
-    TWIM_ID->TXD.PTR = (uint32_t) tx_ptr;
-    TWIM_ID->TXD.MAXCNT = tx_len;
-    TWIM_ID->SHORTS = TWIM_SHORTS_LASTTX_STOP_Msk;
-    TWIM_ID->TASKS_STARTTX = 1;
-
-    twim_status.current_transfer = TWIM_TX;
-    twim_status.transfer_finished = false;
-
-    //Error is always set, as its required to recover from an error
-    TWIM_ID->INTEN = TWIM_INTENSET_ERROR_Msk;
-    (void)TWIM_ID->INTEN;
-    TWIM_ID->INTENSET = (twim_status.evt_mask & TWIM_TX_DONE_MSK)?
-            (TWIM_INTENSET_STOPPED_Msk) : 0 ;
+    return is_queued;
+}
 
-    return TWIM_STARTED;
+bool hal_twim_is_busy(void)
+{
+    return !twim_status.transfer_finished;
 }
 
-twim_ret_status hal_twim_rx(uint8_t * rx_ptr, uint32_t rx_len)
+/**
+ * @brief Start a transfer with the slave given at init
+ * @param type Type of the transfer
+ * @param p_op Step with the data of the transfer
+ * @return Status of the transfer as per @ref twim_ret_status
+ */
+static twim_ret_status default_xfer_start(twim_transfer_t type,
+        const hal_twim_op_t * p_op)
 {
-    twim_ret_status check_val = initial_txfr_check();
-    if(check_val != TWIM_STARTED)
+    if(twim_status.on == false)
     {
-        return check_val;
+        return TWIM_UNINIT;
     }
 
-    clear_all_events();
-    TWIM_ID->RXD.PTR = (uint32_t) rx_ptr;
-    TWIM_ID->RXD.MAXCNT = rx_len;
-    TWIM_ID->SHORTS = TWIM_SHORTS_LASTRX_STOP_Msk;
-    TWIM_ID->TASKS_STARTRX = 1;
+    if(twim_status.transfer_finished == false)
+    {
+        return TWIM_BUSY;
+    }
 
-    twim_status.current_transfer = TWIM_RX;
-    twim_status.transfer_finished = false;
+    default_op = *p_op;
+    twim_status.current_transfer = type;
+    hal_twim_queue_xfer (&default_xfer);
+    return TWIM_STARTED;
+}
 
-    //Error is always set, as its required to recover from an error
-    TWIM_ID->INTEN = TWIM_INTENSET_ERROR_Msk;
-    (void)TWIM_ID->INTEN;
-    TWIM_ID->INTENSET = (twim_status.evt_mask & TWIM_RX_DONE_MSK)?
-            (TWIM_INTENSET_STOPPED_Msk) : 0 ;
+twim_ret_status hal_twim_tx(uint8_t * tx_ptr, uint32_t tx_len)
+{
+    hal_twim_op_t op = {.p_tx = tx_ptr, .tx_len = tx_len,
+        .p_rx = NULL, .rx_len = 0};
+    return default_xfer_start (TWIM_TX, &op);
+}
 
-    return TWIM_STARTED;
+twim_ret_status hal_twim_rx(uint8_t * rx_ptr, uint32_t rx_len)
+{
+    hal_twim_op_t op = {.p_tx = NULL, .tx_len = 0,
+        .p_rx = rx_ptr, .rx_len = rx_len};
+    return default_xfer_start (TWIM_RX, &op);
 }
 
 twim_ret_status hal_twim_tx_rx(uint8_t * tx_ptr, uint32_t tx_len,
         uint8_t * rx_ptr, uint32_t rx_len)
 {
-    twim_ret_status check_val = initial_txfr_check();
-    if(check_val != TWIM_STARTED)
-    {
-        return check_val;
-    }
-
-    clear_all_events();
-    TWIM_ID->TXD.PTR = (uint32_t) tx_ptr;
-    TWIM_ID->TXD.MAXCNT = tx_len;
-    TWIM_ID->RXD.PTR = (uint32_t) rx_ptr;
-    TWIM_ID->RXD.MAXCNT = rx_len;
-    TWIM_ID->SHORTS = TWIM_SHORTS_LASTTX_STARTRX_Msk |
-            TWIM_SHORTS_LASTRX_STOP_Msk;
-    TWIM_ID->TASKS_STARTTX = 1;
-
-    twim_status.current_transfer = TWIM_TX_RX;
-    twim_status.transfer_finished = false;
-
-    //Error is always set, as its required to recover from an error
-    TWIM_ID->INTEN = TWIM_INTENSET_ERROR_Msk;
-    (void)TWIM_ID->INTEN;
-    TWIM_ID->INTENSET = (twim_status.evt_mask & TWIM_TX_RX_DONE_MSK)?
-            (TWIM_INTENSET_STOPPED_Msk) : 0 ;
-
-    return TWIM_STARTED;
+    hal_twim_op_t op = {.p_tx = tx_ptr, .tx_len = tx_len,
+        .p_rx = rx_ptr, .rx_len = rx_len};
+    return default_xfer_start (TWIM_TX_RX, &op);
 }
 
 uint32_t hal_twim_get_current_adrs(void)
 {
     return TWIM_ID->ADDRESS;
 }
+
 #if ISR_MANAGER == 1
 void hal_twim_Handler (void)
 #else
@@ -284,8 +346,30 @@ void TWIM_IRQ_Handler(void)
 #if ISR_MANAGER == 0
         TWIM_EVENT_CLEAR(TWIM_ID->EVENTS_STOPPED);
 #endif
-        twim_status.transfer_finished = true;
-
-        send_event(twim_status.current_transfer);
+        const hal_twim_xfer_t * p_done = twim_status.p_xfer;
+        twim_status.op_idx++;
+        if((twim_status.err == TWIM_ERR_NONE) &&
+            (twim_status.op_idx < p_done->op_cnt))
+        {
+            op_start (&p_done->p_ops[twim_status.op_idx]);
+        }
+        else
+        {
+            twim_err_t err = twim_status.err;
+            if(CBUF_IsEmpty (xfer_queue))
+            {
+                TWIM_ID->INTEN = 0;
+                twim_status.transfer_finished = true;
+            }
+            else
+            {
+                xfer_start (CBUF_Pop (xfer_queue));
+            }
+
+            if(p_done->done_handler != NULL)
+            {
+                p_done->done_handler (err, p_done->p_context);
+            }
+        }
     }
 }
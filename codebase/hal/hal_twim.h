@@ -31,6 +31,8 @@
 #define CODEBASE_HAL_HAL_TWIM_H_
 
 #include "nrf.h"
+#include "nrf_util.h"
+#include "stdbool.h"
 
 #ifdef NRF51
 #error TWIM peripheral is not present in the nRF51 SoC
@@ -43,6 +45,11 @@
 #define HAL_TWIM_PERIPH_USED 0
 #endif
 
+#ifndef HAL_TWIM_QUEUE_SIZE
+/** Number of transactions which can wait for the TWIM, must be a power of 2 */
+#define HAL_TWIM_QUEUE_SIZE 8
+#endif
+
 
 /** Specify which TWIM peripheral is used for this HAL module */
 #define TWIM_USED           HAL_TWIM_PERIPH_USED
@@ -106,6 +113,42 @@ typedef struct
     uint32_t            evt_mask;
 } hal_twim_init_config_t;
 
+/** @brief One step of a register script. A step is a write, a read or a write
+ *  followed by a read with a repeated start. Writing a register is a step
+ *  with {reg, value} as the Tx data and reading is a step with {reg} as the
+ *  Tx data followed by the Rx data.
+ */
+typedef struct
+{
+    /** Data to be written, must be in RAM for EasyDMA. Can be NULL if tx_len is 0 */
+    const uint8_t * p_tx;
+    /** Number of bytes to be written */
+    uint32_t tx_len;
+    /** Location for the data read, can be NULL if rx_len is 0 */
+    uint8_t * p_rx;
+    /** Number of bytes to be read */
+    uint32_t rx_len;
+} hal_twim_op_t;
+
+/** @brief A transaction with a slave, made of a script of steps which are
+ *  run one after the other from the interrupt. Transactions are queued and
+ *  run in the order in which they are queued.
+ */
+typedef struct
+{
+    /** I2C address of the slave */
+    uint32_t address;
+    /** Pointer to the array of steps of the script */
+    const hal_twim_op_t * p_ops;
+    /** Number of steps in the array */
+    uint32_t op_cnt;
+    /** Function to be called from the interrupt once all the steps are done
+     *  or a step fails, can be NULL */
+    void (*done_handler)(twim_err_t err, void * p_context);
+    /** Parameter passed to the done_handler */
+    void * p_context;
+} hal_twim_xfer_t;
+
 /**
  * @brief Function for initializing and enabling one of the TWIM peripheral
  * @param config Pointer to the initialization configuration parameters
@@ -120,7 +163,9 @@ void hal_twim_init(hal_twim_init_config_t * config);
 void hal_twim_uninit(void);
 
 /**
- * @brief Start a Tx only TWI transfer
+ * @brief Start a Tx only TWI transfer to the slave given at init
+ * @note This returns @ref TWIM_BUSY while a transaction of
+ *  @ref hal_twim_queue_xfer is ongoing or queued
  * @param tx_ptr Pointer to the data to be transferred
  * @param tx_len Length of the data to be transferred
  * @return Status of the transfer as per @ref twim_ret_status
@@ -128,7 +173,7 @@ void hal_twim_uninit(void);
 twim_ret_status hal_twim_tx(uint8_t * tx_ptr, uint32_t tx_len);
 
 /**
- * @brief Start a Rx only TWI transfer
+ * @brief Start a Rx only TWI transfer from the slave given at init
  * @param rx_ptr Pointer to the data to be received
  * @param rx_len Length of the data to be received
  * @return Status of the transfer as per @ref twim_ret_status
@@ -136,7 +181,8 @@ twim_ret_status hal_twim_tx(uint8_t * tx_ptr, uint32_t tx_len);
 twim_ret_status hal_twim_rx(uint8_t * rx_ptr, uint32_t rx_len);
 
 /**
- * @brief Start a Tx TWI transfer followed by a Rx by repeated start
+ * @brief Start a Tx TWI transfer followed by a Rx by repeated start with
+ *  the slave given at init
  * @param tx_ptr Pointer to the data to be transferred
  * @param tx_len Length of the data to be transferred
  * @param rx_ptr Pointer to the data to be received
@@ -146,6 +192,24 @@ twim_ret_status hal_twim_rx(uint8_t * rx_ptr, uint32_t rx_len);
 twim_ret_status hal_twim_tx_rx(uint8_t * tx_ptr, uint32_t tx_len,
         uint8_t * rx_ptr, uint32_t rx_len);
 
+/**
+ * @brief Queue a transaction, which is started right away if the TWIM is free
+ * @param p_xfer Pointer to the transaction. This, its steps and their data must
+ *  remain valid till its done_handler is called
+ * @return True if the transaction is started or queued, false if the queue
+ *  is full or the TWIM is not initialized
+ * @note The next step is started from the STOPPED interrupt, so there are no
+ *  CPU delays in between the steps. A step which fails aborts the rest of the
+ *  script and the error is given to the done_handler.
+ */
+bool hal_twim_queue_xfer(const hal_twim_xfer_t * p_xfer);
+
+/**
+ * @brief Find if a transaction is ongoing or queued
+ * @return True if the TWIM is busy
+ */
+bool hal_twim_is_busy(void);
+
 /**
  * @brief Get the current specified address of the I2C slave
  * @return The I2C address currently initialized in the driver
@@ -50,7 +50,16 @@
 #include "app_error.h"
 #include "log.h"
 #include "nrf_util.h"
-#include "hal_nop_delay.h"
+#include "hal_gpio.h"
+
+#if ISR_MANAGER == 1
+#include "isr_manager.h"
+#endif
+
+#ifndef LSM6DS3_INT1_PIN
+#define LSM6DS3_INT1_PIN        INT1
+#endif
+
 uint8_t who_am_i = 0;
 static struct IMU_settings settings;
 
@@ -72,23 +81,131 @@ hal_twim_init_config_t LSM6D_twi_config =
     .frequency = HAL_TWI_FREQ_100K,
 };
 
+/** Number of registers written by the config script */
+#define CONFIG_REG_CNT      4
+
+/** {register, value} pairs of the config script, values filled by LSM6DS3_config */
+static uint8_t config_regs[CONFIG_REG_CNT][2] =
+{
+    {MASTER_CONFIG, 0},
+    {CTRL3_C, 0},
+    {CTRL1_XL, 0},
+    {CTRL2_G, 0},
+};
+
+/** Steps of the config script, one write per register */
+static const hal_twim_op_t config_ops[CONFIG_REG_CNT] =
+{
+    {.p_tx = config_regs[0], .tx_len = 2, .p_rx = NULL, .rx_len = 0},
+    {.p_tx = config_regs[1], .tx_len = 2, .p_rx = NULL, .rx_len = 0},
+    {.p_tx = config_regs[2], .tx_len = 2, .p_rx = NULL, .rx_len = 0},
+    {.p_tx = config_regs[3], .tx_len = 2, .p_rx = NULL, .rx_len = 0},
+};
+
+/** Flag to know that the config script is queued or ongoing */
+static volatile bool config_xfer_pending = false;
+
+/**
+ * @brief Handler of the scripts which are queued without waiting for them.
+ * @param p_context Pointer to the pending flag of the script, which is cleared
+ */
+static void queued_script_done (twim_err_t err, void * p_context)
+{
+    log_printf("%s : %d\n", __func__, err);
+    *((volatile bool *) p_context) = false;
+}
 
+static const hal_twim_xfer_t config_xfer =
+{
+    .address = LSM6DS3_ADDR,
+    .p_ops = config_ops,
+    .op_cnt = CONFIG_REG_CNT,
+    .done_handler = queued_script_done,
+    .p_context = (void *) &config_xfer_pending,
+};
+
+/** Completion of a register script which is waited for */
+typedef struct
+{
+    volatile bool is_done;
+    volatile twim_err_t err;
+}script_wait_t;
+
+static void script_wait_done (twim_err_t err, void * p_context)
+{
+    script_wait_t * p_wait = (script_wait_t *) p_context;
+    p_wait->err = err;
+    p_wait->is_done = true;
+}
+
+/**
+ * @brief Function to run a register script and wait for it to finish. The
+ *  wait is only for the scripts queued before and the bus time of this one.
+ * @param p_ops Pointer to the steps of the script
+ * @param op_cnt Number of steps
+ * @return Error of the script as per @ref twim_err_t
+ */
+static twim_err_t run_script (const hal_twim_op_t * p_ops, uint32_t op_cnt)
+{
+    script_wait_t wait = {.is_done = false, .err = TWIM_ERR_NONE};
+    hal_twim_xfer_t xfer =
+    {
+        .address = LSM6DS3_ADDR,
+        .p_ops = p_ops,
+        .op_cnt = op_cnt,
+        .done_handler = script_wait_done,
+        .p_context = &wait,
+    };
+
+    while(hal_twim_queue_xfer (&xfer) == false);
+    while(wait.is_done == false);
+    return wait.err;
+}
+
+/**
+ * @brief Function to change only the ODR_XL bits of the CTRL1_XL register.
+ *  CTRL6_C is written and CTRL1_XL is read in one script, then CTRL1_XL is
+ *  written back with the new ODR.
+ * @param ctrl6_c Value to be written to CTRL6_C
+ * @param odr_xl Value of the ODR_XL bits
+ */
+static void set_accel_odr (uint8_t ctrl6_c, uint8_t odr_xl)
+{
+    twim_err_t err_code;
+    uint8_t ctrl6_c_data[2] = {CTRL6_C, ctrl6_c};
+    uint8_t ctrl1_xl_reg = CTRL1_XL;
+    uint8_t rx_data = 0;
+    hal_twim_op_t read_ops[2] =
+    {
+        {.p_tx = ctrl6_c_data, .tx_len = 2, .p_rx = NULL, .rx_len = 0},
+        {.p_tx = &ctrl1_xl_reg, .tx_len = 1, .p_rx = &rx_data, .rx_len = 1},
+    };
+
+    err_code = run_script (read_ops, 2);
+    log_printf("Status : %d, %d\n", err_code, __LINE__);
+
+    // bit mask CTRL1_XL to avoid losing previously set parameters. Only change ODR_XL bits.
+    uint8_t ctrl1_xl_data[2] = {CTRL1_XL, (odr_xl << 4) | (rx_data & 0x0F)};
+    hal_twim_op_t write_op =
+        {.p_tx = ctrl1_xl_data, .tx_len = 2, .p_rx = NULL, .rx_len = 0};
+
+    err_code = run_script (&write_op, 1);
+    log_printf("Status : %d, %d\n", err_code, __LINE__);
+}
 
 /**
  * @brief function to test availablility of IMU by reading WHO_AM_I register.
  */
 void LSM6DS3_who_am_i(void)
 {
-  twim_ret_status err_code;
+  twim_err_t err_code;
   uint8_t  p_wmi_reg = WHO_AM_I;
-//  log_printf("Pointer : %x\n",*p_wmi_reg);
-  err_code = hal_twim_tx_rx (&p_wmi_reg, sizeof(who_am_i), &who_am_i, sizeof(who_am_i));
-  
-//  err_code = read_register(p_twi_sensors, LSM6DS3_ADDR, WHO_AM_I, &who_am_i, 1, false);
-  
+  hal_twim_op_t op =
+    {.p_tx = &p_wmi_reg, .tx_len = 1, .p_rx = &who_am_i, .rx_len = sizeof(who_am_i)};
+
+  err_code = run_script (&op, 1);
   log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(10);
-    log_printf("%s : %x\n",__func__, who_am_i);
+  log_printf("%s : %x\n",__func__, who_am_i);
 }
 
 
@@ -99,8 +216,6 @@ void LSM6DS3_init(void)
 {
     hal_twim_init (&LSM6D_twi_config);
 
-  twim_ret_status err_code;
-
   settings.accel_enable           = 1;      // 0 - Disable. 1 - Enable
   settings.accel_range            = 2;      // Full Scale(FS) range (in g). Select from: 2, 4, 8, 16
   settings.accel_samplerate       = 13;    // Hz. Select from: 13, 26, 52, 104, 208, 416, 833, 1666
@@ -122,18 +237,6 @@ void LSM6DS3_init(void)
 	settings.FIFO_samplerate 		    = 13;     //default 13Hz
 	settings.FIFO_mode 			        = 6;      //Default off
 
-  uint8_t tx_data[2] = {MASTER_CONFIG, 0x01};
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-  err_code = hal_twim_tx (tx_data, sizeof(tx_data));
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms (10);
-
-  // set IF_INC in CTRL3_C register.
-  tx_data[0] = CTRL3_C;
-  tx_data[1] = 0x04;
-  err_code = hal_twim_tx (tx_data, sizeof(tx_data));
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms (10);
   LSM6DS3_config();
 }
 
@@ -149,53 +252,57 @@ void LSM6DS3_init(void)
  * Bit[1] is reserved for full scale range selection at 125 dps.
  * Bit[3:2] are reserved for full scale range sselection from 245 dps, 500 dps, 1000 dps and 2000 dps
  * Bit[7:4] are reserved for output data rate selection.
+ *
+ * All the config registers are written by a single register script, this
+ * function returns once the script is queued.
  */
 void LSM6DS3_config(void)
 {
-  twim_ret_status err_code;
-  uint8_t tx_data[2];
+  uint8_t ctrl1_xl = 0;
+  uint8_t ctrl2_g = 0;
+
+  //Wait for the previous config script to be done with its buffers
+  while(config_xfer_pending == true);
 
   // configure accelerometer
-  tx_data[0] = CTRL1_XL;
-  tx_data[1] = 0;
   if(settings.accel_enable == 1) {
     // Bandwidth
     switch(settings.accel_bandwidth) {
       case 50:
-              tx_data[1] |= LSM6DS3_IMU_BW_XL_50Hz;
+              ctrl1_xl |= LSM6DS3_IMU_BW_XL_50Hz;
               break;
 
       case 100:
-              tx_data[1] |= LSM6DS3_IMU_BW_XL_100Hz;
+              ctrl1_xl |= LSM6DS3_IMU_BW_XL_100Hz;
               break;
 
       case 200:
-              tx_data[1] |= LSM6DS3_IMU_BW_XL_200Hz;
+              ctrl1_xl |= LSM6DS3_IMU_BW_XL_200Hz;
               break;
 
       default:
       case 400:
-              tx_data[1] |= LSM6DS3_IMU_BW_XL_400Hz;
+              ctrl1_xl |= LSM6DS3_IMU_BW_XL_400Hz;
               break;
     }
 
     // Full scale range
     switch(settings.accel_range) {
       case 2:
-              tx_data[1] |= LSM6DS3_IMU_FS_XL_2g;
+              ctrl1_xl |= LSM6DS3_IMU_FS_XL_2g;
               break;
 
       case 4:
-              tx_data[1] |= LSM6DS3_IMU_FS_XL_4g;
+              ctrl1_xl |= LSM6DS3_IMU_FS_XL_4g;
               break;
 
       case 8:
-              tx_data[1] |= LSM6DS3_IMU_FS_XL_8g;
+              ctrl1_xl |= LSM6DS3_IMU_FS_XL_8g;
               break;
 
       default:
       case 16:
-              tx_data[1] |= LSM6DS3_IMU_FS_XL_16g;
+              ctrl1_xl |= LSM6DS3_IMU_FS_XL_16g;
               break;
     }
 
@@ -203,131 +310,132 @@ void LSM6DS3_config(void)
     switch(settings.accel_samplerate) {
 
       case 0:
-              tx_data[1] |= LSM6DS3_IMU_ODR_XL_POWER_DOWN;
+              ctrl1_xl |= LSM6DS3_IMU_ODR_XL_POWER_DOWN;
               break;
 
       case 13:
-              tx_data[1] |= LSM6DS3_IMU_ODR_XL_13Hz;
+              ctrl1_xl |= LSM6DS3_IMU_ODR_XL_13Hz;
               break;
 
       case 26:
-              tx_data[1] |= LSM6DS3_IMU_ODR_XL_26Hz;
+              ctrl1_xl |= LSM6DS3_IMU_ODR_XL_26Hz;
               break;
 
       case 52:
-              tx_data[1] |= LSM6DS3_IMU_ODR_XL_52Hz;
+              ctrl1_xl |= LSM6DS3_IMU_ODR_XL_52Hz;
               break;
 
       default:
       case 104:
-              tx_data[1] |= LSM6DS3_IMU_ODR_XL_104Hz;
+              ctrl1_xl |= LSM6DS3_IMU_ODR_XL_104Hz;
               break;
 
       case 208:
-              tx_data[1] |= LSM6DS3_IMU_ODR_XL_208Hz;
+              ctrl1_xl |= LSM6DS3_IMU_ODR_XL_208Hz;
               break;
 
       case 416:
-              tx_data[1] |= LSM6DS3_IMU_ODR_XL_416Hz;
+              ctrl1_xl |= LSM6DS3_IMU_ODR_XL_416Hz;
               break;
 
       case 833:
-              tx_data[1] |= LSM6DS3_IMU_ODR_XL_833Hz;
+              ctrl1_xl |= LSM6DS3_IMU_ODR_XL_833Hz;
               break;
 
       case 1660:
-              tx_data[1] |= LSM6DS3_IMU_ODR_XL_1660Hz;
+              ctrl1_xl |= LSM6DS3_IMU_ODR_XL_1660Hz;
               break;
 
       case 3330:
-              tx_data[1] |= LSM6DS3_IMU_ODR_XL_3330Hz;
+              ctrl1_xl |= LSM6DS3_IMU_ODR_XL_3330Hz;
               break;
 
       case 6660:
-              tx_data[1] |= LSM6DS3_IMU_ODR_XL_6660Hz;
+              ctrl1_xl |= LSM6DS3_IMU_ODR_XL_6660Hz;
               break;
     }
   }
   else {
-    tx_data[1] = 0;
+    ctrl1_xl = 0;
   }
 
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-  err_code = hal_twim_tx (tx_data, sizeof(tx_data));
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(10);
-
   // configure gyroscope
-  tx_data[0] = CTRL2_G;
-  tx_data[1] = 0;
   if(settings.gyro_enable == 1) {
     // range
     switch(settings.gyro_range) {
       case 125:
-              tx_data[1] |= LSM6DS3_IMU_FS_125_ENABLED;
+              ctrl2_g |= LSM6DS3_IMU_FS_125_ENABLED;
               break;
 
       case 245:
-              tx_data[1] |= LSM6DS3_IMU_FS_G_245dps;
+              ctrl2_g |= LSM6DS3_IMU_FS_G_245dps;
               break;
 
       case 500:
-              tx_data[1] |= LSM6DS3_IMU_FS_G_500dps;
+              ctrl2_g |= LSM6DS3_IMU_FS_G_500dps;
               break;
 
       case 1000:
-              tx_data[1] |= LSM6DS3_IMU_FS_G_1000dps;
+              ctrl2_g |= LSM6DS3_IMU_FS_G_1000dps;
               break;
 
       default:
       case 2000:
-              tx_data[1] |= LSM6DS3_IMU_FS_G_2000dps;
+              ctrl2_g |= LSM6DS3_IMU_FS_G_2000dps;
               break;
     }
 
     // ODR
     switch(settings.gyro_samplerate) {
       case 13:
-              tx_data[1] |= LSM6DS3_IMU_ODR_G_13Hz;
+              ctrl2_g |= LSM6DS3_IMU_ODR_G_13Hz;
               break;
 
       case 26:
-              tx_data[1] |= LSM6DS3_IMU_ODR_G_26Hz;
+              ctrl2_g |= LSM6DS3_IMU_ODR_G_26Hz;
               break;
 
       case 52:
-              tx_data[1] |= LSM6DS3_IMU_ODR_G_52Hz;
+              ctrl2_g |= LSM6DS3_IMU_ODR_G_52Hz;
               break;
 
       default:
       case 104:
-              tx_data[1] |= LSM6DS3_IMU_ODR_G_104Hz;
+              ctrl2_g |= LSM6DS3_IMU_ODR_G_104Hz;
               break;
 
       case 208:
-              tx_data[1] |= LSM6DS3_IMU_ODR_G_208Hz;
+              ctrl2_g |= LSM6DS3_IMU_ODR_G_208Hz;
               break;
 
       case 416:
-              tx_data[1] |= LSM6DS3_IMU_ODR_G_416Hz;
+              ctrl2_g |= LSM6DS3_IMU_ODR_G_416Hz;
               break;
 
       case 833:
-              tx_data[1] |= LSM6DS3_IMU_ODR_G_833Hz;
+              ctrl2_g |= LSM6DS3_IMU_ODR_G_833Hz;
               break;
 
       case 1660:
-              tx_data[1] |= LSM6DS3_IMU_ODR_G_1660Hz;
+              ctrl2_g |= LSM6DS3_IMU_ODR_G_1660Hz;
               break;
     }
   }
   else {
-    tx_data[1] = 0;
+    ctrl2_g = 0;
   }
 
-  err_code = hal_twim_tx (tx_data, sizeof(tx_data));
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(10);
+  // MASTER_ON in MASTER_CONFIG, IF_INC in CTRL3_C, then the sensor config
+  uint8_t config_val[CONFIG_REG_CNT] = {0x01, 0x04, ctrl1_xl, ctrl2_g};
+  for(uint32_t i = 0; i < CONFIG_REG_CNT; i++)
+  {
+      config_regs[i][1] = config_val[i];
+  }
+
+  //All the writes are done from the TWIM interrupt. Transactions queued
+  //after this run only once it is done.
+  config_xfer_pending = true;
+  while(hal_twim_queue_xfer (&config_xfer) == false);
 }
 
 /**
@@ -337,23 +445,7 @@ void LSM6DS3_config(void)
  */
 void LSM6DS3_set_accel_power_down_mode()
 {
-  twim_ret_status err_code;
-  uint8_t rx_data;
-  uint8_t tx_data[2] = {CTRL1_XL, 0};
-
-  // read CTRL1_XL register to obtain current parameters.
-  err_code = hal_twim_tx_rx ((uint8_t *)CTRL1_XL, 1, &rx_data, sizeof(rx_data));
-//  err_code = read_register(p_twi_sensors, LSM6DS3_ADDR, CTRL1_XL, &rx_data, sizeof(rx_data), false);
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(10);
-
-  // bit mask CTRL1_XL to avoid losing previously set parameters. Only change ODR_XL bits.
-  tx_data[1] |= (0x00 << 4) | (rx_data & 0x0F);
-
-  err_code = hal_twim_tx (tx_data, sizeof(tx_data));
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(10);
+  set_accel_odr (0x00, 0x00);
 }
 
 /**
@@ -363,48 +455,24 @@ void LSM6DS3_set_accel_power_down_mode()
  */
 void LSM6DS3_set_accel_low_power_mode(uint16_t value)
 {
-  twim_ret_status err_code;
-  uint8_t rx_data;
-  // uint8_t tx_data[2] = {CTRL1_XL, 0};
-  uint8_t tx_data[2];
-
-  // set XL_HM_MODE bit to 1 in CTRL6_C to enable high performance mode.
-  tx_data[0] = CTRL6_C;
-  tx_data[1] = 0x10;
-
-  err_code = hal_twim_tx (tx_data, sizeof(tx_data));
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(10);
-
-
-  // read CTRL1_XL register to obtain current parameters.
-//  err_code = read_register(p_twi_sensors, LSM6DS3_ADDR, CTRL1_XL, &rx_data, sizeof(rx_data), false);
-  err_code = hal_twim_tx_rx ((uint8_t *)CTRL1_XL, 1, &rx_data, sizeof(rx_data));
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(10);
-
-  tx_data[0] = CTRL1_XL;
-  // bit mask CTRL1_XL to avoid losing previously set parameters. Only change ODR_XL bits.
+  uint8_t odr_xl;
   switch(value) {
     case 13:
-      tx_data[1] |= (0x01 << 4) | (rx_data & 0x0F);
+      odr_xl = 0x01;
       break;
 
     case 26:
-      tx_data[1] |= (0x02 << 4) | (rx_data & 0x0F);
+      odr_xl = 0x02;
       break;
 
     default:
     case 52:
-      tx_data[1] |= (0x03 << 4) | (rx_data & 0x0F);
+      odr_xl = 0x03;
       break;
   }
 
-  err_code = hal_twim_tx (tx_data, sizeof(tx_data));
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(10);
+  // set XL_HM_MODE bit to 1 in CTRL6_C to disable high performance mode.
+  set_accel_odr (0x10, odr_xl);
 }
 
 /**
@@ -414,43 +482,20 @@ void LSM6DS3_set_accel_low_power_mode(uint16_t value)
  */
 void LSM6DS3_set_accel_normal_mode(uint16_t value)
 {
-  twim_ret_status err_code;
-  uint8_t rx_data;
-  // uint8_t tx_data[2] = {CTRL1_XL, 0};
-  uint8_t tx_data[2];
-
-  // set XL_HM_MODE bit to 1 in CTRL6_C to enable high performance mode.
-  tx_data[0] = CTRL6_C;
-  tx_data[1] = 0x10;
-
-  err_code = hal_twim_tx (tx_data, sizeof(tx_data));
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(10);
-
-  // read CTRL1_XL register to obtain current parameters.
-//  err_code = read_register(p_twi_sensors, LSM6DS3_ADDR, CTRL1_XL, &rx_data, sizeof(rx_data), false);
-  err_code = hal_twim_tx_rx ((uint8_t *)CTRL1_XL, 1, &rx_data, sizeof(rx_data));
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(10);
-
-  tx_data[0] = CTRL1_XL;
-  // bit mask CTRL1_XL to avoid losing previously set parameters. Only change ODR_XL bits.
+  uint8_t odr_xl;
   switch(value) {
     default:
     case 104:
-      tx_data[1] |= (0x04 << 4) | (rx_data & 0x0F);
+      odr_xl = 0x04;
       break;
 
     case 208:
-      tx_data[1] |= (0x05 << 4) | (rx_data & 0x0F);
+      odr_xl = 0x05;
       break;
   }
 
-  err_code = hal_twim_tx (tx_data, sizeof(tx_data));
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(10);
+  // set XL_HM_MODE bit to 1 in CTRL6_C to disable high performance mode.
+  set_accel_odr (0x10, odr_xl);
 }
 
 /**
@@ -460,90 +505,54 @@ void LSM6DS3_set_accel_normal_mode(uint16_t value)
  */
 void LSM6DS3_set_accel_high_performance_mode(uint16_t value)
 {
-  twim_ret_status err_code;
-  uint8_t rx_data;
-  // uint8_t tx_data[2] = {CTRL1_XL, 0};
-  uint8_t tx_data[2];
-
-  // set XL_HM_MODE bit to 1 in CTRL6_C to enable high performance mode.
-  tx_data[0] = CTRL6_C;
-  tx_data[1] = 0x00;
-
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-  err_code = hal_twim_tx (tx_data, sizeof(tx_data));
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  uint8_t ctrl1_xl = CTRL1_XL;  
-  hal_nop_delay_ms(10);
-
-  // read CTRL1_XL register to obtain current parameters.
-  err_code = hal_twim_tx_rx (&ctrl1_xl, 1, &rx_data, sizeof(rx_data));
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(10);
-
-  tx_data[0] = CTRL1_XL;
-  // bit mask CTRL1_XL to avoid losing previously set parameters. Only change ODR_XL bits.
+  uint8_t odr_xl;
   switch(value) {
     case 416:
-      tx_data[1] |= (0x06 << 4) | (rx_data & 0x0F);
+      odr_xl = 0x06;
       break;
 
     case 833:
-      tx_data[1] |= (0x07 << 4) | (rx_data & 0x0F);
+      odr_xl = 0x07;
       break;
 
     default:
     case 1660:
-      tx_data[1] |= (0x08 << 4) | (rx_data & 0x0F);
+      odr_xl = 0x08;
       break;
 
     case 3330:
-      tx_data[1] |= (0x09 << 4) | (rx_data & 0x0F);
+      odr_xl = 0x09;
       break;
 
     case 6660:
-      tx_data[1] |= (0x0A << 4) | (rx_data & 0x0F);
+      odr_xl = 0x0A;
       break;
   }
 
-  err_code = hal_twim_tx (tx_data, sizeof(tx_data));
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(10);
+  // clear XL_HM_MODE bit in CTRL6_C to enable high performance mode.
+  set_accel_odr (0x00, odr_xl);
 }
 
 
 /**
  * @brief function to read accelerometer data
+ *
+ * All the output registers are read in one transfer with auto increment,
+ * queued behind any pending config script.
  */
 void LSM6DS3_read_accl_data(int16_t *x_axis, int16_t *y_axis, int16_t *z_axis)
 {
-  twim_ret_status err_code;
-//  uint8_t status = 0;
-  uint8_t data[6];
-
-//  LSM6DS3_set_accel_high_performance_mode(settings.accel_samplerate);
-
-//  do {
-//    err_code = read_register(p_twi_sensors, LSM6DS3_ADDR, STATUS_REG, &status, sizeof(status), false);
-//      uint8_t status_reg = STATUS_REG;
-//    err_code = hal_twim_tx_rx (&status_reg, 1, &status, sizeof(status));
-//  log_printf("Status : %d, %d\n", err_code, __LINE__);
-//  hal_nop_delay_ms(10);
-//  } while(!(status & 0x01));
-  
+  twim_err_t err_code;
+  uint8_t data[6] = {0};
   uint8_t outxl = OUTX_L_XL;
+  hal_twim_op_t op = {.p_tx = &outxl, .tx_len = 1, .p_rx = data, .rx_len = sizeof(data)};
 
-  err_code = hal_twim_tx_rx (&outxl, 1, data, sizeof(data));
-//  err_code = read_register(p_twi_sensors, LSM6DS3_ADDR, OUTX_L_XL, data, sizeof(data), true);
-//  log_printf("Status : %d, %d\n", err_code, __LINE__);
-  hal_nop_delay_ms(100);
-  if(err_code == 0)
+  err_code = run_script (&op, 1);
+  if(err_code != TWIM_ERR_NONE)
   {
-      
+    log_printf("Status : %d, %d\n", err_code, __LINE__);
   }
 
-//  LSM6DS3_set_accel_power_down_mode();
-
   *x_axis = (data[1] << 8) | data[0];
   *y_axis = (data[3] << 8) | data[2];
   *z_axis = (data[5] << 8) | data[4];
@@ -553,11 +562,22 @@ void LSM6DS3_read_accl_data(int16_t *x_axis, int16_t *y_axis, int16_t *z_axis)
  * @brief function to compute raw accelerometer data in g.
  *
  * Multiply linear acceleration sensitivity with raw_data. Divide the product by 1000 to obtain value in g.
- * Refer table 4.1 on page 19 of LSM6DS3 datasheet.
+ * Refer table 4.1 on page 19 of LSM6DS3 datasheet. The sensitivity is used
+ * as a Q15 number unless LSM6DS3_FLOAT_CONV is 1.
  */
 int16_t LSM6DS3_accelData_in_g(int16_t raw_data)
 {
+#if LSM6DS3_FLOAT_CONV == 1
   return (int16_t)((float)((raw_data * 0.061 * (settings.accel_range >> 1)) / 10 ));
+#else
+  // Q15 sensitivity, the division truncates towards zero like the float cast
+  return (int16_t)((raw_data * (int32_t) LSM6DS3_accel_mg_per_lsb_q15()) / (10 << 15));
+#endif
+}
+
+uint32_t LSM6DS3_accel_mg_per_lsb_q15(void)
+{
+  return LSM6DS3_ACCEL_MG_PER_LSB_2G_Q15 * (settings.accel_range >> 1);
 }
 
 
@@ -634,168 +654,343 @@ int16_t LSM6DS3_accelData_in_g(int16_t raw_data)
 //  return ((float) ((raw_data * 4.375 * gyro_range_divisor) / 1000 ));
 //}
 //
+/** Number of registers written by the FIFO config script */
+#define FIFO_CONFIG_REG_CNT     6
+
+/** {register, value} pairs of the FIFO config script, FIFO is reset by
+ *  the bypass mode at the start. Values filled by LSM6DS3_FIFO_config */
+static uint8_t fifo_config_regs[FIFO_CONFIG_REG_CNT][2] =
+{
+    {FIFO_CTRL5, LSM6DS3_IMU_FIFO_MODE_BYPASS},
+    {FIFO_CTRL1, 0},
+    {FIFO_CTRL2, 0},
+    {FIFO_CTRL3, 0},
+    {INT1_CTRL, 0},
+    {FIFO_CTRL5, 0},
+};
+
+/** Steps of the FIFO config script, one write per register */
+static const hal_twim_op_t fifo_config_ops[FIFO_CONFIG_REG_CNT] =
+{
+    {.p_tx = fifo_config_regs[0], .tx_len = 2, .p_rx = NULL, .rx_len = 0},
+    {.p_tx = fifo_config_regs[1], .tx_len = 2, .p_rx = NULL, .rx_len = 0},
+    {.p_tx = fifo_config_regs[2], .tx_len = 2, .p_rx = NULL, .rx_len = 0},
+    {.p_tx = fifo_config_regs[3], .tx_len = 2, .p_rx = NULL, .rx_len = 0},
+    {.p_tx = fifo_config_regs[4], .tx_len = 2, .p_rx = NULL, .rx_len = 0},
+    {.p_tx = fifo_config_regs[5], .tx_len = 2, .p_rx = NULL, .rx_len = 0},
+};
+
+/** Flag to know that the FIFO config script is queued or ongoing */
+static volatile bool fifo_config_pending = false;
+
+static const hal_twim_xfer_t fifo_config_xfer =
+{
+    .address = LSM6DS3_ADDR,
+    .p_ops = fifo_config_ops,
+    .op_cnt = FIFO_CONFIG_REG_CNT,
+    .done_handler = queued_script_done,
+    .p_context = (void *) &fifo_config_pending,
+};
+
+/** Value of INT1_CTRL written by the FIFO config, FIFO watermark when streaming */
+static uint8_t fifo_int1_ctrl = 0;
+
+/** Size of a FIFO block in bytes */
+#define FIFO_BLOCK_BYTES        (LSM6DS3_FIFO_BLOCK_SAMPLES * sizeof(LSM6DS3_accel_sample_t))
+/** Maximum bytes in one read of the TWIM, a whole number of samples */
+#define FIFO_READ_MAX_BYTES     ((TWIM_RXD_MAXCNT_MAXCNT_Msk/sizeof(LSM6DS3_accel_sample_t)) \
+                                    * sizeof(LSM6DS3_accel_sample_t))
+/** Number of reads in the script reading a FIFO block */
+#define FIFO_READ_STEPS         ((FIFO_BLOCK_BYTES + FIFO_READ_MAX_BYTES - 1)/FIFO_READ_MAX_BYTES)
+
+/** Double buffer of the FIFO blocks, one is filled while the other is with the application */
+static LSM6DS3_accel_sample_t fifo_block[2][LSM6DS3_FIFO_BLOCK_SAMPLES];
+
+/** FIFO output register, which the sensor rolls back to after every word */
+static uint8_t fifo_data_reg = FIFO_DATA_OUT_L;
+
+/** Scripts to read a FIFO block into each of the buffers */
+static hal_twim_op_t fifo_read_ops[2][FIFO_READ_STEPS];
+static hal_twim_xfer_t fifo_read_xfer[2];
+
+/** Index of the buffer to be filled next */
+static uint32_t fifo_fill_idx = 0;
+
+/** Flag to know that a FIFO block read is queued or ongoing */
+static volatile bool fifo_read_pending = false;
+
+static void (*fifo_block_handler)(const LSM6DS3_accel_sample_t * p_samples,
+    uint32_t sample_cnt) = NULL;
+
+/**
+ * @brief Function to queue the read of a FIFO block, unless one is pending
+ */
+static void fifo_read_start (void)
+{
+    bool is_started = false;
+    CRITICAL_REGION_ENTER();
+    if(fifo_read_pending == false)
+    {
+        fifo_read_pending = true;
+        is_started = true;
+    }
+    CRITICAL_REGION_EXIT();
+
+    if((is_started == true) &&
+        (hal_twim_queue_xfer (&fifo_read_xfer[fifo_fill_idx]) == false))
+    {
+        log_printf("%s : TWIM queue full\n", __func__);
+        fifo_read_pending = false;
+    }
+}
+
+static void fifo_read_done (twim_err_t err, void * p_context)
+{
+    uint32_t filled_idx = (uint32_t) p_context;
+    fifo_fill_idx = (filled_idx + 1) & 1;
+    fifo_read_pending = false;
+
+    if(fifo_block_handler == NULL)
+    {
+        return;
+    }
+
+    //INT1 stays high without a new edge if the FIFO filled up to the
+    //watermark again during the read, so start the next read right away
+    if(hal_gpio_pin_read (LSM6DS3_INT1_PIN))
+    {
+        fifo_read_start ();
+    }
+
+    if(err == TWIM_ERR_NONE)
+    {
+        fifo_block_handler (fifo_block[filled_idx], LSM6DS3_FIFO_BLOCK_SAMPLES);
+    }
+    else
+    {
+        log_printf("%s : %d\n", __func__, err);
+    }
+}
+
+#if ISR_MANAGER == 1
+void LSM6DS3_gpiote_Handler (void)
+#else
+void GPIOTE_IRQHandler (void)
+#endif
+{
+    if(NRF_GPIOTE->EVENTS_IN[GPIOTE_CH_USED_LSM6DS3] == 1)
+    {
+#if ISR_MANAGER == 0
+        NRF_GPIOTE->EVENTS_IN[GPIOTE_CH_USED_LSM6DS3] = 0;
+        (void) NRF_GPIOTE->EVENTS_IN[GPIOTE_CH_USED_LSM6DS3];
+#endif
+        fifo_read_start ();
+    }
+}
+
 /**
  * @brief function to configure FIFO
  */
-//void LSM6DS3_FIFO_config(void)
-//{
-//  twim_ret_status err_code;
-//  uint8_t tx_data[2];
-//
-//  // masking the threshold value in FIFO_CTRL1 register.
-//  tx_data[0] = FIFO_CTRL1;
-//  tx_data[1] = settings.FIFO_threshold & 0x00FF;
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-//  log_printf("Status : %d, %d\n", err_code, __LINE__);
-//
-//  // masking the threshold value in FIFO_CTRL2 register.
-//  tx_data[0] = FIFO_CTRL2;
-//  tx_data[1] = (settings.FIFO_threshold & 0x0F00) >> 8;
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-//  log_printf("Status : %d, %d\n", err_code, __LINE__);
-//
-//  // set up decimation factor for accelerometer and gyroscope
-//  tx_data[0] = FIFO_CTRL3;
-//  tx_data[1] = 0;
-//  if(settings.accel_FIFO_enable == 1) {
-//    tx_data[1] |= (settings.accel_FIFO_decimation & 0x07);
-//  }
-//
-//  if (settings.gyro_FIFO_enable == 1) {
-//    tx_data[1] |= ((settings.gyro_FIFO_decimation & 0x07) << 3);
-//  }
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-//  log_printf("Status : %d, %d\n", err_code, __LINE__);
-//
-//  // configure sensor hub (if any)
-//  // set decimation and ONLY_HIGH_DATA bit here
-//  // tx_data[0] = FIFO_CTRL4;
-//
-//  // configure FIFO_CTRL5 register
-//  tx_data[0] = FIFO_CTRL5;
-//  // set FIFO ODR
-//  tx_data[1] = 0;
-//  switch(settings.FIFO_samplerate) {
-//    default:
-//    case 13:
-//            tx_data[1] |= LSM6DS3_IMU_ODR_FIFO_13Hz;
-//            break;
-//
-//    case 26:
-//            tx_data[1] |= LSM6DS3_IMU_ODR_FIFO_26Hz;
-//            break;
-//
-//    case 52:
-//            tx_data[1] |= LSM6DS3_IMU_ODR_FIFO_52Hz;
-//            break;
-//
-//    case 104:
-//            tx_data[1] |= LSM6DS3_IMU_ODR_FIFO_104Hz;
-//            break;
-//
-//    case 208:
-//            tx_data[1] |= LSM6DS3_IMU_ODR_FIFO_208Hz;
-//            break;
-//
-//    case 416:
-//            tx_data[1] |= LSM6DS3_IMU_ODR_FIFO_416Hz;
-//            break;
-//
-//    case 833:
-//            tx_data[1] |= LSM6DS3_IMU_ODR_FIFO_833Hz;
-//            break;
-//
-//    case 1660:
-//            tx_data[1] |= LSM6DS3_IMU_ODR_FIFO_1660Hz;
-//            break;
-//
-//    case 3330:
-//            tx_data[1] |= LSM6DS3_IMU_ODR_FIFO_3330Hz;
-//            break;
-//
-//    case 6660:
-//            tx_data[1] |= LSM6DS3_IMU_ODR_FIFO_6660Hz;
-//            break;
-//  }
-//
-//  // set FIFO mode
-//  switch(settings.FIFO_mode) {
-//    default:
-//    case 0:
-//          tx_data[1] |= LSM6DS3_IMU_FIFO_MODE_BYPASS;
-//          break;
-//
-//    case 1:
-//            tx_data[1] |= LSM6DS3_IMU_FIFO_MODE_FIFO;
-//            break;
-//
-//    case 3:
-//            tx_data[1] |= LSM6DS3_IMU_FIFO_MODE_STF;
-//            break;
-//
-//    case 4:
-//            tx_data[1] |= LSM6DS3_IMU_FIFO_MODE_BTS;
-//            break;
-//
-//    case 6:
-//            tx_data[1] |= LSM6DS3_IMU_FIFO_MODE_STREAM;
-//            break;
-//  }
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-//  log_printf("Status : %d, %d\n", err_code, __LINE__);
-//}
+void LSM6DS3_FIFO_config(void)
+{
+  uint8_t fifo_ctrl3 = 0;
+  uint8_t fifo_ctrl5 = 0;
+
+  //Wait for the previous FIFO config script to be done with its buffers
+  while(fifo_config_pending == true);
+
+  // set up decimation factor for accelerometer and gyroscope
+  if(settings.accel_FIFO_enable == 1) {
+    fifo_ctrl3 |= (settings.accel_FIFO_decimation & 0x07);
+  }
+
+  if (settings.gyro_FIFO_enable == 1) {
+    fifo_ctrl3 |= ((settings.gyro_FIFO_decimation & 0x07) << 3);
+  }
+
+  // set FIFO ODR
+  switch(settings.FIFO_samplerate) {
+    default:
+    case 13:
+            fifo_ctrl5 |= LSM6DS3_IMU_ODR_FIFO_13Hz;
+            break;
+
+    case 26:
+            fifo_ctrl5 |= LSM6DS3_IMU_ODR_FIFO_26Hz;
+            break;
+
+    case 52:
+            fifo_ctrl5 |= LSM6DS3_IMU_ODR_FIFO_52Hz;
+            break;
+
+    case 104:
+            fifo_ctrl5 |= LSM6DS3_IMU_ODR_FIFO_104Hz;
+            break;
+
+    case 208:
+            fifo_ctrl5 |= LSM6DS3_IMU_ODR_FIFO_208Hz;
+            break;
+
+    case 416:
+            fifo_ctrl5 |= LSM6DS3_IMU_ODR_FIFO_416Hz;
+            break;
+
+    case 833:
+            fifo_ctrl5 |= LSM6DS3_IMU_ODR_FIFO_833Hz;
+            break;
+
+    case 1660:
+            fifo_ctrl5 |= LSM6DS3_IMU_ODR_FIFO_1660Hz;
+            break;
+
+    case 3330:
+            fifo_ctrl5 |= LSM6DS3_IMU_ODR_FIFO_3330Hz;
+            break;
+
+    case 6660:
+            fifo_ctrl5 |= LSM6DS3_IMU_ODR_FIFO_6660Hz;
+            break;
+  }
+
+  // set FIFO mode
+  switch(settings.FIFO_mode) {
+    default:
+    case 0:
+          fifo_ctrl5 |= LSM6DS3_IMU_FIFO_MODE_BYPASS;
+          break;
+
+    case 1:
+            fifo_ctrl5 |= LSM6DS3_IMU_FIFO_MODE_FIFO;
+            break;
+
+    case 3:
+            fifo_ctrl5 |= LSM6DS3_IMU_FIFO_MODE_STF;
+            break;
+
+    case 4:
+            fifo_ctrl5 |= LSM6DS3_IMU_FIFO_MODE_BTS;
+            break;
+
+    case 6:
+            fifo_ctrl5 |= LSM6DS3_IMU_FIFO_MODE_STREAM;
+            break;
+  }
+
+  // masking the threshold value in FIFO_CTRL1 and FIFO_CTRL2 registers.
+  fifo_config_regs[1][1] = settings.FIFO_threshold & 0x00FF;
+  fifo_config_regs[2][1] = (settings.FIFO_threshold & 0x0F00) >> 8;
+  fifo_config_regs[3][1] = fifo_ctrl3;
+  fifo_config_regs[4][1] = fifo_int1_ctrl;
+  fifo_config_regs[5][1] = fifo_ctrl5;
+
+  fifo_config_pending = true;
+  while(hal_twim_queue_xfer (&fifo_config_xfer) == false);
+}
+
+void LSM6DS3_FIFO_stream_start(uint32_t irq_priority,
+    void (*block_handler)(const LSM6DS3_accel_sample_t * p_samples, uint32_t sample_cnt))
+{
+    for(uint32_t buf = 0; buf < 2; buf++)
+    {
+        for(uint32_t step = 0; step < FIFO_READ_STEPS; step++)
+        {
+            uint32_t offset = step * FIFO_READ_MAX_BYTES;
+            fifo_read_ops[buf][step].p_tx = &fifo_data_reg;
+            fifo_read_ops[buf][step].tx_len = 1;
+            fifo_read_ops[buf][step].p_rx = ((uint8_t *) fifo_block[buf]) + offset;
+            fifo_read_ops[buf][step].rx_len =
+                ((FIFO_BLOCK_BYTES - offset) < FIFO_READ_MAX_BYTES)?
+                (FIFO_BLOCK_BYTES - offset) : FIFO_READ_MAX_BYTES;
+        }
+        fifo_read_xfer[buf].address = LSM6DS3_ADDR;
+        fifo_read_xfer[buf].p_ops = fifo_read_ops[buf];
+        fifo_read_xfer[buf].op_cnt = FIFO_READ_STEPS;
+        fifo_read_xfer[buf].done_handler = fifo_read_done;
+        fifo_read_xfer[buf].p_context = (void *) buf;
+    }
+    fifo_fill_idx = 0;
+    fifo_block_handler = block_handler;
+
+    //INT1 is push-pull and active high
+    hal_gpio_cfg_input (LSM6DS3_INT1_PIN, HAL_GPIO_PULL_DISABLED);
+    NRF_GPIOTE->EVENTS_IN[GPIOTE_CH_USED_LSM6DS3] = 0;
+    NRF_GPIOTE->CONFIG[GPIOTE_CH_USED_LSM6DS3] =
+        GPIOTE_CONFIG_MODE_Event << GPIOTE_CONFIG_MODE_Pos|
+        GPIOTE_CONFIG_POLARITY_LoToHi << GPIOTE_CONFIG_POLARITY_Pos|
+        ((LSM6DS3_INT1_PIN << GPIOTE_CONFIG_PSEL_Pos)
+         & GPIOTE_CONFIG_PSEL_Msk);
+    NRF_GPIOTE->INTENSET = GPIOTE_INTENSET_IN0_Msk << GPIOTE_CH_USED_LSM6DS3;
+
+    NVIC_ClearPendingIRQ(GPIOTE_IRQn);
+    NVIC_SetPriority(GPIOTE_IRQn, irq_priority);
+    NVIC_EnableIRQ(GPIOTE_IRQn);
+
+    // only accelerometer data in the FIFO, watermark is in 16 bit words
+    settings.accel_FIFO_enable      = 1;
+    settings.accel_FIFO_decimation  = LSM6DS3_IMU_DEC_FIFO_XL_NO_DECIMATION;
+    settings.gyro_FIFO_enable       = 0;
+    settings.FIFO_threshold         = LSM6DS3_FIFO_BLOCK_SAMPLES * 3;
+    settings.FIFO_samplerate        = settings.accel_samplerate;
+    settings.FIFO_mode              = 6;
+    fifo_int1_ctrl = LSM6DS3_IMU_INT1_FTH_ENABLED;
+    LSM6DS3_FIFO_config();
+}
+
+void LSM6DS3_FIFO_stream_stop(void)
+{
+    NRF_GPIOTE->INTENCLR = GPIOTE_INTENCLR_IN0_Msk << GPIOTE_CH_USED_LSM6DS3;
+    NRF_GPIOTE->CONFIG[GPIOTE_CH_USED_LSM6DS3] =
+        GPIOTE_CONFIG_MODE_Disabled << GPIOTE_CONFIG_MODE_Pos;
+    fifo_block_handler = NULL;
+
+    settings.FIFO_mode = 0;
+    fifo_int1_ctrl = 0;
+    LSM6DS3_FIFO_config();
+}
 
 /**
  * @brief function to read FIFO status
  */
-//uint16_t LSM6DS3_read_FIFO_status(void)
-//{
-//  twim_ret_status err_code;
-//  uint8_t data[2];
-//  //uint8_t tx_data[2];
-//  uint16_t status = 0;
-//
-//  /*// set BDU bit in CTRL3_C registers
-//  tx_data[0] = CTRL3_C;
-//  tx_data[1] = 0x40;
-//  err_code = nrf_drv_twi_tx(&p_twi_sensors, LSM6DS3_ADDR, tx_data, sizeof(tx_data), false);
-//  log_printf("Status : %d, %d\n", err_code, __LINE__);*/
-//
-//  // read FIFO_STATUS1 and FIFO_STATUS2 registers
-//  err_code = read_register(p_twi_sensors, LSM6DS3_ADDR, FIFO_STATUS1, data, sizeof(data), true);
-//  log_printf("Status : %d, %d\n", err_code, __LINE__);
-//  status = (data[1] << 8) | data[0];
-//
-//  return status;
-//}
+uint16_t LSM6DS3_read_FIFO_status(void)
+{
+  twim_err_t err_code;
+  uint8_t status_reg = FIFO_STATUS1;
+  uint8_t data[2] = {0};
+  hal_twim_op_t op = {.p_tx = &status_reg, .tx_len = 1, .p_rx = data, .rx_len = sizeof(data)};
+
+  // read FIFO_STATUS1 and FIFO_STATUS2 registers
+  err_code = run_script (&op, 1);
+  log_printf("Status : %d, %d\n", err_code, __LINE__);
+
+  return (data[1] << 8) | data[0];
+}
 
 /**
  * @brief function to read FIFO buffer
  */
-//int16_t LSM6DS3_read_FIFO_buffer()
-//{
-//  twim_ret_status err_code;
-//  uint8_t read_data[2];
-//  int16_t data = 0;
-//
-//  // read FIFO_DATA_OUT_L and FIFO_DATA_OUT_H registers
-//  err_code = read_register(p_twi_sensors, LSM6DS3_ADDR, FIFO_DATA_OUT_L, read_data, sizeof(read_data), true);
-//  log_printf("Status : %d, %d\n", err_code, __LINE__);
-//  data = (read_data[1] << 8) | read_data[0];
-//
-//  return data;
-//}
+int16_t LSM6DS3_read_FIFO_buffer(void)
+{
+  twim_err_t err_code;
+  uint8_t read_data[2] = {0};
+  hal_twim_op_t op = {.p_tx = &fifo_data_reg, .tx_len = 1, .p_rx = read_data, .rx_len = sizeof(read_data)};
+
+  // read FIFO_DATA_OUT_L and FIFO_DATA_OUT_H registers
+  err_code = run_script (&op, 1);
+  log_printf("Status : %d, %d\n", err_code, __LINE__);
+
+  return (read_data[1] << 8) | read_data[0];
+}
 
 /**
  * @brief function to empty FIFO buffer
  */
-//void LSM6DS3_clear_FIFO_buffer(void)
-//{
-//  // Read FIFO data and dump it.
-//  while((LSM6DS3_read_FIFO_status() & 0x1000) == 0) {
-//    LSM6DS3_read_FIFO_buffer();
-//  }
-//}
+void LSM6DS3_clear_FIFO_buffer(void)
+{
+  // Read FIFO data and dump it.
+  while((LSM6DS3_read_FIFO_status() & 0x1000) == 0) {
+    LSM6DS3_read_FIFO_buffer();
+  }
+}
 
 /**
  * @brief function to configure tap functionality
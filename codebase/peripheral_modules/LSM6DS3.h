@@ -51,6 +51,30 @@
 #include "app_error.h"
 #include "boards.h"
 
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+#ifndef GPIOTE_CH_USED_LSM6DS3
+/** GPIOTE channel used for the FIFO watermark interrupt on INT1 */
+#define GPIOTE_CH_USED_LSM6DS3 0
+#endif
+
+#ifndef LSM6DS3_FLOAT_CONV
+/** Set to 1 to convert the accelerometer data with float math instead of
+ *  fixed point, only to compare the two */
+#define LSM6DS3_FLOAT_CONV 0
+#endif
+
+/** Sensitivity of the accelerometer at the 2 g range, 0.061 mg/LSB, in Q15 */
+#define LSM6DS3_ACCEL_MG_PER_LSB_2G_Q15     1999
+
+#ifndef LSM6DS3_FIFO_BLOCK_SAMPLES
+/** Number of accelerometer samples in a block delivered by the FIFO
+ *  stream, which is also the FIFO watermark. Can be up to 1365. */
+#define LSM6DS3_FIFO_BLOCK_SAMPLES 128
+#endif
+
 /*Pin Definitions*/
 #define INT1                    15
 #define INT2                    20
@@ -1783,6 +1807,13 @@ struct IMU_settings {
     uint8_t FIFO_mode;
 };
 
+/** An accelerometer sample as it is stored in the FIFO */
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+} LSM6DS3_accel_sample_t;
+
 /**
  * @brief function to initialize IMU sensor.
  */
@@ -1850,6 +1881,12 @@ void LSM6DS3_read_accl_data(int16_t *x_axis, int16_t *y_axis, int16_t *z_axis);
  */
 int16_t LSM6DS3_accelData_in_g(int16_t raw_data);
 
+/**
+ * @brief function to get the accelerometer sensitivity at the configured range.
+ * @return Sensitivity in mg per LSB as a Q15 number
+ */
+uint32_t LSM6DS3_accel_mg_per_lsb_q15(void);
+
 /**
  * @brief function to disable sleep mode in gyroscope
  */
@@ -1875,9 +1912,34 @@ float LSM6DS3_gyroData_in_dps(int16_t raw_data);
 
 /**
  * @brief function to configure FIFO
+ *
+ * FIFO is reset by going through the bypass mode and then configured as per
+ * the FIFO settings in a single register script. This function returns once
+ * the script is queued.
  */
 void LSM6DS3_FIFO_config(void);
 
+/**
+ * @brief function to start streaming the accelerometer data through the FIFO.
+ *
+ * The FIFO is configured in continuous mode at the accelerometer ODR with a
+ * watermark of @ref LSM6DS3_FIFO_BLOCK_SAMPLES, routed to INT1. On the
+ * watermark interrupt the block is read in one TWIM burst into one half of a
+ * double buffer, which is then given to the block_handler.
+ * @param irq_priority Priority of the GPIOTE interrupt for the watermark
+ * @param block_handler Function called from the TWIM interrupt with a block
+ *  of samples. The block is valid till the next call of the handler.
+ * @note This uses the GPIOTE channel @ref GPIOTE_CH_USED_LSM6DS3
+ */
+void LSM6DS3_FIFO_stream_start(uint32_t irq_priority,
+    void (*block_handler)(const LSM6DS3_accel_sample_t * p_samples, uint32_t sample_cnt));
+
+/**
+ * @brief function to stop streaming the accelerometer data through the FIFO.
+ * The FIFO is put in bypass mode and INT1 is disabled.
+ */
+void LSM6DS3_FIFO_stream_stop(void);
+
 /**
  * @brief function to empty FIFO buffer
  */
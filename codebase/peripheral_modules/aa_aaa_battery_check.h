@@ -45,6 +45,17 @@ inline uint8_t aa_aaa_battery_status()
     return ((simple_adc_get_value(SIMPLE_ADC_GAIN1_6,ANALOG_VDD) >> 4) & 0xFF);
 }
 
+/**
+ * @brief Function to convert a battery ADC value read elsewhere, such as with
+ *  @ref simple_adc_request, to the battery status
+ * @param adc_val ADC value of @ref ANALOG_VDD with the gain of 1/6
+ * @return 8bit ADC value corresponding to battery voltage
+ */
+static inline uint8_t aa_aaa_battery_status_from_adc(uint32_t adc_val)
+{
+    return ((adc_val >> 4) & 0xFF);
+}
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,114 @@
+/**
+ *  adv_beacon.c : Beacons of the telemetry without the SoftDevice
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "adv_beacon.h"
+#include "ble_adv.h"
+#include "adv_telemetry.h"
+#include "nrf.h"
+#include "nrf_assert.h"
+#include "string.h"
+
+/** Upper bits of the address which mark it as static random, as is done
+ *  by the SoftDevice with the address in FICR */
+#define STATIC_RANDOM_ADRS_MSK  0xC0
+
+static struct
+{
+    adv_beacon_config_t config;
+    uint8_t adv_data[ADV_BEACON_MAX_DATA_LEN];
+    uint32_t ticks;
+    volatile bool is_on;
+}beacon;
+
+/** Called at the end of a beacon by ble_adv */
+static void beacon_done (void)
+{
+    if(beacon.config.radio_release != NULL)
+    {
+        beacon.config.radio_release ();
+    }
+}
+
+void adv_beacon_start (const adv_beacon_config_t * p_config)
+{
+    ASSERT((p_config->adv_len <= ADV_BEACON_MAX_DATA_LEN) &&
+           (p_config->telemetry_pos + ADV_TELEMETRY_LEN <= p_config->adv_len));
+
+    uint8_t adrs[ADRS_LEN];
+    ble_adv_param_t adv_param =
+    {
+        //Not used for the single events, which are paced by the ticks
+        .adv_intvl = ADV_INTERVAL_MS(1000),
+        .adv_type = ADV_NONCONN_IND_PARAM,
+        .own_adrs_type = RANDOM_ADRS_PARAM,
+        .adv_ch_map = CH_ALL_PARAM
+    };
+
+    memcpy (&beacon.config, p_config, sizeof(adv_beacon_config_t));
+    memcpy (beacon.adv_data, p_config->p_adv_data, p_config->adv_len);
+
+    memcpy (adrs, (const void *) NRF_FICR->DEVICEADDR, ADRS_LEN);
+    adrs[ADRS_LEN - 1] |= STATIC_RANDOM_ADRS_MSK;
+    ble_adv_set_random_adrs (adrs);
+    ble_adv_set_adv_param (&adv_param);
+    ble_adv_set_tx_power (0);
+
+    //So that the first beacon is at the first tick
+    beacon.ticks = beacon.config.interval_ticks;
+    beacon.is_on = true;
+}
+
+void adv_beacon_add_ticks (uint32_t ticks)
+{
+    if(beacon.is_on == false)
+    {
+        return;
+    }
+    beacon.ticks += ticks;
+    if(beacon.ticks < beacon.config.interval_ticks)
+    {
+        return;
+    }
+
+    if(ble_adv_is_event_ongoing () == true)
+    {
+        //The end of the previous beacon was missed, so free the radio
+        ble_adv_event_abort ();
+        return;
+    }
+    if((beacon.config.radio_claim != NULL) &&
+       (beacon.config.radio_claim () == false))
+    {
+        //Tried again at the next tick
+        return;
+    }
+    beacon.ticks = 0;
+
+    adv_telemetry_encode (&beacon.adv_data[beacon.config.telemetry_pos]);
+    ble_adv_set_adv_data (beacon.config.adv_len, beacon.adv_data);
+    if(ble_adv_event (beacon_done) == false)
+    {
+        beacon_done ();
+    }
+}
+
+void adv_beacon_stop (void)
+{
+    beacon.is_on = false;
+    ble_adv_event_abort ();
+}
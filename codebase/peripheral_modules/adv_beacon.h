@@ -0,0 +1,91 @@
+/**
+ *  adv_beacon.h : Beacons of the telemetry without the SoftDevice
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup group_peripheral_modules
+ * @{
+ *
+ * @defgroup group_adv_beacon Advertising beacon
+ * @brief Module to send the telemetry in non-connectable advertisements while
+ *  the SoftDevice is disabled, so that a site can be scanned without
+ *  connecting to the devices.
+ *
+ * The beacons are single events of @ref group_ble_adv with the address of
+ *  the SoftDevice, so that a scanner sees the same device as when it
+ *  advertises. The application paces them with @ref adv_beacon_add_ticks
+ *  from a timer it already has running, as no ms timer is left for this
+ *  module. The latest telemetry from @ref adv_telemetry_encode is put in the
+ *  payload of each beacon. If the radio is shared with another module, it
+ *  is claimed for each beacon with the handlers in the config and a beacon
+ *  is skipped till the next tick if the radio is in use.
+ *
+ * @note @ref adv_beacon_stop must be called before the SoftDevice is enabled.
+ * @{
+ */
+
+#ifndef CODEBASE_PERIPHERAL_MODULES_ADV_BEACON_H_
+#define CODEBASE_PERIPHERAL_MODULES_ADV_BEACON_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+/** Maximum length of the advertising data of a beacon */
+#define ADV_BEACON_MAX_DATA_LEN     31
+
+/** Configuration of the beacons */
+typedef struct
+{
+    /** Advertising data, a sequence of {Len, type, data} */
+    const uint8_t * p_adv_data;
+    /** Length of the advertising data, at most @ref ADV_BEACON_MAX_DATA_LEN */
+    uint32_t adv_len;
+    /** Position of the telemetry in the advertising data */
+    uint32_t telemetry_pos;
+    /** Interval of the beacons in ms timer ticks */
+    uint32_t interval_ticks;
+    /** Handler to claim the radio, which returns false if it is in use.
+     *  NULL if the radio isn't shared. */
+    bool (* radio_claim)(void);
+    /** Handler to release the radio once a beacon is done. NULL if the
+     *  radio isn't shared. */
+    void (* radio_release)(void);
+}adv_beacon_config_t;
+
+/**
+ * @brief Function to start the beacons, the first one is at the first tick
+ * @param p_config Pointer to the configuration of the beacons
+ */
+void adv_beacon_start (const adv_beacon_config_t * p_config);
+
+/**
+ * @brief Function to pass the time to the beacons
+ * @param ticks Time elapsed in ms timer ticks
+ */
+void adv_beacon_add_ticks (uint32_t ticks);
+
+/**
+ * @brief Function to stop the beacons, with an ongoing one aborted
+ */
+void adv_beacon_stop (void);
+
+#endif /* CODEBASE_PERIPHERAL_MODULES_ADV_BEACON_H_ */
+
+/**
+ * @}
+ * @}
+ */
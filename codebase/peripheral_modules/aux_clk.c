@@ -146,9 +146,7 @@ void TIMER_IRQ_Handler (void)
 
 void set_timer ()
 {
-#if AUX_CLK_HFCLK_SOLO_MODULE == 1
-    hfclk_xtal_init_blocking ();
-#endif
+    hfclk_xtal_request (HFCLK_XTAL_USER_AUX_CLK, NULL);
     if(g_irq_priority != APP_IRQ_PRIORITY_THREAD)
     {
         NVIC_SetPriority (TIMER_IRQN, g_irq_priority);
@@ -160,9 +158,7 @@ void set_timer ()
 
 void set_rtc ()
 {
-#if AUX_CLK_HFCLK_SOLO_MODULE == 1
-    hfclk_xtal_deinit ();
-#endif
+    hfclk_xtal_release (HFCLK_XTAL_USER_AUX_CLK);
     if(g_irq_priority != APP_IRQ_PRIORITY_THREAD)
     {
         NVIC_SetPriority (RTC_IRQN, g_irq_priority);
@@ -78,9 +78,6 @@
 #define AUX_CLK_HFCLK_TIMER_USED 2
 #endif
 
-#ifndef AUX_CLK_HFCLK_SOLO_MODULE 
-#define AUX_CLK_HFCLK_SOLO_MODULE 1
-#endif
 #define AUX_CLK_NO_IRQ 0xFFFFFFFF
 
 #define AUX_CLK_MAX_CHANNELS 4
@@ -49,8 +49,9 @@
  */
 
 #include "ble_adv.h"
-#include "hal_clocks.h"
+#if BLE_ADV_SCANNABLE == 1
 #include "us_timer.h"
+#endif
 #include "ms_timer.h"
 #include "tinyprintf.h"
 #include "nrf.h"
@@ -87,6 +88,23 @@
 
 #define TIME_TO_RX_ACCESS_ADRS      200
 
+/** ms timer used to schedule the advertising events */
+#define ADV_MS_TIMER                CONCAT_2(MS_TIMER, MS_TIMER_USED_BLE_ADV)
+
+/** Conversion from multiples of 0.625 ms to ms timer ticks */
+#define ADV_625_TICKS(x)            \
+        ((uint32_t) ROUNDED_DIV((MS_TIMER_FREQ*(uint64_t)(x)), 1600))
+
+/** Maximum advDelay of 10 ms in ms timer ticks */
+#define ADV_DELAY_MAX_TICKS         MS_TIMER_TICKS_MS(10)
+
+/** Lead of the event wake up for the crystal to start, in ms timer ticks */
+#define HFXO_LEAD_TICKS             \
+        ((uint32_t) ROUNDED_DIV((MS_TIMER_FREQ*(uint64_t)BLE_ADV_HFXO_STARTUP_US), 1000000))
+
+/** Mask of the 24 bit RTC counter */
+#define RTC_COUNTER_MASK            0xFFFFFF
+
 #define SHORT_READY_START           \
         (RADIO_SHORTS_READY_START_Enabled << RADIO_SHORTS_READY_START_Pos)
 #define SHORT_END_DIS               \
@@ -102,6 +120,7 @@ const uint8_t adv_channels[] = {37, 38, 39};
 const uint8_t adv_freq[] = {2, 26, 80};
 
 void irq_null_end(void);
+void irq_adv_nc_end(void);
 void irq_scan_end(void);
 
 void irq_null_dis(void);
@@ -131,7 +150,7 @@ typedef enum{
 
 void (*end_handler[])(void) = {
     irq_null_end,               //IDLE
-    irq_null_end,               //ADV_NC
+    irq_adv_nc_end,             //ADV_NC
     irq_null_end,               //ADV_TX
     irq_null_end,               //ADV_RX
     irq_scan_end                //SCAN
@@ -162,7 +181,14 @@ static struct radio_context {
     int8_t adv_pwr;                     //1 byte
     volatile uint8_t adv_idx;           //1 byte
     volatile bool is_scan;              //1 byte
+    volatile bool is_last_ch;           //1 byte
     uint16_t adv_intvl;                 //2 byte
+
+    /**Scheduling**/
+    uint32_t anchor;                    //4 bytes
+    uint32_t rand_state;                //4 bytes
+    volatile bool is_single_event;      //1 byte
+    void (* event_done_handler)(void);  //4 bytes
 } radio_ctx;
 
 #ifdef DEBUG
@@ -214,6 +240,10 @@ void ble_adv_set_adv_param(ble_adv_param_t * adv_param){
             radio_ctx.adv_type = ADV_NONCONN_IND;
             break;
     }
+#if BLE_ADV_SCANNABLE == 0
+    //Without the us timer to listen for scan requests
+    radio_ctx.adv_type = ADV_NONCONN_IND;
+#endif
 
     radio_ctx.adv_intvl = adv_param->adv_intvl;
     radio_ctx.adv_ch_map[ADV_IDX_CH_37] = (adv_param->adv_ch_map & 0x01);
@@ -290,6 +320,11 @@ void radio_prepare_adv(void)
     radio_ctx.state = STOP;
 }
 
+/** Starts the radio for the advertising event once the crystal is running */
+static void adv_radio_start(void){
+    NRF_RADIO->TASKS_TXEN = 1UL;
+}
+
 void radio_send_adv(void){
     switch(radio_ctx.adv_type){
         case ADV_IND:
@@ -300,6 +335,11 @@ void radio_send_adv(void){
             break;
         case ADV_NONCONN_IND:
             radio_ctx.state = ADV_NC;
+            radio_ctx.is_last_ch = false;
+            NRF_RADIO->SHORTS = SHORT_READY_START;
+            //The CPU is woken at the END of each channel only, the DISABLED
+            //interrupt is needed at the end of the event
+            NRF_RADIO->INTENCLR = RADIO_INTENCLR_DISABLED_Msk;
             break;
         case SCAN_REQ:
         case SCAN_RSP:
@@ -311,7 +351,24 @@ void radio_send_adv(void){
 
     NRF_RADIO->PACKETPTR = (uint32_t) radio_ctx.adv_txbuf;
 
-    NRF_RADIO->TASKS_TXEN = 1UL;
+    //The radio is started right away if the crystal is already running
+    hfclk_xtal_request(HFCLK_XTAL_USER_BLE_ADV, adv_radio_start);
+}
+
+/** Called once the radio is disabled at the end of an advertising event */
+static void adv_event_end(void){
+    hfclk_xtal_release(HFCLK_XTAL_USER_BLE_ADV);
+
+    if(radio_ctx.is_single_event){
+        //The radio is left for other users till the next event
+        radio_ctx.is_single_event = false;
+        NVIC_DisableIRQ(RADIO_IRQn);
+        NRF_RADIO->INTENCLR = RADIO_INTENCLR_END_Msk | RADIO_INTENCLR_DISABLED_Msk;
+        NVIC_ClearPendingIRQ(RADIO_IRQn);
+        if(NULL != radio_ctx.event_done_handler){
+            radio_ctx.event_done_handler();
+        }
+    }
 }
 
 void radio_init(void){
@@ -420,7 +477,7 @@ void radio_deinit(void){
     //NRF_RADIO->POWER = RADIO_POWER_POWER_Disabled;
 }
 
-bool check_set_ch_idx(){
+static bool set_next_ch_idx(void){
     radio_ctx.adv_idx++;
 
     while(ADV_IDX_CH_MAX != radio_ctx.adv_idx){
@@ -430,8 +487,16 @@ bool check_set_ch_idx(){
             radio_ctx.adv_idx++;
         }
     }
+    return false;
+}
+
+bool check_set_ch_idx(){
+    if(set_next_ch_idx()){
+        return true;
+    }
 
     radio_deinit();
+    adv_event_end();
     return false;
 }
 
@@ -453,15 +518,32 @@ void rx_timer_handler(void){
 void irq_null_end(void){}
 void irq_null_dis(void){}
 
+void irq_adv_nc_end(void){
+    //The radio waits in TXIDLE while the next channel is set, after which
+    //the DISABLED to TXEN short starts it on the new channel
+    if(set_next_ch_idx()){
+        adv_set_ch_freq();
+        NRF_RADIO->SHORTS = SHORT_READY_START | SHORT_DIS_TXEN;
+    } else {
+        radio_ctx.is_last_ch = true;
+        NRF_RADIO->SHORTS = SHORT_READY_START;
+        NRF_RADIO->EVENTS_DISABLED = 0;
+        NRF_RADIO->INTENSET = RADIO_INTENSET_DISABLED_Msk;
+    }
+    NRF_RADIO->TASKS_DISABLE = 1;
+}
+
 void irq_scan_end(void){
     NRF_RADIO->SHORTS = SHORT_READY_START | SHORT_END_DIS;
 }
 
 void irq_adv_tx_dis(void){
+#if BLE_ADV_SCANNABLE == 1
     //150 us for IFS and 100 us time to see if the address event has been
     //generated by receiving a packet
     us_timer_start(US_TIMER3, US_SINGLE_CALL,
                     TIME_TO_RX_ACCESS_ADRS, rx_timer_handler);
+#endif
 
     NRF_RADIO->PACKETPTR = (uint32_t) radio_ctx.adv_rxbuf;
     NRF_RADIO->EVENTS_ADDRESS = 0;
@@ -507,9 +589,12 @@ void irq_scan_dis(void){
 void irq_adv_nc_dis(void){
 //    add_log(__func__);
 
-    if(check_set_ch_idx()){
-        adv_set_ch_freq();
-        NRF_RADIO->TASKS_TXEN = 1UL;
+    //DISABLED of the hops between the channels is left to the short
+    if(radio_ctx.is_last_ch){
+        radio_ctx.is_last_ch = false;
+        radio_deinit();
+        NRF_RADIO->INTENSET = RADIO_INTENSET_DISABLED_Msk;
+        adv_event_end();
     }
 }
 
@@ -541,19 +626,101 @@ void RADIO_IRQHandler(void)
     }
 }
 
+void adv_intvl_handler(void);
+
+/** xorshift for advDelay, so that advertisers don't keep colliding */
+static uint32_t adv_rand(void){
+    radio_ctx.rand_state ^= radio_ctx.rand_state << 13;
+    radio_ctx.rand_state ^= radio_ctx.rand_state >> 17;
+    radio_ctx.rand_state ^= radio_ctx.rand_state << 5;
+    return radio_ctx.rand_state;
+}
+
+/** Lead of the event wake up, only when the crystal has to be started. It is
+ *  found while this module has the crystal released, so it is running only
+ *  if another module has it requested and then the radio starts at once. */
+static uint32_t adv_hfxo_lead(void){
+    return (hfclk_xtal_is_running() ? 0 : HFXO_LEAD_TICKS);
+}
+
+/** Schedules the next event at the interval plus advDelay from the anchor of
+ *  the current one, waking up early enough for the crystal to start */
+static void adv_schedule_next(void){
+    uint32_t intvl = ADV_625_TICKS(radio_ctx.adv_intvl);
+    uint32_t lead = adv_hfxo_lead();
+    uint32_t ticks;
+
+    radio_ctx.anchor += intvl + (adv_rand() % (ADV_DELAY_MAX_TICKS + 1));
+    ticks = (radio_ctx.anchor - lead
+            - ms_timer_get_current_count()) & RTC_COUNTER_MASK;
+
+    //Too late for this anchor, which wraps the difference, so start again
+    if((ticks == 0) || (ticks > (intvl + ADV_DELAY_MAX_TICKS))){
+        ticks = intvl;
+        radio_ctx.anchor = ms_timer_get_current_count() + intvl + lead;
+    }
+    ms_timer_start(ADV_MS_TIMER, MS_SINGLE_CALL, ticks, adv_intvl_handler);
+}
+
 void adv_intvl_handler(void){
+    adv_schedule_next();
+
+    if(STOP != radio_ctx.state){
+        if(RADIO_STATE_STATE_Disabled == NRF_RADIO->STATE){
+            //The end of the previous event was missed
+            radio_deinit();
+            adv_event_end();
+        } else {
+            //An event with a long scan response is still going on
+            return;
+        }
+    }
     radio_prepare_adv();
     radio_send_adv();
 //    add_log(__func__);
 }
 
 void ble_adv_start(void){
+    radio_ctx.is_single_event = false;
     radio_init();
-    ms_timer_start(MS_TIMER2, MS_REPEATED_CALL, LFCLK_TICKS_625(radio_ctx.adv_intvl), adv_intvl_handler);
+
+    radio_ctx.rand_state = NRF_FICR->DEVICEID[0] ^ ms_timer_get_current_count();
+    if(0 == radio_ctx.rand_state){
+        radio_ctx.rand_state = 1;
+    }
+
+    radio_ctx.state = STOP;
+    radio_ctx.anchor = ms_timer_get_current_count() + adv_hfxo_lead();
     adv_intvl_handler();
 }
 
 void ble_adv_stop(void){
-    ms_timer_stop(MS_TIMER2);
+    ms_timer_stop(ADV_MS_TIMER);
+}
+
+bool ble_adv_event(void (* done_handler)(void)){
+    if(STOP != radio_ctx.state){
+        return false;
+    }
+    radio_ctx.is_single_event = true;
+    radio_ctx.event_done_handler = done_handler;
+
+    radio_init();
+    radio_prepare_adv();
+    radio_send_adv();
+    return true;
+}
+
+void ble_adv_event_abort(void){
+    CRITICAL_REGION_ENTER();
+    if(STOP != radio_ctx.state){
+        radio_deinit();
+        adv_event_end();
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+bool ble_adv_is_event_ongoing(void){
+    return (STOP != radio_ctx.state);
 }
 
@@ -23,11 +23,29 @@
  * @defgroup group_ble_adv BLE Advertisements
  * @brief Driver of the radio to generate BLE advertisements with scan responses
  *
- * @note This module utilizes the @ref MS_TIMER2 and @ref US_TIMER3, so @ref ms_timer_init
- * and @ref us_timer_init must be called before using this module. Also the radio only
- * works with the high frequency crystal enabled, so @ref hfclk_xtal_init_blocking or
- * @ref hfclk_xtal_init_nonblocking must be used before to enable the it. The radio
- * peripheral uses the highest priority interrupt.
+ * The module schedules the advertising events itself. Each event is at the
+ *  advertising interval plus a pseudo-random advDelay of 0 to 10 ms from the
+ *  previous one, with the interval counted by the RTC of the ms timer. The
+ *  high frequency crystal is requested @ref BLE_ADV_HFXO_STARTUP_US ahead of
+ *  the event and the radio is started from the handler of the request once it
+ *  is running. If another module keeps the crystal running, the request is
+ *  made at the event itself as the radio is then started right away. The crystal is released after
+ *  the event, so that it is left on only if another module needs it. For
+ *  non-connectable advertisements the hop to the next channel is done by the
+ *  radio's DISABLED to TXEN short, the CPU only sets the next channel's
+ *  frequency.
+ *
+ * An application which already has a timer running can instead pace the
+ *  events itself with @ref ble_adv_event, which sends a single event right away
+ *  without the ms timer of this module. The radio interrupt is disabled at the
+ *  end of such an event, so that the radio can be used by other modules or the
+ *  SoftDevice in between.
+ *
+ * @note This module utilizes the ms timer @ref MS_TIMER_USED_BLE_ADV and
+ * @ref US_TIMER3, so @ref ms_timer_init and @ref us_timer_init must be called
+ * before using this module. The us timer isn't used when
+ * @ref BLE_ADV_SCANNABLE is 0. The radio peripheral uses the highest priority
+ * interrupt.
  *
  * @{
  */
@@ -38,6 +56,26 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+#ifndef MS_TIMER_USED_BLE_ADV
+#define MS_TIMER_USED_BLE_ADV   2
+#endif
+
+#ifndef BLE_ADV_HFXO_STARTUP_US
+/** Time in us for the high frequency crystal to start before an event */
+#define BLE_ADV_HFXO_STARTUP_US 400
+#endif
+
+#ifndef BLE_ADV_SCANNABLE
+/** 1 for the scannable and connectable advertisements, which listen for a scan
+ *  request with @ref US_TIMER3. 0 to have only non-connectable ones, so that
+ *  the us timer isn't needed. */
+#define BLE_ADV_SCANNABLE       1
+#endif
+
 #ifdef DEBUG
 
 #define LOG_BUFFER_SIZE     128
@@ -145,14 +183,33 @@ void ble_adv_set_tx_power(int8_t pwr);
  */
 int8_t ble_adv_get_tx_power(void);
 
-/** @brief Start advertising based on the parameters set
+/** @brief Start advertising based on the parameters set. The first event is
+ *  right away and the next ones are scheduled by the module.
  */
 void ble_adv_start(void);
 
-/** @brief Stop advertising
+/** @brief Stop advertising. An ongoing advertising event is completed.
  */
 void ble_adv_stop(void);
 
+/** @brief Send a single advertising event right away based on the parameters
+ *  set, for the application to pace the events without @ref ble_adv_start.
+ * @param done_handler Handler called from the radio interrupt at the end of
+ *  the event, NULL if not needed
+ * @return True if the event is started, false if an event is still ongoing
+ */
+bool ble_adv_event(void (* done_handler)(void));
+
+/** @brief Abort an ongoing event sent by @ref ble_adv_event, with the radio
+ *  disabled and its interrupt turned off. Its done handler is called.
+ */
+void ble_adv_event_abort(void);
+
+/** @brief Know if an advertising event is ongoing
+ * @return True if the radio is used by this module
+ */
+bool ble_adv_is_event_ongoing(void);
+
 /** @brief Set the advertising data
  *  @param len Length of the advertising data
  *  @param data_ptr Pointer to the buffer containing the data_ptr
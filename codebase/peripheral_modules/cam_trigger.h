@@ -25,7 +25,9 @@
  * @{
  *
  * @brief Driver triggers the camera according to configuration sent by application.
- * This Driver uses out_pattern_gen module.
+ * This Driver uses out_pattern_gen module. The pattern of each setup is
+ * compiled with @ref group_cam_trigger_plan when the setup is set, so that
+ * a trigger only starts the pattern.
  *
  * The image below gives the flow of how camera triggering takes place.
  * @dot 
@@ -145,7 +147,7 @@ typedef struct
 void cam_trigger_init(cam_trigger_setup_t * cam_trigger_setup);
 
 /**
- * @brief Function to set a camera trigger
+ * @brief Function to set a camera trigger, which compiles the plan of the setup
  * 
  * @param cam_trigger Structure pointer to the structure storing camera trigger related information.
  * 
@@ -0,0 +1,321 @@
+/**
+ *  cam_trigger_plan.c : Precompiled plans to trigger a camera
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "cam_trigger_plan.h"
+#include "ms_timer.h"
+#include "nrf_assert.h"
+#include "string.h"
+
+/** Index of the pins in the out patterns */
+enum
+{
+    FOCUS_PIN,
+    TRIGGER_PIN,
+};
+
+/** Phases of a running plan */
+typedef enum
+{
+    PLAN_IDLE,
+    PLAN_RUN,
+    PLAN_VIDEO_START,
+    PLAN_VIDEO_END,
+    PLAN_VIDEO_EXTN,
+    PLAN_VIDEO_ITT,
+}plan_state_t;
+
+static void plan_done_handler (uint32_t out_gen_state);
+
+/** Last part of a video in which it can be extended, same for all plans */
+static const out_gen_config_t video_end_config =
+{
+    .num_transitions = 1,
+    .transitions_durations =
+        {MS_TIMER_TICKS_MS(CAM_TRIGGER_PLAN_VIDEO_END_PART_MS)},
+    .next_out = {{1, 1},
+                 {1, 1}},
+    .done_handler = plan_done_handler,
+};
+
+/** Extension of a video, with the time left of the extension */
+static out_gen_config_t video_extn_config =
+{
+    .num_transitions = 1,
+    .next_out = {{1, 1},
+                 {1, 1}},
+    .done_handler = plan_done_handler,
+};
+
+/** End pulse of a video and the rest of the inter trigger time */
+static out_gen_config_t video_itt_config =
+{
+    .num_transitions = 2,
+    .transitions_durations =
+        {MS_TIMER_TICKS_MS(CAM_TRIGGER_PLAN_VIDEO_END_PULSE_MS), 0},
+    .next_out = {{0, 1, 1},
+                 {1, 1, 1}},
+    .done_handler = plan_done_handler,
+};
+
+static void (* plan_handler) (cam_trigger_plan_evt_t evt, uint32_t context);
+
+static const cam_trigger_plan_t * volatile p_active;
+static volatile uint32_t active_context;
+static volatile plan_state_t state = PLAN_IDLE;
+/** Number of extensions which can still be done for the running video */
+static volatile uint32_t extn_remain;
+
+/** Set to false when a part of the plan being compiled is lengthened */
+static bool is_exact;
+
+/** Add a part to a pattern with the levels of the pins during it */
+static uint32_t step_add (out_gen_config_t * p_config, uint32_t ticks,
+        bool focus, bool trigger)
+{
+    uint32_t n = p_config->num_transitions;
+
+    if(ticks < CAM_TRIGGER_PLAN_MIN_TICKS)
+    {
+        ticks = CAM_TRIGGER_PLAN_MIN_TICKS;
+        is_exact = false;
+    }
+    p_config->transitions_durations[n] = ticks;
+    p_config->next_out[FOCUS_PIN][n] = focus;
+    p_config->next_out[TRIGGER_PIN][n] = trigger;
+    p_config->num_transitions = n + 1;
+    //Pins are idle once the pattern is done
+    p_config->next_out[FOCUS_PIN][n + 1] = 1;
+    p_config->next_out[TRIGGER_PIN][n + 1] = 1;
+
+    return ticks;
+}
+
+/** Time left from the time used till the time of the whole plan */
+static uint32_t ticks_left (uint32_t total, uint64_t used)
+{
+    return (total > used) ? (total - used) : 0;
+}
+
+/** Check that a compiled pattern can be run and returns the pins to idle */
+static uint64_t pattern_check (const out_gen_config_t * p_config)
+{
+    uint32_t n = p_config->num_transitions;
+    uint64_t total = 0;
+
+    ASSERT((n > 0) && (n < OUT_GEN_MAX_TRANSITIONS));
+    for(uint32_t i = 0; i < n; i++)
+    {
+        ASSERT(p_config->transitions_durations[i] >= CAM_TRIGGER_PLAN_MIN_TICKS);
+        total += p_config->transitions_durations[i];
+    }
+    ASSERT((p_config->next_out[FOCUS_PIN][n] == 1)
+            && (p_config->next_out[TRIGGER_PIN][n] == 1));
+
+    return total;
+}
+
+static void video_end_start (void)
+{
+    state = PLAN_VIDEO_END;
+    out_gen_start (&video_end_config);
+    if(extn_remain > 0)
+    {
+        plan_handler (CAM_TRIGGER_PLAN_EVT_EXTN_OPEN, active_context);
+    }
+}
+
+static void plan_done_handler (uint32_t out_gen_state)
+{
+    switch(state)
+    {
+    case PLAN_IDLE:
+        break;
+    case PLAN_RUN:
+    case PLAN_VIDEO_ITT:
+        state = PLAN_IDLE;
+        plan_handler (CAM_TRIGGER_PLAN_EVT_DONE, active_context);
+        break;
+    case PLAN_VIDEO_START:
+        extn_remain = CAM_TRIGGER_PLAN_MAX_EXTN;
+        video_end_start ();
+        break;
+    case PLAN_VIDEO_EXTN:
+        video_end_start ();
+        break;
+    case PLAN_VIDEO_END:
+        state = PLAN_VIDEO_ITT;
+        video_itt_config.transitions_durations[1] = p_active->
+            video_itt_ticks[CAM_TRIGGER_PLAN_MAX_EXTN - extn_remain];
+        out_gen_start (&video_itt_config);
+        break;
+    }
+}
+
+void cam_trigger_plan_init (void (* handler) (cam_trigger_plan_evt_t evt,
+        uint32_t context))
+{
+    plan_handler = handler;
+    state = PLAN_IDLE;
+}
+
+bool cam_trigger_plan_compile (const cam_trigger_plan_desc_t * p_desc,
+        cam_trigger_plan_t * p_plan)
+{
+    out_gen_config_t * p_start = &p_plan->start;
+    //Parts of up to 36 hours each can add up beyond 32 bits
+    uint64_t used = 0;
+
+    is_exact = true;
+    memset (p_plan, 0, sizeof(cam_trigger_plan_t));
+    p_start->done_handler = plan_done_handler;
+
+    if((p_desc->pre_focus_ticks != 0) &&
+            (p_desc->mode != CAM_TRIGGER_PLAN_NO_PRESS))
+    {
+        used += step_add (p_start, p_desc->pre_focus_ticks, 0, 1);
+    }
+
+    switch(p_desc->mode)
+    {
+    case CAM_TRIGGER_PLAN_SINGLE_SHOT:
+        used += step_add (p_start, p_desc->press_ticks, 0, 0);
+        break;
+    case CAM_TRIGGER_PLAN_MULTI_SHOT:
+    {
+        uint32_t shot_cnt = p_desc->shot_cnt;
+
+        if(shot_cnt > CAM_TRIGGER_PLAN_MAX_SHOTS)
+        {
+            shot_cnt = CAM_TRIGGER_PLAN_MAX_SHOTS;
+            is_exact = false;
+        }
+        for(uint32_t i = 0; i < shot_cnt; i++)
+        {
+            used += step_add (p_start, p_desc->press_ticks, 0, 0);
+            //The rest of the inter trigger time follows the last shot
+            if(i != (shot_cnt - 1))
+            {
+                used += step_add (p_start, ticks_left (
+                    p_desc->shot_interval_ticks, p_desc->press_ticks), 1, 1);
+            }
+        }
+        break;
+    }
+    case CAM_TRIGGER_PLAN_LONG_PRESS:
+        used += step_add (p_start, p_desc->len_ticks, 0, 0);
+        break;
+    case CAM_TRIGGER_PLAN_VIDEO:
+        used += step_add (p_start, p_desc->press_ticks, 0, 1);
+        if(p_desc->extn_ticks == 0)
+        {
+            used += step_add (p_start, p_desc->len_ticks, 1, 1);
+            used += step_add (p_start,
+                MS_TIMER_TICKS_MS(CAM_TRIGGER_PLAN_VIDEO_END_PULSE_MS), 0, 1);
+        }
+        else
+        {
+            used += step_add (p_start, ticks_left (p_desc->len_ticks,
+                MS_TIMER_TICKS_MS(CAM_TRIGGER_PLAN_VIDEO_END_PART_MS)), 1, 1);
+            used += MS_TIMER_TICKS_MS(CAM_TRIGGER_PLAN_VIDEO_END_PART_MS)
+                    + MS_TIMER_TICKS_MS(CAM_TRIGGER_PLAN_VIDEO_END_PULSE_MS);
+
+            p_plan->extn_ticks = p_desc->extn_ticks;
+            for(uint32_t i = 0; i <= CAM_TRIGGER_PLAN_MAX_EXTN; i++)
+            {
+                uint32_t itt = ticks_left (p_desc->itt_ticks,
+                        used + i*p_desc->extn_ticks);
+                p_plan->video_itt_ticks[i] = (itt < CAM_TRIGGER_PLAN_MIN_TICKS)
+                        ? CAM_TRIGGER_PLAN_MIN_TICKS : itt;
+            }
+            if((p_desc->itt_ticks != 0) && (p_desc->itt_ticks <
+                    (used + CAM_TRIGGER_PLAN_MIN_TICKS)))
+            {
+                is_exact = false;
+            }
+            //The end and the inter trigger time follow as separate phases
+            p_start->out_gen_state = PLAN_VIDEO_START;
+            pattern_check (p_start);
+            return is_exact;
+        }
+        break;
+    case CAM_TRIGGER_PLAN_HALF_PRESS:
+        used += step_add (p_start, p_desc->press_ticks, 0, 1);
+        break;
+    case CAM_TRIGGER_PLAN_NO_PRESS:
+        break;
+    }
+
+    //No inter trigger time is the shortest tail and not a lengthened part
+    if(p_desc->itt_ticks == 0)
+    {
+        used += step_add (p_start, CAM_TRIGGER_PLAN_MIN_TICKS, 1, 1);
+    }
+    else
+    {
+        used += step_add (p_start, ticks_left (p_desc->itt_ticks, used), 1, 1);
+    }
+    p_start->out_gen_state = PLAN_RUN;
+
+    ASSERT(pattern_check (p_start) == used);
+    ASSERT((is_exact == false) || (p_desc->itt_ticks == 0)
+            || (used == p_desc->itt_ticks));
+
+    return is_exact;
+}
+
+void cam_trigger_plan_start (const cam_trigger_plan_t * p_plan,
+        uint32_t context)
+{
+    p_active = p_plan;
+    active_context = context;
+    state = (plan_state_t) p_plan->start.out_gen_state;
+    out_gen_start (&p_plan->start);
+}
+
+bool cam_trigger_plan_extend (void)
+{
+    uint32_t ticks_done, extn_left;
+
+    if((state != PLAN_VIDEO_END) || (extn_remain == 0))
+    {
+        return false;
+    }
+
+    //The extension is counted from the start of the end phase
+    ticks_done = out_gen_get_ticks ();
+    extn_left = (p_active->extn_ticks > ticks_done)
+        ? (p_active->extn_ticks - ticks_done) : p_active->extn_ticks;
+    video_extn_config.transitions_durations[0] =
+        (extn_left < CAM_TRIGGER_PLAN_MIN_TICKS) ? CAM_TRIGGER_PLAN_MIN_TICKS : extn_left;
+    extn_remain--;
+    state = PLAN_VIDEO_EXTN;
+    out_gen_start (&video_extn_config);
+
+    return true;
+}
+
+void cam_trigger_plan_stop (bool * out_vals)
+{
+    state = PLAN_IDLE;
+    out_gen_stop (out_vals);
+}
+
+bool cam_trigger_plan_is_on (void)
+{
+    return (state != PLAN_IDLE);
+}
@@ -0,0 +1,191 @@
+/**
+ *  cam_trigger_plan.h : Precompiled plans to trigger a camera
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup group_peripheral_modules
+ * @{
+ *
+ * @defgroup group_cam_trigger_plan Camera trigger plan
+ *
+ * @brief Module to compile the description of a camera trigger into a plan
+ *  once, when the configuration changes, and to run the plan with the out
+ *  pattern generator when the camera is to be triggered.
+ *
+ * All the durations are converted to ms timer ticks and all the patterns are
+ *  laid out by @ref cam_trigger_plan_compile, so that starting a plan is only
+ *  the start of the out pattern generator and the delay from a trigger to the
+ *  shutter does not depend on the mode. The out pattern generator is to be
+ *  initialized by the application with the focus pin first and the trigger
+ *  pin second, both idle high.
+ *
+ * A video which can be extended runs in these phases
+ *  - Start: The start pulse and the video till
+ *    @ref CAM_TRIGGER_PLAN_VIDEO_END_PART_MS before its end.
+ *  - End: The last part of the video, in which a call of
+ *    @ref cam_trigger_plan_extend extends the video.
+ *  - Extension: The video runs for the extension length from the start of
+ *    the end phase after which the end phase runs again.
+ *  - Inter trigger time: The end pulse and the rest of the inter trigger
+ *    time, which is shortened by the extensions done.
+ *
+ * After @ref CAM_TRIGGER_PLAN_MAX_EXTN extensions the end phase runs once
+ *  more without the video being extendable.
+ * @{
+ */
+
+#ifndef CODEBASE_PERIPHERAL_MODULES_CAM_TRIGGER_PLAN_H_
+#define CODEBASE_PERIPHERAL_MODULES_CAM_TRIGGER_PLAN_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "out_pattern_gen.h"
+
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+#ifndef CAM_TRIGGER_PLAN_MAX_EXTN
+/** Maximum number of extensions of a video */
+#define CAM_TRIGGER_PLAN_MAX_EXTN           3
+#endif
+
+#ifndef CAM_TRIGGER_PLAN_VIDEO_END_PART_MS
+/** Duration in ms of the last part of a video in which it can be extended */
+#define CAM_TRIGGER_PLAN_VIDEO_END_PART_MS  2000
+#endif
+
+#ifndef CAM_TRIGGER_PLAN_VIDEO_END_PULSE_MS
+/** Duration in ms of the pulse to end a video */
+#define CAM_TRIGGER_PLAN_VIDEO_END_PULSE_MS 300
+#endif
+
+/** Shortest duration in ticks of any part of a plan, to which the parts
+ *  which would be zero or negative are extended */
+#define CAM_TRIGGER_PLAN_MIN_TICKS          2
+
+/** Maximum number of shots in multi shot, so that the pre-focus, the shots
+ *  and the rest of the inter trigger time fit in an out pattern */
+#define CAM_TRIGGER_PLAN_MAX_SHOTS          ((OUT_GEN_MAX_TRANSITIONS - 2)/2)
+
+/** The actions with which a camera can be triggered */
+typedef enum
+{
+    CAM_TRIGGER_PLAN_SINGLE_SHOT,   ///< A press of the trigger
+    CAM_TRIGGER_PLAN_MULTI_SHOT,    ///< A number of presses of the trigger
+    CAM_TRIGGER_PLAN_LONG_PRESS,    ///< A press of the trigger for the exposure
+    CAM_TRIGGER_PLAN_VIDEO,         ///< Focus pulses to start and end a video
+    CAM_TRIGGER_PLAN_HALF_PRESS,    ///< A press of the focus
+    CAM_TRIGGER_PLAN_NO_PRESS,      ///< Nothing for the inter trigger time
+}cam_trigger_plan_mode_t;
+
+/** Description of a trigger from which a plan is compiled, in ms timer ticks */
+typedef struct
+{
+    /** Action to be done */
+    cam_trigger_plan_mode_t mode;
+    /** Press of the focus before the action, 0 for none */
+    uint32_t pre_focus_ticks;
+    /** Press of each shot, of a half press or of the pulse to start a video */
+    uint32_t press_ticks;
+    /** Exposure of a long press or the length of a video */
+    uint32_t len_ticks;
+    /** Time from the start of a shot to the start of the next in multi shot */
+    uint32_t shot_interval_ticks;
+    /** Number of shots in multi shot, limited to @ref CAM_TRIGGER_PLAN_MAX_SHOTS */
+    uint32_t shot_cnt;
+    /** Time by which a video is extended, 0 if it cannot be extended */
+    uint32_t extn_ticks;
+    /** Time from the start of the plan to its end, the inter trigger time.
+     *  0 for the pins to be idle right after the action. */
+    uint32_t itt_ticks;
+}cam_trigger_plan_desc_t;
+
+/** A compiled plan, to be kept till it is replaced by another */
+typedef struct
+{
+    /** Pattern started on a trigger */
+    out_gen_config_t start;
+    /** Time by which the video is extended, 0 if it cannot be extended */
+    uint32_t extn_ticks;
+    /** Rest of the inter trigger time after the end pulse of a video which can
+     *  be extended, indexed by the number of extensions done */
+    uint32_t video_itt_ticks[CAM_TRIGGER_PLAN_MAX_EXTN + 1];
+}cam_trigger_plan_t;
+
+/** Events of a running plan given to the application */
+typedef enum
+{
+    /** A video has entered its end phase and can be extended now */
+    CAM_TRIGGER_PLAN_EVT_EXTN_OPEN,
+    /** The plan is done and another can be started */
+    CAM_TRIGGER_PLAN_EVT_DONE,
+}cam_trigger_plan_evt_t;
+
+/**
+ * @brief Function to initialize the module
+ * @param handler Handler for the events of the running plan, called with the
+ *  context passed to @ref cam_trigger_plan_start
+ */
+void cam_trigger_plan_init (void (* handler) (cam_trigger_plan_evt_t evt,
+        uint32_t context));
+
+/**
+ * @brief Function to compile a plan from its description. A plan that is
+ *  not as described can still be run.
+ * @param p_desc Pointer to the description of the trigger
+ * @param p_plan Pointer to the plan to be filled
+ * @return True if the plan is as described. False if the number of shots is
+ *  limited or a part is lengthened to @ref CAM_TRIGGER_PLAN_MIN_TICKS, so that
+ *  the plan can run longer than the inter trigger time.
+ */
+bool cam_trigger_plan_compile (const cam_trigger_plan_desc_t * p_desc,
+        cam_trigger_plan_t * p_plan);
+
+/**
+ * @brief Function to start a plan. Any running plan is replaced.
+ * @param p_plan Pointer to the plan, which must not change while it runs
+ * @param context Value passed to the handler for the events of this plan
+ */
+void cam_trigger_plan_start (const cam_trigger_plan_t * p_plan,
+        uint32_t context);
+
+/**
+ * @brief Function to extend the running video
+ * @return True if the video is extended, false if the plan is not in the end
+ *  phase of a video or the maximum extensions are done
+ */
+bool cam_trigger_plan_extend (void);
+
+/**
+ * @brief Function to stop the running plan
+ * @param out_vals Pointer to the values to which the pins are set
+ */
+void cam_trigger_plan_stop (bool * out_vals);
+
+/**
+ * @brief Function to know if a plan is running
+ * @return True if a plan is running
+ */
+bool cam_trigger_plan_is_on (void);
+
+#endif /* CODEBASE_PERIPHERAL_MODULES_CAM_TRIGGER_PLAN_H_ */
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,63 @@
+/**
+ *  latency_trace.c : Trace of the trigger path stages on GPIOs
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "latency_trace.h"
+#include "hal_gpio.h"
+#include "boards.h"
+#include "nrf.h"
+
+/** Pins toggled in software for each stage */
+static const uint32_t arr_stage_pin[LATENCY_TRACE_STAGE_MAX] =
+{
+    LATENCY_TRACE_PIN_DETECT,
+    LATENCY_TRACE_PIN_RADIO_TX,
+    LATENCY_TRACE_PIN_NONE,     //Address match is toggled by GPIOTE
+    LATENCY_TRACE_PIN_CAM_TRIGGER,
+};
+
+void latency_trace_init (void)
+{
+    for(uint32_t stage = 0; stage < LATENCY_TRACE_STAGE_MAX; stage++)
+    {
+        if(arr_stage_pin[stage] != LATENCY_TRACE_PIN_NONE)
+        {
+            hal_gpio_cfg_output (arr_stage_pin[stage], 0);
+        }
+    }
+
+#if LATENCY_TRACE_PIN_RADIO_RX_ADDR != LATENCY_TRACE_PIN_NONE
+    NRF_GPIOTE->CONFIG[GPIOTE_CH_USED_LATENCY_TRACE] =
+              (GPIOTE_CONFIG_MODE_Task << GPIOTE_CONFIG_MODE_Pos)
+            | (LATENCY_TRACE_PIN_RADIO_RX_ADDR << GPIOTE_CONFIG_PSEL_Pos)
+            | (GPIOTE_CONFIG_POLARITY_Toggle << GPIOTE_CONFIG_POLARITY_Pos)
+            | (GPIOTE_CONFIG_OUTINIT_Low << GPIOTE_CONFIG_OUTINIT_Pos);
+
+    NRF_PPI->CH[PPI_CH_USED_LATENCY_TRACE].EEP = (uint32_t) &(NRF_RADIO->EVENTS_ADDRESS);
+    NRF_PPI->CH[PPI_CH_USED_LATENCY_TRACE].TEP =
+        (uint32_t) &(NRF_GPIOTE->TASKS_OUT[GPIOTE_CH_USED_LATENCY_TRACE]);
+    NRF_PPI->CHENSET = 1 << PPI_CH_USED_LATENCY_TRACE;
+#endif
+}
+
+void latency_trace_mark (latency_trace_stage_t stage)
+{
+    if(arr_stage_pin[stage] != LATENCY_TRACE_PIN_NONE)
+    {
+        hal_gpio_pin_toggle (arr_stage_pin[stage]);
+    }
+}
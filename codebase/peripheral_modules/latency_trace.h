@@ -0,0 +1,106 @@
+/**
+ *  latency_trace.h : Trace of the trigger path stages on GPIOs
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup group_peripheral_modules
+ * @{
+ *
+ * @defgroup group_latency_trace Latency trace
+ *
+ * @brief Module to mark the stages of the trigger path on GPIOs so that the
+ *  end to end latency can be measured with a logic analyzer.
+ *
+ * Every stage has its own pin which is toggled when the stage is reached, so
+ *  each edge on a pin is one occurrence of that stage. The address match of
+ *  a received packet is routed from the radio to its pin with PPI and GPIOTE
+ *  so that it is independent of the interrupt latency. A stage whose pin is
+ *  @ref LATENCY_TRACE_PIN_NONE is not traced. The module is compiled in only
+ *  when LATENCY_TRACE is defined as 1, else all the calls are empty.
+ *  utils/latency_bench.py converts a capture of these pins into latency
+ *  distributions.
+ * @{
+ */
+
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include "stdint.h"
+
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+/** Pin number used to mark that a stage is not traced on this device */
+#define LATENCY_TRACE_PIN_NONE 0xFF
+
+#ifndef LATENCY_TRACE_PIN_DETECT
+#define LATENCY_TRACE_PIN_DETECT LATENCY_TRACE_PIN_NONE
+#endif
+
+#ifndef LATENCY_TRACE_PIN_RADIO_TX
+#define LATENCY_TRACE_PIN_RADIO_TX LATENCY_TRACE_PIN_NONE
+#endif
+
+#ifndef LATENCY_TRACE_PIN_RADIO_RX_ADDR
+#define LATENCY_TRACE_PIN_RADIO_RX_ADDR LATENCY_TRACE_PIN_NONE
+#endif
+
+#ifndef LATENCY_TRACE_PIN_CAM_TRIGGER
+#define LATENCY_TRACE_PIN_CAM_TRIGGER LATENCY_TRACE_PIN_NONE
+#endif
+
+#ifndef PPI_CH_USED_LATENCY_TRACE
+#define PPI_CH_USED_LATENCY_TRACE 6
+#endif
+
+#ifndef GPIOTE_CH_USED_LATENCY_TRACE
+#define GPIOTE_CH_USED_LATENCY_TRACE 7
+#endif
+
+/** Stages of the trigger path which can be traced */
+typedef enum
+{
+    LATENCY_TRACE_DETECT,           ///< Motion detected at the detecting unit
+    LATENCY_TRACE_RADIO_TX,         ///< First radio transmission of a trigger started
+    LATENCY_TRACE_RADIO_RX_ADDR,    ///< Address of a packet matched at the receiver, traced in hardware
+    LATENCY_TRACE_CAM_TRIGGER,      ///< Camera trigger pattern started
+    LATENCY_TRACE_STAGE_MAX,        ///< Not a stage, used to find the number of stages
+}latency_trace_stage_t;
+
+#if LATENCY_TRACE == 1
+/**
+ * @brief Function to configure the pins of the stages traced on this device
+ *  and the PPI route for the radio address match
+ */
+void latency_trace_init (void);
+
+/**
+ * @brief Function to mark that a stage of the trigger path is reached
+ * @param stage Stage which is reached
+ */
+void latency_trace_mark (latency_trace_stage_t stage);
+#else
+#define latency_trace_init()
+#define latency_trace_mark(stage)
+#endif
+
+#endif /* LATENCY_TRACE_H */
+/**
+ * @}
+ * @}
+ */
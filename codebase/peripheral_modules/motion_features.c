@@ -0,0 +1,121 @@
+/**
+ *  motion_features.c : Motion features from blocks of accelerometer samples
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "motion_features.h"
+#include "stdbool.h"
+
+/** Magnitude of the acceleration due to gravity in mg */
+#define GRAVITY_MG          1000
+
+uint32_t motion_features_isqrt (uint32_t num)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while(bit > num)
+    {
+        bit >>= 2;
+    }
+
+    while(bit != 0)
+    {
+        if(num >= root + bit)
+        {
+            num -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+void motion_features_calc (const int16_t * p_xyz, uint32_t sample_cnt,
+        uint32_t mg_per_lsb_q15, motion_features_t * p_features)
+{
+    int32_t sum[3] = {0};
+    uint64_t sum_sq[3] = {0};
+    uint32_t mag_sum = 0, mag_peak = 0, total_var = 0;
+    uint16_t peak_cnt = 0;
+    bool in_peak = false;
+
+    if(sample_cnt == 0)
+    {
+        *p_features = (motion_features_t) {0};
+        return;
+    }
+
+    for(uint32_t i = 0; i < sample_cnt; i++)
+    {
+        uint32_t mag_sq = 0;
+        for(uint32_t axis = 0; axis < 3; axis++)
+        {
+            //Q15 scaling to mg with rounding, fits in 32 bits up to 16 g
+            int32_t mg = ((int32_t) p_xyz[3*i + axis] *
+                    (int32_t) mg_per_lsb_q15 + (1 << 14)) >> 15;
+            sum[axis] += mg;
+            sum_sq[axis] += (uint32_t) (mg * mg);
+            mag_sq += (uint32_t) (mg * mg);
+        }
+
+        uint32_t mag = motion_features_isqrt (mag_sq);
+        mag_sum += mag;
+        if(mag > mag_peak)
+        {
+            mag_peak = mag;
+        }
+
+        //Hysteresis of half the threshold so that a single peak is counted once
+        uint32_t dev = (mag > GRAVITY_MG)? (mag - GRAVITY_MG) : (GRAVITY_MG - mag);
+        if((in_peak == false) && (dev > MOTION_FEATURES_PEAK_MG))
+        {
+            in_peak = true;
+            peak_cnt++;
+        }
+        else if((in_peak == true) && (dev < MOTION_FEATURES_PEAK_MG/2))
+        {
+            in_peak = false;
+        }
+    }
+
+    for(uint32_t axis = 0; axis < 3; axis++)
+    {
+        int64_t mean_sq = ((int64_t) sum[axis] * sum[axis]) / sample_cnt;
+        p_features->var_mg2[axis] = (uint32_t) ((sum_sq[axis] - mean_sq) / sample_cnt);
+        total_var += p_features->var_mg2[axis];
+    }
+
+    p_features->mag_mean_mg = mag_sum / sample_cnt;
+    p_features->mag_peak_mg = mag_peak;
+    p_features->peak_cnt = peak_cnt;
+    if(total_var < MOTION_FEATURES_STILL_VAR)
+    {
+        p_features->activity = MOTION_ACTIVITY_STILL;
+    }
+    else if(total_var < MOTION_FEATURES_ACTIVE_VAR)
+    {
+        p_features->activity = MOTION_ACTIVITY_LOW;
+    }
+    else
+    {
+        p_features->activity = MOTION_ACTIVITY_HIGH;
+    }
+}
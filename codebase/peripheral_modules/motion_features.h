@@ -0,0 +1,107 @@
+/**
+ *  motion_features.h : Motion features from blocks of accelerometer samples
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup group_peripheral_modules
+ * @{
+ *
+ * @defgroup group_motion_features Motion features
+ *
+ * @brief Module to reduce a block of 3 axis accelerometer samples to a few
+ *  motion features, so that the features can be logged or advertised instead
+ *  of the raw samples.
+ *
+ * Only integer math is used so that it is fast on the parts without an FPU.
+ *  The raw samples are scaled to mg with a Q15 factor. The features are the
+ *  mean and peak of the magnitude, the variance of each axis, the number of
+ *  peaks where the magnitude deviates from 1 g by more than
+ *  @ref MOTION_FEATURES_PEAK_MG and a coarse activity class from the total
+ *  variance.
+ * @{
+ */
+
+#ifndef CODEBASE_PERIPHERAL_MODULES_MOTION_FEATURES_H_
+#define CODEBASE_PERIPHERAL_MODULES_MOTION_FEATURES_H_
+
+#include "stdint.h"
+
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+#ifndef MOTION_FEATURES_PEAK_MG
+/** Deviation of the magnitude from 1 g in mg to count a peak */
+#define MOTION_FEATURES_PEAK_MG         300
+#endif
+
+#ifndef MOTION_FEATURES_STILL_VAR
+/** Total variance of the three axes in mg^2 below which the block is still */
+#define MOTION_FEATURES_STILL_VAR       400
+#endif
+
+#ifndef MOTION_FEATURES_ACTIVE_VAR
+/** Total variance of the three axes in mg^2 above which the block is active */
+#define MOTION_FEATURES_ACTIVE_VAR      40000
+#endif
+
+/** Coarse classes of activity in a block */
+typedef enum
+{
+    MOTION_ACTIVITY_STILL,      ///< Only sensor noise
+    MOTION_ACTIVITY_LOW,        ///< Small movements
+    MOTION_ACTIVITY_HIGH,       ///< Large movements
+}motion_activity_t;
+
+/** Features of a block of samples */
+typedef struct
+{
+    /** Mean of the magnitude in mg */
+    uint16_t mag_mean_mg;
+    /** Maximum of the magnitude in mg */
+    uint16_t mag_peak_mg;
+    /** Variance of the x, y and z axes in mg^2 */
+    uint32_t var_mg2[3];
+    /** Number of times the magnitude deviated from 1 g by more than
+     *  @ref MOTION_FEATURES_PEAK_MG */
+    uint16_t peak_cnt;
+    /** Activity class of the block */
+    motion_activity_t activity;
+}motion_features_t;
+
+/**
+ * @brief Function to find the features of a block of samples
+ * @param p_xyz Pointer to the raw samples with the x, y and z values interleaved
+ * @param sample_cnt Number of samples, each with three values
+ * @param mg_per_lsb_q15 Sensitivity of the sensor in mg per LSB as a Q15 number
+ * @param p_features Pointer where the features are to be stored
+ */
+void motion_features_calc (const int16_t * p_xyz, uint32_t sample_cnt,
+        uint32_t mg_per_lsb_q15, motion_features_t * p_features);
+
+/**
+ * @brief Function to find the integer square root
+ * @param num Number whose square root is required
+ * @return Largest integer whose square is not more than num
+ */
+uint32_t motion_features_isqrt (uint32_t num);
+
+#endif /* CODEBASE_PERIPHERAL_MODULES_MOTION_FEATURES_H_ */
+/**
+ * @}
+ * @}
+ */
@@ -178,7 +178,7 @@ uint32_t update_log (log_config_t * log_config)
             LOGS[log_config->log_id].size_bytes = (log_config->entry_size );
             LOGS[log_config->log_id].entry_size = CEIL_DIV(log_config->entry_size,4);
             LOGS[log_config->log_id].no_pages = log_config->no_of_pages;
-            for(uint32_t page_no; page_no < log_config->no_of_pages; page_no++)
+            for(uint32_t page_no = 0; page_no < log_config->no_of_pages; page_no++)
             {
                 LOGS[log_config->log_id].page_addrs[page_no] = log_config->start_page 
                                     - page_no*NVM_LOGGER_PAGE_OFFSETS;
@@ -230,6 +230,12 @@ void prepare_log_metadata (uint32_t * p_mem_loc, uint32_t page_no)
     {   
         return;
     }
+    //Pages not of a log, such as that of the configuration, are skipped
+    if((local_ptr->log_id >= NVM_LOGGER_MAX_LOGS) ||
+       (local_ptr->log_page_no >= NVM_LOGGER_MAX_PAGES))
+    {
+        return;
+    }
     LOGS[local_ptr->log_id].size_bytes = (uint32_t)local_ptr->data_size;
     LOGS[local_ptr->log_id].entry_size = CEIL_DIV(local_ptr->data_size,4);
     LOGS[local_ptr->log_id].page_addrs[local_ptr->log_page_no] = 
@@ -408,12 +414,37 @@ bool nvm_logger_is_log_empty (uint32_t log_id)
     return log_empty;
 }
 
+uint32_t nvm_logger_get_total_entries (uint32_t log_id)
+{
+    return LOGS[log_id].total_entries;
+}
+
+uint32_t nvm_logger_get_entry_size (uint32_t log_id)
+{
+    return LOGS[log_id].size_bytes;
+}
+
+uint32_t nvm_logger_get_log_at_page (uint32_t page_addr)
+{
+    for(uint32_t log_no = 0; log_no < NVM_LOGGER_MAX_LOGS; log_no++)
+    {
+        if((LOGS[log_no].no_pages != 0) && (LOGS[log_no].page_addrs[0] == page_addr))
+        {
+            return log_no;
+        }
+    }
+    return NVM_LOGGER_MAX_LOGS;
+}
+
 void nvm_logger_release_log (uint32_t log_id)
 {
-    for(uint32_t page_no; page_no < LOGS[log_id].no_pages; page_no++)
+    for(uint32_t page_no = 0; page_no < LOGS[log_id].no_pages; page_no++)
     {
         hal_nvmc_erase_page (LOGS[log_id].page_addrs[page_no]);
     }
+    //The pages and the ID can now be given to a new log
+    no_avail_pages += LOGS[log_id].no_pages;
+    memcpy (&LOGS[log_id], &EMPTY_LOG_METADATA, sizeof(log_metadata_t));
 }
 
 
@@ -61,7 +61,7 @@ typedef enum
     NVM_LOG_PAGE2 = 0x25000,
     NVM_LOG_PAGE3 = 0x24000,
     NVM_LOG_PAGE4 = 0x23000,
-    NVM_LOG_PAGE5 = 0x23000,
+    NVM_LOG_PAGE5 = 0x22000,
     NVM_LOG_MAX_PAGES = 6,
 }log_page_start_t;
 
@@ -149,9 +149,31 @@ void nvm_logger_empty_log (uint32_t log_id);
  */
 bool nvm_logger_is_log_empty (uint32_t log_id);
 
+/**
+ * @brief Function to get the number of entries in the log.
+ * @param log_id Log ID of log whose entries are to be counted.
+ * @return Number of entries which can be fetched from the log.
+ */
+uint32_t nvm_logger_get_total_entries (uint32_t log_id);
+
+/**
+ * @brief Function to get the size of the entries of a log.
+ * @param log_id Log ID of log whose entry size is required.
+ * @return Size of each entry in bytes, 0 if the log is not present.
+ */
+uint32_t nvm_logger_get_entry_size (uint32_t log_id);
+
+/**
+ * @brief Function to find the log which starts at a page, as found in the
+ * page metadata in the flash.
+ * @param page_addr Address of the first page of the log.
+ * @return Log ID of the log, NVM_LOGGER_MAX_LOGS if no log starts at the page.
+ */
+uint32_t nvm_logger_get_log_at_page (uint32_t page_addr);
+
 /**
  * @brief Function to release the log. Once released, page used by that log will\
- * be erased and available for other logs to use.
+ * be erased and available for other logs to use, as is the log ID.
  * @param log_id Log ID of log which is to be released.
  * @Note Two logs cannot access the same log page.
  */
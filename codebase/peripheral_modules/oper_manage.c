@@ -19,6 +19,60 @@
 #include "oper_manage.h"
 #include "simple_adc.h"
 #include "common_util.h"
+#include "ms_timer.h"
+#include "stddef.h"
+
+/** ms timer used to wait for the next transition of the slots */
+#define OPER_MANAGE_MS_TIMER CONCAT_2(MS_TIMER, MS_TIMER_USED_OPER_MANAGE)
+
+#if (MS_TIMER_USED_OPER_MANAGE >= MS_TIMER_CC_COUNT)
+#error MS_TIMER_USED_OPER_MANAGE is not a timer of the RTC used by the ms timer
+#endif
+
+/** Latitude in 1/100 degrees between the rows of @ref half_day_min */
+#define LAT_STEP_CDEG       500
+/** Highest latitude of @ref half_day_min in 1/100 degrees */
+#define LAT_MAX_CDEG        6500
+/** Declination in 1/100 degrees between the columns of @ref half_day_min */
+#define DECL_STEP_CDEG      400
+/** Lowest declination of @ref half_day_min, the highest is its negative */
+#define DECL_MIN_CDEG       (-2400)
+/** Tilt of the axis of the earth in 1/100 degrees */
+#define AXIAL_TILT_CDEG     2344
+/** Day of the year of the March equinox, with 1st January as 0 */
+#define MARCH_EQUINOX_DAY   79
+/** Days from the March equinox to the September equinox, the sun is north
+ *  of the equator for longer as the earth is farther from it then */
+#define NORTH_SUMMER_DAYS   186
+#define DAYS_IN_YEAR        365
+
+/** sin() of 0 to 90 degrees in steps of 5 degrees, scaled to 32767 */
+static const uint16_t sin_q15[] =
+{
+    0, 2856, 5690, 8481, 11207, 13848, 16383, 18794, 21062, 23170,
+    25101, 26841, 28377, 29697, 30791, 31650, 32269, 32642, 32767,
+};
+
+/** Time in minutes from sunrise to solar noon, for latitudes of 0 to 65
+ *  degrees in rows and declinations of the sun of -24 to 24 degrees in
+ *  columns, with the atmospheric refraction at the horizon of 0.833 degree */
+static const uint16_t half_day_min[][13] =
+{
+    {364, 364, 363, 363, 363, 363, 363, 363, 363, 363, 363, 364, 364},
+    {355, 356, 358, 359, 361, 362, 363, 365, 366, 368, 369, 371, 373},
+    {346, 349, 352, 355, 358, 361, 363, 366, 369, 372, 375, 378, 382},
+    {336, 341, 346, 350, 355, 359, 363, 368, 372, 377, 381, 386, 391},
+    {327, 333, 340, 346, 352, 358, 364, 369, 375, 381, 388, 394, 401},
+    {316, 325, 333, 341, 349, 356, 364, 371, 379, 387, 395, 403, 412},
+    {305, 316, 326, 336, 345, 355, 364, 373, 383, 392, 402, 413, 424},
+    {292, 305, 318, 330, 342, 353, 364, 375, 387, 398, 411, 424, 437},
+    {277, 294, 309, 323, 337, 351, 364, 378, 392, 406, 420, 436, 453},
+    {260, 280, 298, 316, 332, 349, 365, 381, 397, 414, 432, 451, 472},
+    {238, 263, 286, 307, 327, 346, 365, 384, 404, 424, 446, 469, 495},
+    {210, 242, 270, 296, 320, 343, 366, 389, 412, 437, 463, 493, 526},
+    {169, 213, 249, 281, 311, 339, 367, 395, 423, 454, 487, 526, 574},
+    { 94, 168, 218, 260, 298, 333, 368, 403, 439, 478, 522, 579, 692},
+};
 
 static uint32_t light_sense_pin;
 
@@ -29,64 +83,279 @@ static oper_list_t arr_oper_cond [OPER_MANAGE_MAX_SLOTS];
 
 volatile uint8_t active_slots = OPER_MANAGE_INVALID_SLOTS;
 
-void oper_manage_set_light_sense_pin (uint32_t light_sense_adc)
+/** Slots which have been set */
+static uint8_t set_slots;
+
+static void (* change_handler) (uint8_t active_slots);
+
+static int32_t latitude = 0;
+static uint32_t solar_noon = TIME_TRACKER_DAY_LEN_S/2;
+
+/** sin() of an angle in 1/100 degrees, scaled to 32767 */
+static int32_t sin_cdeg (int32_t angle)
 {
-    light_sense_pin = light_sense_adc;
-    
+    int32_t sign = 1;
+    uint32_t idx, frac;
+
+    angle %= 36000;
+    angle = (angle < 0) ? (angle + 36000) : angle;
+    if(angle >= 18000)
+    {
+        angle -= 18000;
+        sign = -1;
+    }
+    angle = (angle > 9000) ? (18000 - angle) : angle;
+
+    idx = angle/500;
+    frac = angle % 500;
+    if(idx == (ARRAY_SIZE(sin_q15) - 1))
+    {
+        return sign * sin_q15[idx];
+    }
+    return sign * (int32_t) (sin_q15[idx] +
+            ((sin_q15[idx + 1] - sin_q15[idx])*frac)/500);
 }
 
+/** Time in seconds from sunrise to solar noon for the current date */
+static uint32_t half_day_s (void)
+{
+    time_tracker_ddmmyy_t * p_date = time_tracker_get_current_date ();
+    uint32_t day, row, col, lat_frac, decl_frac, sum;
+    int32_t lat = latitude, decl;
 
-void oper_manage_set_slot (oper_manage_slot_t * new_slot)
+    day = time_tracker_get_epoch_s ()/TIME_TRACKER_DAY_LEN_S -
+        time_tracker_days_from_date (TIME_TRACKER_YEAR_BASE + p_date->yy, 1, 1);
+    //Declination as a half sine wave between the equinoxes
+    day = (day + DAYS_IN_YEAR - MARCH_EQUINOX_DAY) % DAYS_IN_YEAR;
+    if(day < NORTH_SUMMER_DAYS)
+    {
+        decl = (AXIAL_TILT_CDEG * sin_cdeg ((18000*day)/NORTH_SUMMER_DAYS))/32767;
+    }
+    else
+    {
+        decl = -(AXIAL_TILT_CDEG * sin_cdeg ((18000*(day - NORTH_SUMMER_DAYS))
+                /(DAYS_IN_YEAR - NORTH_SUMMER_DAYS)))/32767;
+    }
+
+    //The south has the day length of the north with the opposite declination
+    if(lat < 0)
+    {
+        lat = -lat;
+        decl = -decl;
+    }
+    lat = (lat > LAT_MAX_CDEG) ? LAT_MAX_CDEG : lat;
+    decl = (decl < DECL_MIN_CDEG) ? DECL_MIN_CDEG :
+            ((decl > -DECL_MIN_CDEG) ? -DECL_MIN_CDEG : decl);
+
+    row = lat/LAT_STEP_CDEG;
+    lat_frac = lat % LAT_STEP_CDEG;
+    col = (decl - DECL_MIN_CDEG)/DECL_STEP_CDEG;
+    decl_frac = (decl - DECL_MIN_CDEG) % DECL_STEP_CDEG;
+    //The last row or column is only used with a fraction of 0
+    if(row == (ARRAY_SIZE(half_day_min) - 1))
+    {
+        row--;
+        lat_frac = LAT_STEP_CDEG;
+    }
+    if(col == (ARRAY_SIZE(half_day_min[0]) - 1))
+    {
+        col--;
+        decl_frac = DECL_STEP_CDEG;
+    }
+
+    sum = half_day_min[row][col]*(LAT_STEP_CDEG - lat_frac)*(DECL_STEP_CDEG - decl_frac)
+        + half_day_min[row + 1][col]*lat_frac*(DECL_STEP_CDEG - decl_frac)
+        + half_day_min[row][col + 1]*(LAT_STEP_CDEG - lat_frac)*decl_frac
+        + half_day_min[row + 1][col + 1]*lat_frac*decl_frac;
+
+    return ((uint64_t) sum*60)/(LAT_STEP_CDEG*DECL_STEP_CDEG);
+}
+
+/** Second of the day of a time which can be beyond either end of the day */
+static uint32_t day_wrap (int32_t time_s)
 {
-    if(new_slot->slot_no < OPER_MANAGE_MAX_SLOTS)
+    time_s %= (int32_t) TIME_TRACKER_DAY_LEN_S;
+    return (time_s < 0) ? (time_s + TIME_TRACKER_DAY_LEN_S) : time_s;
+}
+
+/** Find the window of a slot of time of day, daylight or night as the
+ *  second of the day at which it starts and that after it ends */
+static void slot_window (uint32_t slot_no, uint32_t half_day,
+        uint32_t * p_start, uint32_t * p_end)
+{
+    int32_t sunrise = (int32_t) solar_noon - (int32_t) half_day;
+    int32_t sunset = (int32_t) solar_noon + (int32_t) half_day;
+
+    switch(arr_oper_cond[slot_no])
     {
-        arr_start_cond[new_slot->slot_no] = new_slot->start_cond;
-        arr_end_cond[new_slot->slot_no] = new_slot->end_cond;
-        arr_oper_cond[new_slot->slot_no] = new_slot->oper_sel;
-        uint32_t current_time = time_tracker_get_current_time_s();
-        if(current_time >=  new_slot->start_cond 
-           && current_time <= new_slot->end_cond)
-        {
-            active_slots |= 1 << new_slot->slot_no;
-        }
+    case OPER_MANAGE_DAYLIGHT:
+        *p_start = day_wrap (sunrise + (int32_t) arr_start_cond[slot_no]);
+        *p_end = day_wrap (sunset + (int32_t) arr_end_cond[slot_no]);
+        break;
+    case OPER_MANAGE_NIGHT:
+        *p_start = day_wrap (sunset + (int32_t) arr_start_cond[slot_no]);
+        *p_end = day_wrap (sunrise + (int32_t) arr_end_cond[slot_no]);
+        break;
+    default:
+        *p_start = arr_start_cond[slot_no];
+        *p_end = day_wrap (arr_end_cond[slot_no] + 1);
+        break;
     }
 }
 
-uint8_t oper_manage_check_update ()
+static bool is_in_window (uint32_t start, uint32_t end, uint32_t time_s)
+{
+    if(start <= end)
+    {
+        return ((time_s >= start) && (time_s < end));
+    }
+    //A window across midnight
+    return ((time_s >= start) || (time_s < end));
+}
+
+/** Seconds from a time till the next occurrence of a second of the day */
+static uint32_t time_till (uint32_t time_s, uint32_t edge)
 {
-    uint32_t current_time = time_tracker_get_current_time_s();
-    uint32_t light_val = simple_adc_get_value (SIMPLE_ADC_GAIN1_6, light_sense_pin);
+    uint32_t diff = day_wrap ((int32_t) edge - (int32_t) time_s);
+    return (diff == 0) ? TIME_TRACKER_DAY_LEN_S : diff;
+}
+
+static void slot_timer_handler (void);
+
+/** Evaluate all the slots and start the timer for the next transition */
+static uint8_t slots_evaluate (void)
+{
+    uint32_t current_time = time_tracker_get_current_time_s ();
+    bool is_time_set = (current_time < TIME_TRACKER_DAY_LEN_S);
+    uint32_t next_s = 0;
+    uint32_t light_val = 0;
+    bool is_light_read = false;
+    uint32_t half_day = 0;
+    uint8_t slots = 0;
+
     for(uint32_t slot_no = 0; slot_no < OPER_MANAGE_MAX_SLOTS; slot_no++)
     {
-        if(arr_start_cond[slot_no] == arr_end_cond[slot_no])
+        uint32_t start, end, till_s;
+
+        if((set_slots & (1 << slot_no)) == 0)
         {
-                active_slots = CLR_BIT_VAR(active_slots, slot_no);
+            continue;
         }
-        else if(arr_oper_cond[slot_no] == OPER_MANAGE_TIME_OF_DAY)
+
+        if(arr_oper_cond[slot_no] == OPER_MANAGE_AMBI_LIGHT)
         {
-            if(current_time >= arr_start_cond[slot_no] 
-               && current_time <= arr_end_cond[slot_no])
+            if(arr_start_cond[slot_no] == arr_end_cond[slot_no])
             {
-                active_slots = SET_BIT_VAR(active_slots, slot_no);
+                continue;
             }
-            else
+            if(is_light_read == false)
             {
-                active_slots = CLR_BIT_VAR(active_slots, slot_no);
+                //The light is read once for all the slots
+                light_val = simple_adc_get_value (SIMPLE_ADC_GAIN1_6,
+                        light_sense_pin);
+                is_light_read = true;
             }
-        }
-        else if(arr_oper_cond[slot_no] == OPER_MANAGE_AMBI_LIGHT)
-        {
-            if(light_val >= arr_start_cond[slot_no] 
+            next_s = ((next_s == 0) || (next_s > OPER_MANAGE_LIGHT_CHECK_INTERVAL_S))
+                    ? OPER_MANAGE_LIGHT_CHECK_INTERVAL_S : next_s;
+            if(light_val >= arr_start_cond[slot_no]
                && light_val <= arr_end_cond[slot_no])
             {
-                active_slots = SET_BIT_VAR(active_slots, slot_no);
+                slots = SET_BIT_VAR(slots, slot_no);
             }
-            else
-            {
-                active_slots = CLR_BIT_VAR(active_slots, slot_no);
-            }            
+            continue;
+        }
+
+        if((is_time_set == false) || ((arr_oper_cond[slot_no] ==
+                OPER_MANAGE_TIME_OF_DAY) &&
+                (arr_start_cond[slot_no] == arr_end_cond[slot_no])))
+        {
+            continue;
+        }
+        if((arr_oper_cond[slot_no] != OPER_MANAGE_TIME_OF_DAY) &&
+                (half_day == 0))
+        {
+            half_day = half_day_s ();
+        }
+
+        slot_window (slot_no, half_day, &start, &end);
+        if(is_in_window (start, end, current_time))
+        {
+            slots = SET_BIT_VAR(slots, slot_no);
+            till_s = time_till (current_time, end);
+        }
+        else
+        {
+            till_s = time_till (current_time, start);
+        }
+        next_s = ((next_s == 0) || (till_s < next_s)) ? till_s : next_s;
+    }
+
+    if(next_s != 0)
+    {
+        ms_timer_start (OPER_MANAGE_MS_TIMER, MS_SINGLE_CALL,
+                MS_TIMER_TICKS_MS(next_s*1000), slot_timer_handler);
+    }
+    else
+    {
+        ms_timer_stop (OPER_MANAGE_MS_TIMER);
+    }
+
+    return slots;
+}
+
+static void slot_timer_handler (void)
+{
+    uint8_t slots = slots_evaluate ();
+
+    if(slots != active_slots)
+    {
+        active_slots = slots;
+        if(change_handler != NULL)
+        {
+            change_handler (slots);
         }
     }
+}
+
+void oper_manage_init (void (* slot_change_handler) (uint8_t active_slots))
+{
+    change_handler = slot_change_handler;
+    set_slots = 0;
+    active_slots = OPER_MANAGE_INVALID_SLOTS;
+}
+
+void oper_manage_set_location (int32_t latitude_cdeg, uint32_t solar_noon_s)
+{
+    latitude = latitude_cdeg;
+    solar_noon = solar_noon_s % TIME_TRACKER_DAY_LEN_S;
+    if(set_slots != 0)
+    {
+        active_slots = slots_evaluate ();
+    }
+}
+
+void oper_manage_set_light_sense_pin (uint32_t light_sense_adc)
+{
+    light_sense_pin = light_sense_adc;
+    
+}
+
+
+void oper_manage_set_slot (oper_manage_slot_t * new_slot)
+{
+    if(new_slot->slot_no < OPER_MANAGE_MAX_SLOTS)
+    {
+        arr_start_cond[new_slot->slot_no] = new_slot->start_cond;
+        arr_end_cond[new_slot->slot_no] = new_slot->end_cond;
+        arr_oper_cond[new_slot->slot_no] = new_slot->oper_sel;
+        set_slots = SET_BIT_VAR(set_slots, new_slot->slot_no);
+        active_slots = slots_evaluate ();
+    }
+}
+
+uint8_t oper_manage_check_update ()
+{
+    active_slots = slots_evaluate ();
     return active_slots;
 }
 
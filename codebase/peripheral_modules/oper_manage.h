@@ -26,11 +26,44 @@
  *
  * @brief Module to keep track of operational conditions (i.e. Time of day, 
  * ambient light) of Appiko device.
+ *
+ * Instead of every slot being checked periodically, the time till the next
+ *  change of any slot is found and a single ms timer is started for it, so
+ *  the slots are evaluated only at their transitions. These are the edges of
+ *  the time of day windows, the edges of the windows relative to sunrise and
+ *  sunset, and a re-evaluation every @ref OPER_MANAGE_LIGHT_CHECK_INTERVAL_S
+ *  only when there is an ambient light slot. The light is read only if there
+ *  is an ambient light slot.
+ *
+ * Sunrise and sunset are approximated from the day of the year and the
+ *  latitude, centred on the local time of solar noon set with
+ *  @ref oper_manage_set_location. The error is within 4 minutes up to a
+ *  latitude of 45 degrees and 7 minutes up to 60 degrees. Latitudes beyond
+ *  65 degrees are taken as 65.
+ *  The current time is that of the time tracker module, which must be kept
+ *  updated by the application.
  * @{
  */
 
 
 #include "time_tracker.h"
+#include "stdbool.h"
+
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+#ifndef MS_TIMER_USED_OPER_MANAGE
+/** The ms timer used to wait for the next transition of the slots. The
+ *  sensebe applications use all four ms timers, so one of them must be
+ *  freed and given to this module in their sys_config.h. */
+#define MS_TIMER_USED_OPER_MANAGE 2
+#endif
+
+#ifndef OPER_MANAGE_LIGHT_CHECK_INTERVAL_S
+/** Interval in seconds at which the ambient light slots are evaluated */
+#define OPER_MANAGE_LIGHT_CHECK_INTERVAL_S 600
+#endif
 
 /** Maximum number of slots which can be managed by the module */
 #define OPER_MANAGE_MAX_SLOTS 8
@@ -45,6 +78,10 @@ typedef enum
     OPER_MANAGE_AMBI_LIGHT,
     /** Operation Condition : Time of day */
     OPER_MANAGE_TIME_OF_DAY,
+    /** Operation Condition : Daylight, from sunrise to sunset */
+    OPER_MANAGE_DAYLIGHT,
+    /** Operation Condition : Night, from sunset to the next sunrise */
+    OPER_MANAGE_NIGHT,
 }oper_list_t;
 
 /** Structure to store Condition slots information */
@@ -54,12 +91,30 @@ typedef struct
     oper_list_t oper_sel;
     /** Slot number for given condition. Should be less than @ref OPER_MANAGE_MAX_SLOTS */
     uint32_t slot_no;
-    /** Starting condition for slot */
+    /** Starting condition for slot. For time of day the second of the day,
+     *  which can be after the ending one for a slot across midnight. For
+     *  daylight and night the offset in seconds from the start, as int32_t. */
     uint32_t start_cond;
-    /** Ending condition for slot */
+    /** Ending condition for slot, included in the slot for time of day */
     uint32_t end_cond;
 }oper_manage_slot_t;
 
+/**
+ * @brief Function to initialize the module
+ * @param slot_change_handler Handler called from the ms timer interrupt
+ *  with the status of all the slots when any of them changes. Can be NULL.
+ */
+void oper_manage_init (void (* slot_change_handler) (uint8_t active_slots));
+
+/**
+ * @brief Function to set the location for the sunrise and sunset
+ * @param latitude_cdeg Latitude in 1/100 degrees, negative for the south
+ * @param solar_noon_s Second of the day in local time when the sun is the
+ *  highest, which is 12:00 shifted by the offset of the longitude from
+ *  that of the time zone
+ */
+void oper_manage_set_location (int32_t latitude_cdeg, uint32_t solar_noon_s);
+
 /**
  * @brief Function to initiate new operation condition slot
  * @param new_slot Structure pointer to data type @ref oper_manage_slot_t
@@ -75,7 +130,9 @@ void oper_manage_set_slot (oper_manage_slot_t * new_slot);
 uint8_t oper_manage_get_active_slots ();
 
 /**
- * @brief Function to check if there are any changes in active slots.
+ * @brief Function to check if there are any changes in active slots, which
+ *  also finds the next transition again. To be called when the time of the
+ *  time tracker is set.
  * @return bitwise status of all slots.
  * @retval if [i]th bit is 1 then [i]th condition slot is active.
  */
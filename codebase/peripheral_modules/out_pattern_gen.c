@@ -86,7 +86,7 @@ void out_gen_init(uint32_t num_out, uint32_t * out_pins, bool * out_init_value)
     context.is_on = false;
 }
 
-void out_gen_start(out_gen_config_t * out_gen_config)
+void out_gen_start(const out_gen_config_t * out_gen_config)
 {
     ASSERT((out_gen_config->num_transitions < OUT_GEN_MAX_TRANSITIONS)
             && (out_gen_config->num_transitions > 0));
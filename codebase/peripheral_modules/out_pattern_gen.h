@@ -82,7 +82,7 @@ void out_gen_init(uint32_t num_out, uint32_t * out_pins, bool * out_init_value);
  * @param out_gen_config A pointer to configuration which is used to generate
  * pattern.
  */
-void out_gen_start(out_gen_config_t * out_gen_config);
+void out_gen_start(const out_gen_config_t * out_gen_config);
 
 /**
  * @brief Stop the output pattern generation and sets the output pins
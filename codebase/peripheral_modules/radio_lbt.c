@@ -0,0 +1,195 @@
+/**
+ *  radio_lbt.c : Listen before talk with random backoff for the sub-GHz radio
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "radio_lbt.h"
+#include "radio_drv.h"
+#include "ms_timer.h"
+#include "common_util.h"
+#include "nrf.h"
+#include "string.h"
+
+/** ms timer used for the backoff waits */
+#define LBT_MS_TIMER CONCAT_2(MS_TIMER, MS_TIMER_USED_RADIO_LBT)
+
+/** ms timer ticks in a backoff slot, at least one */
+#define SLOT_TICKS   ((MS_TIMER_FREQ*(uint64_t)RADIO_LBT_SLOT_US >= 1000000) ?  \
+    ((uint32_t) ROUNDED_DIV(MS_TIMER_FREQ*(uint64_t)RADIO_LBT_SLOT_US, 1000000)) : 1)
+
+/** Mask of the 24 bit RTC counter */
+#define RTC_COUNTER_MASK    0xFFFFFF
+
+/** States of a send request */
+typedef enum
+{
+    LBT_IDLE,
+    LBT_BACKOFF,
+}lbt_state_t;
+
+static volatile lbt_state_t lbt_state = LBT_IDLE;
+static void (*lbt_done_handler) (radio_lbt_result_t result);
+
+/** Copy of the packet as it is sent later */
+static uint8_t lbt_buf[RADIO_PKT_MAX_LEN];
+static uint32_t lbt_len;
+
+/** Backoff exponent and number of busy assessments of the ongoing request */
+static uint32_t lbt_be, lbt_nb;
+/** RTC count at the request, for the access delay */
+static uint32_t lbt_req_ticks;
+
+static radio_lbt_stats_t lbt_stats;
+static uint64_t lbt_access_sum_us;
+
+/** State of the xorshift generator for the backoff, seeded per device */
+static uint32_t lbt_rand_state;
+
+static uint32_t lbt_rand (void)
+{
+    lbt_rand_state ^= lbt_rand_state << 13;
+    lbt_rand_state ^= lbt_rand_state >> 17;
+    lbt_rand_state ^= lbt_rand_state << 5;
+    return lbt_rand_state;
+}
+
+static void lbt_timer_handler (void);
+static void lbt_cca_handler (int result);
+
+/** Wait a random number of slots in the current backoff window, plus one
+ *  slot for the RSSI to be valid after entering RX */
+static void backoff_start (void)
+{
+    uint32_t slots = lbt_rand () & ((1 << lbt_be) - 1);
+
+    lbt_state = LBT_BACKOFF;
+    ms_timer_start (LBT_MS_TIMER, MS_SINGLE_CALL, (slots + 1) * SLOT_TICKS,
+            lbt_timer_handler);
+}
+
+static void request_done (radio_lbt_result_t result)
+{
+    lbt_state = LBT_IDLE;
+    if(lbt_done_handler != NULL)
+    {
+        lbt_done_handler (result);
+    }
+}
+
+/** Assess the channel again after a busy one, or give up */
+static void channel_busy (void)
+{
+    lbt_stats.busy_cnt++;
+    lbt_nb++;
+    if(lbt_nb > RADIO_LBT_MAX_BACKOFFS)
+    {
+        lbt_stats.fail_cnt++;
+        request_done (RADIO_LBT_CHANNEL_BUSY);
+        return;
+    }
+
+    if(lbt_be < RADIO_LBT_MAX_BE)
+    {
+        lbt_be++;
+    }
+    backoff_start ();
+}
+
+static void lbt_timer_handler (void)
+{
+    //A packet on air (GDO0 high) means a busy channel, else carrier sense
+    //is read with an access queued behind those of the radio_drv chains
+    if((radio_is_busy () != 0) || (radio_channel_clear_async (lbt_cca_handler) != 0))
+    {
+        channel_busy ();
+    }
+}
+
+/** Called from the SPIM interrupt with the carrier sense. An invalid
+ *  carrier sense is taken as a busy channel. */
+static void lbt_cca_handler (int result)
+{
+    if((result == 0) && (radio_is_busy () == 0)
+            && (radio_send_async (lbt_buf, lbt_len) == 0))
+    {
+        uint32_t ticks = (ms_timer_get_current_count () - lbt_req_ticks)
+                & RTC_COUNTER_MASK;
+        uint32_t access_us = ((uint64_t) ticks * 1000000) / MS_TIMER_FREQ;
+
+        lbt_stats.tx_cnt++;
+        lbt_access_sum_us += access_us;
+        if(access_us > lbt_stats.access_max_us)
+        {
+            lbt_stats.access_max_us = access_us;
+        }
+        request_done (RADIO_LBT_TX_STARTED);
+        return;
+    }
+
+    channel_busy ();
+}
+
+void radio_lbt_init (void (*done_handler) (radio_lbt_result_t result))
+{
+    lbt_done_handler = done_handler;
+    lbt_state = LBT_IDLE;
+    memset (&lbt_stats, 0, sizeof(lbt_stats));
+    lbt_access_sum_us = 0;
+
+    //Different units on a site must not pick the same backoff
+    lbt_rand_state = NRF_FICR->DEVICEID[0] ^ ms_timer_get_current_count ();
+    if(lbt_rand_state == 0)
+    {
+        lbt_rand_state = 1;
+    }
+}
+
+bool radio_lbt_send (const uint8_t * p_data, uint32_t len)
+{
+    if((lbt_state != LBT_IDLE) || (len > RADIO_PKT_MAX_LEN))
+    {
+        return false;
+    }
+
+    //The radio listens during the backoff, unless it is already on a packet
+    if((radio_is_busy () == 0) && (radio_receive_async () != 0))
+    {
+        return false;
+    }
+
+    memcpy (lbt_buf, p_data, len);
+    lbt_len = len;
+    lbt_be = RADIO_LBT_MIN_BE;
+    lbt_nb = 0;
+    lbt_req_ticks = ms_timer_get_current_count ();
+    lbt_stats.req_cnt++;
+    backoff_start ();
+    return true;
+}
+
+bool radio_lbt_is_busy (void)
+{
+    return (lbt_state != LBT_IDLE);
+}
+
+void radio_lbt_stats_get (radio_lbt_stats_t * p_stats)
+{
+    *p_stats = lbt_stats;
+    if(lbt_stats.tx_cnt != 0)
+    {
+        p_stats->access_mean_us = lbt_access_sum_us / lbt_stats.tx_cnt;
+    }
+}
@@ -0,0 +1,131 @@
+/**
+ *  radio_lbt.h : Listen before talk with random backoff for the sub-GHz radio
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup group_peripheral_modules
+ * @{
+ *
+ * @defgroup group_radio_lbt Radio listen before talk
+ *
+ * @brief CSMA for the packets sent with the interrupt driven mode of
+ *  radio_drv, so that many units on a site don't keep colliding.
+ *
+ * A send request puts the radio in RX right away and waits a random number
+ *  of backoff slots, plus one for the carrier sense to be valid, before it
+ *  assesses the channel. The channel is busy if the radio has carrier sense,
+ *  the carrier sense is not valid or a packet is being received (GDO0 high).
+ *  On a busy channel the backoff exponent is incremented and the wait is
+ *  repeated. After @ref RADIO_LBT_MAX_BACKOFFS busy assessments the request
+ *  fails, which bounds the channel access delay to the sum of the backoff windows.
+ *  The waits are done with a ms timer so the CPU can sleep meanwhile.
+ * @{
+ */
+
+#ifndef CODEBASE_PERIPHERAL_MODULES_RADIO_LBT_H_
+#define CODEBASE_PERIPHERAL_MODULES_RADIO_LBT_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+#ifndef MS_TIMER_USED_RADIO_LBT
+#define MS_TIMER_USED_RADIO_LBT     2
+#endif
+
+#ifndef RADIO_LBT_SLOT_US
+/** Duration of a backoff slot in us, longer than the channel assessment */
+#define RADIO_LBT_SLOT_US           1000
+#endif
+
+#ifndef RADIO_LBT_MIN_BE
+/** Backoff exponent of the first wait, the wait is up to 2^BE - 1 slots */
+#define RADIO_LBT_MIN_BE            2
+#endif
+
+#ifndef RADIO_LBT_MAX_BE
+/** Maximum backoff exponent */
+#define RADIO_LBT_MAX_BE            5
+#endif
+
+#ifndef RADIO_LBT_MAX_BACKOFFS
+/** Number of busy channel assessments after which a request fails */
+#define RADIO_LBT_MAX_BACKOFFS      4
+#endif
+
+/** Results of a send request */
+typedef enum
+{
+    RADIO_LBT_TX_STARTED,       ///< Channel clear, the packet is given to the radio
+    RADIO_LBT_CHANNEL_BUSY,     ///< Channel busy for all the assessments, not sent
+}radio_lbt_result_t;
+
+/** Statistics of the channel access */
+typedef struct
+{
+    /** Number of send requests */
+    uint32_t req_cnt;
+    /** Number of packets given to the radio */
+    uint32_t tx_cnt;
+    /** Number of channel assessments which found the channel busy */
+    uint32_t busy_cnt;
+    /** Number of requests that failed on a busy channel */
+    uint32_t fail_cnt;
+    /** Mean and maximum delay from the request to the start of TX in us */
+    uint32_t access_mean_us;
+    uint32_t access_max_us;
+}radio_lbt_stats_t;
+
+/**
+ * @brief Function to initialize the module. The ms timer and the interrupt
+ *  driven mode of radio_drv must be initialized before this.
+ * @param done_handler Function called with the result of a send request,
+ *  from the SPIM interrupt in which the carrier sense is read or from the
+ *  ms timer interrupt
+ */
+void radio_lbt_init (void (*done_handler) (radio_lbt_result_t result));
+
+/**
+ * @brief Function to send a packet once the channel is clear. The packet is
+ *  copied. RADIO_EVT_TX_DONE from radio_drv follows RADIO_LBT_TX_STARTED.
+ * @param p_data Pointer to the packet
+ * @param len Length of the packet, at most RADIO_PKT_MAX_LEN
+ * @return True if the request is accepted, false if one is ongoing or the
+ *  radio could not be put in RX
+ */
+bool radio_lbt_send (const uint8_t * p_data, uint32_t len);
+
+/**
+ * @brief Function to know if a send request is ongoing
+ * @return True if a request is waiting for the channel
+ */
+bool radio_lbt_is_busy (void);
+
+/**
+ * @brief Function to get the channel access statistics since init
+ * @param p_stats Pointer where the statistics are to be stored
+ */
+void radio_lbt_stats_get (radio_lbt_stats_t * p_stats);
+
+#endif /* CODEBASE_PERIPHERAL_MODULES_RADIO_LBT_H_ */
+/**
+ * @}
+ * @}
+ */
@@ -18,7 +18,12 @@
 
 #include "radio_trigger.h"
 #include "hal_radio.h"
+#include "hal_clocks.h"
+#include "ms_timer.h"
 #include "nrf52810.h"
+#include "string.h"
+#include "nrf_util.h"
+#include "latency_trace.h"
 
 #if ISR_MANAGER == 1
 #include "isr_manager.h"
@@ -54,10 +59,63 @@
 #define TIMER_CHANNEL_TX_ON TIMER_CHANNEL_USED_RADIO_TRIGGER_1
 #define TIMER_CHANNEL_TX_FREQ TIMER_CHANNEL_USED_RADIO_TRIGGER_2
 
-#define XTAL_STARTUP_TIME 450
+#define TIMER_CHANNEL_LATENCY TIMER_CHANNEL_USED_RADIO_TRIGGER_3
+
+/** Time in us from the start of the timer, which is once the HF crystal is
+ *  running, to the start of the radio */
+#define RADIO_START_DELAY_US 1
 
 #define MS_TO_US_CONV(n) (n * 1000)
 
+/** Mask of the 24 bit count of the ms timer */
+#define RTC_COUNTER_MASK 0xFFFFFF
+
+/** Time in us of a number of ms timer ticks */
+#define MS_TIMER_TICKS_TO_US(ticks) ((uint32_t) ROUNDED_DIV((ticks)*1000000ULL, MS_TIMER_FREQ))
+
+/** ms timer used to wake up the receiver in low duty cycle mode */
+#define WOR_MS_TIMER CONCAT_2(MS_TIMER, MS_TIMER_USED_RADIO_TRIGGER)
+
+/** Time by which a listen window is extended when a packet is on air */
+#define WOR_EXTEND_US 1000
+
+/** Maximum number of times a listen window is extended */
+#define WOR_MAX_EXTENSIONS 4
+
+/** RSSI in -dBm stronger than which the channel is considered to have a packet on air */
+#define WOR_RSSI_THRESHOLD 85
+
+/** Radio address for a pair ID, pair ID 0 gives the default address */
+#define RADIO_TRIGGER_ADDR(id) (0x8E89BE35 ^ (((id) & 0xFFFF) << 8))
+
+/** Length of the link layer header, the sequence number byte followed by
+ *  the session byte */
+#define LINK_HDR_LEN 2
+/** Position of the session in the link layer header */
+#define LINK_HDR_SESSION_POS 1
+/** Bit in the link layer header which marks an ACK frame */
+#define LINK_HDR_ACK_Msk 0x80
+/** Bits in the link layer header which hold the sequence number */
+#define LINK_HDR_SEQ_Msk 0x7F
+/** Sequence number which is never sent, used before anything is received */
+#define LINK_SEQ_INVALID 0xFF
+
+/** Time in us for a byte on air at the 2 Mbps of hal_radio */
+#define AIR_US_PER_BYTE 4
+/** Bytes on air of a frame besides its payload: preamble, address, length and CRC */
+#define AIR_FRAME_OVERHEAD_BYTES (2 + 4 + 1 + 3)
+/** Time in us for the radio to ramp up, without the fast ramp up */
+#define RADIO_RAMP_UP_US 140
+/** Time in us of the turnaround from RX to TX, the TIFS of hal_radio */
+#define RADIO_TURNAROUND_US 150
+/** Time in us of an attempt to deliver a trigger with the largest data: the
+ *  ramp up, the trigger, the turnaround and its ACK */
+#define LINK_ATTEMPT_US (RADIO_RAMP_UP_US + RADIO_TURNAROUND_US + AIR_US_PER_BYTE*(  \
+    2*AIR_FRAME_OVERHEAD_BYTES + 2*LINK_HDR_LEN + RADIO_TRIGGER_MAX_DATA_LEN))
+/** Shortest listen window in us, so that retransmissions at half the window
+ *  are an attempt apart and a whole attempt lands in every window */
+#define WOR_MIN_LISTEN_WINDOW_US (2*LINK_ATTEMPT_US)
+
 //static uint32_t radio_rx_on_ticks = 0;
 
 //static uint32_t radio_tx_on_ticks = 0;
@@ -68,6 +126,12 @@ static radio_trigger_dir_t radio_dir = RADIO_TRIGGER_Tx;
 
 volatile bool is_radio_free = true;
 
+/** Flag to know that the radio is lent to another module */
+static volatile bool is_radio_lent = false;
+
+/** Flag to know that a yell is due once the lent radio is taken back */
+static volatile bool is_yell_pending = false;
+
 void (* p_radio_rx_handler) (void * p_data, uint32_t len);
 void (* p_radio_tx_handler) (void * p_data, uint32_t len);
  
@@ -75,6 +139,158 @@ hal_radio_config_t radio_config;
 
 app_irq_priority_t radio_trig_irq_priority;
 
+/** Flag to check if the link layer is enabled */
+static bool is_ack_en = false;
+
+/** Maximum number of retransmissions for a trigger */
+static uint32_t link_max_retries;
+
+/** Retransmissions done for the current trigger */
+static uint32_t link_retry_cnt;
+
+/** Sequence number of the latest frame received */
+static uint32_t link_last_rx_seq = LINK_SEQ_INVALID;
+
+/** Session of the latest frame received */
+static uint32_t link_last_rx_session;
+
+/** Flag to check if the session of the transmitter is chosen */
+static bool is_link_session_set = false;
+
+/** Frame which is to be transmitted, link layer header followed by data */
+static uint8_t link_tx_frame[LINK_HDR_LEN + RADIO_TRIGGER_MAX_DATA_LEN];
+
+/** Length of data in the frame to be transmitted */
+static uint32_t link_tx_data_len;
+
+/** ACK frame sent by the receiver */
+static uint8_t link_ack_frame[LINK_HDR_LEN];
+
+/** Statistics of the link layer */
+static radio_trigger_stats_t link_stats;
+
+/** Listen interval in ms for the low duty cycle mode, 0 if not used */
+static uint32_t wor_interval_ms;
+
+/** Time in us for which the receiver is on after crystal startup */
+static uint32_t rx_on_us;
+
+/** Number of times the current listen window is extended */
+static uint32_t wor_ext_cnt;
+
+/** ms timer count at the latest radio_trigger_yell */
+static uint32_t yell_count;
+
+/** ms timer count when the timer of the trigger or listen window started */
+static uint32_t timer_start_count;
+
+/**
+ * @brief Function to stop the timer and the radio once a trigger is over
+ */
+static void radio_trigger_end (void)
+{
+    TIMER_ID->TASKS_CLEAR = 1;
+    TIMER_ID->TASKS_STOP = 1;
+    TIMER_ID->TASKS_SHUTDOWN = 1;
+    (void) TIMER_ID->TASKS_SHUTDOWN;
+    TIMER_ID->EVENTS_COMPARE[TIMER_CHANNEL_COMMON_STARTUP] = 0;
+    TIMER_ID->EVENTS_COMPARE[TIMER_CHANNEL_TX_ON] = 0;
+    TIMER_ID->EVENTS_COMPARE[TIMER_CHANNEL_TX_FREQ] = 0;
+    if(is_radio_lent == false)
+    {
+        hal_radio_deinit ();
+        hfclk_xtal_release (HFCLK_XTAL_USER_RADIO_TRIGGER);
+        is_radio_free = true;
+    }
+}
+
+/**
+ * @brief Function to start the timer of a trigger or a listen window once
+ *  the HF crystal is running, so that the radio is started just in time
+ */
+static void radio_trigger_timer_start (void)
+{
+    timer_start_count = ms_timer_get_current_count ();
+    TIMER_ID->TASKS_START = 1;
+}
+
+/**
+ * @brief Function to get a random session for the transmitter. A session
+ *  different from the one before a reset makes the receiver accept a
+ *  trigger whose sequence number repeats the last one it received.
+ * @return A random byte from the RNG
+ */
+static uint8_t link_session_get (void)
+{
+    uint8_t session;
+    NRF_RNG->EVENTS_VALRDY = 0;
+    NRF_RNG->TASKS_START = 1;
+    while(NRF_RNG->EVENTS_VALRDY == 0);
+    session = NRF_RNG->VALUE;
+    NRF_RNG->TASKS_STOP = 1;
+    NRF_RNG->EVENTS_VALRDY = 0;
+    return session;
+}
+
+/**
+ * @brief Function called at the transmitter when a frame is received after
+ *  the TX to RX turnaround, which should be the ACK of the current trigger.
+ */
+static void link_ack_handler (void * p_data, uint32_t len)
+{
+    uint8_t * p_hdr = (uint8_t *) p_data;
+    if((is_radio_free == false) && (len >= LINK_HDR_LEN) &&
+       (p_hdr[0] == (LINK_HDR_ACK_Msk | link_tx_frame[0])) &&
+       (p_hdr[LINK_HDR_SESSION_POS] == link_tx_frame[LINK_HDR_SESSION_POS]))
+    {
+        TIMER_ID->TASKS_CAPTURE[TIMER_CHANNEL_LATENCY] = 1;
+        //The timer starts only once the HF crystal is running
+        link_stats.last_latency_us = TIMER_ID->CC[TIMER_CHANNEL_LATENCY] +
+            MS_TIMER_TICKS_TO_US((timer_start_count - yell_count) & RTC_COUNTER_MASK);
+        link_stats.delivered++;
+        radio_trigger_end ();
+        if(p_radio_tx_handler != NULL)
+        {
+            p_radio_tx_handler (&link_tx_frame[LINK_HDR_LEN], link_tx_data_len);
+        }
+    }
+}
+
+/**
+ * @brief Function called at the receiver when a frame is received. Every
+ *  data frame is acknowledged, but passed on only if it is not a duplicate.
+ *  The ACK is sent by the radio's turnaround to TX which is already on, and
+ *  the receiver is back in RX after it to acknowledge retransmissions in
+ *  case the ACK is lost.
+ */
+static void link_data_handler (void * p_data, uint32_t len)
+{
+    uint8_t * p_hdr = (uint8_t *) p_data;
+    if((len < LINK_HDR_LEN) || (p_hdr[0] & LINK_HDR_ACK_Msk))
+    {
+        hal_radio_cancel_reply ();
+        return;
+    }
+    uint32_t seq = p_hdr[0] & LINK_HDR_SEQ_Msk;
+    uint32_t session = p_hdr[LINK_HDR_SESSION_POS];
+    link_ack_frame[0] = LINK_HDR_ACK_Msk | seq;
+    link_ack_frame[LINK_HDR_SESSION_POS] = session;
+    hal_radio_set_tx_payload_data (link_ack_frame, LINK_HDR_LEN);
+
+    if((seq == link_last_rx_seq) && (session == link_last_rx_session))
+    {
+        link_stats.duplicates++;
+        return;
+    }
+    link_last_rx_seq = seq;
+    link_last_rx_session = session;
+    link_stats.delivered++;
+    if(p_radio_rx_handler != NULL)
+    {
+        p_radio_rx_handler (&p_hdr[LINK_HDR_LEN], len - LINK_HDR_LEN);
+    }
+}
+
 void radio_trigger_init (radio_trigger_init_t* radio_trig_init)
 {
     p_radio_rx_handler = radio_trig_init->radio_trigger_rx_callback;
@@ -85,6 +301,25 @@ void radio_trigger_init (radio_trigger_init_t* radio_trig_init)
         radio_config.freq = radio_trig_init->comm_freq;
         radio_config.irq_priority = radio_trig_init->irq_priority;
         radio_config.rx_done_handler = p_radio_rx_handler;
+        radio_config.tx_done_handler = NULL;
+        radio_config.addr = RADIO_TRIGGER_ADDR(radio_trig_init->pair_id);
+    }
+    is_ack_en = radio_trig_init->ack_en;
+    link_max_retries = (radio_trig_init->max_retries != 0) ?
+        radio_trig_init->max_retries : RADIO_TRIGGER_DEF_MAX_RETRIES;
+    wor_interval_ms = radio_trig_init->listen_interval_ms;
+    uint32_t listen_window_us = MAX(radio_trig_init->listen_window_us,
+        WOR_MIN_LISTEN_WINDOW_US);
+    if(is_ack_en == true)
+    {
+        if(radio_dir == RADIO_TRIGGER_Tx)
+        {
+            radio_config.rx_done_handler = link_ack_handler;
+        }
+        else
+        {
+            radio_config.rx_done_handler = link_data_handler;
+        }
     }
     
     TIMER_ID->MODE = (TIMER_MODE_MODE_Timer << TIMER_MODE_MODE_Pos) & TIMER_MODE_MODE_Msk;
@@ -92,21 +327,35 @@ void radio_trigger_init (radio_trigger_init_t* radio_trig_init)
     TIMER_ID->BITMODE = TIMER_BITMODE_BITMODE_32Bit;
     
     TIMER_ID->PRESCALER = TIMER_1MHz_PRESCALAR;
-    TIMER_ID->CC[TIMER_CHANNEL_COMMON_STARTUP] = XTAL_STARTUP_TIME;
+    TIMER_ID->CC[TIMER_CHANNEL_COMMON_STARTUP] = RADIO_START_DELAY_US;
     if(radio_trig_init->comm_direction == RADIO_TRIGGER_Tx)
     {
+        uint32_t tx_on_us = MS_TO_US_CONV(radio_trig_init->tx_on_time_ms);
+        radio_tx_freq_ticks = radio_trig_init->tx_on_freq_us;
+        if(wor_interval_ms != 0)
+        {
+            //Burst must overlap one full listen window of the receiver
+            tx_on_us = MAX(tx_on_us, MS_TO_US_CONV(wor_interval_ms)
+                + listen_window_us);
+            //Not so frequent that a retransmission cuts off the ACK
+            radio_tx_freq_ticks = MAX(MIN(radio_tx_freq_ticks, listen_window_us/2),
+                LINK_ATTEMPT_US);
+            //Enough retries to reach the next listen window of the receiver
+            link_max_retries = MAX(link_max_retries,
+                tx_on_us/radio_tx_freq_ticks);
+        }
         TIMER_ID->INTENSET = 
             (1 << (TIMER_CHANNEL_COMMON_STARTUP + TIMER_INTEN_OFFSET)) |
             (1 << (TIMER_CHANNEL_TX_ON + TIMER_INTEN_OFFSET)) | 
             (1 << (TIMER_CHANNEL_TX_FREQ + TIMER_INTEN_OFFSET)) ;
-        TIMER_ID->CC[TIMER_CHANNEL_TX_ON] = 
-            (MS_TO_US_CONV(radio_trig_init->tx_on_time_ms) + XTAL_STARTUP_TIME);
-        TIMER_ID->CC[TIMER_CHANNEL_TX_FREQ] = radio_trig_init->tx_on_freq_us+ XTAL_STARTUP_TIME;
-        radio_tx_freq_ticks = radio_trig_init->tx_on_freq_us;
+        TIMER_ID->CC[TIMER_CHANNEL_TX_ON] = tx_on_us + RADIO_START_DELAY_US;
+        TIMER_ID->CC[TIMER_CHANNEL_TX_FREQ] = radio_tx_freq_ticks + RADIO_START_DELAY_US;
     }
     else
     {
-        TIMER_ID->CC[TIMER_CHANNEL_RX_ON] = MS_TO_US_CONV(radio_trig_init->rx_on_time_ms) + XTAL_STARTUP_TIME;
+        rx_on_us = (wor_interval_ms != 0) ? listen_window_us
+            : MS_TO_US_CONV(radio_trig_init->rx_on_time_ms);
+        TIMER_ID->CC[TIMER_CHANNEL_RX_ON] = rx_on_us + RADIO_START_DELAY_US;
         TIMER_ID->INTENSET = 
             (1 << (TIMER_CHANNEL_COMMON_STARTUP + TIMER_INTEN_OFFSET)) |
             (1 << (TIMER_CHANNEL_RX_ON + TIMER_INTEN_OFFSET));
@@ -118,33 +367,95 @@ void radio_trigger_init (radio_trigger_init_t* radio_trig_init)
     
 }
 
-void radio_trigger_yell ()
+/**
+ * @brief Function to start the transmission of a trigger, or to defer it
+ *  till the radio is taken back
+ */
+static void radio_trigger_tx_start (void)
 {
-    is_radio_free = false;
-    TIMER_ID->CC[TIMER_CHANNEL_TX_FREQ] = radio_tx_freq_ticks + XTAL_STARTUP_TIME;
+    bool is_deferred;
+
+    CRITICAL_REGION_ENTER();
+    is_deferred = is_radio_lent;
+    if(is_deferred == true)
+    {
+        is_yell_pending = true;
+    }
+    else
+    {
+        is_radio_free = false;
+    }
+    CRITICAL_REGION_EXIT();
+    if(is_deferred == true)
+    {
+        return;
+    }
+    TIMER_ID->CC[TIMER_CHANNEL_TX_FREQ] = radio_tx_freq_ticks + RADIO_START_DELAY_US;
+
+    if(is_ack_en == true)
+    {
+        //The radio can't be used with the SoftDevice on, nor can the RNG
+        if(is_link_session_set == false)
+        {
+            link_tx_frame[LINK_HDR_SESSION_POS] = link_session_get ();
+            is_link_session_set = true;
+        }
+        link_tx_frame[0] = (link_tx_frame[0] + 1) & LINK_HDR_SEQ_Msk;
+        link_retry_cnt = 0;
+        hal_radio_set_tx_payload_data (link_tx_frame, LINK_HDR_LEN + link_tx_data_len);
+    }
 
-    TIMER_ID->TASKS_START = 1;
     hal_radio_init (&radio_config);
     NVIC_SetPriority (TIMER_IRQN, radio_trig_irq_priority);
     NVIC_EnableIRQ (TIMER_IRQN);
+    hfclk_xtal_request (HFCLK_XTAL_USER_RADIO_TRIGGER, radio_trigger_timer_start);
 }
 
-void radio_trigger_listen ()
+void radio_trigger_yell ()
+{
+    yell_count = ms_timer_get_current_count ();
+    radio_trigger_tx_start ();
+}
+
+/**
+ * @brief Function to turn on the receiver for one listen window
+ */
+static void radio_trigger_listen_once (void)
 {
+    bool is_free;
+
+    CRITICAL_REGION_ENTER();
+    is_free = is_radio_free;
     is_radio_free = false;
-    TIMER_ID->TASKS_START = 1;
+    CRITICAL_REGION_EXIT();
+    if(is_free == false)
+    {
+        return;
+    }
+    wor_ext_cnt = 0;
+    TIMER_ID->CC[TIMER_CHANNEL_RX_ON] = rx_on_us + RADIO_START_DELAY_US;
     hal_radio_init (&radio_config);
     NVIC_SetPriority (TIMER_IRQN, radio_trig_irq_priority);
     NVIC_EnableIRQ (TIMER_IRQN);
+    hfclk_xtal_request (HFCLK_XTAL_USER_RADIO_TRIGGER, radio_trigger_timer_start);
+}
+
+void radio_trigger_listen ()
+{
+    if(wor_interval_ms != 0)
+    {
+        ms_timer_start (WOR_MS_TIMER, MS_REPEATED_CALL,
+                        MS_TIMER_TICKS_MS(wor_interval_ms), radio_trigger_listen_once);
+    }
+    radio_trigger_listen_once ();
 }
 
 void radio_trigger_shut ()
 {
-    TIMER_ID->TASKS_STOP = 1;
-    TIMER_ID->TASKS_SHUTDOWN = 1;
+    is_yell_pending = false;
+    ms_timer_stop (WOR_MS_TIMER);
     NVIC_DisableIRQ (TIMER_IRQN);
-    hal_radio_deinit ();
-    is_radio_free = true;
+    radio_trigger_end ();
 }
 
 #if ISR_MANAGER == true
@@ -161,7 +472,15 @@ void TIMER_IRQ_Handler ()
             TIMER_ID->EVENTS_COMPARE[TIMER_CHANNEL_COMMON_STARTUP] = false;
 #endif
             log_printf("%s\n", __func__);
-            hal_radio_start_tx ();
+            latency_trace_mark (LATENCY_TRACE_RADIO_TX);
+            if(is_ack_en == true)
+            {
+                hal_radio_start_tx_rx ();
+            }
+            else
+            {
+                hal_radio_start_tx ();
+            }
         }
         
         if(TIMER_ID->EVENTS_COMPARE[TIMER_CHANNEL_TX_FREQ] == true)
@@ -169,7 +488,24 @@ void TIMER_IRQ_Handler ()
 #if ISR_MANAGER == false
             TIMER_ID->EVENTS_COMPARE[TIMER_CHANNEL_TX_FREQ] = false;
 #endif
-            hal_radio_start_tx ();
+            if(is_ack_en == false)
+            {
+                hal_radio_start_tx ();
+            }
+            else if(link_retry_cnt >= link_max_retries)
+            {
+                //No ACK even after all the retries
+                link_stats.failed++;
+                radio_trigger_end ();
+                return;
+            }
+            else
+            {
+                //No ACK received within the retransmission interval
+                link_retry_cnt++;
+                link_stats.retries++;
+                hal_radio_start_tx_rx ();
+            }
             TIMER_ID->CC[TIMER_CHANNEL_TX_FREQ] += radio_tx_freq_ticks;
             log_printf("CC[%d] : %d\n", TIMER_CHANNEL_TX_FREQ, TIMER_ID->CC[TIMER_CHANNEL_TX_FREQ]);
         }
@@ -179,12 +515,11 @@ void TIMER_IRQ_Handler ()
 #if ISR_MANAGER == false
             TIMER_ID->EVENTS_COMPARE[TIMER_CHANNEL_TX_ON] = false;
 #endif
-            TIMER_ID->TASKS_CLEAR = 1;
-            TIMER_ID->TASKS_STOP = 1;
-            TIMER_ID->TASKS_SHUTDOWN = 1;
-            (void) TIMER_ID->TASKS_SHUTDOWN;
-            hal_radio_deinit ();
-            is_radio_free = true;
+            if(is_ack_en == true)
+            {
+                link_stats.failed++;
+            }
+            radio_trigger_end ();
         }
     }
     else
@@ -194,7 +529,14 @@ void TIMER_IRQ_Handler ()
 #if ISR_MANAGER == false
             TIMER_ID->EVENTS_COMPARE[TIMER_CHANNEL_COMMON_STARTUP] = false;
 #endif
-            hal_radio_start_rx ();
+            if(is_ack_en == true)
+            {
+                hal_radio_start_rx_reply ();
+            }
+            else
+            {
+                hal_radio_start_rx ();
+            }
         }
         
         if(TIMER_ID->EVENTS_COMPARE[TIMER_CHANNEL_RX_ON])
@@ -202,18 +544,24 @@ void TIMER_IRQ_Handler ()
 #if ISR_MANAGER == false
             TIMER_ID->EVENTS_COMPARE[TIMER_CHANNEL_RX_ON] = false;
 #endif
-            TIMER_ID->TASKS_CLEAR = 1;
-            TIMER_ID->TASKS_STOP = 1;
-            TIMER_ID->TASKS_SHUTDOWN = 1;
-            (void) TIMER_ID->TASKS_SHUTDOWN;
-            hal_radio_deinit ();
-            is_radio_free = true;
+            if((wor_interval_ms != 0) && (wor_ext_cnt < WOR_MAX_EXTENSIONS) &&
+               (hal_radio_is_packet_ongoing () ||
+                (hal_radio_get_rssi () < WOR_RSSI_THRESHOLD)))
+            {
+                //Stay on till the packet on air is received
+                wor_ext_cnt++;
+                TIMER_ID->CC[TIMER_CHANNEL_RX_ON] += WOR_EXTEND_US;
+                return;
+            }
+            radio_trigger_end ();
         }
     }
 }
 
 void radio_trigger_memorize_data (void * data, uint32_t len)
 {
+    link_tx_data_len = (len < RADIO_TRIGGER_MAX_DATA_LEN) ? len : RADIO_TRIGGER_MAX_DATA_LEN;
+    memcpy (&link_tx_frame[LINK_HDR_LEN], data, link_tx_data_len);
     hal_radio_set_tx_payload_data (data, len);
 }
 
@@ -221,3 +569,39 @@ bool is_radio_trigger_availabel ()
 {
     return is_radio_free;
 }
+
+bool radio_trigger_radio_lend (void)
+{
+    bool is_lent = false;
+
+    CRITICAL_REGION_ENTER();
+    if(is_radio_free == true)
+    {
+        is_radio_free = false;
+        is_radio_lent = true;
+        is_lent = true;
+    }
+    CRITICAL_REGION_EXIT();
+    return is_lent;
+}
+
+void radio_trigger_radio_take_back (void)
+{
+    bool is_yell;
+
+    CRITICAL_REGION_ENTER();
+    is_yell = is_yell_pending;
+    is_yell_pending = false;
+    is_radio_lent = false;
+    is_radio_free = true;
+    CRITICAL_REGION_EXIT();
+    if(is_yell == true)
+    {
+        radio_trigger_tx_start ();
+    }
+}
+
+void radio_trigger_get_stats (radio_trigger_stats_t * stats)
+{
+    memcpy (stats, &link_stats, sizeof(radio_trigger_stats_t));
+}
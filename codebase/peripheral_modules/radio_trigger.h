@@ -44,6 +44,22 @@
 #define TIMER_CHANNEL_USED_RADIO_TRIGGER_2 2
 #endif
 
+#ifndef TIMER_CHANNEL_USED_RADIO_TRIGGER_3
+#define TIMER_CHANNEL_USED_RADIO_TRIGGER_3 3
+#endif
+
+#ifndef MS_TIMER_USED_RADIO_TRIGGER
+#define MS_TIMER_USED_RADIO_TRIGGER 3
+#endif
+
+#ifndef RADIO_TRIGGER_DEF_MAX_RETRIES
+/** Number of retransmissions of a trigger if none is given at init */
+#define RADIO_TRIGGER_DEF_MAX_RETRIES 5
+#endif
+
+/** Maximum number of data bytes which can be sent with a trigger */
+#define RADIO_TRIGGER_MAX_DATA_LEN 16
+
 
 typedef enum
 {
@@ -62,9 +78,49 @@ typedef struct
     app_irq_priority_t irq_priority;
     void (* radio_trigger_tx_callback) (void * data, uint32_t len);
     void (* radio_trigger_rx_callback) (void * data, uint32_t len);
+    /** ID shared by a transmitter and its receivers, used to derive the radio address */
+    uint32_t pair_id;
+    /** Enable the link layer with sequence numbers, ACK and duplicate suppression.
+     *  Should be same on both the transmitter and the receiver. With the link
+     *  layer, the transmitter stops as soon as the ACK is received and
+     *  radio_trigger_tx_callback is called with the delivered data. */
+    bool ack_en;
+    /** Maximum number of retransmissions after the first transmission, done
+     *  every tx_on_freq_us, before giving up or till tx_on_time_ms is over.
+     *  @ref RADIO_TRIGGER_DEF_MAX_RETRIES is used if this is 0. In the low
+     *  duty cycle mode there are at least enough to reach a listen window.
+     *  Used only if ack_en is true. */
+    uint32_t max_retries;
+    /** Interval in ms at which the receiver wakes up to listen in the low duty
+     *  cycle mode. At the transmitter, the on time is extended to cover one
+     *  interval and retransmissions are made frequent enough to land in every
+     *  listen window. Low duty cycle mode is not used if this is 0. */
+    uint32_t listen_interval_ms;
+    /** Duration in us for which the receiver listens at each wake up. It stays
+     *  on longer only if a packet is on air at the end of this window. It is
+     *  made at least twice the time of a trigger and its ACK, about 1 ms. */
+    uint32_t listen_window_us;
     
 }radio_trigger_init_t;
 
+/**
+ * @brief Statistics of the link layer
+ */
+typedef struct
+{
+    /** Triggers acknowledged by the receiver at TX, new triggers received at RX */
+    uint32_t delivered;
+    /** Triggers for which no ACK was received at TX */
+    uint32_t failed;
+    /** Total number of retransmissions at TX */
+    uint32_t retries;
+    /** Retransmitted triggers received again and suppressed at RX */
+    uint32_t duplicates;
+    /** Time in us from radio_trigger_yell to reception of ACK for the latest
+     *  trigger, including the HF crystal startup and a deferral of the yell */
+    uint32_t last_latency_us;
+}radio_trigger_stats_t;
+
 void radio_trigger_init (radio_trigger_init_t * radio_trig_init); 
 
 void radio_trigger_yell ();
@@ -76,4 +132,23 @@ void radio_trigger_shut ();
 void radio_trigger_memorize_data (void * data, uint32_t len);
 
 bool is_radio_trigger_availabel ();
+
+/**
+ * @brief Function to lend the radio to another module while it is free. A
+ *  listen window due meanwhile is skipped and a yell is made once the radio
+ *  is taken back.
+ * @return True if the radio is lent, false if it is in use
+ */
+bool radio_trigger_radio_lend (void);
+
+/**
+ * @brief Function to take back the radio lent with @ref radio_trigger_radio_lend
+ */
+void radio_trigger_radio_take_back (void);
+
+/**
+ * @brief Function to get the statistics of the link layer
+ * @param stats Pointer to the structure in which statistics are to be copied
+ */
+void radio_trigger_get_stats (radio_trigger_stats_t * stats);
 #endif /* RADIO_TRIGGER_H */
@@ -0,0 +1,203 @@
+/**
+ *  rf_bench.c : Packet format and receiver statistics for radio benchmarks
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "rf_bench.h"
+#include "string.h"
+
+/** Mask of the 24 bit RTC counter */
+#define RTC_COUNTER_MASK    0xFFFFFF
+
+/** Raw sums from which @ref rf_bench_stats_t is derived */
+static struct
+{
+    bool is_started;
+    uint16_t rx_cnt;
+    uint16_t corrupt_cnt;
+    uint16_t first_seq;
+    uint16_t last_seq;
+    uint32_t last_ticks;
+    uint32_t rx_bytes;
+    /** Sum of the gaps in RTC ticks, which is the duration of the run */
+    uint32_t gap_sum;
+    uint64_t gap_sq_sum;
+    int32_t rssi_sum;
+    int8_t rssi_min;
+    int8_t rssi_max;
+    uint8_t payload_len;
+    uint16_t rssi_hist[RF_BENCH_RSSI_BINS];
+}bench;
+
+/** Pattern byte at an index of a packet with a sequence number */
+static inline uint8_t pattern_byte (uint16_t seq, uint32_t idx)
+{
+    return (uint8_t) (seq + idx);
+}
+
+void rf_bench_pkt_fill (uint8_t * p_buf, uint32_t len, uint16_t seq)
+{
+    p_buf[0] = (uint8_t) seq;
+    p_buf[1] = (uint8_t) (seq >> 8);
+    for(uint32_t i = 2; i < len; i++)
+    {
+        p_buf[i] = pattern_byte (seq, i);
+    }
+}
+
+void rf_bench_stats_start (void)
+{
+    memset (&bench, 0, sizeof(bench));
+}
+
+void rf_bench_stats_add (const uint8_t * p_buf, uint32_t len, int8_t rssi,
+        bool crc_ok, uint32_t rtc_ticks)
+{
+    uint16_t seq;
+    uint32_t bin;
+
+    if((crc_ok == false) || (len < 2))
+    {
+        bench.corrupt_cnt++;
+        return;
+    }
+
+    seq = p_buf[0] | (p_buf[1] << 8);
+    for(uint32_t i = 2; i < len; i++)
+    {
+        if(p_buf[i] != pattern_byte (seq, i))
+        {
+            bench.corrupt_cnt++;
+            return;
+        }
+    }
+
+    if(bench.is_started && (seq < bench.last_seq))
+    {
+        //Transmitter restarted
+        rf_bench_stats_start ();
+    }
+
+    if(bench.is_started == false)
+    {
+        bench.is_started = true;
+        bench.first_seq = seq;
+        bench.rssi_min = rssi;
+        bench.rssi_max = rssi;
+        bench.payload_len = len;
+    }
+    else if(seq == bench.last_seq)
+    {
+        //Duplicate
+        return;
+    }
+    else
+    {
+        uint32_t gap = (rtc_ticks - bench.last_ticks) & RTC_COUNTER_MASK;
+        bench.gap_sum += gap;
+        bench.gap_sq_sum += (uint64_t) gap * gap;
+    }
+
+    bench.last_seq = seq;
+    bench.last_ticks = rtc_ticks;
+    bench.rx_cnt++;
+    bench.rx_bytes += len;
+
+    bench.rssi_sum += rssi;
+    if(rssi < bench.rssi_min)
+    {
+        bench.rssi_min = rssi;
+    }
+    if(rssi > bench.rssi_max)
+    {
+        bench.rssi_max = rssi;
+    }
+
+    if(rssi < RF_BENCH_RSSI_BIN_MIN)
+    {
+        bin = 0;
+    }
+    else
+    {
+        bin = (rssi - RF_BENCH_RSSI_BIN_MIN)/RF_BENCH_RSSI_BIN_WIDTH;
+        if(bin >= RF_BENCH_RSSI_BINS)
+        {
+            bin = RF_BENCH_RSSI_BINS - 1;
+        }
+    }
+    if(bench.rssi_hist[bin] != UINT16_MAX)
+    {
+        bench.rssi_hist[bin]++;
+    }
+}
+
+void rf_bench_stats_get (rf_bench_stats_t * p_stats)
+{
+    uint32_t sent = 0, gap_cnt;
+
+    memset (p_stats, 0, sizeof(rf_bench_stats_t));
+    if(bench.is_started == false)
+    {
+        p_stats->corrupt_cnt = bench.corrupt_cnt;
+        return;
+    }
+
+    p_stats->rx_cnt = bench.rx_cnt;
+    p_stats->corrupt_cnt = bench.corrupt_cnt;
+    p_stats->first_seq = bench.first_seq;
+    p_stats->last_seq = bench.last_seq;
+
+    //The corrupt packets can't be placed in the sequence, so they are
+    //taken out of the gaps to find the lost ones
+    sent = bench.last_seq - bench.first_seq + 1;
+    if(sent > (uint32_t) bench.rx_cnt + bench.corrupt_cnt)
+    {
+        p_stats->lost_cnt = sent - bench.rx_cnt - bench.corrupt_cnt;
+    }
+    else
+    {
+        sent = bench.rx_cnt + bench.corrupt_cnt;
+    }
+    p_stats->per_x100 = ((sent - bench.rx_cnt) * 10000) / sent;
+
+    gap_cnt = bench.rx_cnt - 1;
+    if((gap_cnt != 0) && (bench.gap_sum != 0))
+    {
+        //RTC ticks at 32768 Hz to us is x 15625 / 512
+        uint64_t mean = bench.gap_sum / gap_cnt;
+        uint64_t var = (bench.gap_sq_sum / gap_cnt) - (mean * mean);
+        uint32_t sd = 0, bit = 1UL << 30;
+        while(bit != 0)
+        {
+            if((uint64_t) (sd + bit) * (sd + bit) <= var)
+            {
+                sd += bit;
+            }
+            bit >>= 1;
+        }
+
+        p_stats->gap_mean_us = (mean * 15625) / 512;
+        p_stats->gap_jitter_us = ((uint64_t) sd * 15625) / 512;
+        p_stats->throughput_bps =
+            ((uint64_t) (bench.rx_bytes - bench.payload_len) * 32768) / bench.gap_sum;
+    }
+
+    p_stats->rssi_mean = bench.rssi_sum / bench.rx_cnt;
+    p_stats->rssi_min = bench.rssi_min;
+    p_stats->rssi_max = bench.rssi_max;
+    p_stats->payload_len = bench.payload_len;
+    memcpy (p_stats->rssi_hist, bench.rssi_hist, sizeof(bench.rssi_hist));
+}
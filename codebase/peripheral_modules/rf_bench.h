@@ -0,0 +1,145 @@
+/**
+ *  rf_bench.h : Packet format and receiver statistics for radio benchmarks
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup group_peripheral_modules
+ * @{
+ *
+ * @defgroup group_rf_bench Radio benchmark
+ *
+ * @brief Module for the packet error rate and throughput benchmark between
+ *  a transmitter and a receiver.
+ *
+ * The transmitter fills each packet with @ref rf_bench_pkt_fill, which puts
+ *  a sequence number followed by a pattern derived from it. The receiver
+ *  passes every packet to @ref rf_bench_stats_add along with its RSSI, CRC
+ *  status and arrival time. The lost packets are found from the gaps in the
+ *  sequence numbers, packets with a CRC error or a wrong pattern are counted
+ *  as corrupt. The statistics are kept in RAM and @ref rf_bench_stats_get
+ *  gives the derived values in a packed form to be sent over BLE.
+ * @{
+ */
+
+#ifndef CODEBASE_PERIPHERAL_MODULES_RF_BENCH_H_
+#define CODEBASE_PERIPHERAL_MODULES_RF_BENCH_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+#ifndef RF_BENCH_PAYLOAD_LEN
+/** Length of the benchmark packets in bytes, including the sequence number */
+#define RF_BENCH_PAYLOAD_LEN        16
+#endif
+
+#ifndef RF_BENCH_INTERVAL_MS
+/** Interval between the benchmark packets in ms */
+#define RF_BENCH_INTERVAL_MS        100
+#endif
+
+#ifndef RF_BENCH_PKT_CNT
+/** Number of packets sent in a benchmark run */
+#define RF_BENCH_PKT_CNT            1000
+#endif
+
+#ifndef RF_BENCH_RADIO_CFG
+/** Radio configuration passed to radio_init for the benchmark run */
+#define RF_BENCH_RADIO_CFG          4
+#endif
+
+/** Number of bins in the RSSI histogram */
+#define RF_BENCH_RSSI_BINS          8
+/** RSSI in dBm at the lower edge of the first bin, lower values go in it too */
+#define RF_BENCH_RSSI_BIN_MIN       -120
+/** Width of a bin of the RSSI histogram in dB, higher values go in the last */
+#define RF_BENCH_RSSI_BIN_WIDTH     10
+
+#if RF_BENCH_PAYLOAD_LEN < 2
+#error "RF_BENCH_PAYLOAD_LEN must have space for the sequence number"
+#endif
+
+/** Statistics of a benchmark run as read by the host */
+typedef struct __attribute__ ((packed))
+{
+    /** Packets received with the right CRC and pattern */
+    uint16_t rx_cnt;
+    /** Packets received with a CRC error or a wrong pattern */
+    uint16_t corrupt_cnt;
+    /** Packets missing from the sequence numbers */
+    uint16_t lost_cnt;
+    /** Sequence number of the first and the last packet received */
+    uint16_t first_seq;
+    uint16_t last_seq;
+    /** Packet error rate in 0.01 %, lost and corrupt over all the packets sent */
+    uint16_t per_x100;
+    /** Payload bytes received correctly per second */
+    uint32_t throughput_bps;
+    /** Mean and standard deviation of the time between packets in us */
+    uint32_t gap_mean_us;
+    uint32_t gap_jitter_us;
+    /** Mean, minimum and maximum RSSI in dBm of the packets received */
+    int8_t rssi_mean;
+    int8_t rssi_min;
+    int8_t rssi_max;
+    /** Length of the packets in the run */
+    uint8_t payload_len;
+    /** Number of packets in each RSSI bin, starting at @ref RF_BENCH_RSSI_BIN_MIN */
+    uint16_t rssi_hist[RF_BENCH_RSSI_BINS];
+}rf_bench_stats_t;
+
+/**
+ * @brief Function to fill a benchmark packet
+ * @param p_buf Pointer to the packet buffer
+ * @param len Length of the packet, at least 2 for the sequence number
+ * @param seq Sequence number of the packet
+ */
+void rf_bench_pkt_fill (uint8_t * p_buf, uint32_t len, uint16_t seq);
+
+/**
+ * @brief Function to clear the statistics to start a new run. This is also
+ *  done when a packet has a sequence number lower than the previous one,
+ *  which happens when the transmitter restarts.
+ */
+void rf_bench_stats_start (void);
+
+/**
+ * @brief Function to add a received packet to the statistics
+ * @param p_buf Pointer to the packet
+ * @param len Length of the packet
+ * @param rssi RSSI of the packet in dBm
+ * @param crc_ok CRC status of the packet given by the radio
+ * @param rtc_ticks Arrival time in ticks of a 32768 Hz counter, only the
+ *  difference between consecutive packets is used and can wrap at 24 bits
+ */
+void rf_bench_stats_add (const uint8_t * p_buf, uint32_t len, int8_t rssi,
+        bool crc_ok, uint32_t rtc_ticks);
+
+/**
+ * @brief Function to get the statistics of the ongoing run
+ * @param p_stats Pointer where the statistics are to be stored
+ */
+void rf_bench_stats_get (rf_bench_stats_t * p_stats);
+
+#endif /* CODEBASE_PERIPHERAL_MODULES_RF_BENCH_H_ */
+/**
+ * @}
+ * @}
+ */
@@ -19,11 +19,200 @@
 #include "simple_adc.h"
 #include "common_util.h"
 #include "hal_pin_analog_input.h"
+#if SIMPLE_ADC_ASYNC == 1
+#include "nrf_util.h"
+#endif
+
+#if ISR_MANAGER == 1
+#include "isr_manager.h"
+#endif
 
 int16_t saadc_result[1];
 
+#if SIMPLE_ADC_ASYNC == 1
+/** Requests being converted or waiting, from tail to head */
+static const simple_adc_req_t * queue[SIMPLE_ADC_QUEUE_LEN];
+static volatile uint32_t queue_head;
+static volatile uint32_t queue_tail;
+
+/** Results of the request being converted */
+static int16_t batch_result[SIMPLE_ADC_MAX_BATCH];
+
+/** Set while the SAADC is enabled for the requests */
+static volatile bool is_converting = false;
+/** Set while a blocking conversion is done, the requests then only wait */
+static volatile bool is_blocked = false;
+#endif
+
+static void channel_config (uint32_t ch, simple_adc_gain_t gain,
+        simple_adc_input_t pin)
+{
+    NRF_SAADC->CH[ch].PSELP = pin;
+    NRF_SAADC->CH[ch].PSELN = SAADC_CH_PSELN_PSELN_NC;
+
+    NRF_SAADC->CH[ch].CONFIG = ((SAADC_CH_CONFIG_RESP_Bypass << SAADC_CH_CONFIG_RESP_Pos)
+            & SAADC_CH_CONFIG_RESP_Msk)
+            | ((SAADC_CH_CONFIG_RESN_Bypass << SAADC_CH_CONFIG_RESN_Pos) & SAADC_CH_CONFIG_RESN_Msk)
+            | ((gain << SAADC_CH_CONFIG_GAIN_Pos) & SAADC_CH_CONFIG_GAIN_Msk)
+            | ((SAADC_CH_CONFIG_REFSEL_Internal << SAADC_CH_CONFIG_REFSEL_Pos)
+                    & SAADC_CH_CONFIG_REFSEL_Msk)
+            | ((SAADC_CH_CONFIG_TACQ_10us << SAADC_CH_CONFIG_TACQ_Pos) & SAADC_CH_CONFIG_TACQ_Msk)
+            | ((SAADC_CH_CONFIG_MODE_SE << SAADC_CH_CONFIG_MODE_Pos) & SAADC_CH_CONFIG_MODE_Msk)
+            | ((SAADC_CH_CONFIG_BURST_Disabled << SAADC_CH_CONFIG_BURST_Pos)
+                    & SAADC_CH_CONFIG_BURST_Msk);
+}
+
+#if SIMPLE_ADC_ASYNC == 1
+/** Configure the channels of the request at the tail and start the SAADC */
+static void batch_start (void)
+{
+    const simple_adc_req_t * p_req = queue[queue_tail % SIMPLE_ADC_QUEUE_LEN];
+
+    //All the channels with an input are converted by the sample task
+    for(uint32_t i = 0; i < SIMPLE_ADC_MAX_BATCH; i++)
+    {
+        if(i < p_req->input_cnt)
+        {
+            channel_config (SIMPLE_ADC_CHANNEL_USED + i,
+                    p_req->p_inputs[i].gain, p_req->p_inputs[i].pin);
+        }
+        else
+        {
+            NRF_SAADC->CH[SIMPLE_ADC_CHANNEL_USED + i].PSELP = SAADC_CH_PSELP_PSELP_NC;
+        }
+    }
+    NRF_SAADC->RESULT.PTR = (uint32_t) batch_result;
+    NRF_SAADC->RESULT.MAXCNT = p_req->input_cnt;
+
+    NRF_SAADC->EVENTS_END = 0;
+    NRF_SAADC->EVENTS_STARTED = 0;
+    //The sample task is started by PPI once the SAADC is started
+    NRF_SAADC->TASKS_START = 1;
+}
+
+/** Enable the SAADC for the requests and start the one at the tail */
+static void async_start (void)
+{
+    is_converting = true;
+
+    NRF_SAADC->INTENCLR = 0xFFFFFFFF;
+    NRF_SAADC->INTENSET = SAADC_INTENSET_END_Msk;
+    NVIC_ClearPendingIRQ(SAADC_IRQn);
+    NVIC_EnableIRQ(SAADC_IRQn);
+
+    NRF_PPI->CH[PPI_CH_USED_SIMPLE_ADC].EEP = (uint32_t) &(NRF_SAADC->EVENTS_STARTED);
+    NRF_PPI->CH[PPI_CH_USED_SIMPLE_ADC].TEP = (uint32_t) &(NRF_SAADC->TASKS_SAMPLE);
+    NRF_PPI->CHENSET = 1 << PPI_CH_USED_SIMPLE_ADC;
+
+    NRF_SAADC->RESOLUTION = SAADC_RESOLUTION_VAL_12bit << SAADC_RESOLUTION_VAL_Pos;
+    NRF_SAADC->ENABLE = SAADC_ENABLE_ENABLE_Enabled << SAADC_ENABLE_ENABLE_Pos;
+
+    batch_start ();
+}
+
+static void async_stop (void)
+{
+    NRF_SAADC->TASKS_STOP = 1;
+    NRF_SAADC->INTENCLR = 0xFFFFFFFF;
+    NRF_PPI->CHENCLR = 1 << PPI_CH_USED_SIMPLE_ADC;
+
+    NRF_SAADC->ENABLE = (SAADC_ENABLE_ENABLE_Disabled << SAADC_ENABLE_ENABLE_Pos);
+    for(uint32_t i = 0; i < SIMPLE_ADC_MAX_BATCH; i++)
+    {
+        NRF_SAADC->CH[SIMPLE_ADC_CHANNEL_USED + i].PSELP = SAADC_CH_PSELP_PSELP_NC;
+    }
+
+    is_converting = false;
+}
+
+#if ISR_MANAGER == 1
+void simple_adc_saadc_Handler (void)
+#else
+void SAADC_IRQHandler (void)
+#endif
+{
+    const simple_adc_req_t * p_req;
+    uint32_t vals[SIMPLE_ADC_MAX_BATCH];
+
+    if((is_converting == false) || (NRF_SAADC->EVENTS_END == 0))
+    {
+        return;
+    }
+    NRF_SAADC->EVENTS_END = 0;
+    (void) NRF_SAADC->EVENTS_END;
+
+    p_req = queue[queue_tail % SIMPLE_ADC_QUEUE_LEN];
+    for(uint32_t i = 0; i < p_req->input_cnt; i++)
+    {
+        //Values close to 0 V can be converted as negative
+        vals[i] = (batch_result[i] < 0) ? 0 : (uint32_t) batch_result[i];
+    }
+
+    //The next request is started before the handler, which can add more
+    CRITICAL_REGION_ENTER();
+    queue_tail++;
+    if((queue_head != queue_tail) && (is_blocked == false))
+    {
+        batch_start ();
+    }
+    else
+    {
+        async_stop ();
+    }
+    CRITICAL_REGION_EXIT();
+
+    p_req->handler (vals, p_req->input_cnt);
+}
+
+void simple_adc_async_init (uint32_t irq_priority)
+{
+    queue_head = 0;
+    queue_tail = 0;
+    is_converting = false;
+    is_blocked = false;
+    NVIC_SetPriority(SAADC_IRQn, irq_priority);
+}
+
+bool simple_adc_request (const simple_adc_req_t * p_req)
+{
+    bool is_queued = false;
+
+    if((p_req->input_cnt == 0) || (p_req->input_cnt > SIMPLE_ADC_MAX_BATCH))
+    {
+        return false;
+    }
+
+    CRITICAL_REGION_ENTER();
+    if((queue_head - queue_tail) < SIMPLE_ADC_QUEUE_LEN)
+    {
+        queue[queue_head % SIMPLE_ADC_QUEUE_LEN] = p_req;
+        queue_head++;
+        is_queued = true;
+        if((is_converting == false) && (is_blocked == false))
+        {
+            async_start ();
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    return is_queued;
+}
+
+bool simple_adc_is_busy (void)
+{
+    return (queue_head != queue_tail);
+}
+#endif
+
 uint32_t simple_adc_get_value(simple_adc_gain_t gain, simple_adc_input_t pin)
 {
+#if SIMPLE_ADC_ASYNC == 1
+    //Requests made from now wait till this conversion is done, the one being
+    //converted is let to finish from the SAADC interrupt
+    is_blocked = true;
+    while(is_converting);
+#endif
+
     NVIC_ClearPendingIRQ(SAADC_IRQn);
     NVIC_DisableIRQ(SAADC_IRQn);
 
@@ -39,19 +228,7 @@ uint32_t simple_adc_get_value(simple_adc_gain_t gain, simple_adc_input_t pin)
     NRF_SAADC->RESULT.PTR = (uint32_t) saadc_result;
     NRF_SAADC->RESULT.MAXCNT = 1;
 
-    NRF_SAADC->CH[SIMPLE_ADC_CHANNEL_USED].PSELP = pin;
-    NRF_SAADC->CH[SIMPLE_ADC_CHANNEL_USED].PSELN = SAADC_CH_PSELN_PSELN_NC;
-
-    NRF_SAADC->CH[SIMPLE_ADC_CHANNEL_USED].CONFIG = ((SAADC_CH_CONFIG_RESP_Bypass << SAADC_CH_CONFIG_RESP_Pos)
-            & SAADC_CH_CONFIG_RESP_Msk)
-            | ((SAADC_CH_CONFIG_RESN_Bypass << SAADC_CH_CONFIG_RESN_Pos) & SAADC_CH_CONFIG_RESN_Msk)
-            | ((gain << SAADC_CH_CONFIG_GAIN_Pos) & SAADC_CH_CONFIG_GAIN_Msk)
-            | ((SAADC_CH_CONFIG_REFSEL_Internal << SAADC_CH_CONFIG_REFSEL_Pos)
-                    & SAADC_CH_CONFIG_REFSEL_Msk)
-            | ((SAADC_CH_CONFIG_TACQ_10us << SAADC_CH_CONFIG_TACQ_Pos) & SAADC_CH_CONFIG_TACQ_Msk)
-            | ((SAADC_CH_CONFIG_MODE_SE << SAADC_CH_CONFIG_MODE_Pos) & SAADC_CH_CONFIG_MODE_Msk)
-            | ((SAADC_CH_CONFIG_BURST_Disabled << SAADC_CH_CONFIG_BURST_Pos)
-                    & SAADC_CH_CONFIG_BURST_Msk);
+    channel_config (SIMPLE_ADC_CHANNEL_USED, gain, pin);
 
     NRF_SAADC->ENABLE = SAADC_ENABLE_ENABLE_Enabled << SAADC_ENABLE_ENABLE_Pos;
 
@@ -78,6 +255,16 @@ uint32_t simple_adc_get_value(simple_adc_gain_t gain, simple_adc_input_t pin)
     NRF_SAADC->ENABLE = (SAADC_ENABLE_ENABLE_Disabled << SAADC_ENABLE_ENABLE_Pos);
     NRF_SAADC->CH[SIMPLE_ADC_CHANNEL_USED].PSELP = SAADC_CH_PSELP_PSELP_NC;
 
+#if SIMPLE_ADC_ASYNC == 1
+    CRITICAL_REGION_ENTER();
+    is_blocked = false;
+    if(queue_head != queue_tail)
+    {
+        async_start ();
+    }
+    CRITICAL_REGION_EXIT();
+#endif
+
     return  (uint32_t) saadc_result[0];
 }
 
@@ -28,10 +28,22 @@
  *  12 bit resolution, internal reference of 0.6 V, single ended conversion, input impedance
  *  of upto 100k Ohm and a blocking class for the conversion period of 12 us.
  *
+ * When SIMPLE_ADC_ASYNC is defined as 1 the conversions can also be requested
+ *  with @ref simple_adc_request, which returns right away and gives the values
+ *  to a handler from the SAADC interrupt. A request converts up to
+ *  @ref SIMPLE_ADC_MAX_BATCH inputs with one sample task, on the SAADC
+ *  channels from @ref SIMPLE_ADC_CHANNEL_USED onwards. The requests made while
+ *  one is being converted are queued and are done back to back, so the SAADC
+ *  is enabled once for all of them. The sample task is started by PPI when
+ *  the SAADC is started, so there is no wait in the CPU. The SAADC interrupt
+ *  is then owned by this module, so it cannot be used along with another
+ *  module that uses it, such as the PIR sense module.
+ *
  * @{
  */
 
 #include "stdint.h"
+#include "stdbool.h"
 #include "nrf.h"
 
 #if SYS_CFG_PRESENT == 1
@@ -46,6 +58,22 @@
 #ifndef SIMPLE_ADC_CHANNEL_USED 
 #define SIMPLE_ADC_CHANNEL_USED    SAADC_CHANNEL_USED_SIMPLE_ADC
 #endif
+
+#ifndef PPI_CH_USED_SIMPLE_ADC
+/** PPI channel to start the sampling once the SAADC is started */
+#define PPI_CH_USED_SIMPLE_ADC     7
+#endif
+
+#ifndef SIMPLE_ADC_QUEUE_LEN
+/** Number of requests which can wait while another is converted */
+#define SIMPLE_ADC_QUEUE_LEN       4
+#endif
+
+/** Number of channels of the SAADC */
+#define SIMPLE_ADC_SAADC_CHANNELS  8
+
+/** Maximum number of inputs converted together in a request */
+#define SIMPLE_ADC_MAX_BATCH       (SIMPLE_ADC_SAADC_CHANNELS - SIMPLE_ADC_CHANNEL_USED)
 /**
  * @brief Input selection for the analog-to-digital converter.
  */
@@ -80,6 +108,9 @@ typedef enum
 /**
  * @brief This function initializes the SAADC peripheral, gets an ADC value and then deinitializes
  *  The function blocks for about 13 us for the ADC sampling to occur.
+ *  When SIMPLE_ADC_ASYNC is 1 it also waits for the request being converted,
+ *  so then it must not be called at or above the priority of the SAADC
+ *  interrupt while @ref simple_adc_is_busy is true.
  * @param gain The gain applied to the analog input to the ADC unit
  * @param pin The pin at which the analog sample needs to be converted to digital
  * @warning There are only a few pins that can be used with the ADC peripheral,
@@ -88,6 +119,52 @@ typedef enum
  */
 uint32_t simple_adc_get_value(simple_adc_gain_t gain, simple_adc_input_t pin);
 
+#if SIMPLE_ADC_ASYNC == 1
+/** An input to be converted in a request */
+typedef struct
+{
+    /** The gain applied to the analog input */
+    simple_adc_gain_t gain;
+    /** The pin at which the analog input is to be converted */
+    simple_adc_input_t pin;
+}simple_adc_input_cfg_t;
+
+/** A request to convert a number of inputs together */
+typedef struct
+{
+    /** Pointer to the inputs to be converted */
+    const simple_adc_input_cfg_t * p_inputs;
+    /** Number of inputs, up to @ref SIMPLE_ADC_MAX_BATCH */
+    uint32_t input_cnt;
+    /** Handler called from the SAADC interrupt with the converted values
+     *  in the order of the inputs */
+    void (* handler) (const uint32_t * p_vals, uint32_t cnt);
+}simple_adc_req_t;
+
+/**
+ * @brief Function to initialize the requests of conversions
+ * @param irq_priority Priority of the SAADC interrupt from which the
+ *  handlers of the requests are called
+ */
+void simple_adc_async_init (uint32_t irq_priority);
+
+/**
+ * @brief Function to request the conversion of a number of inputs. Can be
+ *  called from an interrupt handler, including the handler of a request.
+ * @param p_req Pointer to the request, which must not change till its
+ *  handler is called
+ * @return True if the request is started or queued, false if the queue is
+ *  full or the request has no inputs or too many
+ */
+bool simple_adc_request (const simple_adc_req_t * p_req);
+
+/**
+ * @brief Function to know if a request is being converted or is queued
+ * @return True if the SAADC is in use by the requests
+ */
+bool simple_adc_is_busy (void);
+#endif
+
 #endif /* CODEBASE_PERIPHERAL_MODULES_SIMPLE_ADC_H_ */
 
 /**
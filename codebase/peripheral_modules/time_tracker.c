@@ -17,63 +17,197 @@
  */
 
 #include "time_tracker.h"
+#include "hal_clocks.h"
 #include "string.h"
 
+#define PPB_SCALE 1000000000LL
 
-#define DAY_TICK_LENGTH (24 * 3600 * MS_TIMER_TICKS_MS(1000))
-
-#define NO_OF_MONTHS 12
+/** Days from 0000-03-01 to 1970-01-01 in the proleptic Gregorian calendar */
+#define DAYS_TO_EPOCH 719468
+/** Days in an era of 400 years, after which the calendar repeats */
+#define DAYS_PER_ERA 146097
 
+/** Entry of the time log of older firmware */
 typedef struct
 {
+    /** Ticks since the start of the day */
     uint32_t log_time;
     time_tracker_ddmmyy_t log_date;
-}date_time_log_t;
+}old_date_time_log_t;
 
-static uint32_t last_date[] = {0xff, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+/** Entry of the time log */
+typedef struct
+{
+    /** Seconds since the epoch */
+    uint32_t epoch_s;
+    /** Estimated drift of the LF clock in ppb */
+    int32_t drift_ppb;
+}time_log_entry_t;
 
-static date_time_log_t date_time;
+/** Seconds since the epoch */
+static uint32_t epoch_s;
+/** Ticks kept which are less than a second */
+static uint32_t rem_ticks;
+
+/** Date of the time kept, found when it is asked for */
+static time_tracker_ddmmyy_t current_date;
 
 static uint32_t log_id;
 
-void update_date ()
+/** Estimated drift of the LF clock in ppb, positive if fast */
+static int32_t drift_ppb;
+/** Product of ticks and ppb of the correction which is less than a tick */
+static int64_t drift_frac;
+/** Ticks kept since the time was last set */
+static uint64_t ticks_since_set;
+/** Ticks kept since the LF RC oscillator was last calibrated */
+static uint32_t ticks_since_cal;
+/** The HF crystal is requested for a calibration which is not yet done */
+static volatile bool is_cal_ongoing;
+/** The LF clock is from the RC oscillator, as far as known */
+static volatile bool is_lfclk_rc;
+
+/* The conversions between dates and days count from March, so that the
+ * leap day is the last day of a year. A year is then 5 months of 153 days
+ * and the rest, with the months in a year laid out by (153*m + 2)/5. */
+
+uint32_t time_tracker_days_from_date (uint32_t year, uint32_t month, uint32_t day)
 {
-    //check if it's a last day of year
-    if(date_time.log_date.mm == NO_OF_MONTHS &&
-       date_time.log_date.dd == last_date[NO_OF_MONTHS])
+    uint32_t era, yoe, doy, doe;
+
+    year -= (month <= 2);
+    era = year/400;
+    yoe = year - era*400;
+    doy = (153*(month + ((month > 2) ? -3 : 9)) + 2)/5 + day - 1;
+    doe = yoe*365 + yoe/4 - yoe/100 + doy;
+    return era*DAYS_PER_ERA + doe - DAYS_TO_EPOCH;
+}
+
+void time_tracker_date_from_days (uint32_t days, uint32_t * p_year,
+        uint32_t * p_month, uint32_t * p_day)
+{
+    uint32_t z = days + DAYS_TO_EPOCH;
+    uint32_t era = z/DAYS_PER_ERA;
+    uint32_t doe = z - era*DAYS_PER_ERA;
+    uint32_t yoe = (doe - doe/1460 + doe/36524 - doe/(DAYS_PER_ERA - 1))/365;
+    uint32_t doy = doe - (365*yoe + yoe/4 - yoe/100);
+    uint32_t mp = (5*doy + 2)/153;
+
+    *p_day = doy - (153*mp + 2)/5 + 1;
+    *p_month = (mp < 10) ? (mp + 3) : (mp - 9);
+    *p_year = yoe + era*400 + (*p_month <= 2);
+}
+
+/** Add the current time and drift to the time log */
+static void log_feed (void)
+{
+    time_log_entry_t entry =
     {
-    //update year, and check if updated year is leap year
-        date_time.log_date.yy++;
-    //if it's leap year, make feb's last date 29
-        last_date[2] = (date_time.log_date.yy%4 == 0) ? 29 : 28;
-    //set date 01/01/updated year
-        date_time.log_date.dd = 1;
-        date_time.log_date.mm = 1;
-        return;        
+        .epoch_s = epoch_s,
+        .drift_ppb = drift_ppb,
+    };
+    nvm_logger_feed_data (log_id, &entry);
+}
+
+/** Handler of the request of the HF crystal, which starts the calibration */
+static void cal_xtal_ready (void)
+{
+    //The crystal is running, so this fails only if the LF clock is not RC
+    if(lfclk_rc_calibration_start () == false)
+    {
+        is_lfclk_rc = false;
+        is_cal_ongoing = false;
+        hfclk_xtal_release (HFCLK_XTAL_USER_TIME_TRACKER);
+    }
+}
+
+/** Calibrate the LF RC oscillator every @ref TIME_TRACKER_LFRC_CAL_INTERVAL_S,
+ *  with the HF crystal requested till the calibration is found done */
+static void cal_update (uint32_t ticks)
+{
+    if(is_cal_ongoing)
+    {
+        if(lfclk_rc_calibration_is_done ())
+        {
+            is_cal_ongoing = false;
+            hfclk_xtal_release (HFCLK_XTAL_USER_TIME_TRACKER);
+        }
+        return;
     }
+    if(is_lfclk_rc == false)
+    {
+        return;
+    }
+    ticks_since_cal += ticks;
+    if(ticks_since_cal >= MS_TIMER_TICKS_MS(TIME_TRACKER_LFRC_CAL_INTERVAL_S*1000))
+    {
+        ticks_since_cal = 0;
+        is_cal_ongoing = true;
+        hfclk_xtal_request (HFCLK_XTAL_USER_TIME_TRACKER, cal_xtal_ready);
+    }
+}
+
+/** Update the estimate of the drift from the time kept and the time set */
+static void drift_update (uint64_t kept_ticks, uint64_t set_ticks)
+{
+    int64_t residual = (int64_t) kept_ticks - (int64_t) set_ticks;
 
-    //check if it's a last day of on going month
-    if(date_time.log_date.dd == last_date[date_time.log_date.mm])
+    if(ticks_since_set < MS_TIMER_TICKS_MS(TIME_TRACKER_DRIFT_MIN_INTERVAL_S*1000ULL))
     {
-    //if it is, update month
-        date_time.log_date.mm++;
-    //set date 01/update month/running year
-        date_time.log_date.dd = 1;
         return;
     }
-    
-    //update date
-    date_time.log_date.dd++;
-    return;    
+    //A change larger than the largest drift is a new time, not a drift
+    if((uint64_t) ((residual < 0) ? -residual : residual) >
+            (ticks_since_set*TIME_TRACKER_DRIFT_MAX_PPB)/PPB_SCALE)
+    {
+        return;
+    }
+    //The drift left after the correction so far, in ppb of the raw ticks
+    residual = (residual*PPB_SCALE)/(int64_t) ticks_since_set;
+    //After the first estimate half of it is taken, so that an error in the
+    //time set is smoothed out
+    residual = (drift_ppb == 0) ? residual : (drift_ppb + residual/2);
+    drift_ppb = (residual > TIME_TRACKER_DRIFT_MAX_PPB) ? TIME_TRACKER_DRIFT_MAX_PPB :
+        ((residual < -TIME_TRACKER_DRIFT_MAX_PPB) ? -TIME_TRACKER_DRIFT_MAX_PPB :
+        (int32_t) residual);
+}
+
+/** Release the time log of older firmware, if present, and get its last time */
+static uint32_t old_log_release (void)
+{
+    old_date_time_log_t old_entry;
+    uint32_t old_id = nvm_logger_get_log_at_page (TIME_TRACKER_OLD_NVM_PAGE_USED_0);
+    uint32_t old_epoch_s = TIME_TRACKER_TIME_NOT_SET;
+
+    if((old_id >= NVM_LOGGER_MAX_LOGS) ||
+       (nvm_logger_get_entry_size (old_id) != sizeof(old_date_time_log_t)))
+    {
+        return TIME_TRACKER_TIME_NOT_SET;
+    }
+    if(nvm_logger_is_log_empty (old_id) == false)
+    {
+        nvm_logger_fetch_tail_data (old_id, &old_entry, 1);
+        if(old_entry.log_time != TIME_TRACKER_TIME_NOT_SET)
+        {
+            old_epoch_s = time_tracker_days_from_date (
+                TIME_TRACKER_YEAR_BASE + old_entry.log_date.yy,
+                old_entry.log_date.mm, old_entry.log_date.dd)*TIME_TRACKER_DAY_LEN_S
+                + old_entry.log_time/MS_TIMER_FREQ;
+        }
+    }
+    nvm_logger_release_log (old_id);
+    return old_epoch_s;
 }
 
 uint32_t time_tracker_init (uint32_t time_log)
 {
+    uint32_t old_epoch_s = old_log_release ();
+
     log_id = time_log;
     log_config_t log = 
     {
         .log_id = log_id,
-        .entry_size = sizeof(date_time_log_t),
+        .entry_size = sizeof(time_log_entry_t),
         .start_page = TIME_TRACKER_NVM_PAGE_USED_0,
         .no_of_pages = TIME_TRACKER_NVM_NO_PAGES_USED,
         
@@ -81,49 +215,113 @@ uint32_t time_tracker_init (uint32_t time_log)
     //check if log is available
     //if log is already being used check if it contains time track and fetch the
     log_id = nvm_logger_log_init (&log);
+    drift_ppb = 0;
     if(nvm_logger_is_log_empty (log_id) == false)
     {
-        //last entry from log to current time
-        nvm_logger_fetch_tail_data (log_id, &date_time, 1);
+        time_log_entry_t entry;
+        //last entry from log to current time and drift
+        nvm_logger_fetch_tail_data (log_id, &entry, 1);
+        epoch_s = entry.epoch_s;
+        drift_ppb = entry.drift_ppb;
+    }
+    else if(old_epoch_s != TIME_TRACKER_TIME_NOT_SET)
+    {
+        epoch_s = old_epoch_s;
+        log_feed ();
     }
     else
     {
-        date_time.log_time = TIME_TRACKER_TIME_NOT_SET;
+        epoch_s = TIME_TRACKER_TIME_NOT_SET;
+    }
+    rem_ticks = 0;
+    drift_frac = 0;
+    ticks_since_set = 0;
+    ticks_since_cal = 0;
+    if(is_cal_ongoing)
+    {
+        hfclk_xtal_release (HFCLK_XTAL_USER_TIME_TRACKER);
     }
+    is_cal_ongoing = false;
+    is_lfclk_rc = true;
     return log_id;
 }
 
+void time_tracker_set_epoch_s (uint32_t time_epoch_s)
+{
+    bool is_time_kept = (epoch_s != TIME_TRACKER_TIME_NOT_SET);
+    uint64_t kept_ticks = (uint64_t) epoch_s*MS_TIMER_FREQ + rem_ticks;
+
+    epoch_s = time_epoch_s;
+    rem_ticks = 0;
+    if(is_time_kept)
+    {
+        drift_update (kept_ticks, (uint64_t) epoch_s*MS_TIMER_FREQ);
+    }
+    ticks_since_set = 0;
+    drift_frac = 0;
+    log_feed ();
+}
+
 void time_tracker_set_date_time (time_tracker_ddmmyy_t * p_date_ddmmyy, uint32_t time_s)
 {
-    date_time.log_time = MS_TIMER_TICKS_MS(time_s * 1000);
-    memcpy(&date_time.log_date, p_date_ddmmyy, sizeof(time_tracker_ddmmyy_t));
-    nvm_logger_feed_data (log_id, &date_time);
-    last_date[2] = (date_time.log_date.yy%4 == 0) ? 29 : 28;
-    
+    time_tracker_set_epoch_s (time_tracker_days_from_date (
+            TIME_TRACKER_YEAR_BASE + p_date_ddmmyy->yy, p_date_ddmmyy->mm,
+            p_date_ddmmyy->dd)*TIME_TRACKER_DAY_LEN_S + time_s);
 }
 
 
 void time_tracker_update_time (uint32_t ticks)
 {
-    //update current time
-    date_time.log_time = (date_time.log_time + ticks);
-    if(date_time.log_time > DAY_TICK_LENGTH)
+    int64_t correction;
+
+    ticks_since_set += ticks;
+    cal_update (ticks);
+
+    //Whole ticks of the correction, the fraction is carried forward
+    drift_frac += (int64_t) ticks * drift_ppb;
+    correction = drift_frac/PPB_SCALE;
+    drift_frac -= correction*PPB_SCALE;
+    ticks = (uint32_t) ((int64_t) ticks - correction);
+
+    if(epoch_s == TIME_TRACKER_TIME_NOT_SET)
     {
-        update_date ();
-        date_time.log_time = date_time.log_time - DAY_TICK_LENGTH;
+        return;
     }
-    //add current date and time entry in time tracking log
-    nvm_logger_feed_data (log_id, &date_time);
+    //update current time, any number of days at once
+    rem_ticks += ticks;
+    epoch_s += rem_ticks/MS_TIMER_FREQ;
+    rem_ticks = rem_ticks % MS_TIMER_FREQ;
+    //add current date, time and drift entry in time tracking log
+    log_feed ();
 }
 
+uint32_t time_tracker_get_epoch_s ()
+{
+    return epoch_s;
+}
 
 uint32_t time_tracker_get_current_time_s ()
 {
-    return (date_time.log_time/MS_TIMER_FREQ);
+    if(epoch_s == TIME_TRACKER_TIME_NOT_SET)
+    {
+        return TIME_TRACKER_TIME_NOT_SET;
+    }
+    return (epoch_s % TIME_TRACKER_DAY_LEN_S);
 }
 
 time_tracker_ddmmyy_t * time_tracker_get_current_date ()
 {
-    return &date_time.log_date;
+    uint32_t year, month, day;
+
+    time_tracker_date_from_days (epoch_s/TIME_TRACKER_DAY_LEN_S,
+            &year, &month, &day);
+    current_date.dd = day;
+    current_date.mm = month;
+    current_date.yy = year - TIME_TRACKER_YEAR_BASE;
+    return &current_date;
 }
 
+int32_t time_tracker_get_drift_ppb ()
+{
+    return drift_ppb;
+}
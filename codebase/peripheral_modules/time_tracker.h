@@ -25,6 +25,27 @@
  * @defgroup group_time_tracker Time tracker module
  *
  * @brief Module to keep track of time in MS_TIMER ticks format. 
+ *
+ * The time is kept as the seconds since 1970-01-01 00:00 and the ticks of
+ *  the current second. The seconds and the estimated drift are the entry of
+ *  the time log, so that both are restored at init. The date is found from
+ *  the seconds in constant time with the full Gregorian calendar, so any
+ *  number of days can be added at once.
+ *
+ * Older firmware logged the ticks of the day and the date as 8 byte entries
+ *  on the pages from @ref NVM_LOG_PAGE0. This log is at other pages, and if
+ *  the old log is found at init, its last time is carried over to this log
+ *  and it is released.
+ *
+ * The error of the LF clock is corrected in two ways. When the LF clock is
+ *  from the RC oscillator, it is calibrated against the HF crystal
+ *  oscillator every @ref TIME_TRACKER_LFRC_CAL_INTERVAL_S. The crystal is
+ *  requested for it, the calibration started once the crystal runs and the
+ *  crystal released at the first update of the time after the calibration
+ *  is done. The drift left is estimated in ppb whenever the time is set, from
+ *  the difference of the time kept and the time set over the time since it
+ *  was last set, and the ticks added are corrected by it with the fraction
+ *  of a tick carried to the next update.
  * @{
  */
 
@@ -41,15 +62,42 @@
 #define TIME_TRACKER_NVM_NO_PAGES_USED 2
 #endif
 #ifndef TIME_TRACKER_NVM_PAGE_USED_0 
-#define TIME_TRACKER_NVM_PAGE_USED_0 NVM_LOG_PAGE0
+#define TIME_TRACKER_NVM_PAGE_USED_0 NVM_LOG_PAGE3
 #endif
 
 #ifndef TIME_TRACKER_NVM_PAGE_USED_1 
-#define TIME_TRACKER_NVM_PAGE_USED_1 NVM_LOG_PAGE1
+#define TIME_TRACKER_NVM_PAGE_USED_1 NVM_LOG_PAGE4
+#endif
+
+/** First page of the log of date and ticks of the day of older firmware */
+#define TIME_TRACKER_OLD_NVM_PAGE_USED_0 NVM_LOG_PAGE0
+
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+#ifndef TIME_TRACKER_LFRC_CAL_INTERVAL_S
+/** Interval in seconds of the calibration of the LF RC oscillator */
+#define TIME_TRACKER_LFRC_CAL_INTERVAL_S 600
 #endif
 
+#ifndef TIME_TRACKER_DRIFT_MIN_INTERVAL_S
+/** Shortest time between two settings of the time for the drift to be
+ *  estimated, so that the error of a second in the time set is small */
+#define TIME_TRACKER_DRIFT_MIN_INTERVAL_S (24 * 3600)
+#endif
+
+#ifndef TIME_TRACKER_DRIFT_MAX_PPB
+/** Largest drift which is corrected, in parts per billion */
+#define TIME_TRACKER_DRIFT_MAX_PPB 1000000
+#endif
+
+/** Value of the time and the entry of the log when the time is not set */
 #define TIME_TRACKER_TIME_NOT_SET 0xFFFFFFFF
 
+/** Year to which the two digit year of @ref time_tracker_ddmmyy_t is added */
+#define TIME_TRACKER_YEAR_BASE 2000
+
 #define TIME_TRACKER_DAY_LEN_S (24 * 3600 )
 
 typedef struct
@@ -75,15 +123,30 @@ uint32_t time_tracker_init (uint32_t time_log);
  */
 void time_tracker_set_date_time (time_tracker_ddmmyy_t * p_date_ddmmyy, uint32_t time_s);
 
+/**
+ * @brief Function to set current time
+ * @param time_epoch_s Seconds since 1970-01-01 00:00 in local time
+ */
+void time_tracker_set_epoch_s (uint32_t time_epoch_s);
+
 /**
  * @brief Function to update time
- * @param ticks MS Timer Ticks which has to be added current time
+ * @param ticks MS Timer Ticks which has to be added current time, which are
+ *  corrected by the estimated drift
  */
 void time_tracker_update_time (uint32_t ticks);
 
 /**
- * @brief Function to get current time in ms.
- * @return Last time entry in log.
+ * @brief Function to get current time
+ * @return Seconds since 1970-01-01 00:00, @ref TIME_TRACKER_TIME_NOT_SET if
+ *  the time is not set
+ */
+uint32_t time_tracker_get_epoch_s ();
+
+/**
+ * @brief Function to get current time of the day.
+ * @return Second of the day, @ref TIME_TRACKER_TIME_NOT_SET if the time is
+ *  not set
  */
 uint32_t time_tracker_get_current_time_s ();
 
@@ -94,6 +157,31 @@ uint32_t time_tracker_get_current_time_s ();
  */
 time_tracker_ddmmyy_t * time_tracker_get_current_date ();
 
+/**
+ * @brief Function to find the days since 1970-01-01 of a date
+ * @param year Year, from 1970
+ * @param month Month, 1 to 12
+ * @param day Day of the month, from 1
+ * @return Days since 1970-01-01
+ */
+uint32_t time_tracker_days_from_date (uint32_t year, uint32_t month, uint32_t day);
+
+/**
+ * @brief Function to find the date of a number of days since 1970-01-01
+ * @param days Days since 1970-01-01
+ * @param p_year Pointer where the year is stored
+ * @param p_month Pointer where the month, 1 to 12, is stored
+ * @param p_day Pointer where the day of the month, from 1, is stored
+ */
+void time_tracker_date_from_days (uint32_t days, uint32_t * p_year,
+        uint32_t * p_month, uint32_t * p_day);
+
+/**
+ * @brief Function to get the estimated drift of the LF clock
+ * @return The drift in parts per billion, positive if the clock is fast
+ */
+int32_t time_tracker_get_drift_ppb ();
+
 #endif /* CODEBASE_PERIPHERAL_MODULES_TIME_TRACKER_H_ */
 
 /**
@@ -0,0 +1,199 @@
+/**
+ *  trigger_log.c : Log of the camera triggers in flash
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "trigger_log.h"
+#include "nvm_logger.h"
+#include "ms_timer.h"
+#include "nrf_util.h"
+#include "string.h"
+#if defined(SOFTDEVICE_PRESENT)
+#include "nrf_sdm.h"
+#endif
+
+#define RTC_COUNTER_MASK    0xFFFFFF
+
+/** Entries waiting to be written, from tail to head */
+static trigger_log_entry_t queue[TRIGGER_LOG_QUEUE_LEN];
+static volatile uint32_t queue_head;
+static volatile uint32_t queue_tail;
+
+static trigger_log_summary_t summary;
+
+static uint32_t log_id;
+static bool is_log_ready = false;
+static volatile uint16_t next_seq;
+static volatile uint8_t battery_status;
+
+/** Seconds since reset till the RTC count of the time base */
+static volatile uint32_t base_s;
+/** Ticks of the time base which are less than a second */
+static volatile uint32_t base_rem_ticks;
+/** RTC count when the time base was last extended */
+static volatile uint32_t base_count;
+
+/** Ticks since the start of the second of the time base, for less than
+ *  one overflow of the RTC since the time base was extended */
+static uint32_t ticks_since_base (void)
+{
+    return base_rem_ticks +
+        ((ms_timer_get_current_count () - base_count) & RTC_COUNTER_MASK);
+}
+
+static bool is_sd_enabled (void)
+{
+#if defined(SOFTDEVICE_PRESENT)
+    uint8_t is_enabled;
+    (void) sd_softdevice_is_enabled (&is_enabled);
+    return (is_enabled != 0);
+#else
+    return false;
+#endif
+}
+
+uint32_t trigger_log_init (uint32_t id)
+{
+    log_config_t log =
+    {
+        .log_id = id,
+        .entry_size = sizeof(trigger_log_entry_t),
+        .start_page = TRIGGER_LOG_NVM_PAGE_USED_0,
+        .no_of_pages = TRIGGER_LOG_NVM_NO_PAGES_USED,
+    };
+
+    queue_head = 0;
+    queue_tail = 0;
+    memset (&summary, 0, sizeof(trigger_log_summary_t));
+    base_s = 0;
+    base_rem_ticks = 0;
+    base_count = ms_timer_get_current_count ();
+    next_seq = 0;
+
+    log_id = nvm_logger_log_init (&log);
+    is_log_ready = (log_id < NVM_LOGGER_MAX_LOGS);
+    if(is_log_ready && (nvm_logger_is_log_empty (log_id) == false))
+    {
+        trigger_log_entry_t last;
+
+        //The numbering continues from the last entry before the reset
+        nvm_logger_fetch_tail_data (log_id, &last, 1);
+        next_seq = last.seq + 1;
+    }
+    return log_id;
+}
+
+void trigger_log_add (trigger_log_src_t src, uint32_t mode, int32_t metric)
+{
+    uint32_t ticks;
+    trigger_log_entry_t * p_entry;
+
+    CRITICAL_REGION_ENTER();
+    ticks = ticks_since_base ();
+    summary.src_cnt[src]++;
+    summary.last_time_s = base_s + ticks/MS_TIMER_FREQ;
+
+    //Dropped entries still take a number, so that the gaps can be seen
+    if((queue_head - queue_tail) < TRIGGER_LOG_QUEUE_LEN)
+    {
+        p_entry = &queue[queue_head % TRIGGER_LOG_QUEUE_LEN];
+        p_entry->time_s = summary.last_time_s;
+        p_entry->sub_s = ((ticks % MS_TIMER_FREQ) << 8)/MS_TIMER_FREQ;
+        p_entry->seq = next_seq;
+        p_entry->src = src;
+        p_entry->mode = mode;
+        p_entry->metric = (metric > INT16_MAX) ? INT16_MAX :
+                ((metric < INT16_MIN) ? INT16_MIN : metric);
+        p_entry->battery = battery_status;
+        queue_head++;
+    }
+    else
+    {
+        summary.dropped++;
+    }
+    next_seq++;
+    CRITICAL_REGION_EXIT();
+}
+
+void trigger_log_set_battery (uint8_t battery)
+{
+    battery_status = battery;
+}
+
+void trigger_log_process (void)
+{
+    CRITICAL_REGION_ENTER();
+    {
+        uint32_t ticks = ticks_since_base ();
+
+        base_count = ms_timer_get_current_count ();
+        base_s += ticks/MS_TIMER_FREQ;
+        base_rem_ticks = ticks % MS_TIMER_FREQ;
+    }
+    CRITICAL_REGION_EXIT();
+
+    if((is_log_ready == false) || is_sd_enabled ())
+    {
+        return;
+    }
+
+    //Only this function removes entries, so the tail entry stays till written
+    while(queue_tail != queue_head)
+    {
+        nvm_logger_feed_data (log_id, &queue[queue_tail % TRIGGER_LOG_QUEUE_LEN]);
+        queue_tail++;
+        summary.written++;
+    }
+}
+
+const trigger_log_summary_t * trigger_log_summary_get (void)
+{
+    return &summary;
+}
+
+uint32_t trigger_log_size (void)
+{
+    if(is_log_ready == false)
+    {
+        return 0;
+    }
+    return nvm_logger_get_total_entries (log_id) * sizeof(trigger_log_entry_t);
+}
+
+uint32_t trigger_log_read (uint32_t offset, uint8_t * p_buf, uint32_t len)
+{
+    uint32_t total = trigger_log_size ()/sizeof(trigger_log_entry_t);
+    uint32_t copied = 0;
+
+    while(copied < len)
+    {
+        trigger_log_entry_t entry;
+        uint32_t entry_no = (offset + copied)/sizeof(trigger_log_entry_t);
+        uint32_t entry_offset = (offset + copied) % sizeof(trigger_log_entry_t);
+        uint32_t cnt = sizeof(trigger_log_entry_t) - entry_offset;
+
+        if(entry_no >= total)
+        {
+            break;
+        }
+        cnt = (cnt > (len - copied)) ? (len - copied) : cnt;
+        //The entries are fetched from the end of the log, the oldest is last
+        nvm_logger_fetch_tail_data (log_id, &entry, total - entry_no);
+        memcpy (&p_buf[copied], (uint8_t *) &entry + entry_offset, cnt);
+        copied += cnt;
+    }
+    return copied;
+}
@@ -0,0 +1,174 @@
+/**
+ *  trigger_log.h : Log of the camera triggers in flash
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup group_peripheral_modules
+ * @{
+ *
+ * @defgroup group_trigger_log Trigger log
+ *
+ * @brief Module to keep a log of the camera triggers in flash with the NVM
+ *  logger, along with counters of the triggers in RAM.
+ *
+ * A trigger is added from its handler with @ref trigger_log_add, which only
+ *  timestamps the entry and puts it in a queue in RAM, so that the trigger
+ *  path is not delayed by a flash write. The queue is written to flash by
+ *  @ref trigger_log_process from the main loop, and only while the SoftDevice
+ *  is disabled as it does not allow the flash to be written directly. When
+ *  the queue is full the later entries are dropped and counted.
+ *
+ * The timestamp is the time since reset from the RTC of the ms timer, which
+ *  is extended beyond its 24 bit counter by @ref trigger_log_process. So this
+ *  must be called at least once every overflow of the counter, 512 s when
+ *  @ref MS_TIMER_FREQ is 32768, which the device tick ensures. The module is
+ *  compiled in only when TRIGGER_LOG is defined as 1, else all the calls are
+ *  empty.
+ * @{
+ */
+
+#ifndef TRIGGER_LOG_H
+#define TRIGGER_LOG_H
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+#ifndef TRIGGER_LOG_NVM_PAGE_USED_0
+/** First flash page of the log, the pages after it are at lower addresses */
+#define TRIGGER_LOG_NVM_PAGE_USED_0     0x26000
+#endif
+
+#ifndef TRIGGER_LOG_NVM_NO_PAGES_USED
+/** Number of flash pages of the log */
+#define TRIGGER_LOG_NVM_NO_PAGES_USED   2
+#endif
+
+#ifndef TRIGGER_LOG_QUEUE_LEN
+/** Number of entries which can wait in RAM to be written to flash */
+#define TRIGGER_LOG_QUEUE_LEN           8
+#endif
+
+/** Sources of a trigger */
+typedef enum
+{
+    TRIGGER_LOG_SRC_PIR,        ///< Motion detected by the PIR sensor
+    TRIGGER_LOG_SRC_TIMER,      ///< Timer of the timelapse
+    TRIGGER_LOG_SRC_TSSP,       ///< Beam broken at the TSSP receiver
+    TRIGGER_LOG_SRC_RADIO,      ///< Trigger received from another unit
+    TRIGGER_LOG_SRC_MAX,        ///< Not a source, used to find the number of sources
+}trigger_log_src_t;
+
+/** An entry of the log as stored in flash */
+typedef struct
+{
+    /** Seconds since reset */
+    uint32_t time_s;
+    /** Number of the entry, continued across resets */
+    uint16_t seq;
+    /** Source of the trigger from @ref trigger_log_src_t */
+    uint8_t src;
+    /** Mode as per the application, the operational mode on SensePi and the
+     *  camera setup on SenseBe */
+    uint8_t mode;
+    /** Measure of the trigger as per the source, the ADC value for PIR */
+    int16_t metric;
+    /** Battery status as given to @ref trigger_log_set_battery */
+    uint8_t battery;
+    /** Fraction of the second in 1/256 s */
+    uint8_t sub_s;
+}__attribute__ ((packed)) trigger_log_entry_t;
+
+/** Counters of the triggers since reset */
+typedef struct
+{
+    /** Number of triggers of each source */
+    uint32_t src_cnt[TRIGGER_LOG_SRC_MAX];
+    /** Number of entries dropped as the queue was full */
+    uint32_t dropped;
+    /** Number of entries written to flash */
+    uint32_t written;
+    /** Time of the last trigger in seconds since reset */
+    uint32_t last_time_s;
+}trigger_log_summary_t;
+
+#if TRIGGER_LOG == 1
+/**
+ * @brief Function to initialize the log. The NVM logger module must be
+ *  initialized before this.
+ * @param log_id ID of the log in the NVM logger
+ * @return The ID of the log as given by the NVM logger
+ */
+uint32_t trigger_log_init (uint32_t log_id);
+
+/**
+ * @brief Function to add a trigger to the log. Can be called from an
+ *  interrupt handler.
+ * @param src Source of the trigger
+ * @param mode Mode of the trigger as per the application
+ * @param metric Measure of the trigger as per the source, 0 if none
+ */
+void trigger_log_add (trigger_log_src_t src, uint32_t mode, int32_t metric);
+
+/**
+ * @brief Function to set the battery status stored with the later entries
+ * @param battery The battery status
+ */
+void trigger_log_set_battery (uint8_t battery);
+
+/**
+ * @brief Function to extend the time base and to write the queued entries to
+ *  flash, to be called from the main loop
+ */
+void trigger_log_process (void);
+
+/**
+ * @brief Function to get the counters of the triggers
+ * @return Pointer to the counters
+ */
+const trigger_log_summary_t * trigger_log_summary_get (void);
+
+/**
+ * @brief Function to get the size of the log in flash
+ * @return The number of bytes of the entries in the log
+ */
+uint32_t trigger_log_size (void);
+
+/**
+ * @brief Function to read the log in flash as a stream of bytes of the
+ *  entries, oldest first
+ * @param offset Offset of the first byte to be read
+ * @param p_buf Pointer to the buffer where the bytes are copied
+ * @param len Number of bytes to be read
+ * @return Number of bytes copied, less than len at the end of the log
+ */
+uint32_t trigger_log_read (uint32_t offset, uint8_t * p_buf, uint32_t len);
+#else
+#define trigger_log_init(log_id)
+#define trigger_log_add(src, mode, metric)
+#define trigger_log_set_battery(battery)
+#define trigger_log_process()
+#endif
+
+#endif /* TRIGGER_LOG_H */
+/**
+ * @}
+ * @}
+ */
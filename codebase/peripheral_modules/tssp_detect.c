@@ -17,6 +17,7 @@
  */
 
 #include "tssp_detect.h"
+#include "tssp_ir_code.h"
 #include "hal_gpio.h"
 #include "common_util.h"
 #include "hal_clocks.h"
@@ -54,6 +55,18 @@
 /** Half of duration for which sensor will be enabled while detecting window */
 #define HALF_TSSP_ENABLE_DURATION TSSP_DETECT_TICKS_MS(2)
 
+/** Mask of the 24 bit counter of the RTC */
+#define RTC_TICKS_MASK 0x00FFFFFF
+/** Minimum ticks from the counter for a compare of the RTC to occur */
+#define RTC_MIN_CC_TICKS 2
+
+/** Delay of a pulse of the coded beam in a slot */
+#define CODE_SLOT_TICKS(slot) TSSP_DETECT_TICKS_US((slot)*TSSP_IR_CODE_SLOT_US)
+/** Largest delay of a pulse of the coded beam */
+#define CODE_SPAN_TICKS TSSP_DETECT_TICKS_US(TSSP_IR_CODE_SPAN_US)
+/** Allowed deviation of a pulse of the coded beam */
+#define CODE_MARGIN_TICKS ((int32_t) TSSP_DETECT_TICKS_US(TSSP_IR_CODE_MARGIN_US))
+
 
 #ifndef ENABLE
 #define ENABLE 1
@@ -83,6 +96,184 @@ void (*missed_handler)(void);
 /**Function pointer which is to be called if module detects the pulse*/
 void (*detect_handler)(uint32_t ticks);
 
+/** Window duration in RTC ticks */
+static uint32_t window_ticks;
+/** RTC count at the last pulse given to the detect handler */
+static uint32_t pulse_ticks;
+
+/** Following of the coded beam of the paired unit, as per @ref group_tssp_ir_code.
+ *  The RTC runs freely, the sensor is gated and the window restarted by the CPU. */
+static struct
+{
+    /** Unit ID of the coded beam, 0 for the plain beam */
+    uint32_t unit_id;
+    /** Window detection of the coded beam is on */
+    bool is_on;
+    /** Period of the ticks of the transmitter */
+    uint32_t period_ticks;
+    /** Time of the last pulse, or of its tick if it was missed */
+    uint32_t last_ticks;
+    /** Delays of the last pulses from the ticks of the first of them */
+    int32_t delays[TSSP_IR_CODE_PULSES];
+    /** Number of the last pulses in a row whose delays are kept */
+    uint32_t delay_cnt;
+    /** The codeword is seen and the slot of every next pulse is known */
+    bool is_locked;
+    /** Position in the codeword of the pulse expected */
+    uint32_t pulse_no;
+    /** Time at which the pulse is expected, once locked */
+    uint32_t expected_ticks;
+}code;
+
+/** Signed difference of two times of the RTC */
+static int32_t rtc_ticks_diff (uint32_t later, uint32_t earlier)
+{
+    return ((int32_t) ((later - earlier) << 8)) >> 8;
+}
+
+/** Enable the sensor from half_ticks before till half_ticks after a time,
+ *  right away if it is already due */
+static void code_gate_set (uint32_t center_ticks, uint32_t half_ticks)
+{
+    uint32_t on_ticks = center_ticks - half_ticks;
+    uint32_t off_ticks = center_ticks + half_ticks;
+
+    TSSP_DETECT_RTC_USED->EVENTS_COMPARE[SYNC_ON_RTC_CHANNEL] = 0;
+    TSSP_DETECT_RTC_USED->EVENTS_COMPARE[SYNC_OFF_RTC_CHANNEL] = 0;
+    if(rtc_ticks_diff (on_ticks, TSSP_DETECT_RTC_USED->COUNTER) < RTC_MIN_CC_TICKS)
+    {
+        //Enabling again at the end of the gate is harmless
+        hal_gpio_pin_write (tssp_en_pin, ENABLE);
+        on_ticks = off_ticks;
+    }
+    else
+    {
+        hal_gpio_pin_write (tssp_en_pin, DISABLE);
+    }
+    TSSP_DETECT_RTC_USED->CC[SYNC_ON_RTC_CHANNEL] = on_ticks & RTC_TICKS_MASK;
+    TSSP_DETECT_RTC_USED->CC[SYNC_OFF_RTC_CHANNEL] = off_ticks & RTC_TICKS_MASK;
+}
+
+/** Restart the window from a pulse of the beam */
+static void code_window_restart (uint32_t ticks)
+{
+    TSSP_DETECT_RTC_USED->EVENTS_COMPARE[WINDOW_RTC_CHANNEL] = 0;
+    TSSP_DETECT_RTC_USED->CC[WINDOW_RTC_CHANNEL] = (ticks + window_ticks) & RTC_TICKS_MASK;
+}
+
+/** Expect the pulse after the one of the position code.pulse_no at ticks */
+static void code_next_expect (uint32_t ticks)
+{
+    uint32_t slot = tssp_ir_code_slot (code.unit_id, code.pulse_no);
+
+    code.pulse_no = (code.pulse_no + 1) % TSSP_IR_CODE_PULSES;
+    code.expected_ticks = ticks - CODE_SLOT_TICKS(slot) + code.period_ticks
+        + CODE_SLOT_TICKS(tssp_ir_code_slot (code.unit_id, code.pulse_no));
+    code_gate_set (code.expected_ticks, HALF_TSSP_ENABLE_DURATION);
+}
+
+/** Find the position in the codeword of the last pulse if the delays of the
+ *  last pulses match the slots of the unit at one of the positions */
+static bool code_lock_find (uint32_t * p_pulse_no)
+{
+    for(uint32_t first = 0; first < TSSP_IR_CODE_PULSES; first++)
+    {
+        int32_t first_ticks = CODE_SLOT_TICKS(tssp_ir_code_slot (code.unit_id, first));
+        bool is_match = true;
+
+        for(uint32_t k = 1; (k < TSSP_IR_CODE_PULSES) && is_match; k++)
+        {
+            int32_t error = code.delays[k] + first_ticks - (int32_t) CODE_SLOT_TICKS(
+                tssp_ir_code_slot (code.unit_id, (first + k) % TSSP_IR_CODE_PULSES));
+            is_match = (error <= CODE_MARGIN_TICKS) && (error >= -CODE_MARGIN_TICKS);
+        }
+        if(is_match)
+        {
+            *p_pulse_no = (first + TSSP_IR_CODE_PULSES - 1) % TSSP_IR_CODE_PULSES;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Take a pulse of the coded beam. Till the codeword is seen, the window is
+ *  restarted only by the pulses of the first codeword, so that the beam of
+ *  another unit lets the window end. */
+static void code_pulse_handler (uint32_t ticks)
+{
+    if(code.is_locked)
+    {
+        int32_t error = rtc_ticks_diff (ticks, code.expected_ticks);
+
+        if((error > CODE_MARGIN_TICKS) || (error < -CODE_MARGIN_TICKS))
+        {
+            //Not from the paired unit, or sunlight
+            return;
+        }
+        code_next_expect (ticks);
+    }
+    else
+    {
+        int32_t delay = rtc_ticks_diff (ticks, code.last_ticks) - (int32_t) code.period_ticks;
+
+        if((code.delay_cnt == 0) || (delay > (int32_t) (CODE_SPAN_TICKS + CODE_MARGIN_TICKS))
+                || (delay < -(int32_t) (CODE_SPAN_TICKS + CODE_MARGIN_TICKS)))
+        {
+            code.delays[0] = 0;
+            code.delay_cnt = 1;
+        }
+        else
+        {
+            if(code.delay_cnt == TSSP_IR_CODE_PULSES)
+            {
+                //Drop the oldest pulse, the delays are from the ticks of the next
+                int32_t base = code.delays[1];
+                for(uint32_t k = 1; k < TSSP_IR_CODE_PULSES; k++)
+                {
+                    code.delays[k - 1] = code.delays[k] - base;
+                }
+                code.delay_cnt--;
+            }
+            code.delays[code.delay_cnt] = code.delays[code.delay_cnt - 1] + delay;
+            code.delay_cnt++;
+        }
+        code.last_ticks = ticks;
+
+        if((code.delay_cnt == TSSP_IR_CODE_PULSES) && code_lock_find (&code.pulse_no))
+        {
+            code.is_locked = true;
+            code_next_expect (ticks);
+        }
+        else
+        {
+            //The next pulse is delayed by up to the span more or less than this one
+            code_gate_set (ticks + code.period_ticks,
+                HALF_TSSP_ENABLE_DURATION + CODE_SPAN_TICKS);
+            if(code.delay_cnt == TSSP_IR_CODE_PULSES)
+            {
+                return;
+            }
+        }
+    }
+    code_window_restart (ticks);
+}
+
+/** Move on to the next tick of the transmitter when no pulse was taken in the gate */
+static void code_pulse_missed (void)
+{
+    if(code.is_locked)
+    {
+        code_next_expect (code.expected_ticks);
+    }
+    else
+    {
+        code.delay_cnt = 0;
+        code.last_ticks += code.period_ticks;
+        code_gate_set (code.last_ticks + code.period_ticks,
+            HALF_TSSP_ENABLE_DURATION + CODE_SPAN_TICKS);
+    }
+}
+
 void tssp_detect_init (tssp_detect_config_t * tssp_detect_config)
 {
     tssp_en_pin = tssp_detect_config->rx_en_pin;
@@ -96,7 +287,8 @@ void tssp_detect_init (tssp_detect_config_t * tssp_detect_config)
         is_window_detect_req = true;
         missed_handler = tssp_detect_config->tssp_missed_handler;
         TSSP_DETECT_RTC_USED->PRESCALER = ROUNDED_DIV(LFCLK_FREQ, TSSP_DETECT_FREQ) - 1;
-        TSSP_DETECT_RTC_USED->CC[WINDOW_RTC_CHANNEL] = TSSP_DETECT_TICKS_MS(tssp_detect_config->window_duration_ticks);
+        window_ticks = TSSP_DETECT_TICKS_MS(tssp_detect_config->window_duration_ticks);
+        TSSP_DETECT_RTC_USED->CC[WINDOW_RTC_CHANNEL] = window_ticks;
         TSSP_DETECT_RTC_USED->INTENSET |= ENABLE << (WINDOW_RTC_CHANNEL+16);
                     
         NRF_PPI->CH[PPI_CHANNEL_USED_RTC].EEP = (uint32_t) &NRF_GPIOTE->EVENTS_IN[GPIOTE_CHANNEL_USED];
@@ -107,12 +299,21 @@ void tssp_detect_init (tssp_detect_config_t * tssp_detect_config)
     {
         is_window_detect_req = false;
     }
+    code.unit_id = tssp_detect_config->code_unit_id & TSSP_IR_CODE_ID_MASK;
+    code.is_on = false;
     if(tssp_detect_config->tssp_detect_handler != NULL)
     {
         is_pulse_detect_req = true;
         
         detect_handler = tssp_detect_config->tssp_detect_handler;
-
+    }
+    else
+    {
+        is_pulse_detect_req = false;
+    }
+    //The pulses of the coded beam are taken by the CPU in window detection
+    if((tssp_detect_config->tssp_detect_handler != NULL) || (code.unit_id != 0))
+    {
         TSSP_DETECT_EGU_USED->INTENSET |= ENABLE << EGU_CHANNEL_USED;
         NVIC_SetPriority (SWI0_EGU0_IRQn, APP_IRQ_PRIORITY_HIGHEST);
         NVIC_EnableIRQ (SWI0_IRQn);
@@ -121,10 +322,6 @@ void tssp_detect_init (tssp_detect_config_t * tssp_detect_config)
         NRF_PPI->CH[PPI_CHANNEL_USED_EGU].EEP = (uint32_t) &NRF_GPIOTE->EVENTS_IN[GPIOTE_CHANNEL_USED];
         NRF_PPI->CH[PPI_CHANNEL_USED_EGU].TEP = (uint32_t) &TSSP_DETECT_EGU_USED->TASKS_TRIGGER[EGU_CHANNEL_USED];
     }
-    else
-    {
-        is_pulse_detect_req = false;
-    }
 
 }
 
@@ -135,7 +332,10 @@ void tssp_detect_window_detect ()
     
     
     TSSP_DETECT_RTC_USED->INTENSET |= ENABLE << (WINDOW_RTC_CHANNEL+16);
-    NRF_PPI->CHENSET |= 1 << PPI_CHANNEL_USED_RTC;
+    if(code.unit_id == 0)
+    {
+        NRF_PPI->CHENSET |= 1 << PPI_CHANNEL_USED_RTC;
+    }
 
     NRF_GPIOTE->EVENTS_IN[GPIOTE_CHANNEL_USED] = 0;
     
@@ -147,6 +347,19 @@ void tssp_detect_window_detect ()
 
     TSSP_DETECT_RTC_USED->EVENTS_COMPARE[WINDOW_RTC_CHANNEL] = 0;
     (void) TSSP_DETECT_RTC_USED->EVENTS_COMPARE[WINDOW_RTC_CHANNEL];
+
+    if((code.unit_id != 0) && (code.period_ticks != 0))
+    {
+        //Gated from the pulse of the synchronization, widened till the codeword is seen
+        code.is_on = true;
+        code.is_locked = false;
+        code.delays[0] = 0;
+        code.delay_cnt = 1;
+        code_gate_set (code.last_ticks + code.period_ticks,
+            HALF_TSSP_ENABLE_DURATION + CODE_SPAN_TICKS);
+        code_window_restart (code.last_ticks);
+        NRF_PPI->CHENSET |= 1 << PPI_CHANNEL_USED_EGU;
+    }
     
     TSSP_DETECT_RTC_USED->TASKS_START = 1;   
     NVIC_SetPriority (RTC0_IRQn, APP_IRQ_PRIORITY_HIGHEST);
@@ -182,6 +395,11 @@ void tssp_detect_window_stop (void)
 
         hal_gpio_pin_write (tssp_en_pin, DISABLE);
     }
+    if(code.is_on)
+    {
+        code.is_on = false;
+        NRF_PPI->CHENCLR |= 1 << PPI_CHANNEL_USED_EGU;
+    }
     TSSP_DETECT_RTC_USED->INTENCLR |= ENABLE << (WINDOW_RTC_CHANNEL+16) | 
                                       ENABLE << (SYNC_ON_RTC_CHANNEL+16) | 
                                       ENABLE << (SYNC_OFF_RTC_CHANNEL+16);
@@ -216,6 +434,15 @@ void tssp_detect_window_sync (uint32_t sync_ms)
     tssp_sync_ms = (sync_ms);
     
     uint32_t rtc_counter;
+    if(code.unit_id != 0)
+    {
+        //The gates are set once the window detection starts
+        code.period_ticks = sync_ms;
+        code.last_ticks = pulse_ticks;
+        TSSP_DETECT_RTC_USED->INTENSET |= ENABLE << (SYNC_ON_RTC_CHANNEL+16) |
+                                          ENABLE << (SYNC_OFF_RTC_CHANNEL+16);
+        return;
+    }
     rtc_counter = TSSP_DETECT_RTC_USED->COUNTER ;
     TSSP_DETECT_RTC_USED->CC[SYNC_ON_RTC_CHANNEL] =
         (rtc_counter + (tssp_sync_ms - HALF_TSSP_ENABLE_DURATION)) ;
@@ -240,8 +467,14 @@ void SWI0_IRQHandler ()
     TSSP_DETECT_EGU_USED->EVENTS_TRIGGERED[EGU_CHANNEL_USED] = 0;
     (void) TSSP_DETECT_EGU_USED->EVENTS_TRIGGERED[EGU_CHANNEL_USED];
 #endif
+    if(code.is_on)
+    {
+        code_pulse_handler (TSSP_DETECT_RTC_USED->COUNTER);
+        return;
+    }
     NRF_PPI->CHENCLR |= 1 << PPI_CHANNEL_USED_EGU;
-    detect_handler ( TSSP_DETECT_RTC_USED->COUNTER );
+    pulse_ticks = TSSP_DETECT_RTC_USED->COUNTER;
+    detect_handler (pulse_ticks);
 }
 
 #if ISR_MANAGER == 1
@@ -257,7 +490,10 @@ void RTC0_IRQHandler (void)
         (void) TSSP_DETECT_RTC_USED->EVENTS_COMPARE[SYNC_ON_RTC_CHANNEL];
 #endif
         hal_gpio_pin_write (tssp_en_pin, ENABLE);
-        TSSP_DETECT_RTC_USED->CC[SYNC_OFF_RTC_CHANNEL] = HALF_TSSP_ENABLE_DURATION;
+        if(code.is_on == false)
+        {
+            TSSP_DETECT_RTC_USED->CC[SYNC_OFF_RTC_CHANNEL] = HALF_TSSP_ENABLE_DURATION;
+        }
         
     }
     if(TSSP_DETECT_RTC_USED->EVENTS_COMPARE[SYNC_OFF_RTC_CHANNEL] == 1)
@@ -267,7 +503,14 @@ void RTC0_IRQHandler (void)
         (void) TSSP_DETECT_RTC_USED->EVENTS_COMPARE[SYNC_OFF_RTC_CHANNEL];
 #endif
         hal_gpio_pin_write (tssp_en_pin, DISABLE);
-        TSSP_DETECT_RTC_USED->CC[SYNC_ON_RTC_CHANNEL] = (tssp_sync_ms - HALF_TSSP_ENABLE_DURATION);
+        if(code.is_on)
+        {
+            code_pulse_missed ();
+        }
+        else
+        {
+            TSSP_DETECT_RTC_USED->CC[SYNC_ON_RTC_CHANNEL] = (tssp_sync_ms - HALF_TSSP_ENABLE_DURATION);
+        }
     }
     if(TSSP_DETECT_RTC_USED->EVENTS_COMPARE[WINDOW_RTC_CHANNEL] == 1)
     {
@@ -276,7 +519,15 @@ void RTC0_IRQHandler (void)
         (void) TSSP_DETECT_RTC_USED->EVENTS_COMPARE[WINDOW_RTC_CHANNEL];
 #endif
         missed_handler ();
-        TSSP_DETECT_RTC_USED->TASKS_CLEAR = 1;
-        (void) TSSP_DETECT_RTC_USED->TASKS_CLEAR;
+        if(code.is_on)
+        {
+            //The RTC keeps the times of the gates
+            code_window_restart (TSSP_DETECT_RTC_USED->COUNTER);
+        }
+        else
+        {
+            TSSP_DETECT_RTC_USED->TASKS_CLEAR = 1;
+            (void) TSSP_DETECT_RTC_USED->TASKS_CLEAR;
+        }
     }
 }
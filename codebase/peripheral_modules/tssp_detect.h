@@ -69,6 +69,9 @@
 /** Macro to find out the rounded number of TSSP_DETECT ticks for the passed time in milli-seconds */
 #define TSSP_DETECT_TICKS_MS(ms)                ((uint32_t) ROUNDED_DIV( (TSSP_DETECT_FREQ*(uint64_t)(ms)) , 1000) )
 
+/** Macro to find out the rounded number of TSSP_DETECT ticks for the passed time in micro-seconds */
+#define TSSP_DETECT_TICKS_US(us)                ((uint32_t) ROUNDED_DIV( (TSSP_DETECT_FREQ*(uint64_t)(us)) , 1000000) )
+
 
 /**
  * @brief Structure to store information required to use this module.
@@ -94,6 +97,11 @@ typedef struct
     /** Function pointer for a function which is to be called when a pulse is detected */
     void (*tssp_detect_handler) (uint32_t ticks);
 
+    /** Unit ID of the coded beam to be received as per @ref group_tssp_ir_code,
+     *  0 for the plain beam. With a coded beam only the pulses in the slots
+     *  of the unit restart the window once its codeword has been seen. */
+    uint32_t code_unit_id;
+
 }tssp_detect_config_t;
 
 /**
@@ -128,7 +136,9 @@ void tssp_detect_pulse_detect (void);
 
 /**
  * @brief Function to Synchronize TSSP detector to IR transmitter which is being used
- * @param sync_ms Synchronization time in ms
+ * @param sync_ms Synchronization time in TSSP_DETECT ticks, to be called from
+ *  the detect handler of a pulse. With a coded beam this is the period of the
+ *  ticks of the transmitter, as the pulses are delayed from them by their slots.
  */
 void tssp_detect_window_sync (uint32_t sync_ms);
 
@@ -0,0 +1,94 @@
+/**
+ *  tssp_ir_code.h : Codeword format shared by TSSP IR transmitter and detector
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup group_peripheral_modules
+ * @{
+ *
+ * @defgroup group_tssp_ir_code TSSP IR codeword format
+ *
+ * @brief Pulse position codeword of the coded beam of the TSSP IR
+ *  transmitter and detector.
+ *
+ * The beam keeps its single burst at every IR tick and a codeword is spread
+ *  over @ref TSSP_IR_CODE_PULSES consecutive bursts, one symbol per burst. A
+ *  burst is delayed from its tick by its slot times @ref TSSP_IR_CODE_SLOT_US.
+ *  The first burst of a codeword is in @ref TSSP_IR_CODE_START_SLOT, which no
+ *  other burst uses, and each of the others carries 2 bits in slot 0 to 3.
+ *  The 8 bits are the unit ID followed by its complement. So the bursts of
+ *  a unit are in a fixed order of slots, which the detector paired with it
+ *  follows burst by burst once it has seen a whole codeword.
+ * @{
+ */
+
+#ifndef TSSP_IR_CODE_H
+#define TSSP_IR_CODE_H
+
+#include "stdint.h"
+
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+/** Unit ID of the coded beam sent and received, 0 for the plain beam */
+#ifndef TSSP_IR_CODE_ID
+#define TSSP_IR_CODE_ID 0
+#endif
+
+/** Number of bits used for the unit ID */
+#define TSSP_IR_CODE_ID_BITS        4
+/** Mask of the valid unit IDs */
+#define TSSP_IR_CODE_ID_MASK        ((1 << TSSP_IR_CODE_ID_BITS) - 1)
+
+/** Delay of a burst for each slot in us */
+#define TSSP_IR_CODE_SLOT_US        500
+/** Slot of the first burst of a codeword */
+#define TSSP_IR_CODE_START_SLOT     4
+/** Number of bits carried by a burst after the first */
+#define TSSP_IR_CODE_SYMBOL_BITS    2
+/** Number of bursts in a codeword */
+#define TSSP_IR_CODE_PULSES         (1 + (2*TSSP_IR_CODE_ID_BITS)/TSSP_IR_CODE_SYMBOL_BITS)
+/** Largest delay of a burst from its tick in us */
+#define TSSP_IR_CODE_SPAN_US        (TSSP_IR_CODE_START_SLOT*TSSP_IR_CODE_SLOT_US)
+/** Allowed deviation of a received burst from its expected time in us */
+#define TSSP_IR_CODE_MARGIN_US      200
+
+/**
+ * @brief Function to find the slot of a burst of a codeword
+ * @param unit_id Unit ID of the transmitter, only lower @ref TSSP_IR_CODE_ID_BITS are used
+ * @param pulse_no Position of the burst in the codeword, from 0
+ * @return Slot of the burst
+ */
+static inline uint32_t tssp_ir_code_slot (uint32_t unit_id, uint32_t pulse_no)
+{
+    uint32_t word = ((unit_id & TSSP_IR_CODE_ID_MASK) << TSSP_IR_CODE_ID_BITS)
+        | (~unit_id & TSSP_IR_CODE_ID_MASK);
+
+    if(pulse_no == 0)
+    {
+        return TSSP_IR_CODE_START_SLOT;
+    }
+    return (word >> (TSSP_IR_CODE_SYMBOL_BITS*(TSSP_IR_CODE_PULSES - 1 - pulse_no)))
+        & ((1 << TSSP_IR_CODE_SYMBOL_BITS) - 1);
+}
+
+#endif /* TSSP_IR_CODE_H */
+/**
+ * @}
+ * @}
+ */
@@ -18,7 +18,9 @@
 
 #include "simple_pwm.h"
 #include "tssp_ir_tx.h"
+#include "tssp_ir_code.h"
 #include "hal_gpio.h"
+#include "hal_clocks.h"
 #include "common_util.h"
 #include "sys_config.h"
 #include "nrf_util.h"
@@ -37,16 +39,29 @@
 #define TIMER_56KHZ_GPIOTE_CHANNEL GPIOTE_CH_USED_TSSP_IR_TX_2
 
 #define TIMERS_CHANNEL_USED TIMER_CHANNEL_USED_TSSP_IR_TX_1_1
+/** Channel of the on time TIMER which starts the carrier of a coded burst */
+#define CODE_START_CHANNEL TIMER_CHANNEL_USED_TSSP_IR_TX_1_2
 
 #define PPI_56KHz_1 PPI_CH_USED_TSSP_IR_TX_1
 #define PPI_56KHz_2 PPI_CH_USED_TSSP_IR_TX_2
 #define PPI_xxKHz_1 PPI_CH_USED_TSSP_IR_TX_3
 #define PPI_xxKHz_2 PPI_CH_USED_TSSP_IR_TX_4
+/** PPI channel starting the carrier of a coded burst */
+#define PPI_CODE_START PPI_CH_USED_TSSP_IR_TX_3
+
+/** Number of on time TIMER ticks in a us */
+#define TIMER_TICKS_US 16
 
 static uint32_t tx_en;
 
 static uint32_t tx_in;
 
+/** Unit ID of the coded beam, 0 for the plain beam */
+static uint32_t code_unit_id;
+
+/** Position in the codeword of the next coded burst */
+static uint32_t code_pulse_no;
+
 void tssp_ir_tx_init (uint32_t tssp_tx_en, uint32_t tssp_tx_in)
 {
     tx_en = tssp_tx_en;
@@ -90,6 +105,9 @@ void tssp_ir_tx_init (uint32_t tssp_tx_en, uint32_t tssp_tx_in)
     TIMER_ID_1KHZ->BITMODE = TIMER_BITMODE_BITMODE_32Bit;
     TIMER_ID_1KHZ->CC[TIMERS_CHANNEL_USED] = 16000 * TSSP_IR_TX_ON_TIME_MS;
 
+    NRF_PPI->CH[PPI_CODE_START].EEP = (uint32_t) &(TIMER_ID_1KHZ->EVENTS_COMPARE[CODE_START_CHANNEL]);
+    NRF_PPI->CH[PPI_CODE_START].TEP = (uint32_t) &(TIMER_ID_56KHZ->TASKS_START);
+
 //    TIMER_ID_1KHZ->SHORTS |= TIMER_SHORTS_COMPARE0_CLEAR_Enabled
 //                            << TIMER_SHORTS_COMPARE0_CLEAR_Pos;
 //    TIMER_ID_1KHZ->SHORTS |= TIMER_SHORTS_COMPARE0_STOP_Enabled
@@ -130,6 +148,7 @@ void TIMER2_IRQHandler ()
     TIMER_ID_1KHZ->TASKS_STOP = 1;
     TIMER_ID_1KHZ->TASKS_SHUTDOWN = 1;
     TIMER_ID_56KHZ->TASKS_SHUTDOWN = 1;
+    hfclk_xtal_release (HFCLK_XTAL_USER_TSSP_IR_TX);
 }
 
 void tssp_ir_tx_timer2_Handler ()
@@ -137,9 +156,19 @@ void tssp_ir_tx_timer2_Handler ()
     
 }
 
-void tssp_ir_tx_start (void)
+/**
+ * @brief Function to start the burst once the HF crystal is running, as the
+ *  carrier is only as accurate as the HF clock the receiver is tuned to
+ */
+static void tssp_ir_tx_burst_start (void)
 {
     hal_gpio_pin_set (tx_en);
+    if(code_unit_id != 0)
+    {
+        //The carrier is started by the on time TIMER already running
+        return;
+    }
+    TIMER_ID_1KHZ->CC[TIMERS_CHANNEL_USED] = 16000 * TSSP_IR_TX_ON_TIME_MS;
     TIMER_ID_56KHZ->EVENTS_COMPARE[TIMERS_CHANNEL_USED] = 0;
     TIMER_ID_1KHZ->EVENTS_COMPARE[TIMERS_CHANNEL_USED] = 0;
     NRF_GPIOTE->TASKS_SET[ON_TIMER_GPIOTE_CHANNEL] = 1;
@@ -155,6 +184,52 @@ void tssp_ir_tx_start (void)
 
 }
 
+/**
+ * @brief Function to start the on time TIMER of a coded burst right away, so
+ *  that its delay is counted from the start of the transmission. The TIMER
+ *  runs from the HF crystal once it is running.
+ */
+static void tssp_ir_tx_code_burst_start (void)
+{
+    uint32_t delay = TIMER_TICKS_US*(TSSP_IR_TX_CODE_LEAD_US +
+        TSSP_IR_CODE_SLOT_US*tssp_ir_code_slot (code_unit_id, code_pulse_no));
+
+    code_pulse_no = (code_pulse_no + 1) % TSSP_IR_CODE_PULSES;
+
+    TIMER_ID_1KHZ->TASKS_CLEAR = 1;
+    TIMER_ID_1KHZ->CC[CODE_START_CHANNEL] = delay;
+    TIMER_ID_1KHZ->CC[TIMERS_CHANNEL_USED] = delay + 16000 * TSSP_IR_TX_ON_TIME_MS;
+    TIMER_ID_1KHZ->EVENTS_COMPARE[CODE_START_CHANNEL] = 0;
+    TIMER_ID_1KHZ->EVENTS_COMPARE[TIMERS_CHANNEL_USED] = 0;
+    TIMER_ID_56KHZ->EVENTS_COMPARE[TIMERS_CHANNEL_USED] = 0;
+    TIMER_ID_56KHZ->TASKS_CLEAR = 1;
+    TIMER_ID_1KHZ->INTENSET |= TIMER_INTENSET_COMPARE0_Msk;
+
+    NRF_PPI->CHENSET |= 1 << PPI_56KHz_1;
+    NRF_PPI->CHENSET |= 1 << PPI_56KHz_2;
+    NRF_PPI->CHENSET |= 1 << PPI_CODE_START;
+    TIMER_ID_1KHZ->TASKS_START = 1;
+}
+
+void tssp_ir_tx_start (void)
+{
+    if(code_unit_id != 0)
+    {
+        tssp_ir_tx_code_burst_start ();
+    }
+    hfclk_xtal_request (HFCLK_XTAL_USER_TSSP_IR_TX, tssp_ir_tx_burst_start);
+}
+
+void tssp_ir_tx_code_set (uint32_t unit_id)
+{
+    code_unit_id = unit_id & TSSP_IR_CODE_ID_MASK;
+    code_pulse_no = 0;
+    if(code_unit_id == 0)
+    {
+        NRF_PPI->CHENCLR |= 1 << PPI_CODE_START;
+    }
+}
+
 void tssp_ir_tx_stop (void)
 {
     TIMER_ID_1KHZ->TASKS_SHUTDOWN = 1;
@@ -164,7 +239,9 @@ void tssp_ir_tx_stop (void)
 //    NRF_PPI->CHENCLR |= 1 << PPI_xxKHz_2;
     NRF_PPI->CHENCLR |= 1 << PPI_56KHz_1;
     NRF_PPI->CHENCLR |= 1 << PPI_56KHz_2;
+    NRF_PPI->CHENCLR |= 1 << PPI_CODE_START;
     TIMER_ID_56KHZ->TASKS_STOP = 1;
 
     TIMER_ID_56KHZ->TASKS_SHUTDOWN = 1;
+    hfclk_xtal_release (HFCLK_XTAL_USER_TSSP_IR_TX);
 }
@@ -75,6 +75,10 @@ typedef enum
 #define TIMER_CHANNEL_USED_TSSP_IR_TX_1_1 0
 #endif
 
+#ifndef TIMER_CHANNEL_USED_TSSP_IR_TX_1_2 
+#define TIMER_CHANNEL_USED_TSSP_IR_TX_1_2 1
+#endif
+
 #ifndef TIMER_CHANNEL_USED_TSSP_IR_TX_2_1 
 #define TIMER_CHANNEL_USED_TSSP_IR_TX_2_1 0
 #endif
@@ -95,6 +99,14 @@ typedef enum
 #ifndef TSSP_IR_TX_ON_TIME_MS
 #define TSSP_IR_TX_ON_TIME_MS 1
 #endif
+
+/** Time from the start of a transmission to the slot 0 of a coded burst in
+ *  us, longer than the startup of the HF crystal so that the delay of the
+ *  burst does not depend on whether the crystal was already running */
+#ifndef TSSP_IR_TX_CODE_LEAD_US
+#define TSSP_IR_TX_CODE_LEAD_US 1000
+#endif
+
 /**
  * @brief Function to initiate the IR transmitter compatible with TSSP receiver.
  * @param tssp_tx_en Enable pin for IR transmitter circuitry. 
@@ -103,7 +115,8 @@ typedef enum
 void tssp_ir_tx_init (uint32_t tssp_tx_en, uint32_t tssp_tx_in);
 
 /**
- * @brief Function to start transmission.
+ * @brief Function to start transmission. The burst starts once the HF
+ *  crystal is running, right away if it already is.
  */
 void tssp_ir_tx_start (void);
 
@@ -112,4 +125,14 @@ void tssp_ir_tx_start (void);
  */
 void tssp_ir_tx_stop (void);
 
+/**
+ * @brief Function to select the coded beam, sent from the next transmission.
+ * @details Each transmission then sends the next burst of the codeword of
+ *  the unit, delayed from its start as per @ref group_tssp_ir_code. The
+ *  delay is timed by the TIMER used for the on time, which starts the 56 kHz
+ *  carrier over PPI.
+ * @param unit_id Unit ID sent, 0 for the plain beam
+ */
+void tssp_ir_tx_code_set (uint32_t unit_id);
+
 #endif /* TSSP_IR_TX_H */
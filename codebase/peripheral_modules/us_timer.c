@@ -18,6 +18,7 @@
 
 #include "us_timer.h"
 #include "nrf_util.h"
+#include "hal_clocks.h"
 #include <stddef.h>
 
 #if ISR_MANAGER == 1
@@ -88,6 +89,7 @@ void us_timer_start(us_timer_num id, us_timer_mode mode, uint32_t time_us, void
     //If no timers are currently on
     if (us_timers_status == 0)
     {
+        hfclk_xtal_request (HFCLK_XTAL_USER_US_TIMER, NULL);
         TIMER_ID->TASKS_START = 1;
     }
 
@@ -105,6 +107,7 @@ void us_timer_stop(us_timer_num id){
     {
         TIMER_ID->TASKS_STOP          = 1;                // Stop timer.
         TIMER_ID->TASKS_SHUTDOWN      = 1;                // Fully stop timer.
+        hfclk_xtal_release (HFCLK_XTAL_USER_US_TIMER);
     }
 }
 
@@ -0,0 +1,157 @@
+/**
+ *  ble_conn_params.c : Connection parameters as per the phase of a session
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ble_conn_params.h"
+#include "app_error.h"
+#include "common_util.h"
+#include "nrf_util.h"
+#include "ms_timer.h"
+
+/** The parameters requested in each of the phases */
+static const ble_gap_conn_params_t phase_params[] =
+{
+    [BLE_CONN_PARAMS_ACTIVE] =
+    {
+        .min_conn_interval =
+            MSEC_TO_UNITS(BLE_CONN_PARAMS_ACTIVE_MIN_INTVL_MS, UNIT_1_25_MS),
+        .max_conn_interval =
+            MSEC_TO_UNITS(BLE_CONN_PARAMS_ACTIVE_MAX_INTVL_MS, UNIT_1_25_MS),
+        .slave_latency = 0,
+        .conn_sup_timeout =
+            MSEC_TO_UNITS(BLE_CONN_PARAMS_SUP_TIMEOUT_MS, UNIT_10_MS),
+    },
+    [BLE_CONN_PARAMS_IDLE] =
+    {
+        .min_conn_interval =
+            MSEC_TO_UNITS(BLE_CONN_PARAMS_IDLE_MIN_INTVL_MS, UNIT_1_25_MS),
+        .max_conn_interval =
+            MSEC_TO_UNITS(BLE_CONN_PARAMS_IDLE_MAX_INTVL_MS, UNIT_1_25_MS),
+        .slave_latency = BLE_CONN_PARAMS_IDLE_SLAVE_LATENCY,
+        .conn_sup_timeout =
+            MSEC_TO_UNITS(BLE_CONN_PARAMS_SUP_TIMEOUT_MS, UNIT_10_MS),
+    },
+};
+
+static volatile uint16_t h_conn = BLE_CONN_HANDLE_INVALID;
+static volatile ble_conn_params_phase_t conn_phase;
+/** Time since the last activity in ms timer ticks */
+static volatile uint32_t idle_ticks;
+/** The SoftDevice was busy with another procedure for the last request */
+static volatile bool is_req_pending;
+
+/** Request the parameters of the phase. The link layer runs one procedure
+ *  at a time, so a busy SoftDevice is retried on the next tick. */
+static void phase_request (ble_conn_params_phase_t phase)
+{
+    uint32_t err_code;
+
+    err_code = sd_ble_gap_conn_param_update (h_conn, &phase_params[phase]);
+    is_req_pending = (err_code != NRF_SUCCESS);
+}
+
+void ble_conn_params_init (void)
+{
+    uint32_t err_code;
+
+    h_conn = BLE_CONN_HANDLE_INVALID;
+    is_req_pending = false;
+
+    err_code = sd_ble_gap_ppcp_set (&phase_params[BLE_CONN_PARAMS_IDLE]);
+    APP_ERROR_CHECK(err_code);
+}
+
+void ble_conn_params_on_ble_evt (ble_evt_t * evt)
+{
+    switch(evt->header.evt_id)
+    {
+    case BLE_GAP_EVT_CONNECTED:
+        //A session starts with the configuration being read and written
+        h_conn = evt->evt.gap_evt.conn_handle;
+        idle_ticks = 0;
+        conn_phase = BLE_CONN_PARAMS_ACTIVE;
+        phase_request (BLE_CONN_PARAMS_ACTIVE);
+        break;
+    case BLE_GAP_EVT_DISCONNECTED:
+        h_conn = BLE_CONN_HANDLE_INVALID;
+        is_req_pending = false;
+        break;
+    case BLE_GATTS_EVT_WRITE:
+    case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+        ble_conn_params_activity ();
+        break;
+    }
+}
+
+void ble_conn_params_activity (void)
+{
+    bool is_wake = false;
+
+    if(h_conn == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+
+    CRITICAL_REGION_ENTER();
+    idle_ticks = 0;
+    if(conn_phase == BLE_CONN_PARAMS_IDLE)
+    {
+        conn_phase = BLE_CONN_PARAMS_ACTIVE;
+        is_wake = true;
+    }
+    CRITICAL_REGION_EXIT();
+
+    if(is_wake)
+    {
+        phase_request (BLE_CONN_PARAMS_ACTIVE);
+    }
+}
+
+bool ble_conn_params_add_ticks (uint32_t ticks)
+{
+    bool is_req = false;
+    ble_conn_params_phase_t phase;
+
+    if(h_conn == BLE_CONN_HANDLE_INVALID)
+    {
+        return false;
+    }
+
+    CRITICAL_REGION_ENTER();
+    idle_ticks += ticks;
+    if((conn_phase == BLE_CONN_PARAMS_ACTIVE) &&
+            (idle_ticks >= MS_TIMER_TICKS_MS(BLE_CONN_PARAMS_ACTIVE_HOLD_MS)))
+    {
+        conn_phase = BLE_CONN_PARAMS_IDLE;
+        is_req = true;
+    }
+    is_req |= is_req_pending;
+    phase = conn_phase;
+    CRITICAL_REGION_EXIT();
+
+    if(is_req)
+    {
+        phase_request (phase);
+    }
+
+    return (idle_ticks >= MS_TIMER_TICKS_MS(BLE_CONN_PARAMS_IDLE_DISCONN_MS));
+}
+
+ble_conn_params_phase_t ble_conn_params_phase_get (void)
+{
+    return conn_phase;
+}
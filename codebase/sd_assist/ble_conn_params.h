@@ -0,0 +1,141 @@
+/**
+ *  ble_conn_params.h : Connection parameters as per the phase of a session
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup group_sd_assist
+ * @{
+ *
+ * @defgroup group_ble_conn_params BLE connection parameters
+ *
+ * @brief Module to request the connection parameters which suit the phase
+ *  of a configuration session, trading latency for power.
+ *
+ * A connection starts in the active phase with a short interval. Writes
+ *  from the peer and sent notifications keep it active. After
+ *  @ref BLE_CONN_PARAMS_ACTIVE_HOLD_MS without any of these the idle phase
+ *  is requested with a long interval and slave latency, so that the radio
+ *  is mostly off while the user reads the settings. Any activity requests
+ *  the active phase again. @ref ble_conn_params_add_ticks tells when the
+ *  link has been idle for @ref BLE_CONN_PARAMS_IDLE_DISCONN_MS.
+ *
+ * The default parameters are within the limits that phones accept.
+ * @{
+ */
+
+#ifndef CODEBASE_SD_ASSIST_BLE_CONN_PARAMS_H_
+#define CODEBASE_SD_ASSIST_BLE_CONN_PARAMS_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "ble.h"
+
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+#ifndef BLE_CONN_PARAMS_ACTIVE_MIN_INTVL_MS
+/** Minimum connection interval in ms in the active phase */
+#define BLE_CONN_PARAMS_ACTIVE_MIN_INTVL_MS     15
+#endif
+
+#ifndef BLE_CONN_PARAMS_ACTIVE_MAX_INTVL_MS
+/** Maximum connection interval in ms in the active phase */
+#define BLE_CONN_PARAMS_ACTIVE_MAX_INTVL_MS     30
+#endif
+
+#ifndef BLE_CONN_PARAMS_IDLE_MIN_INTVL_MS
+/** Minimum connection interval in ms in the idle phase */
+#define BLE_CONN_PARAMS_IDLE_MIN_INTVL_MS       270
+#endif
+
+#ifndef BLE_CONN_PARAMS_IDLE_MAX_INTVL_MS
+/** Maximum connection interval in ms in the idle phase */
+#define BLE_CONN_PARAMS_IDLE_MAX_INTVL_MS       300
+#endif
+
+#ifndef BLE_CONN_PARAMS_IDLE_SLAVE_LATENCY
+/** Connection events that can be skipped in the idle phase */
+#define BLE_CONN_PARAMS_IDLE_SLAVE_LATENCY      4
+#endif
+
+#ifndef BLE_CONN_PARAMS_SUP_TIMEOUT_MS
+/** Supervision timeout in ms, more than thrice the idle interval
+ *  times one plus the slave latency */
+#define BLE_CONN_PARAMS_SUP_TIMEOUT_MS          6000
+#endif
+
+#ifndef BLE_CONN_PARAMS_ACTIVE_HOLD_MS
+/** Time in ms without activity after which the idle phase is requested */
+#define BLE_CONN_PARAMS_ACTIVE_HOLD_MS          5000
+#endif
+
+#ifndef BLE_CONN_PARAMS_IDLE_DISCONN_MS
+/** Time in ms without activity after which the link is to be dropped */
+#define BLE_CONN_PARAMS_IDLE_DISCONN_MS         (2*60*1000)
+#endif
+
+/** The phases of a connection */
+typedef enum
+{
+    BLE_CONN_PARAMS_ACTIVE, ///< Short interval for a quick response
+    BLE_CONN_PARAMS_IDLE,   ///< Long interval and slave latency to save power
+}ble_conn_params_phase_t;
+
+/**
+ * @brief Function to initialize the module and to set the peripheral
+ *  preferred connection parameters to those of the idle phase. To be called
+ *  after the BLE stack is enabled.
+ */
+void ble_conn_params_init (void);
+
+/**
+ * @brief Function to handle the BLE events of the SoftDevice, to be called
+ *  for every event from the BLE event handler.
+ * @param evt Pointer to the BLE event
+ */
+void ble_conn_params_on_ble_evt (ble_evt_t * evt);
+
+/**
+ * @brief Function to mark activity on the link other than the writes and
+ *  notifications, which are tracked already. The active phase is requested
+ *  if the link is idle.
+ */
+void ble_conn_params_activity (void);
+
+/**
+ * @brief Function to pass the time, which moves to the idle phase after
+ *  @ref BLE_CONN_PARAMS_ACTIVE_HOLD_MS and retries a request that the
+ *  SoftDevice could not take up earlier.
+ * @param ticks Time elapsed in ms timer ticks
+ * @return True if there is no activity for
+ *  @ref BLE_CONN_PARAMS_IDLE_DISCONN_MS and the link can be dropped
+ */
+bool ble_conn_params_add_ticks (uint32_t ticks);
+
+/**
+ * @brief Function to get the phase that the connection is in
+ * @return The phase requested last
+ */
+ble_conn_params_phase_t ble_conn_params_phase_get (void);
+
+#endif /* CODEBASE_SD_ASSIST_BLE_CONN_PARAMS_H_ */
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,391 @@
+/**
+ *  ble_log_xfer.c : BLE service for the bulk download of logs
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ble_log_xfer.h"
+#include "app_error.h"
+#include "stddef.h"
+#include "string.h"
+
+/** The 16 bit UUID of the log transfer service */
+#define LOG_XFER_UUID_SERVICE       0xdc80
+/** The 16 bit UUID of the read-write Control characteristic */
+#define LOG_XFER_UUID_CTRL          0xdc81
+/** The 16 bit UUID of the notify Data characteristic */
+#define LOG_XFER_UUID_DATA          0xdc82
+
+/** Length of the control value, total length and next offset */
+#define CTRL_VALUE_LEN              8
+/** Length of a write to the control characteristic, the start offset */
+#define CTRL_WRITE_LEN              4
+
+/** Bytes of ATT header in a notification */
+#define ATT_HVX_HDR_LEN             3
+
+/** Handle to specify the connection state to the soft device */
+static uint16_t h_conn = BLE_CONN_HANDLE_INVALID;
+
+/** Handle to specify the attribute of the log transfer service */
+static uint16_t h_log_xfer_service;
+
+/** Handles of the Control and Data characteristics */
+static ble_gatts_char_handles_t h_ctrl_char;
+static ble_gatts_char_handles_t h_data_char;
+
+/** ATT MTU agreed with the peer */
+static uint16_t att_mtu = BLE_GATT_ATT_MTU_DEFAULT;
+
+static const ble_log_xfer_src_t * p_log_src;
+
+/** Total length of the log and the offset of the next byte to be sent */
+static uint32_t xfer_size, xfer_offset;
+static bool is_xfer, is_notif_en;
+
+/** A notification is copied by the SoftDevice, so one buffer is enough */
+static uint8_t pkt_buf[BLE_LOG_XFER_ATT_MTU - ATT_HVX_HDR_LEN];
+
+static void u32_encode (uint32_t val, uint8_t * p_buf)
+{
+    p_buf[0] = (uint8_t) val;
+    p_buf[1] = (uint8_t) (val >> 8);
+    p_buf[2] = (uint8_t) (val >> 16);
+    p_buf[3] = (uint8_t) (val >> 24);
+}
+
+static void ctrl_value_update (void)
+{
+    uint32_t err_code;
+    uint8_t value[CTRL_VALUE_LEN];
+    ble_gatts_value_t val =
+    {
+        .len = CTRL_VALUE_LEN,
+        .offset = 0,
+        .p_value = value
+    };
+
+    u32_encode (xfer_size, &value[0]);
+    u32_encode (xfer_offset, &value[4]);
+    err_code = sd_ble_gatts_value_set (h_conn, h_ctrl_char.value_handle, &val);
+    APP_ERROR_CHECK(err_code);
+}
+
+/** Queue notifications till the SoftDevice has no more buffers, the rest are
+ *  sent on the BLE_GATTS_EVT_HVN_TX_COMPLETE events */
+static void xfer_fill (void)
+{
+    uint32_t payload_max = att_mtu - ATT_HVX_HDR_LEN - BLE_LOG_XFER_HDR_LEN;
+
+    while(is_xfer && is_notif_en && (h_conn != BLE_CONN_HANDLE_INVALID))
+    {
+        uint32_t err_code, len = 0;
+        uint16_t hvx_len;
+        ble_gatts_hvx_params_t hvx_params;
+
+        if(xfer_offset < xfer_size)
+        {
+            len = xfer_size - xfer_offset;
+            len = (len > payload_max) ? payload_max : len;
+            len = p_log_src->read (xfer_offset,
+                    &pkt_buf[BLE_LOG_XFER_HDR_LEN], len);
+        }
+        u32_encode (xfer_offset, pkt_buf);
+        hvx_len = BLE_LOG_XFER_HDR_LEN + len;
+
+        memset (&hvx_params, 0, sizeof(hvx_params));
+        hvx_params.handle = h_data_char.value_handle;
+        hvx_params.type = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.offset = 0;
+        hvx_params.p_len = &hvx_len;
+        hvx_params.p_data = pkt_buf;
+
+        err_code = sd_ble_gatts_hvx (h_conn, &hvx_params);
+        if(err_code == NRF_ERROR_RESOURCES)
+        {
+            //TX queue full, the same offset is read again on the next event
+            break;
+        }
+        else if(err_code != NRF_SUCCESS)
+        {
+            //Notifications disabled or the link is going down
+            is_xfer = false;
+            break;
+        }
+
+        xfer_offset += len;
+        if(len == 0)
+        {
+            //End of log marker sent
+            is_xfer = false;
+        }
+    }
+    ctrl_value_update ();
+}
+
+static void xfer_start (uint32_t offset)
+{
+    xfer_size = (p_log_src != NULL) ? p_log_src->size () : 0;
+    xfer_offset = (offset > xfer_size) ? xfer_size : offset;
+    is_xfer = true;
+    xfer_fill ();
+}
+
+/** Request the larger MTU and the 2 Mbps PHY. The data length update is
+ *  requested once the PHY procedure is over, as the link layer can run one
+ *  procedure at a time. These are only requests, so errors are not fatal. */
+static void link_negotiate (void)
+{
+    ble_gap_phys_t const phys = {
+        .rx_phys = BLE_GAP_PHY_2MBPS,
+        .tx_phys = BLE_GAP_PHY_2MBPS,
+    };
+
+    (void) sd_ble_gattc_exchange_mtu_request (h_conn, BLE_LOG_XFER_ATT_MTU);
+    (void) sd_ble_gap_phy_update (h_conn, &phys);
+}
+
+void ble_log_xfer_cfg_set (uint32_t app_ram_start)
+{
+    uint32_t err_code;
+    ble_cfg_t ble_cfg;
+
+    memset (&ble_cfg, 0, sizeof(ble_cfg));
+    ble_cfg.conn_cfg.conn_cfg_tag = BLE_LOG_XFER_CONN_CFG_TAG;
+    ble_cfg.conn_cfg.params.gatt_conn_cfg.att_mtu = BLE_LOG_XFER_ATT_MTU;
+    err_code = sd_ble_cfg_set (BLE_CONN_CFG_GATT, &ble_cfg, app_ram_start);
+    APP_ERROR_CHECK(err_code);
+
+    memset (&ble_cfg, 0, sizeof(ble_cfg));
+    ble_cfg.conn_cfg.conn_cfg_tag = BLE_LOG_XFER_CONN_CFG_TAG;
+    ble_cfg.conn_cfg.params.gap_conn_cfg.conn_count = BLE_GAP_CONN_COUNT_DEFAULT;
+    ble_cfg.conn_cfg.params.gap_conn_cfg.event_length = BLE_LOG_XFER_EVENT_LEN;
+    err_code = sd_ble_cfg_set (BLE_CONN_CFG_GAP, &ble_cfg, app_ram_start);
+    APP_ERROR_CHECK(err_code);
+
+    memset (&ble_cfg, 0, sizeof(ble_cfg));
+    ble_cfg.conn_cfg.conn_cfg_tag = BLE_LOG_XFER_CONN_CFG_TAG;
+    ble_cfg.conn_cfg.params.gatts_conn_cfg.hvn_tx_queue_size =
+            BLE_LOG_XFER_HVN_QUEUE_SIZE;
+    err_code = sd_ble_cfg_set (BLE_CONN_CFG_GATTS, &ble_cfg, app_ram_start);
+    APP_ERROR_CHECK(err_code);
+}
+
+void ble_log_xfer_service_init (uint8_t uuid_type)
+{
+    uint32_t err_code;
+    ble_uuid_t ble_uuid;
+    ble_opt_t ble_opt;
+
+    h_conn = BLE_CONN_HANDLE_INVALID;
+    is_xfer = false;
+
+    //Let a connection event go on while there are packets to be sent
+    memset (&ble_opt, 0, sizeof(ble_opt));
+    ble_opt.common_opt.conn_evt_ext.enable = 1;
+    err_code = sd_ble_opt_set (BLE_COMMON_OPT_CONN_EVT_EXT, &ble_opt);
+    APP_ERROR_CHECK(err_code);
+
+    ble_uuid.type = uuid_type;
+    ble_uuid.uuid = LOG_XFER_UUID_SERVICE;
+
+    err_code = sd_ble_gatts_service_add (BLE_GATTS_SRVC_TYPE_PRIMARY,
+            &ble_uuid, &h_log_xfer_service);
+    APP_ERROR_CHECK(err_code);
+
+    /**** Create the read-write Control characteristic *****/
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t attr_char_value;
+    ble_gatts_attr_md_t attr_md;
+    ble_gatts_attr_md_t cccd_md;
+
+    memset (&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.read = 1;
+    char_md.char_props.write = 1;
+
+    ble_uuid.type = uuid_type;
+    ble_uuid.uuid = LOG_XFER_UUID_CTRL;
+
+    memset (&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+    attr_md.vloc = BLE_GATTS_VLOC_STACK;
+    attr_md.vlen = 1;
+
+    memset (&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len = CTRL_VALUE_LEN;
+    attr_char_value.max_len = CTRL_VALUE_LEN;
+
+    err_code = sd_ble_gatts_characteristic_add (h_log_xfer_service,
+            &char_md, &attr_char_value, &h_ctrl_char);
+    APP_ERROR_CHECK(err_code);
+
+    /**** Create the notify Data characteristic *****/
+    memset (&cccd_md, 0, sizeof(cccd_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.write_perm);
+    cccd_md.vloc = BLE_GATTS_VLOC_STACK;
+
+    memset (&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.notify = 1;
+    char_md.p_cccd_md = &cccd_md;
+
+    ble_uuid.type = uuid_type;
+    ble_uuid.uuid = LOG_XFER_UUID_DATA;
+
+    memset (&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+    attr_md.vloc = BLE_GATTS_VLOC_STACK;
+    attr_md.vlen = 1;
+
+    memset (&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len = 0;
+    attr_char_value.max_len = sizeof(pkt_buf);
+
+    err_code = sd_ble_gatts_characteristic_add (h_log_xfer_service,
+            &char_md, &attr_char_value, &h_data_char);
+    APP_ERROR_CHECK(err_code);
+
+    xfer_size = (p_log_src != NULL) ? p_log_src->size () : 0;
+    ctrl_value_update ();
+}
+
+void ble_log_xfer_src_set (const ble_log_xfer_src_t * p_src)
+{
+    p_log_src = p_src;
+    is_xfer = false;
+    xfer_offset = 0;
+}
+
+bool ble_log_xfer_on_ble_evt (ble_evt_t * evt)
+{
+    uint32_t err_code;
+
+    switch(evt->header.evt_id)
+    {
+    case BLE_GAP_EVT_CONNECTED:
+        h_conn = evt->evt.gap_evt.conn_handle;
+        att_mtu = BLE_GATT_ATT_MTU_DEFAULT;
+        is_notif_en = false;
+        is_xfer = false;
+        link_negotiate ();
+        break;
+    case BLE_GAP_EVT_DISCONNECTED:
+        //The offset is kept so that the peer can read where it stopped
+        h_conn = BLE_CONN_HANDLE_INVALID;
+        is_xfer = false;
+        break;
+    case BLE_GAP_EVT_PHY_UPDATE:
+        (void) sd_ble_gap_data_length_update (h_conn, NULL, NULL);
+        break;
+    case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
+    {
+        ble_gap_phys_t const phys = {
+            .rx_phys = BLE_GAP_PHY_AUTO,
+            .tx_phys = BLE_GAP_PHY_AUTO,
+        };
+
+        err_code = sd_ble_gap_phy_update (h_conn, &phys);
+        APP_ERROR_CHECK(err_code);
+        return true;
+    }
+    case BLE_GAP_EVT_DATA_LENGTH_UPDATE_REQUEST:
+        //The SoftDevice picks the largest length the event length allows
+        err_code = sd_ble_gap_data_length_update (h_conn, NULL, NULL);
+        APP_ERROR_CHECK(err_code);
+        return true;
+    case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
+    {
+        uint16_t client_mtu =
+                evt->evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu;
+
+        err_code = sd_ble_gatts_exchange_mtu_reply (h_conn,
+                BLE_LOG_XFER_ATT_MTU);
+        APP_ERROR_CHECK(err_code);
+        att_mtu = (client_mtu < BLE_LOG_XFER_ATT_MTU) ?
+                client_mtu : BLE_LOG_XFER_ATT_MTU;
+        att_mtu = (att_mtu < BLE_GATT_ATT_MTU_DEFAULT) ?
+                BLE_GATT_ATT_MTU_DEFAULT : att_mtu;
+        return true;
+    }
+    case BLE_GATTC_EVT_EXCHANGE_MTU_RSP:
+    {
+        uint16_t server_mtu =
+                evt->evt.gattc_evt.params.exchange_mtu_rsp.server_rx_mtu;
+
+        att_mtu = (server_mtu < BLE_LOG_XFER_ATT_MTU) ?
+                server_mtu : BLE_LOG_XFER_ATT_MTU;
+        att_mtu = (att_mtu < BLE_GATT_ATT_MTU_DEFAULT) ?
+                BLE_GATT_ATT_MTU_DEFAULT : att_mtu;
+        break;
+    }
+    case BLE_GATTS_EVT_SYS_ATTR_MISSING:
+        //No bonding, so the CCCD starts off for every connection
+        err_code = sd_ble_gatts_sys_attr_set (h_conn, NULL, 0, 0);
+        APP_ERROR_CHECK(err_code);
+        break;
+    case BLE_GATTS_EVT_WRITE:
+    {
+        ble_gatts_evt_write_t * write = &evt->evt.gatts_evt.params.write;
+
+        if(write->handle == h_data_char.cccd_handle)
+        {
+            if(write->len == 2)
+            {
+                is_notif_en = ((write->data[0] & BLE_GATT_HVX_NOTIFICATION) != 0);
+                xfer_fill ();
+            }
+            return true;
+        }
+        if(write->handle == h_ctrl_char.value_handle)
+        {
+            if(write->len == CTRL_WRITE_LEN)
+            {
+                xfer_start ((uint32_t) write->data[0] |
+                        ((uint32_t) write->data[1] << 8) |
+                        ((uint32_t) write->data[2] << 16) |
+                        ((uint32_t) write->data[3] << 24));
+            }
+            else
+            {
+                ctrl_value_update ();
+            }
+            return true;
+        }
+        break;
+    }
+    case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+        xfer_fill ();
+        break;
+    }
+    return false;
+}
+
+bool ble_log_xfer_is_busy (void)
+{
+    return is_xfer;
+}
@@ -0,0 +1,135 @@
+/**
+ *  ble_log_xfer.h : BLE service for the bulk download of logs
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup group_sd_assist
+ * @{
+ *
+ * @defgroup group_ble_log_xfer BLE log transfer
+ *
+ * @brief GATT service to download a log from a device at the highest
+ *  throughput that the connection allows.
+ *
+ * On connection the ATT MTU of @ref BLE_LOG_XFER_ATT_MTU, data length
+ *  extension and the 2 Mbps PHY are requested, while connection event length
+ *  extension lets a connection event carry as many packets as possible. The
+ *  log is seen as a stream of bytes given by a @ref ble_log_xfer_src_t.
+ *
+ * The service has two characteristics
+ *  - Control (write, read): Writing a 32 bit little endian byte offset
+ *    starts the transfer from that offset. Reading gives the total length of
+ *    the log followed by the offset of the next byte to be sent, both 32 bit.
+ *  - Data (notify): Packets of a 32 bit offset followed by the bytes of the
+ *    log from that offset. A packet with no bytes after the offset marks the
+ *    end of the log.
+ *
+ * The notifications are queued till the SoftDevice's TX queue is full and
+ *  the queue is filled again as packets are sent. A transfer stopped by a
+ *  disconnection is resumed by writing the offset after the last byte
+ *  received to the control characteristic.
+ * @{
+ */
+
+#ifndef CODEBASE_SD_ASSIST_BLE_LOG_XFER_H_
+#define CODEBASE_SD_ASSIST_BLE_LOG_XFER_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "ble.h"
+
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+#ifndef BLE_LOG_XFER_ATT_MTU
+/** ATT MTU requested, 247 fills a data length extended packet of 251 bytes */
+#define BLE_LOG_XFER_ATT_MTU        247
+#endif
+
+#ifndef BLE_LOG_XFER_CONN_CFG_TAG
+/** Tag of the connection configuration with the larger MTU and TX queue */
+#define BLE_LOG_XFER_CONN_CFG_TAG   1
+#endif
+
+#ifndef BLE_LOG_XFER_HVN_QUEUE_SIZE
+/** Number of notifications the SoftDevice can queue */
+#define BLE_LOG_XFER_HVN_QUEUE_SIZE 8
+#endif
+
+#ifndef BLE_LOG_XFER_EVENT_LEN
+/** Connection event length reserved, in 1.25 ms units */
+#define BLE_LOG_XFER_EVENT_LEN      6
+#endif
+
+/** Bytes of the offset in the start of every data packet */
+#define BLE_LOG_XFER_HDR_LEN        4
+
+/** The source of the bytes of the log to be sent */
+typedef struct
+{
+    /** Function returning the total length of the log in bytes */
+    uint32_t (* size) (void);
+    /** Function to copy bytes of the log from an offset. Returns the number
+     *  of bytes copied, which is less than len only at the end of the log */
+    uint32_t (* read) (uint32_t offset, uint8_t * p_buf, uint32_t len);
+}ble_log_xfer_src_t;
+
+/**
+ * @brief Function to configure the SoftDevice for the transfer. To be called
+ *  after sd_softdevice_enable and before sd_ble_enable. The connection is to
+ *  be established with @ref BLE_LOG_XFER_CONN_CFG_TAG for this to apply.
+ * @param app_ram_start Start of the RAM of the application as given to
+ *  sd_ble_enable
+ */
+void ble_log_xfer_cfg_set (uint32_t app_ram_start);
+
+/**
+ * @brief Function to add the log transfer service
+ * @param uuid_type The type of the vendor specific base UUID to which the
+ *  16 bit UUIDs of the service and characteristics are added
+ */
+void ble_log_xfer_service_init (uint8_t uuid_type);
+
+/**
+ * @brief Function to set the log to be sent. An ongoing transfer is stopped.
+ * @param p_src Pointer to the source of the log, which must remain valid
+ */
+void ble_log_xfer_src_set (const ble_log_xfer_src_t * p_src);
+
+/**
+ * @brief Function to handle the BLE events of the SoftDevice, to be called
+ *  for every event from the BLE event handler.
+ * @param evt Pointer to the BLE event
+ * @return True if the event is fully handled here and is not to be handled
+ *  further, which is the case for the writes to this service and the MTU,
+ *  PHY and data length requests of the peer
+ */
+bool ble_log_xfer_on_ble_evt (ble_evt_t * evt);
+
+/**
+ * @brief Function to know if a transfer is ongoing
+ * @return True if the log is being sent
+ */
+bool ble_log_xfer_is_busy (void);
+
+#endif /* CODEBASE_SD_ASSIST_BLE_LOG_XFER_H_ */
+
+/**
+ * @}
+ * @}
+ */
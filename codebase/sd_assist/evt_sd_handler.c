@@ -49,7 +49,7 @@
 
 ///The buffer where the ble event data is stored by sd_evt_get
 uint32_t ble_evt_buffer[
-          CEIL_DIV(BLE_EVT_LEN_MAX(BLE_GATT_ATT_MTU_DEFAULT)
+          CEIL_DIV(BLE_EVT_LEN_MAX(EVT_SD_HANDLER_ATT_MTU)
           ,sizeof(uint32_t))];
 
 void (*ble_handler)(ble_evt_t * evt);
@@ -42,6 +42,10 @@
 #ifndef SWI_USED_EVT_SD_HANDLER 
 #define SWI_USED_EVT_SD_HANDLER 2
 #endif
+#ifndef EVT_SD_HANDLER_ATT_MTU
+/** Largest ATT MTU of a connection, for the size of the event buffer */
+#define EVT_SD_HANDLER_ATT_MTU BLE_GATT_ATT_MTU_DEFAULT
+#endif
 
 /**
  * @brief Initializes the SWI2 interrupt routine and stores the
@@ -40,14 +40,20 @@
  * INCLUDES
  */
 #include "stdlib.h"
+#include "string.h"
 #include "cc112x_def.h"
 #include "radio_drv.h"
 #include "hal_spi_rf.h"
 #include "hal_nop_delay.h"
 #include "log.h"
 #include "hal_gpio.h"
+#include "nrf_util.h"
 //#include "cc112x_drv.h"
 
+#if ISR_MANAGER == 1
+#include "isr_manager.h"
+#endif
+
 #ifdef USE_CC112X
 
 /******************************************************************************
@@ -56,10 +62,43 @@
 #define RF_XTAL_FREQ           RF_XTAL       /* XTAL frequency, given in 1kHz steps */
 #define RF_LO_DIVIDER          4             /* there is a hardware LO divider CC112x */
 
+/* APPEND_STATUS bit in PKT_CFG1, RSSI and CRC_OK|LQI follow the payload */
+#define PKT_CFG1_APPEND_STATUS 0x01
+/* Offset of the appended RSSI to get dBm, same as in radio_get_rssi */
+#define RF_RSSI_OFFSET         99
+
 /******************************************************************************
  * GLOBALS -  used by the driver
  */
-uint8_t rf_end_packet = 0;
+/* States of the interrupt driven mode */
+typedef enum
+{
+	RADIO_STATE_IDLE,          /* Not in RX or TX */
+	RADIO_STATE_RX_START,      /* Strobes to enter RX are queued */
+	RADIO_STATE_RX,            /* Waiting for the end of a packet on GDO0 */
+	RADIO_STATE_RX_READ,       /* Reading the received packet from the RX FIFO */
+	RADIO_STATE_TX_LOAD,       /* Strobes and TX FIFO write are queued */
+	RADIO_STATE_TX,            /* Waiting for the end of the packet on GDO0 */
+}radio_state_t;
+
+static volatile radio_state_t radio_state = RADIO_STATE_IDLE;
+static void (*radio_evt_handler)(radio_evt_t evt);
+/* Events to be passed on from the GPIOTE interrupt, bit per radio_evt_t */
+static volatile uint32_t radio_evt_pending;
+
+/* Received packets, filled at radio_pkt_wr by the SPIM EasyDMA */
+static radio_pkt_t radio_pkt_pool[RADIO_PKT_POOL_SIZE];
+static volatile uint32_t radio_pkt_wr, radio_pkt_rd;
+/* Number of bytes in the RX FIFO, including the appended status */
+static uint8_t radio_rx_bytes;
+
+/* Copy of the packet to be sent, as the TX FIFO write is done later */
+static uint8_t radio_tx_buf[RADIO_PKT_MAX_LEN];
+static uint8_t radio_tx_len;
+
+/* RSSI0 read by radio_channel_clear_async and the function given the result */
+static uint8_t radio_cca_rssi0;
+static void (*radio_cca_handler)(int result);
 
 /******************************************************************************
  * Configuration extracted from SmartRF Studio version 7 Release 2.0.0
@@ -623,6 +662,20 @@ int radio_read(uint8_t *buf, uint8_t *buf_len) {
 	return (status);
 }
 
+/******************************************************************************
+ * @fn         radio_cca_result
+ *
+ * @brief      Get the result of a CCA from RSSI0. The carrier sense signal
+ *             is only valid some time after entering RX.
+ */
+static int radio_cca_result(uint8_t rssi0) {
+
+	if((rssi0 & RSSI0_CARRIER_SENSE_VALID) == 0) {
+		return -1;
+	}
+	return(rssi0 & RSSI0_CARRIER_SENSE);
+}
+
 /******************************************************************************
  * @fn         radio_channel_clear
  *
@@ -638,89 +691,101 @@ int radio_read(uint8_t *buf, uint8_t *buf_len) {
  *
  * @return      0  - no carrier found
  *              >0 - carrier found
+ *              -1 - carrier sense not valid yet or the SPI is taken
  *
  */
 int radio_channel_clear(void) {
-	uint8_t status;
+	uint8_t rssi0;
 
 	/* get RSSI0, and return the carrier sense signal */
-	trx16BitRegAccess(RADIO_READ_ACCESS, 0x2F, 0xff & RSSI0, &status, 1);
+	if(trx16BitRegAccess(RADIO_READ_ACCESS, 0x2F, 0xff & RSSI0, &rssi0, 1)
+			== TRX_STATUS_SPI_ERROR) {
+		return -1;
+	}
 
 	/* return the carrier sense signal */
-	return(status  & 0x04);
+	return radio_cca_result(rssi0);
 }
 
+static void radio_cca_done(rfStatus_t status) {
+	if(radio_cca_handler != NULL) {
+		radio_cca_handler(radio_cca_result(radio_cca_rssi0));
+	}
+}
 
 /******************************************************************************
- * @fn         radio_channel_clear
- *
- * @brief      Wait for end of packet interupt to happen
+ * @fn         radio_channel_clear_async
  *
- *             Timeout is controlled by TimerA running at 8MHz
- *             64000 = 128ms, 32000 = 64ms, 16000 = 32ms
- *             0 = no timeout.
+ * @brief      Non blocking version of radio_channel_clear, which can be
+ *             used along with the interrupt driven mode as the RSSI0 read
+ *             is queued behind the accesses of the RX and TX chains.
  *
  * input parameters
  *
- * @param       max_hold   :  Watch dog timeout, no end of packet = 0;
+ * @param       cca_handler - Function called from the SPIM interrupt with
+ *                            the result, as returned by radio_channel_clear
  *
  * output parameters
  *
- * @return      timer value:  Interupt happened based on end_of_packet interupt
+ * @return      0 if started, -1 if the SPI is taken
  *
  */
+int radio_channel_clear_async(void (*cca_handler)(int result)) {
 
-//COMPLETELY BROKEN
-int radio_wait_for_idle(uint16_t max_hold) {
-
-	uint32_t status;
-	uint8_t reg_status;
-
-	/* check that we are still in RX mode before entering wait for RX end */
-	trx16BitRegAccess(RADIO_READ_ACCESS, 0x2F, 0xff & MARCSTATE, &reg_status, 1);
-
-	/* filter out only the status section of the register values */
-	reg_status  = (reg_status & 0x1F);
+	radio_cca_handler = cca_handler;
+	if(trx16BitRegAccessAsync(RADIO_READ_ACCESS, 0x2F, 0xff & RSSI0,
+			&radio_cca_rssi0, 1, radio_cca_done) == false) {
+		return -1;
+	}
+	return 0;
+}
 
-	/* check for not idle mode */
-	if(!(reg_status == MARCSTATE_IDLE)) {
 
-		rf_end_packet = 0;  // initialize global variable for use in this function
+/******************************************************************************
+ * @fn         radio_wait_for_idle
+ *
+ * @brief      Wait for the ongoing packet to be sent or received, which is
+ *             known from the end of packet interrupt on GDO0 in the
+ *             interrupt driven mode. No SPI access is done while waiting.
+ *
+ * input parameters
+ *
+ * @param       max_hold   :  Timeout in ms, 0 to wait till the end of packet
+ *
+ * output parameters
+ *
+ * @return      time waited in ms, max_hold if there was no end of packet
+ *
+ */
+int radio_wait_for_idle(uint16_t max_hold) {
 
-//		/* setup the interrupt */
-//		RF_GDO_PxIES |= RF_GDO_PIN;       // Int on falling edge (end of pkt)
-//		RF_GDO_PxIFG &= ~RF_GDO_PIN;      // Clear flag
-//		RF_GDO_PxIE |= RF_GDO_PIN;        // Enable int on end of packet
+	uint16_t waited = 0;
 
-		/* enabled timeout if requested */
+	while(radio_is_busy()) {
 		if(max_hold > 0) {
-//			status = hal_nop_delay_ms ((uint)max_hold);   //CHECKOUT WHAT TO DO WITH THIS LINE    // this will timeout either with GDO or timer
+			if(waited == max_hold) {
+				break;
+			}
+			hal_nop_delay_ms (1);
+			waited++;
 		} else {
-			// wait for radio to interupt us to continue processing
-			status = 0;
-//			_BIS_SR(LPM0_bits + GIE);             // Enter LPM0
+			/* any interrupt from the driver wakes this up */
+			__WFE();
 		}
-
-		/********  Setup the GDO ports to not interupts ****************************/
-//		RF_GDO_PxIE &= ~RF_GDO_PIN;              // Disable int on end of packet
-
-	}
-	/* Get timer values, however if we did not get a packet in time use 0      */
-	if(rf_end_packet == 0) {
-		status = max_hold;
 	}
 
 #ifdef ENABLE_RANGE_EXTENDER
 	range_extender_idle();
 #endif
 
-	return status;
+	return waited;
 }
 
 /******************************************************************************
  * @fn         radio_is_busy
  *
- * @brief      Wait for radio to become idle
+ * @brief      Check if a packet is being sent or received. GDO0 is high
+ *             from the sync word to the end of the packet.
  *
  * input parameters
  *
@@ -728,27 +793,28 @@ int radio_wait_for_idle(uint16_t max_hold) {
  *
  * output parameters
  *
- * @return      void
+ * @return      1 if busy, else 0
  *
  */
 int radio_is_busy(void) {
 
-	// Wait GDO0 to go hi -> sync TX'ed
-//	while (!(RF_GDO_IN & RF_GDO_PIN));
-
-	// Wait GDO0 to go low again -> sync TX'ed
-//	while (RF_GDO_IN & RF_GDO_PIN);
-
-	// Wait GDO0 to clear -> end of pkt
-//	RF_GDO_PxIFG &= ~RF_GDO_PIN;          // After pkt TX, this flag is set.
-
-	return(0);
+	switch(radio_state) {
+	case RADIO_STATE_RX_START:
+	case RADIO_STATE_RX_READ:
+	case RADIO_STATE_TX_LOAD:
+	case RADIO_STATE_TX:
+		return 1;
+	case RADIO_STATE_RX:
+		return (hal_gpio_pin_read (RF_GDO0_PIN) ? 1 : 0);
+	default:
+		return 0;
+	}
 }
 
 /******************************************************************************
  * @fn         radio_pending_packet
  *
- * @brief      Check if the radio driver has just received a packet
+ * @brief      Check if the radio driver has received packets
  *
  * input parameters
  *
@@ -756,21 +822,18 @@ int radio_is_busy(void) {
  *
  * output parameters
  *
- * @return      void
+ * @return      number of packets in the pool
  *
  */
 int radio_pending_packet(void) {
 
-//	RF_GDO_PxIES |= RF_GDO_PIN;       // Int on falling edge (end of pkt)
-//	RF_GDO_PxIE |= RF_GDO_PIN;        // Enable int on end of packet
-
-	return rf_end_packet;
+	return (radio_pkt_wr - radio_pkt_rd);
 }
 
 /******************************************************************************
  * @fn         radio_clear_pending_packet
  *
- * @brief      Clear pending packet indicator
+ * @brief      Return all the received packets to the pool
  *
  * input parameters
  *
@@ -783,10 +846,7 @@ int radio_pending_packet(void) {
  */
 int radio_clear_pending_packet(void) {
 
-//	RF_GDO_PxIES &= ~RF_GDO_PIN;       // Int on falling edge (end of pkt)
-//	RF_GDO_PxIE &= ~RF_GDO_PIN;        // Enable int on end of packet
-
-	rf_end_packet = 0;
+	radio_pkt_rd = radio_pkt_wr;
 
 	return 0;
 }
@@ -1040,9 +1100,197 @@ int radio_get_rssi_val (void)
     return rssi_val;
 }
 /******************************************************************************
- * @fn         radio_ISR
+ * @fn         radio_evt_post
  *
- * @brief      Interrupt service routine used by transciever
+ * @brief      Pass an event on to the application from the GPIOTE interrupt,
+ *             so that the handler runs at the priority given at init and
+ *             not at the SPIM interrupt priority.
+ */
+static void radio_evt_post(radio_evt_t evt) {
+	CRITICAL_REGION_ENTER();
+	radio_evt_pending |= (1 << evt);
+	CRITICAL_REGION_EXIT();
+	NVIC_SetPendingIRQ(GPIOTE_IRQn);
+}
+
+/******************************************************************************
+ * @fn         radio_chain_abort
+ *
+ * @brief      Stop a chain of accesses whose next access could not be queued.
+ *             The radio is left where the chain stopped, the application
+ *             is told so that it can start over.
+ */
+static void radio_chain_abort(void) {
+	radio_state = RADIO_STATE_IDLE;
+	radio_evt_post(RADIO_EVT_SPI_ERROR);
+}
+
+/* RX chain, called in order from the SPIM interrupt */
+static void radio_rx_on_done(rfStatus_t status) {
+	radio_state = RADIO_STATE_RX;
+}
+
+static void radio_rx_flush_done(rfStatus_t status) {
+	if(trxSpiCmdStrobeAsync(SRX, radio_rx_on_done) == false) {
+		radio_chain_abort();
+	}
+}
+
+static void radio_rx_idle_done(rfStatus_t status) {
+	if(trxSpiCmdStrobeAsync(SFRX, radio_rx_flush_done) == false) {
+		radio_chain_abort();
+	}
+}
+
+static void radio_rx_data_done(rfStatus_t status) {
+	radio_pkt_t * p_pkt = &radio_pkt_pool[radio_pkt_wr & (RADIO_PKT_POOL_SIZE - 1)];
+
+	p_pkt->len = radio_rx_bytes - 2;
+	p_pkt->rssi = (int8_t) p_pkt->data[p_pkt->len] - RF_RSSI_OFFSET;
+	p_pkt->lqi = p_pkt->data[p_pkt->len + 1] & ~CRC_OK;
+	p_pkt->crc_ok = (p_pkt->data[p_pkt->len + 1] & CRC_OK) ? true : false;
+	radio_pkt_wr++;
+
+	/* the radio is idle at the end of the packet, flush and get back to RX */
+	radio_state = RADIO_STATE_RX_START;
+	if(trxSpiCmdStrobeAsync(SFRX, radio_rx_flush_done) == false) {
+		radio_chain_abort();
+	}
+	radio_evt_post(RADIO_EVT_RX_DONE);
+}
+
+static void radio_rx_len_done(rfStatus_t status) {
+	if((radio_rx_bytes > 2) && (radio_rx_bytes <= (RADIO_PKT_MAX_LEN + 2))
+			&& ((radio_pkt_wr - radio_pkt_rd) < RADIO_PKT_POOL_SIZE)) {
+		if(trx8BitRegAccessAsync(RADIO_READ_ACCESS|RADIO_BURST_ACCESS, RXFIFO,
+				radio_pkt_pool[radio_pkt_wr & (RADIO_PKT_POOL_SIZE - 1)].data,
+				radio_rx_bytes, radio_rx_data_done) == false) {
+			radio_chain_abort();
+		}
+	} else {
+		radio_state = RADIO_STATE_RX_START;
+		if(trxSpiCmdStrobeAsync(SFRX, radio_rx_flush_done) == false) {
+			radio_chain_abort();
+		}
+		radio_evt_post(RADIO_EVT_RX_DROPPED);
+	}
+}
+
+/* TX chain, called in order from the SPIM interrupt */
+static void radio_tx_fifo_done(rfStatus_t status) {
+	/* only the end of this packet on GDO0 is to be seen as TX done */
+	NRF_GPIOTE->EVENTS_IN[GPIOTE_CH_USED_RADIO_DRV] = 0;
+	radio_state = RADIO_STATE_TX;
+	if(trxSpiCmdStrobeAsync(STX, NULL) == false) {
+		radio_chain_abort();
+	}
+}
+
+static void radio_tx_flush_done(rfStatus_t status) {
+	if(trx8BitRegAccessAsync(RADIO_WRITE_ACCESS|RADIO_BURST_ACCESS, TXFIFO,
+			radio_tx_buf, radio_tx_len, radio_tx_fifo_done) == false) {
+		radio_chain_abort();
+	}
+}
+
+static void radio_tx_idle_done(rfStatus_t status) {
+	if(trxSpiCmdStrobeAsync(SFTX, radio_tx_flush_done) == false) {
+		radio_chain_abort();
+	}
+}
+
+/******************************************************************************
+ * @fn         radio_evt_init
+ *
+ * @brief      Start the interrupt driven mode. The end of packet on GDO0
+ *             (IOCFG0 as PKT_SYNC_RXTX) is an event on GPIOTE, on which the
+ *             RX FIFO is read into the packet pool with queued SPI accesses.
+ *             APPEND_STATUS is set so that RSSI and LQI are read along
+ *             with the payload.
+ *
+ * input parameters
+ *
+ * @param       irq_priority - Priority of the GPIOTE interrupt, from which
+ *                             evt_handler is called
+ * @param       evt_handler  - Function called on the radio events
+ *
+ * output parameters
+ *
+ * @return      0
+ *
+ */
+int radio_evt_init(uint32_t irq_priority, void (*evt_handler)(radio_evt_t evt)) {
+	uint8_t pkt_cfg1;
+
+	radio_evt_handler = evt_handler;
+	radio_state = RADIO_STATE_IDLE;
+	radio_evt_pending = 0;
+	radio_pkt_wr = 0;
+	radio_pkt_rd = 0;
+
+	trx8BitRegAccess(RADIO_READ_ACCESS, PKT_CFG1, &pkt_cfg1, 1);
+	pkt_cfg1 |= PKT_CFG1_APPEND_STATUS;
+	trx8BitRegAccess(RADIO_WRITE_ACCESS, PKT_CFG1, &pkt_cfg1, 1);
+
+	hal_gpio_cfg_input (RF_GDO0_PIN, HAL_GPIO_PULL_DISABLED);
+	NRF_GPIOTE->EVENTS_IN[GPIOTE_CH_USED_RADIO_DRV] = 0;
+	NRF_GPIOTE->CONFIG[GPIOTE_CH_USED_RADIO_DRV] =
+		GPIOTE_CONFIG_MODE_Event << GPIOTE_CONFIG_MODE_Pos|
+		GPIOTE_CONFIG_POLARITY_HiToLo << GPIOTE_CONFIG_POLARITY_Pos|
+		((RF_GDO0_PIN << GPIOTE_CONFIG_PSEL_Pos) & GPIOTE_CONFIG_PSEL_Msk);
+	NRF_GPIOTE->INTENSET = GPIOTE_INTENSET_IN0_Msk << GPIOTE_CH_USED_RADIO_DRV;
+
+	NVIC_ClearPendingIRQ(GPIOTE_IRQn);
+	NVIC_SetPriority(GPIOTE_IRQn, irq_priority);
+	NVIC_EnableIRQ(GPIOTE_IRQn);
+
+	return 0;
+}
+
+/******************************************************************************
+ * @fn         radio_send_async
+ *
+ * @brief      Copy a packet and send it without waiting. RADIO_EVT_TX_DONE
+ *             is given at the end of the packet, the radio is idle then.
+ *
+ * input parameters
+ *
+ * @param       uint8_t *payload
+ *              uint16_t payload_len
+ *
+ * output parameters
+ *
+ * @return      0 if started, -1 if a packet is being sent or received or
+ *              the SPI is taken
+ *
+ */
+int radio_send_async(uint8_t *payload, uint16_t payload_len) {
+
+	if(radio_is_busy() || (payload_len > RADIO_PKT_MAX_LEN)) {
+		return -1;
+	}
+
+	memcpy(radio_tx_buf, payload, payload_len);
+	radio_tx_len = payload_len;
+	radio_state = RADIO_STATE_TX_LOAD;
+
+#ifdef ENABLE_RANGE_EXTENDER
+	range_extender_txon();
+#endif
+
+	if(trxSpiCmdStrobeAsync(SIDLE, radio_tx_idle_done) == false) {
+		radio_state = RADIO_STATE_IDLE;
+		return -1;
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+ * @fn         radio_receive_async
+ *
+ * @brief      Enter RX without waiting. Every packet received is added to the
+ *             pool and RADIO_EVT_RX_DONE is given, the radio stays in RX.
  *
  * input parameters
  *
@@ -1050,23 +1298,100 @@ int radio_get_rssi_val (void)
  *
  * output parameters
  *
- * @return      void
+ * @return      0 if started, -1 if the SPI is taken
  *
  */
-//#pragma vector=RF_PORT_VECTOR
-//__interrupt void radio_isr(void) {
-//
-//	if(RF_GDO_PxIFG & RF_GDO_PIN) {
-//
-//		// Clear LPM0 bits from 0(SR)
-//		__bic_SR_register_on_exit(LPM3_bits);
-//
-//		// clear the interrupt flag
-//		RF_GDO_PxIFG &= ~RF_GDO_PIN;
-//
-//		// indicate that end of packet has been found
-//		rf_end_packet = 1;
-//	}
-//}
+int radio_receive_async(void) {
+
+#ifdef ENABLE_RANGE_EXTENDER
+	range_extender_rxon();
+#endif
+
+	radio_state = RADIO_STATE_RX_START;
+	if(trxSpiCmdStrobeAsync(SIDLE, radio_rx_idle_done) == false) {
+		radio_state = RADIO_STATE_IDLE;
+		return -1;
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+ * @fn         radio_pkt_get
+ *
+ * @brief      Get the oldest received packet in the pool
+ *
+ * output parameters
+ *
+ * @return      pointer to the packet, NULL if the pool is empty
+ *
+ */
+radio_pkt_t * radio_pkt_get(void) {
+
+	if(radio_pkt_wr == radio_pkt_rd) {
+		return NULL;
+	}
+	return &radio_pkt_pool[radio_pkt_rd & (RADIO_PKT_POOL_SIZE - 1)];
+}
+
+/******************************************************************************
+ * @fn         radio_pkt_release
+ *
+ * @brief      Return the oldest received packet to the pool
+ *
+ */
+void radio_pkt_release(void) {
+
+	if(radio_pkt_wr != radio_pkt_rd) {
+		radio_pkt_rd++;
+	}
+}
+
+/******************************************************************************
+ * @fn         radio_ISR
+ *
+ * @brief      Interrupt service routine for the end of packet on GDO0, also
+ *             used to pass on the events posted from the SPIM interrupt
+ *
+ */
+#if ISR_MANAGER == 1
+void radio_drv_gpiote_Handler(void)
+#else
+void GPIOTE_IRQHandler(void)
+#endif
+{
+	uint32_t evts;
+
+	if(NRF_GPIOTE->EVENTS_IN[GPIOTE_CH_USED_RADIO_DRV] == 1) {
+#if ISR_MANAGER == 0
+		NRF_GPIOTE->EVENTS_IN[GPIOTE_CH_USED_RADIO_DRV] = 0;
+		(void) NRF_GPIOTE->EVENTS_IN[GPIOTE_CH_USED_RADIO_DRV];
+#endif
+		if(radio_state == RADIO_STATE_RX) {
+			radio_state = RADIO_STATE_RX_READ;
+			if(trx16BitRegAccessAsync(RADIO_READ_ACCESS, 0x2F, (0xFF & NUM_RXBYTES),
+					&radio_rx_bytes, 1, radio_rx_len_done) == false) {
+				radio_chain_abort();
+			}
+		} else if(radio_state == RADIO_STATE_TX) {
+			radio_state = RADIO_STATE_IDLE;
+#ifdef ENABLE_RANGE_EXTENDER
+			range_extender_idle();
+#endif
+			radio_evt_post(RADIO_EVT_TX_DONE);
+		}
+	}
+
+	CRITICAL_REGION_ENTER();
+	evts = radio_evt_pending;
+	radio_evt_pending = 0;
+	CRITICAL_REGION_EXIT();
+
+	for(uint32_t evt = 0; evts != 0; evt++, evts >>= 1) {
+		if((evts & 1) && (radio_evt_handler != NULL)) {
+			radio_evt_handler((radio_evt_t) evt);
+		}
+	}
+}
 
 #endif
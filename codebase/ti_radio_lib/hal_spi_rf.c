@@ -44,17 +44,172 @@
 #include "hal_spim.h"
 
 #include "stdint.h"
+#include "stdbool.h"
 #include "string.h"
 #include "hal_gpio.h"
 #include "log.h"
 #include "hal_nop_delay.h"
+#include "nrf_util.h"
 
 
+/******************************************************************************
+ * LOCAL VARIABLES
+ */
+/* Address bytes of the ongoing access */
+static uint8_t trxHdr[2];
+/* Chip status byte clocked in with the first address byte */
+static uint8_t trxStatus;
+/* Address and data segments of the ongoing access */
+static hal_spim_seg_t trxSeg[2];
+/* Function to be called when the ongoing asynchronous access is done */
+static trxAccessDone_t trxDone;
+/* SPIM transfer of the ongoing access, queued along with other SPI devices.
+ * The device settings are filled in from the SPIM config at init. */
+static hal_spim_xfer_t trxXfer =
+{
+    .p_seg = trxSeg,
+};
+/* Set while an access is queued or ongoing */
+static volatile bool trxBusy = false;
+/* Where the chip status of the ongoing blocking access is to be stored */
+static volatile uint16_t * trxSyncResult;
+
+/* Value of a blocking access result till the access is done */
+#define TRX_SYNC_PENDING    0x100
+
 /******************************************************************************
  * LOCAL FUNCTIONS
  */
 //static void trxReadWriteBurstSingle(uint8_t addr,uint8_t *pData,uint16_t len) ;
 
+static void trxAccessDoneHandler(void * p_context)
+{
+    /* A new access can be started as soon as trxBusy is cleared */
+    trxAccessDone_t done = trxDone;
+    rfStatus_t status = trxStatus;
+
+    trxBusy = false;
+    if(done != NULL)
+    {
+        done(status);
+    }
+}
+
+static void trxSyncDoneHandler(rfStatus_t status)
+{
+    *trxSyncResult = status;
+}
+
+/*******************************************************************************
+ * @fn          trxRegAccessStart
+ *
+ * @brief       Starts a register access. The data is sent from or received
+ *              into pData directly by the SPIM EasyDMA in a second segment,
+ *              CS_N is held low in between. The access is claimed atomically,
+ *              so the blocking accessors and the asynchronous chains run
+ *              from the interrupts can't take over each other's access.
+ *
+ * input parameters
+ *
+ * @param       accessType - Read or write access, as in trx8BitRegAccess
+ * @param       pHdr       - Address bytes, copied once the access is claimed
+ * @param       hdrLen     - Number of address bytes, 1 or 2
+ * @param       pData      - data array
+ * @param       len        - Length of array to be read/written
+ * @param       done       - Function called on completion, can be NULL
+ * @param       pResult    - Where the chip status is stored by
+ *                           trxSyncDoneHandler, NULL for the async accesses
+ *
+ * output parameters
+ *
+ * @return      true if the access is queued, false if the previous access
+ *              is not done yet or the SPIM queue is full
+ */
+static bool trxRegAccessStart(uint8_t accessType, const uint8_t *pHdr, uint32_t hdrLen,
+        uint8_t *pData, uint16_t len, trxAccessDone_t done, volatile uint16_t *pResult)
+{
+  bool isFree;
+
+  CRITICAL_REGION_ENTER();
+  isFree = (trxBusy == false);
+  trxBusy = true;
+  CRITICAL_REGION_EXIT();
+  if(isFree == false)
+  {
+      return false;
+  }
+
+  memcpy(trxHdr, pHdr, hdrLen);
+  trxSeg[0].p_tx = trxHdr;
+  trxSeg[0].tx_len = hdrLen;
+  trxSeg[0].p_rx = &trxStatus;
+  trxSeg[0].rx_len = 1;
+
+  if((accessType&RADIO_READ_ACCESS) == RADIO_READ_ACCESS)
+  {
+      trxSeg[1].p_tx = NULL;
+      trxSeg[1].tx_len = 0;
+      trxSeg[1].p_rx = pData;
+      trxSeg[1].rx_len = len;
+  }
+  else
+  {
+      trxSeg[1].p_tx = pData;
+      trxSeg[1].tx_len = len;
+      trxSeg[1].p_rx = NULL;
+      trxSeg[1].rx_len = 0;
+  }
+
+  trxDone = done;
+  trxSyncResult = pResult;
+  trxXfer.seg_cnt = (len != 0) ? 2 : 1;
+  trxXfer.done_handler = trxAccessDoneHandler;
+  if(hal_spim_queue_xfer (&trxXfer) == false)
+  {
+      trxBusy = false;
+      return false;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ * @fn          trxRegAccessBlocking
+ *
+ * @brief       Does a register access and waits for it to be done. The
+ *              access is ended from the SPIM interrupt, so it is refused
+ *              where that interrupt can't preempt the caller. The status is
+ *              returned through a local, as an access from an interrupt can
+ *              start right after this one is done.
+ *
+ * input parameters
+ *
+ * @param       accessType - Read or write access, as in trx8BitRegAccess
+ * @param       pHdr       - Address bytes
+ * @param       hdrLen     - Number of address bytes, 1 or 2
+ * @param       pData      - data array
+ * @param       len        - Length of array to be read/written
+ *
+ * output parameters
+ *
+ * @return      chip status, TRX_STATUS_SPI_ERROR if the access is not done
+ */
+static rfStatus_t trxRegAccessBlocking(uint8_t accessType, const uint8_t *pHdr, uint32_t hdrLen, uint8_t *pData, uint16_t len)
+{
+  volatile uint16_t result = TRX_SYNC_PENDING;
+
+  if(hal_spim_is_irq_blocked())
+  {
+      return TRX_STATUS_SPI_ERROR;
+  }
+  if(trxRegAccessStart (accessType, pHdr, hdrLen, pData, len,
+          trxSyncDoneHandler, &result) == false)
+  {
+      return TRX_STATUS_SPI_ERROR;
+  }
+  while(result == TRX_SYNC_PENDING);
+  return (rfStatus_t) result;
+}
+
 void trxRfSpiInterfaceInit()
 {
     log_printf("%s\n", __func__);
@@ -78,6 +233,10 @@ void trxRfSpiInterfaceInit()
         
     };
     hal_spim_init (&default_spim_config);
+    trxXfer.csBar_pin = default_spim_config.csBar_pin;
+    trxXfer.freq = default_spim_config.freq;
+    trxXfer.spi_mode = default_spim_config.spi_mode;
+    trxXfer.byte_order = default_spim_config.byte_order;
     
 }
 
@@ -101,11 +260,12 @@ void trxRfSpiInterfaceInit()
  *
  * output parameters
  *
- * @return      chip status
+ * @return      chip status, TRX_STATUS_SPI_ERROR if the access is not done
  */
 rfStatus_t trx8BitRegAccess(uint8_t accessType, uint8_t addrByte, uint8_t *pData, uint16_t len)
 {
 	uint8_t readValue;
+	uint8_t hdr = accessType|addrByte;
 
 //	/* Pull CS_N low and wait for SO to go low before communication starts */
 //	RF_SPI_BEGIN();
@@ -118,29 +278,8 @@ rfStatus_t trx8BitRegAccess(uint8_t accessType, uint8_t addrByte, uint8_t *pData
 //	trxReadWriteBurstSingle(accessType|addrByte,pData,len);
 //	RF_SPI_END();
 //	/* return the status byte value */
-  uint8_t tx_buff[257];
-  tx_buff[0] = accessType|addrByte;
-  uint8_t rx_buff[257];
-  
-  
-  if((accessType&RADIO_READ_ACCESS) == RADIO_READ_ACCESS)  
-  {
-      memset (&tx_buff[1], 0x00, len);
-      hal_spim_tx_rx (tx_buff, len+1, rx_buff, 1 + len);
-      while(hal_spim_is_busy ());
-      memcpy(pData,rx_buff  + 1, len); 
-  }
-  else if((accessType&RADIO_WRITE_ACCESS) == RADIO_WRITE_ACCESS)
-  {
-      memcpy (&tx_buff[1], pData, len);
-      hal_spim_tx_rx (tx_buff, len+1, rx_buff, 2);
-      while(hal_spim_is_busy ());
-  }
-  
-//  ((uint8_t*)&status)[1]=rx_buff[0];
-//  ((uint8_t*)&status)[0]=rx_buff[1];
-  readValue = rx_buff[0];
-  
+  readValue = trxRegAccessBlocking (accessType, &hdr, 1, pData, len);
+
 	return(readValue);
 }
 
@@ -163,11 +302,12 @@ rfStatus_t trx8BitRegAccess(uint8_t accessType, uint8_t addrByte, uint8_t *pData
  *
  * output parameters
  *
- * @return      rfStatus_t
+ * @return      rfStatus_t, TRX_STATUS_SPI_ERROR if the access is not done
  */
 rfStatus_t trx16BitRegAccess(uint8_t accessType, uint8_t extAddr, uint8_t regAddr, uint8_t *pData, uint8_t len)
 {
 	uint8_t readValue = 0;
+	uint8_t hdr[2] = {accessType|extAddr, regAddr};
 
 //	RF_SPI_BEGIN();
 //	while(RF_PORT_IN & RF_MISO_PIN);
@@ -182,33 +322,66 @@ rfStatus_t trx16BitRegAccess(uint8_t accessType, uint8_t extAddr, uint8_t regAdd
 //	trxReadWriteBurstSingle(accessType|extAddr,pData,len);
 //	RF_SPI_END();
 	/* return the status byte value */
-    uint8_t tx_buff[257];
-    tx_buff[0] = accessType|extAddr;
-    tx_buff[1] = regAddr;
-    uint8_t rx_buff[257];
-
+    readValue = trxRegAccessBlocking (accessType, hdr, 2, pData, len);
 
-  if((accessType&RADIO_READ_ACCESS) == RADIO_READ_ACCESS)  
-  {
-      memset (&tx_buff[2], 0x00, len);
-      hal_spim_tx_rx (tx_buff, len+2, rx_buff, len+2);
-      while(hal_spim_is_busy ());
-      memcpy(pData, &rx_buff[2], len);   
-  }
-  else if((accessType&RADIO_WRITE_ACCESS) == RADIO_WRITE_ACCESS)
-  {
-      memcpy (&tx_buff[2], pData, len);
-      hal_spim_tx_rx (tx_buff, len+2, rx_buff, 2);
-      while(hal_spim_is_busy ());
-  }
-  
-//  ((uint8_t*)&status)[1]=rx_buff[0];
-//  ((uint8_t*)&status)[0]=rx_buff[1];
-    readValue = rx_buff[0];
-  
     return(readValue);
 }
 
+/*******************************************************************************
+ * @fn          trx8BitRegAccessAsync
+ *
+ * @brief       Non blocking version of trx8BitRegAccess. pData must stay
+ *              valid till done is called from the SPIM interrupt.
+ *
+ * input parameters
+ *
+ * @param       accessType - Specifies if this is a read or write and if it's
+ *                           a single or burst access.
+ * @param       addrByte - address byte of register.
+ * @param       pData    - data array
+ * @param       len      - Length of array to be read(TX)/written(RX)
+ * @param       done     - Function called with the chip status when done
+ *
+ * output parameters
+ *
+ * @return      true if the access is queued, false if the previous access
+ *              is not done yet or the SPIM queue is full
+ */
+bool trx8BitRegAccessAsync(uint8_t accessType, uint8_t addrByte, uint8_t *pData, uint16_t len, trxAccessDone_t done)
+{
+  uint8_t hdr = accessType|addrByte;
+
+  return trxRegAccessStart (accessType, &hdr, 1, pData, len, done, NULL);
+}
+
+/*******************************************************************************
+ * @fn          trx16BitRegAccessAsync
+ *
+ * @brief       Non blocking version of trx16BitRegAccess. pData must stay
+ *              valid till done is called from the SPIM interrupt.
+ *
+ * input parameters
+ *
+ * @param       accessType - Specifies if this is a read or write and if it's
+ *                           a single or burst access.
+ * @param       extAddr - Extended register space address = 0x2F.
+ * @param       regAddr - Register address in the extended address space.
+ * @param       *pData  - Pointer to data array for communication
+ * @param       len     - Length of bytes to be read/written from/to radio
+ * @param       done    - Function called with the chip status when done
+ *
+ * output parameters
+ *
+ * @return      true if the access is queued, false if the previous access
+ *              is not done yet or the SPIM queue is full
+ */
+bool trx16BitRegAccessAsync(uint8_t accessType, uint8_t extAddr, uint8_t regAddr, uint8_t *pData, uint8_t len, trxAccessDone_t done)
+{
+  uint8_t hdr[2] = {accessType|extAddr, regAddr};
+
+  return trxRegAccessStart (accessType, hdr, 2, pData, len, done, NULL);
+}
+
 /*******************************************************************************
  * @fn          trxSpiCmdStrobe
  *
@@ -222,7 +395,7 @@ rfStatus_t trx16BitRegAccess(uint8_t accessType, uint8_t extAddr, uint8_t regAdd
  *
  * output parameters
  *
- * @return      status byte
+ * @return      status byte, TRX_STATUS_SPI_ERROR if the strobe is not sent
  */
 rfStatus_t trxSpiCmdStrobe(uint8_t cmd)
 {
@@ -233,13 +406,33 @@ rfStatus_t trxSpiCmdStrobe(uint8_t cmd)
 //	RF_SPI_WAIT_DONE();
 //	rc = RF_SPI_RX();
 //	RF_SPI_END();
-    hal_spim_tx_rx (&cmd, 1, NULL, 0);
-    while(hal_spim_is_busy ());
-    rc = 0;
+    rc = trxRegAccessBlocking (RADIO_WRITE_ACCESS, &cmd, 1, NULL, 0);
 
     return(rc);
 }
 
+/*******************************************************************************
+ * @fn          trxSpiCmdStrobeAsync
+ *
+ * @brief       Non blocking version of trxSpiCmdStrobe. The strobe is queued
+ *              behind the other accesses, so a strobe after a FIFO access
+ *              is sent only once the FIFO access is done.
+ *
+ * input parameters
+ *
+ * @param       cmd  - command strobe
+ * @param       done - Function called with the chip status when done
+ *
+ * output parameters
+ *
+ * @return      true if the strobe is queued, false if the previous access
+ *              is not done yet or the SPIM queue is full
+ */
+bool trxSpiCmdStrobeAsync(uint8_t cmd, trxAccessDone_t done)
+{
+  return trxRegAccessStart (RADIO_WRITE_ACCESS, &cmd, 1, NULL, 0, done, NULL);
+}
+
 /*******************************************************************************
  * @fn          trxReadWriteBurstSingle
  *
@@ -35,7 +35,49 @@
  *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  *******************************************************************************/
+#ifndef RADIO_DRV_H
+#define RADIO_DRV_H
+
 #include "stdint.h"
+#include "stdbool.h"
+
+#if SYS_CFG_PRESENT == 1
+#include "sys_config.h"
+#endif
+
+#ifndef GPIOTE_CH_USED_RADIO_DRV
+/* GPIOTE channel used for the end of packet interrupt from GDO0 */
+#define GPIOTE_CH_USED_RADIO_DRV    0
+#endif
+
+#ifndef RADIO_PKT_POOL_SIZE
+/* Number of received packets buffered by the driver, must be a power of 2 */
+#define RADIO_PKT_POOL_SIZE         4
+#endif
+
+#ifndef RADIO_PKT_MAX_LEN
+/* Maximum payload length of a packet in the interrupt driven mode */
+#define RADIO_PKT_MAX_LEN           62
+#endif
+
+/* Events from the interrupt driven mode */
+typedef enum
+{
+    RADIO_EVT_TX_DONE,          /* Packet sent, the radio is idle */
+    RADIO_EVT_RX_DONE,          /* Packet added to the pool */
+    RADIO_EVT_RX_DROPPED,       /* Packet dropped for a bad length or a full pool */
+    RADIO_EVT_SPI_ERROR,        /* An SPI access could not be queued, the driver is idle */
+}radio_evt_t;
+
+/* Received packet along with the status bytes appended by the radio */
+typedef struct
+{
+    uint8_t len;                /* Payload length */
+    int8_t rssi;                /* RSSI in dBm */
+    uint8_t lqi;                /* Link quality indicator */
+    bool crc_ok;                /* CRC check status */
+    uint8_t data[RADIO_PKT_MAX_LEN + 2];
+}radio_pkt_t;
 
 
 /* Initialize the radio hardware */
@@ -59,9 +101,15 @@ int radio_read(uint8_t * buf, uint8_t *buf_len);
 /* Perform a Clear-Channel Assessment (CCA) to find out if channel is clear */
 int radio_channel_clear(void);
 
+/* CCA without waiting, the result is given from the SPIM interrupt */
+int radio_channel_clear_async(void (*cca_handler)(int result));
+
 /* Wait for radio to become idle (currently receiving or transmitting) */
 int radio_wait_for_idle(uint16_t max_hold);
 
+/* Check if the radio is sending or receiving a packet */
+int radio_is_busy(void);
+
 /* Check if the radio driver has just received a packet */
 int radio_pending_packet(void);
 
@@ -94,3 +142,20 @@ int radio_check_status_flag (uint8_t status_bits);
 
 /* Function to get RSSI Value */
 int radio_get_rssi_val  ();
+
+/* Start the interrupt driven mode with GDO0 on GPIOTE and queued SPI accesses */
+int radio_evt_init(uint32_t irq_priority, void (*evt_handler)(radio_evt_t evt));
+
+/* Copy and send a packet without waiting, RADIO_EVT_TX_DONE follows */
+int radio_send_async(uint8_t *payload, uint16_t payload_len);
+
+/* Enter receive mode without waiting, RADIO_EVT_RX_DONE follows each packet */
+int radio_receive_async(void);
+
+/* Get the oldest received packet in the pool, NULL if there is none */
+radio_pkt_t * radio_pkt_get(void);
+
+/* Return the oldest received packet to the pool */
+void radio_pkt_release(void);
+
+#endif /* RADIO_DRV_H */
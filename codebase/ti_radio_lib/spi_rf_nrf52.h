@@ -31,6 +31,8 @@
 #define RF_SCK_PIN  22
 #define RF_CS_PIN   23
 #define RF_RESET_PIN    24
+/* GPIO0 of the radio, configured as PKT_SYNC_RXTX */
+#define RF_GDO0_PIN     26
 
 #define LED1
 #define LED2
@@ -59,6 +61,9 @@ typedef struct
 
 typedef uint8_t rfStatus_t;
 
+/* Status returned when an access could not be done, CHIP_RDYn is set in it */
+#define TRX_STATUS_SPI_ERROR        0xFF
+
 void trxRfSpiInterfaceInit(void);
 rfStatus_t trx8BitRegAccess(uint8_t accessType, uint8_t addrByte, uint8_t *pData, uint16_t len);
 rfStatus_t trxSpiCmdStrobe(uint8_t cmd);
@@ -66,6 +71,14 @@ rfStatus_t trxSpiCmdStrobe(uint8_t cmd);
 /* CC112X specific prototype function */
 rfStatus_t trx16BitRegAccess(uint8_t accessType, uint8_t extAddr, uint8_t regAddr, uint8_t *pData, uint8_t len);
 
+/** Function called from the SPIM interrupt when an asynchronous register
+ *  access is done, with the chip status byte */
+typedef void (* trxAccessDone_t)(rfStatus_t status);
+
+bool trx8BitRegAccessAsync(uint8_t accessType, uint8_t addrByte, uint8_t *pData, uint16_t len, trxAccessDone_t done);
+bool trx16BitRegAccessAsync(uint8_t accessType, uint8_t extAddr, uint8_t regAddr, uint8_t *pData, uint8_t len, trxAccessDone_t done);
+bool trxSpiCmdStrobeAsync(uint8_t cmd, trxAccessDone_t done);
+
 
 #endif /* SPI_RF_NRF52_H */
 
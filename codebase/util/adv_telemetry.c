@@ -0,0 +1,121 @@
+/**
+ *  adv_telemetry.c : Device health to be sent in the advertising payload
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "adv_telemetry.h"
+#include "ms_timer.h"
+#include "string.h"
+
+/** ms timer ticks in a minute */
+#define TICKS_PER_MIN       MS_TIMER_TICKS_MS(60000)
+
+#define MIN_PER_HOUR        60
+#define MIN_PER_DAY         (24*60)
+
+/** Starting values of the age byte for hours and days */
+#define AGE_HOUR_BASE       59
+#define AGE_DAY_BASE        82
+#define AGE_MAX             254
+
+static struct
+{
+    uint8_t flags;
+    uint8_t battery;
+    uint16_t trig_cnt;
+    bool is_trig;
+    /** Age of the last trigger in minutes and the ticks in the ongoing one */
+    uint32_t age_min;
+    uint32_t age_ticks;
+    uint8_t last_enc[ADV_TELEMETRY_LEN];
+}telemetry;
+
+static uint8_t encode_age (void)
+{
+    uint32_t age;
+
+    if(telemetry.is_trig == false)
+    {
+        return ADV_TELEMETRY_AGE_NONE;
+    }
+
+    if(telemetry.age_min < MIN_PER_HOUR)
+    {
+        age = telemetry.age_min;
+    }
+    else if(telemetry.age_min < MIN_PER_DAY)
+    {
+        age = AGE_HOUR_BASE + telemetry.age_min/MIN_PER_HOUR;
+    }
+    else
+    {
+        age = AGE_DAY_BASE + telemetry.age_min/MIN_PER_DAY;
+    }
+    return (age > AGE_MAX) ? AGE_MAX : age;
+}
+
+void adv_telemetry_trig_add (void)
+{
+    if(telemetry.trig_cnt != UINT16_MAX)
+    {
+        telemetry.trig_cnt++;
+    }
+    telemetry.is_trig = true;
+    telemetry.age_min = 0;
+    telemetry.age_ticks = 0;
+}
+
+void adv_telemetry_add_tick (uint32_t ticks)
+{
+    telemetry.age_ticks += ticks;
+    if(telemetry.age_ticks >= TICKS_PER_MIN)
+    {
+        telemetry.age_min += telemetry.age_ticks/TICKS_PER_MIN;
+        telemetry.age_ticks %= TICKS_PER_MIN;
+    }
+}
+
+void adv_telemetry_set_battery (uint8_t battery)
+{
+    telemetry.battery = battery;
+}
+
+void adv_telemetry_set_flags (uint32_t flags, bool is_set)
+{
+    if(is_set)
+    {
+        telemetry.flags |= (flags & 0x0F);
+    }
+    else
+    {
+        telemetry.flags &= ~(flags & 0x0F);
+    }
+}
+
+bool adv_telemetry_encode (uint8_t * p_buf)
+{
+    bool is_changed;
+
+    p_buf[0] = (ADV_TELEMETRY_VER << 4) | telemetry.flags;
+    p_buf[1] = telemetry.battery;
+    p_buf[2] = (uint8_t) telemetry.trig_cnt;
+    p_buf[3] = (uint8_t) (telemetry.trig_cnt >> 8);
+    p_buf[4] = encode_age ();
+
+    is_changed = (memcmp (p_buf, telemetry.last_enc, ADV_TELEMETRY_LEN) != 0);
+    memcpy (telemetry.last_enc, p_buf, ADV_TELEMETRY_LEN);
+    return is_changed;
+}
@@ -0,0 +1,106 @@
+/**
+ *  adv_telemetry.h : Device health to be sent in the advertising payload
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup group_util
+ * @{
+ *
+ * @defgroup group_adv_telemetry Advertising telemetry
+ * @brief Module to keep the health of a device in a compact form which is
+ *  sent in the manufacturer specific data of the advertising payload, so
+ *  that a scanner can monitor many devices without connecting to them.
+ *
+ * The application counts the triggers with @ref adv_telemetry_trig_add,
+ *  passes the time with @ref adv_telemetry_add_tick and sets the battery and
+ *  the error flags. @ref adv_telemetry_encode gives the
+ *  @ref ADV_TELEMETRY_LEN bytes and tells if they changed since the last
+ *  call, so that the payload is updated only when required.
+ *
+ * Format of version @ref ADV_TELEMETRY_VER, all little endian
+ *  | Byte | Content                                                   |
+ *  |:----:|:----------------------------------------------------------|
+ *  | 0    | Version in the upper nibble, @ref adv_telemetry_flags_t   |
+ *  | 1    | Battery, 8 bit value of the ADC                           |
+ *  | 2-3  | Number of triggers since reset, saturates at 0xFFFF       |
+ *  | 4    | Age of the last trigger, see @ref adv_telemetry_encode    |
+ * @{
+ */
+
+#ifndef CODEBASE_UTIL_ADV_TELEMETRY_H_
+#define CODEBASE_UTIL_ADV_TELEMETRY_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+/** Version of the format of the telemetry */
+#define ADV_TELEMETRY_VER       1
+
+/** Number of bytes of the encoded telemetry */
+#define ADV_TELEMETRY_LEN       5
+
+/** Age byte when there has not been any trigger since reset */
+#define ADV_TELEMETRY_AGE_NONE  0xFF
+
+/** Error flags in the lower nibble of the first byte */
+typedef enum
+{
+    ADV_TELEMETRY_FLAG_WDT_RESET    = 0x01, ///< Last reset was by the watchdog
+    ADV_TELEMETRY_FLAG_LOW_BATT     = 0x02, ///< Battery below the threshold
+    ADV_TELEMETRY_FLAG_DEFAULT_CFG  = 0x04, ///< No stored config, default in use
+    ADV_TELEMETRY_FLAG_CPU_LOCKUP   = 0x08, ///< Last reset was by a CPU lockup
+}adv_telemetry_flags_t;
+
+/**
+ * @brief Function to count a trigger, which also restarts its age
+ */
+void adv_telemetry_trig_add (void);
+
+/**
+ * @brief Function to pass the time for the age of the last trigger
+ * @param ticks Time elapsed in ms timer ticks
+ */
+void adv_telemetry_add_tick (uint32_t ticks);
+
+/**
+ * @brief Function to set the battery value
+ * @param battery 8 bit battery value as given by aa_aaa_battery_status
+ */
+void adv_telemetry_set_battery (uint8_t battery);
+
+/**
+ * @brief Function to set or clear error flags
+ * @param flags Flags from @ref adv_telemetry_flags_t to be changed
+ * @param is_set True to set the flags, false to clear them
+ */
+void adv_telemetry_set_flags (uint32_t flags, bool is_set);
+
+/**
+ * @brief Function to encode the telemetry. The age of the last trigger is
+ *  0-59 for minutes, 60-82 for 1-23 hours, 83-253 for 1-171 days, 254 for
+ *  longer and @ref ADV_TELEMETRY_AGE_NONE if there is no trigger yet.
+ * @param p_buf Pointer to a buffer of @ref ADV_TELEMETRY_LEN bytes
+ * @return True if the encoded bytes differ from the previous call
+ */
+bool adv_telemetry_encode (uint8_t * p_buf);
+
+#endif /* CODEBASE_UTIL_ADV_TELEMETRY_H_ */
+
+/**
+ * @}
+ * @}
+ */
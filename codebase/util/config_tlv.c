@@ -0,0 +1,117 @@
+/**
+ *  config_tlv.c : Partial updates of a configuration with Type-Length-Value
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config_tlv.h"
+#include "nrf_assert.h"
+#include "string.h"
+
+static const config_tlv_field_t * field_find (const config_tlv_field_t * p_fields,
+        uint32_t field_cnt, uint8_t id)
+{
+    for(uint32_t i = 0; i < field_cnt; i++)
+    {
+        if(p_fields[i].id == id)
+        {
+            return &p_fields[i];
+        }
+    }
+    return NULL;
+}
+
+config_tlv_err_t config_tlv_apply (const config_tlv_field_t * p_fields,
+        uint32_t field_cnt, const uint8_t * p_tlv, uint32_t len,
+        void * p_cfg, uint32_t * p_changed)
+{
+    uint32_t pos;
+    uint32_t changed = 0;
+
+    ASSERT(field_cnt <= CONFIG_TLV_MAX_FIELDS);
+
+    //First pass to check all the entries before anything is changed
+    pos = 0;
+    while(pos < len)
+    {
+        const config_tlv_field_t * p_field;
+
+        if((pos + CONFIG_TLV_HDR_LEN) > len)
+        {
+            return CONFIG_TLV_ERR_TRUNC;
+        }
+        if((pos + CONFIG_TLV_HDR_LEN + p_tlv[pos + 1]) > len)
+        {
+            return CONFIG_TLV_ERR_TRUNC;
+        }
+
+        p_field = field_find (p_fields, field_cnt, p_tlv[pos]);
+        if(p_field == NULL)
+        {
+            return CONFIG_TLV_ERR_ID;
+        }
+        if(p_field->len != p_tlv[pos + 1])
+        {
+            return CONFIG_TLV_ERR_LEN;
+        }
+        if((p_field->is_valid != NULL) &&
+                (p_field->is_valid (&p_tlv[pos + CONFIG_TLV_HDR_LEN]) == false))
+        {
+            return CONFIG_TLV_ERR_VALUE;
+        }
+        pos += CONFIG_TLV_HDR_LEN + p_field->len;
+    }
+
+    pos = 0;
+    while(pos < len)
+    {
+        const config_tlv_field_t * p_field =
+                field_find (p_fields, field_cnt, p_tlv[pos]);
+        uint8_t * p_dest = (uint8_t *) p_cfg + p_field->offset;
+        const uint8_t * p_val = &p_tlv[pos + CONFIG_TLV_HDR_LEN];
+
+        if(memcmp (p_dest, p_val, p_field->len) != 0)
+        {
+            memcpy (p_dest, p_val, p_field->len);
+            changed |= (1UL << (p_field - p_fields));
+        }
+        pos += CONFIG_TLV_HDR_LEN + p_field->len;
+    }
+
+    if(p_changed != NULL)
+    {
+        *p_changed = changed;
+    }
+    return CONFIG_TLV_OK;
+}
+
+uint32_t config_tlv_diff (const config_tlv_field_t * p_fields,
+        uint32_t field_cnt, const void * p_old, const void * p_new)
+{
+    uint32_t changed = 0;
+
+    ASSERT(field_cnt <= CONFIG_TLV_MAX_FIELDS);
+
+    for(uint32_t i = 0; i < field_cnt; i++)
+    {
+        if(memcmp ((const uint8_t *) p_old + p_fields[i].offset,
+                (const uint8_t *) p_new + p_fields[i].offset,
+                p_fields[i].len) != 0)
+        {
+            changed |= (1UL << i);
+        }
+    }
+    return changed;
+}
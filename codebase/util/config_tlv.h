@@ -0,0 +1,110 @@
+/**
+ *  config_tlv.h : Partial updates of a configuration with Type-Length-Value
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @addtogroup group_util
+ * @{
+ *
+ * @defgroup group_config_tlv Configuration TLV
+ * @brief Module to change some of the fields of a configuration structure
+ *  with a sequence of {ID, length, value} entries, so that only the fields
+ *  changed by the user are sent, checked and applied.
+ *
+ * The application describes the fields of its configuration with a table of
+ *  @ref config_tlv_field_t. Each entry in the data is one byte of the field
+ *  ID, one byte of the length which must be that of the field and then the
+ *  value as laid out in the structure. The data is applied only if all its
+ *  entries are valid, so a configuration is never left half updated.
+ * @{
+ */
+
+#ifndef CODEBASE_UTIL_CONFIG_TLV_H_
+#define CODEBASE_UTIL_CONFIG_TLV_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+
+/** Bytes of the ID and length before the value of each entry */
+#define CONFIG_TLV_HDR_LEN      2
+
+/** Maximum number of fields in a table, one bit each in the changed mask */
+#define CONFIG_TLV_MAX_FIELDS   32
+
+/** Macro to define a field of a table from a member of the structure */
+#define CONFIG_TLV_FIELD(id, type, member, is_valid_func)               \
+    {(id), offsetof(type, member), sizeof(((type *) 0)->member), (is_valid_func)}
+
+/** Description of a field of the configuration structure */
+typedef struct
+{
+    /** ID of the field in the TLV data */
+    uint8_t id;
+    /** Offset of the field in the structure */
+    uint8_t offset;
+    /** Length of the field */
+    uint8_t len;
+    /** Function to check the value of the field, NULL if any value is fine */
+    bool (* is_valid) (const uint8_t * p_val);
+}config_tlv_field_t;
+
+/** Results of applying the TLV data */
+typedef enum
+{
+    CONFIG_TLV_OK,          ///< All entries applied
+    CONFIG_TLV_ERR_TRUNC,   ///< An entry goes beyond the end of the data
+    CONFIG_TLV_ERR_ID,      ///< An entry has an unknown field ID
+    CONFIG_TLV_ERR_LEN,     ///< An entry has a length different from its field
+    CONFIG_TLV_ERR_VALUE,   ///< An entry has a value which is not valid
+}config_tlv_err_t;
+
+/**
+ * @brief Function to apply TLV data to a configuration structure
+ * @param p_fields Table of the fields of the structure
+ * @param field_cnt Number of fields in the table, at most
+ *  @ref CONFIG_TLV_MAX_FIELDS
+ * @param p_tlv Pointer to the TLV data
+ * @param len Length of the TLV data
+ * @param p_cfg Pointer to the structure, changed only if all entries are valid
+ * @param p_changed Pointer where a mask is stored with the bit of the index in
+ *  the table set for every field whose value changed. Can be NULL.
+ * @return @ref CONFIG_TLV_OK or the first error found
+ */
+config_tlv_err_t config_tlv_apply (const config_tlv_field_t * p_fields,
+        uint32_t field_cnt, const uint8_t * p_tlv, uint32_t len,
+        void * p_cfg, uint32_t * p_changed);
+
+/**
+ * @brief Function to find the fields which differ between two structures
+ * @param p_fields Table of the fields of the structure
+ * @param field_cnt Number of fields in the table, at most
+ *  @ref CONFIG_TLV_MAX_FIELDS
+ * @param p_old Pointer to one structure
+ * @param p_new Pointer to the other structure
+ * @return Mask with the bit of the index in the table set for every field
+ *  which is different
+ */
+uint32_t config_tlv_diff (const config_tlv_field_t * p_fields,
+        uint32_t field_cnt, const void * p_old, const void * p_new);
+
+#endif /* CODEBASE_UTIL_CONFIG_TLV_H_ */
+
+/**
+ * @}
+ * @}
+ */
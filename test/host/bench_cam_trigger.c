@@ -0,0 +1,90 @@
+/*
+ *  bench_cam_trigger.c : Host benchmark of the compiling of the configs of
+ *  the camera triggers into their patterns
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "cam_trigger.h"
+#include "cam_trigger_sim.h"
+
+/** Number of random configs, each compiled once per round */
+#define BENCH_CONFIGS   4096
+#define BENCH_ROUNDS    256
+
+static cam_trigger_config_t configs[BENCH_CONFIGS];
+
+void assert_nrf_callback (uint16_t line_num, const uint8_t * file_name)
+{
+}
+
+static void done_handler (uint32_t setup_number)
+{
+}
+
+static double seconds_now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main (void)
+{
+    cam_trigger_setup_t setup =
+    {
+        .focus_pin = CAM_TRIGGER_SIM_FOCUS_PIN,
+        .trigger_pin = CAM_TRIGGER_SIM_TRIGGER_PIN,
+        .cam_trigger_done_handler = done_handler,
+    };
+    double start;
+
+    if(cam_trigger_sim_init () == false)
+    {
+        return 1;
+    }
+    cam_trigger_init (&setup);
+
+    srand (42);
+    for(uint32_t i = 0; i < BENCH_CONFIGS; i++)
+    {
+        configs[i].trig_mode = rand () % (CAM_TRIGGER_NO_PRESS + 1);
+        configs[i].trig_param1 = rand () % 600;
+        configs[i].trig_param2 = rand ();
+        configs[i].trig_duration_100ms = rand () % 36000;
+        configs[i].setup_number = rand () % CAM_TRIGGER_MAX_SETUP_NO;
+        configs[i].pre_focus_en = rand () % 2;
+        configs[i].trig_press_duration_100ms = rand () % 10;
+        configs[i].prf_press_duration_100ms = rand () % 10;
+    }
+
+    start = seconds_now ();
+    for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for(uint32_t i = 0; i < BENCH_CONFIGS; i++)
+        {
+            cam_trigger_set_trigger (&configs[i]);
+        }
+    }
+    printf ("cam_trigger: %.0f configs/s\n",
+            (BENCH_CONFIGS*(double) BENCH_ROUNDS)/(seconds_now () - start));
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ *  cam_trigger_sim.c : Simulated ms timer and pins for the host tests of
+ *  the camera triggers
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "cam_trigger_sim.h"
+#include "cam_trigger_plan.h"
+#include "ms_timer.h"
+#include "hal_gpio.h"
+
+/** The page with the RTC used by the ms timer */
+#define RTC_PAGE_ADDR       ((uintptr_t) CONCAT_2(NRF_RTC, RTC_USED_MS_TIMER) & ~0xFFFUL)
+#define RTC_PAGE_SIZE       0x1000
+/** The count of the RTC, only read by the codebase */
+#define RTC_COUNTER         (*(volatile uint32_t *) \
+        &CONCAT_2(NRF_RTC, RTC_USED_MS_TIMER)->COUNTER)
+
+/** External definition of the count read, for the calls not inlined */
+extern inline uint32_t ms_timer_get_current_count (void);
+
+cam_trigger_sim_trace_t cam_trigger_sim_trace;
+
+static uint64_t now_ticks;
+static uint32_t timer_left;
+static void (* timer_handler) (void);
+
+static void counter_update (void)
+{
+    RTC_COUNTER = now_ticks & 0x00FFFFFF;
+}
+
+void ms_timer_init (uint32_t irq_priority)
+{
+}
+
+void ms_timer_start (ms_timer_num id, ms_timer_mode mode, uint64_t ticks,
+        void (* handler) (void))
+{
+    if(ticks < CAM_TRIGGER_PLAN_MIN_TICKS)
+    {
+        cam_trigger_sim_trace.short_timer_cnt++;
+    }
+    timer_left = ticks;
+    timer_handler = handler;
+}
+
+void ms_timer_stop (ms_timer_num id)
+{
+    timer_handler = NULL;
+}
+
+bool ms_timer_get_on_status (ms_timer_num id)
+{
+    return (timer_handler != NULL);
+}
+
+void hal_gpio_cfg_output (uint32_t pin_num, uint32_t init_val)
+{
+    hal_gpio_pin_write (pin_num, init_val);
+}
+
+void hal_gpio_pin_write (uint32_t pin_num, uint32_t val)
+{
+    cam_trigger_sim_trace_t * p_trace = &cam_trigger_sim_trace;
+    bool * p_level = (pin_num == CAM_TRIGGER_SIM_FOCUS_PIN)
+            ? &p_trace->focus : &p_trace->trigger;
+
+    if((*p_level != (val != 0)) && (p_trace->edge_cnt < CAM_TRIGGER_SIM_MAX_EDGES))
+    {
+        p_trace->edges[p_trace->edge_cnt].ticks = now_ticks;
+        p_trace->edges[p_trace->edge_cnt].pin = pin_num;
+        p_trace->edges[p_trace->edge_cnt].level = (val != 0);
+        p_trace->edge_cnt++;
+    }
+    *p_level = (val != 0);
+}
+
+bool cam_trigger_sim_init (void)
+{
+    void * p_rtc = mmap ((void *) RTC_PAGE_ADDR, RTC_PAGE_SIZE,
+            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE,
+            -1, 0);
+
+    if(p_rtc != (void *) RTC_PAGE_ADDR)
+    {
+        printf ("RTC can't be mapped at 0x%lx\n", (unsigned long) RTC_PAGE_ADDR);
+        return false;
+    }
+    cam_trigger_sim_reset ();
+    return true;
+}
+
+void cam_trigger_sim_reset (void)
+{
+    bool focus = cam_trigger_sim_trace.focus;
+    bool trigger = cam_trigger_sim_trace.trigger;
+
+    //The pins keep their levels across runs
+    memset (&cam_trigger_sim_trace, 0, sizeof(cam_trigger_sim_trace));
+    cam_trigger_sim_trace.focus = focus;
+    cam_trigger_sim_trace.trigger = trigger;
+    now_ticks = 0;
+    timer_handler = NULL;
+    counter_update ();
+}
+
+bool cam_trigger_sim_expire (void)
+{
+    void (* handler) (void) = timer_handler;
+
+    if(handler == NULL)
+    {
+        return false;
+    }
+    now_ticks += timer_left;
+    counter_update ();
+    timer_handler = NULL;
+    handler ();
+    return true;
+}
+
+void cam_trigger_sim_advance (uint32_t ticks)
+{
+    timer_left -= ticks;
+    now_ticks += ticks;
+    counter_update ();
+}
+
+uint32_t cam_trigger_sim_ticks_left (void)
+{
+    return timer_left;
+}
+
+uint64_t cam_trigger_sim_now (void)
+{
+    return now_ticks;
+}
@@ -0,0 +1,89 @@
+/*
+ *  cam_trigger_sim.h : Simulated ms timer and pins for the host tests of
+ *  the camera triggers
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAM_TRIGGER_SIM_H
+#define CAM_TRIGGER_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Pins given to the camera trigger module */
+#define CAM_TRIGGER_SIM_FOCUS_PIN       3
+#define CAM_TRIGGER_SIM_TRIGGER_PIN     4
+
+/** Maximum number of changes of the pins kept from a run */
+#define CAM_TRIGGER_SIM_MAX_EDGES       256
+
+/** A change of the level of a pin */
+typedef struct
+{
+    /** Ticks of the ms timer from the reset of the simulation */
+    uint64_t ticks;
+    uint32_t pin;
+    bool level;
+}cam_trigger_sim_edge_t;
+
+/** The pins and the timer seen during a run */
+typedef struct
+{
+    cam_trigger_sim_edge_t edges[CAM_TRIGGER_SIM_MAX_EDGES];
+    uint32_t edge_cnt;
+    /** Times the ms timer was started for less than the minimum ticks */
+    uint32_t short_timer_cnt;
+    bool focus;
+    bool trigger;
+}cam_trigger_sim_trace_t;
+
+extern cam_trigger_sim_trace_t cam_trigger_sim_trace;
+
+/**
+ * @brief Map the counter of the RTC of the ms timer, which is read directly
+ *  by the out pattern generator
+ * @return True if the RTC could be mapped at its address in the nRF52810
+ */
+bool cam_trigger_sim_init (void);
+
+/**
+ * @brief Clear the trace, the time and the timer of the simulation
+ */
+void cam_trigger_sim_reset (void);
+
+/**
+ * @brief Let the running timer expire and call its handler
+ * @return False if no timer is running
+ */
+bool cam_trigger_sim_expire (void);
+
+/**
+ * @brief Let time pass, less than the ticks left for the running timer
+ * @param ticks The number of ticks of the ms timer
+ */
+void cam_trigger_sim_advance (uint32_t ticks);
+
+/**
+ * @return The ticks left for the running timer to expire
+ */
+uint32_t cam_trigger_sim_ticks_left (void);
+
+/**
+ * @return The ticks of the ms timer from the reset of the simulation
+ */
+uint64_t cam_trigger_sim_now (void);
+
+#endif /* CAM_TRIGGER_SIM_H */
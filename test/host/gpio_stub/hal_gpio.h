@@ -0,0 +1,30 @@
+/*
+ *  hal_gpio.h : Stand-in of the GPIO HAL for the host tests, with the pins
+ *  written to the simulation of the test instead of the GPIO registers
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CODEBASE_HAL_HAL_GPIO_H_
+#define CODEBASE_HAL_HAL_GPIO_H_
+
+#include <stdint.h>
+
+/** Only the functions used by the modules built in the host tests */
+void hal_gpio_cfg_output (uint32_t pin_num, uint32_t init_val);
+
+void hal_gpio_pin_write (uint32_t pin_num, uint32_t val);
+
+#endif /* CODEBASE_HAL_HAL_GPIO_H_ */
@@ -0,0 +1,424 @@
+/*
+ *  test_cam_trigger.c : Host test of the patterns of the camera triggers,
+ *  with random configs run on a simulated ms timer
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cam_trigger.h"
+#include "cam_trigger_plan.h"
+#include "ms_timer.h"
+#include "cam_trigger_sim.h"
+#include "test_util.h"
+
+/** Number of random configs run */
+#define RANDOM_RUNS     100000
+
+/** Maximum number of parts of an expected pattern */
+#define MODEL_MAX_PARTS (OUT_GEN_MAX_TRANSITIONS + 2*CAM_TRIGGER_PLAN_MAX_EXTN + 4)
+
+/** A part of an expected pattern with the levels of the pins during it */
+typedef struct
+{
+    uint64_t ticks;
+    bool focus;
+    bool trigger;
+}model_part_t;
+
+/** Pattern expected for a config, worked out from the config alone */
+typedef struct
+{
+    model_part_t parts[MODEL_MAX_PARTS];
+    uint32_t cnt;
+    /** False if a part is lengthened to the minimum or shots are left out */
+    bool is_exact;
+    /** True if the whole pattern is expected to last the configured duration */
+    bool is_duration_kept;
+}model_t;
+
+static uint32_t assert_cnt;
+static uint32_t handler_cnt;
+static uint32_t handler_setup;
+
+void assert_nrf_callback (uint16_t line_num, const uint8_t * file_name)
+{
+    assert_cnt++;
+}
+
+static void done_handler (uint32_t setup_number)
+{
+    handler_cnt++;
+    handler_setup = setup_number;
+}
+
+/** Add a part as is */
+static void model_add_raw (model_t * p_model, uint64_t ticks, bool focus, bool trigger)
+{
+    p_model->parts[p_model->cnt].ticks = ticks;
+    p_model->parts[p_model->cnt].focus = focus;
+    p_model->parts[p_model->cnt].trigger = trigger;
+    p_model->cnt++;
+}
+
+/** Add a part which is lengthened if it is too short for the ms timer */
+static uint64_t model_add (model_t * p_model, uint64_t ticks, bool focus, bool trigger)
+{
+    if(ticks < CAM_TRIGGER_PLAN_MIN_TICKS)
+    {
+        ticks = CAM_TRIGGER_PLAN_MIN_TICKS;
+        p_model->is_exact = false;
+    }
+    model_add_raw (p_model, ticks, focus, trigger);
+    return ticks;
+}
+
+static uint64_t rest (uint64_t total, uint64_t used)
+{
+    return (total > used) ? (total - used) : 0;
+}
+
+/**
+ * Work out the pattern of a config. A video with an extension time is
+ * extended extn_cnt times, at the ticks in extn_at from the start of its
+ * last part.
+ */
+static void model_build (const cam_trigger_config_t * p_config,
+        uint32_t extn_cnt, const uint32_t * extn_at, model_t * p_model)
+{
+    const uint64_t itt = MS_TIMER_TICKS_MS(p_config->trig_duration_100ms * 100);
+    const uint64_t press = MS_TIMER_TICKS_MS(p_config->trig_press_duration_100ms * 100);
+    uint64_t pre_focus = 2;
+    uint64_t used = 0;
+
+    memset (p_model, 0, sizeof(model_t));
+    p_model->is_exact = true;
+
+    if(p_config->pre_focus_en)
+    {
+        pre_focus = MS_TIMER_TICKS_MS(p_config->prf_press_duration_100ms * 100);
+    }
+    if((pre_focus != 0) && (p_config->trig_mode != CAM_TRIGGER_NO_PRESS))
+    {
+        used += model_add (p_model, pre_focus, 0, 1);
+    }
+
+    switch(p_config->trig_mode)
+    {
+    case CAM_TRIGGER_SINGLE_SHOT:
+        used += model_add (p_model, press, 0, 0);
+        break;
+    case CAM_TRIGGER_MULTI_SHOT:
+    {
+        const uint64_t interval = MS_TIMER_TICKS_MS(p_config->trig_param1 * 100);
+        uint32_t shots = p_config->trig_param2;
+
+        if(shots > CAM_TRIGGER_PLAN_MAX_SHOTS)
+        {
+            shots = CAM_TRIGGER_PLAN_MAX_SHOTS;
+            p_model->is_exact = false;
+        }
+        for(uint32_t i = 0; i < shots; i++)
+        {
+            used += model_add (p_model, press, 0, 0);
+            if(i != (shots - 1))
+            {
+                used += model_add (p_model, rest (interval, press), 1, 1);
+            }
+        }
+        break;
+    }
+    case CAM_TRIGGER_LONG_PRESS:
+        used += model_add (p_model, MS_TIMER_TICKS_MS((p_config->trig_param1
+                | (p_config->trig_param2 << 16)) * 100), 0, 0);
+        break;
+    case CAM_TRIGGER_VIDEO:
+    {
+        const uint64_t len = MS_TIMER_TICKS_MS(p_config->trig_param1 * 1000);
+        const uint64_t extn = MS_TIMER_TICKS_MS(p_config->trig_param2 * 1000);
+        const uint64_t end_part = MS_TIMER_TICKS_MS(CAM_TRIGGER_PLAN_VIDEO_END_PART_MS);
+        const uint64_t end_pulse = MS_TIMER_TICKS_MS(CAM_TRIGGER_PLAN_VIDEO_END_PULSE_MS);
+        uint64_t extended = 0;
+
+        used += model_add (p_model, press, 0, 1);
+        if(extn == 0)
+        {
+            used += model_add (p_model, len, 1, 1);
+            used += model_add (p_model, end_pulse, 0, 1);
+            break;
+        }
+
+        used += model_add (p_model, rest (len, end_part), 1, 1);
+        used += end_part + end_pulse;
+        //An extension runs from the time the last part had run till then
+        for(uint32_t i = 0; i < extn_cnt; i++)
+        {
+            model_add_raw (p_model, extn_at[i], 1, 1);
+            extended += extn_at[i];
+            extended += model_add (p_model, (extn > extn_at[i]) ?
+                    (extn - extn_at[i]) : extn, 1, 1);
+        }
+        model_add_raw (p_model, end_part, 1, 1);
+        model_add_raw (p_model, end_pulse, 0, 1);
+
+        if((itt != 0) && (itt < (used + CAM_TRIGGER_PLAN_MIN_TICKS)))
+        {
+            p_model->is_exact = false;
+        }
+        //The rest of the inter trigger time after the extensions done
+        if(rest (itt, used + extn_cnt*extn) < CAM_TRIGGER_PLAN_MIN_TICKS)
+        {
+            model_add_raw (p_model, CAM_TRIGGER_PLAN_MIN_TICKS, 1, 1);
+        }
+        else
+        {
+            model_add_raw (p_model, itt - (used + extn_cnt*extn), 1, 1);
+            p_model->is_duration_kept = (extended == extn_cnt*extn);
+        }
+        p_model->is_duration_kept &= p_model->is_exact;
+        return;
+    }
+    case CAM_TRIGGER_HALF_PRESS:
+        used += model_add (p_model, press, 0, 1);
+        break;
+    case CAM_TRIGGER_NO_PRESS:
+        break;
+    }
+
+    if(itt == 0)
+    {
+        model_add_raw (p_model, CAM_TRIGGER_PLAN_MIN_TICKS, 1, 1);
+    }
+    else
+    {
+        used += model_add (p_model, rest (itt, used), 1, 1);
+        p_model->is_duration_kept = p_model->is_exact;
+    }
+}
+
+/** Compare the changes of the pins in the run with the ones of the model */
+static void model_check (const model_t * p_model)
+{
+    const cam_trigger_sim_trace_t * p_trace = &cam_trigger_sim_trace;
+    cam_trigger_sim_edge_t edges[CAM_TRIGGER_SIM_MAX_EDGES];
+    uint32_t edge_cnt = 0;
+    bool focus = 1, trigger = 1;
+    uint64_t ticks = 0;
+
+    for(uint32_t i = 0; i <= p_model->cnt; i++)
+    {
+        //Pins are idle after the pattern
+        bool next_focus = (i == p_model->cnt) ? 1 : p_model->parts[i].focus;
+        bool next_trigger = (i == p_model->cnt) ? 1 : p_model->parts[i].trigger;
+
+        if(next_focus != focus)
+        {
+            edges[edge_cnt++] = (cam_trigger_sim_edge_t)
+                {.ticks = ticks, .pin = CAM_TRIGGER_SIM_FOCUS_PIN, .level = next_focus};
+        }
+        if(next_trigger != trigger)
+        {
+            edges[edge_cnt++] = (cam_trigger_sim_edge_t)
+                {.ticks = ticks, .pin = CAM_TRIGGER_SIM_TRIGGER_PIN, .level = next_trigger};
+        }
+        focus = next_focus;
+        trigger = next_trigger;
+        if(i != p_model->cnt)
+        {
+            ticks += p_model->parts[i].ticks;
+        }
+    }
+
+    CHECK_EQ(cam_trigger_sim_now (), ticks);
+    CHECK_EQ(p_trace->edge_cnt, edge_cnt);
+    for(uint32_t i = 0; (i < edge_cnt) && (i < p_trace->edge_cnt); i++)
+    {
+        CHECK_EQ(p_trace->edges[i].ticks, edges[i].ticks);
+        CHECK_EQ(p_trace->edges[i].pin, edges[i].pin);
+        CHECK_EQ(p_trace->edges[i].level, edges[i].level);
+    }
+}
+
+/** Check that a pin stays at a level for at least the minimum ticks */
+static void gaps_check (void)
+{
+    const cam_trigger_sim_trace_t * p_trace = &cam_trigger_sim_trace;
+    uint64_t last_ticks[2] = {0, 0};
+    bool is_changed[2] = {false, false};
+
+    CHECK_EQ(p_trace->short_timer_cnt, 0);
+    for(uint32_t i = 0; i < p_trace->edge_cnt; i++)
+    {
+        uint32_t pin = (p_trace->edges[i].pin == CAM_TRIGGER_SIM_TRIGGER_PIN);
+
+        if(is_changed[pin])
+        {
+            CHECK(p_trace->edges[i].ticks >=
+                    (last_ticks[pin] + CAM_TRIGGER_PLAN_MIN_TICKS));
+        }
+        last_ticks[pin] = p_trace->edges[i].ticks;
+        is_changed[pin] = true;
+    }
+    CHECK_EQ(p_trace->focus, 1);
+    CHECK_EQ(p_trace->trigger, 1);
+}
+
+/**
+ * Run a config till it is done, extending a video up to extn_want times
+ * at a random time of its last part
+ */
+static void config_run (cam_trigger_config_t * p_config, uint32_t extn_want)
+{
+    uint32_t extn_at[CAM_TRIGGER_PLAN_MAX_EXTN];
+    uint32_t extn_cnt = 0;
+    uint32_t handler_done = 0;
+    model_t model;
+
+    cam_trigger_set_trigger (p_config);
+    cam_trigger_sim_reset ();
+    handler_cnt = 0;
+
+    cam_trigger (p_config->setup_number);
+    CHECK(cam_trigger_is_on ());
+    while(cam_trigger_sim_expire ())
+    {
+        if((handler_cnt != handler_done) && cam_trigger_is_on ())
+        {
+            //The last part of the video is open for an extension
+            handler_done = handler_cnt;
+            CHECK(extn_cnt < CAM_TRIGGER_PLAN_MAX_EXTN);
+            if((extn_cnt < extn_want) && (extn_cnt < CAM_TRIGGER_PLAN_MAX_EXTN))
+            {
+                extn_at[extn_cnt] = rand () % cam_trigger_sim_ticks_left ();
+                cam_trigger_sim_advance (extn_at[extn_cnt]);
+                extn_cnt++;
+                cam_trigger (p_config->setup_number);
+            }
+        }
+    }
+    CHECK_EQ(cam_trigger_is_on (), false);
+    CHECK_EQ(handler_cnt, handler_done + 1);
+    CHECK_EQ(handler_setup, p_config->setup_number);
+
+    model_build (p_config, extn_cnt, extn_at, &model);
+    model_check (&model);
+    gaps_check ();
+    if(model.is_duration_kept)
+    {
+        CHECK_EQ(cam_trigger_sim_now (),
+                MS_TIMER_TICKS_MS(p_config->trig_duration_100ms * 100));
+    }
+}
+
+/** Check a single shot with the pre focus against its ticks worked out by hand */
+static void test_single_shot (void)
+{
+    cam_trigger_config_t config =
+    {
+        .trig_mode = CAM_TRIGGER_SINGLE_SHOT,
+        .trig_duration_100ms = 10,
+        .setup_number = 2,
+        .pre_focus_en = true,
+        .trig_press_duration_100ms = 3,
+        .prf_press_duration_100ms = 2,
+    };
+    const cam_trigger_sim_trace_t * p_trace = &cam_trigger_sim_trace;
+
+    config_run (&config, 0);
+    CHECK_EQ(p_trace->edge_cnt, 4);
+    //Focus and then the trigger pressed, released together after 500 ms
+    CHECK_EQ(p_trace->edges[0].ticks, 0);
+    CHECK_EQ(p_trace->edges[0].pin, CAM_TRIGGER_SIM_FOCUS_PIN);
+    CHECK_EQ(p_trace->edges[1].ticks, 6554);
+    CHECK_EQ(p_trace->edges[1].pin, CAM_TRIGGER_SIM_TRIGGER_PIN);
+    CHECK_EQ(p_trace->edges[2].ticks, 6554 + 9830);
+    CHECK_EQ(p_trace->edges[3].ticks, 6554 + 9830);
+    CHECK_EQ(cam_trigger_sim_now (), 32768);
+}
+
+/** Check a video extended till it can't be extended anymore */
+static void test_video_extend (void)
+{
+    cam_trigger_config_t config =
+    {
+        .trig_mode = CAM_TRIGGER_VIDEO,
+        .trig_param1 = 10,
+        .trig_param2 = 5,
+        .trig_duration_100ms = 600,
+        .setup_number = 7,
+        .trig_press_duration_100ms = 3,
+    };
+
+    config_run (&config, CAM_TRIGGER_PLAN_MAX_EXTN + 1);
+    //Three extensions of 5 s, done at random times, within the minute
+    CHECK_EQ(cam_trigger_sim_now (), 60*32768);
+}
+
+/** A value of a field of the config, often one of the smallest */
+static uint32_t rand_val (uint32_t max)
+{
+    uint32_t val = ((rand () % 4) == 0) ? (rand () % 3) : rand ();
+
+    return (max == 0) ? val : (val % (max + 1));
+}
+
+/** Check the invariants of the patterns of random configs */
+static void test_random (void)
+{
+    srand (42);
+    for(uint32_t run = 0; run < RANDOM_RUNS; run++)
+    {
+        cam_trigger_config_t config =
+        {
+            .trig_mode = rand () % (CAM_TRIGGER_NO_PRESS + 1),
+            .trig_param1 = rand_val (UINT16_MAX),
+            .trig_param2 = rand_val (UINT8_MAX),
+            //Mostly less than an hour, with the whole range at times
+            .trig_duration_100ms = ((rand () % 8) == 0) ?
+                    (((uint32_t) rand () << 16) ^ rand ()) : rand_val (36000),
+            .setup_number = rand () % CAM_TRIGGER_MAX_SETUP_NO,
+            .pre_focus_en = rand () % 2,
+            .trig_press_duration_100ms = rand_val (UINT8_MAX),
+            .prf_press_duration_100ms = rand_val (UINT8_MAX),
+        };
+
+        config_run (&config, rand () % (CAM_TRIGGER_PLAN_MAX_EXTN + 2));
+    }
+}
+
+int main (void)
+{
+    cam_trigger_setup_t setup =
+    {
+        .focus_pin = CAM_TRIGGER_SIM_FOCUS_PIN,
+        .trigger_pin = CAM_TRIGGER_SIM_TRIGGER_PIN,
+        .cam_trigger_done_handler = done_handler,
+    };
+
+    if(cam_trigger_sim_init () == false)
+    {
+        return 1;
+    }
+    cam_trigger_init (&setup);
+
+    test_single_shot ();
+    test_video_extend ();
+    test_random ();
+    CHECK_EQ(assert_cnt, 0);
+    return test_util_result ("cam_trigger");
+}
@@ -0,0 +1,203 @@
+/*
+ *  test_config_tlv.c : Host test of the parser of the configuration TLV
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_tlv.h"
+#include "test_util.h"
+
+/** Number of random TLV data applied */
+#define RANDOM_RUNS     100000
+
+/** Fields with the IDs from 1, the last ones to have a full table */
+#define BYTE_FIELDS     (CONFIG_TLV_MAX_FIELDS - 2)
+#define BYTE_ID_BASE    0x10
+
+typedef struct
+{
+    uint8_t mode;
+    uint16_t interval;
+    uint8_t bytes[BYTE_FIELDS];
+}__attribute__ ((packed)) test_cfg_t;
+
+/** One more than the maximum, for the check of the number of fields */
+static config_tlv_field_t fields[CONFIG_TLV_MAX_FIELDS + 1];
+static uint32_t assert_cnt;
+
+void assert_nrf_callback (uint16_t line_num, const uint8_t * file_name)
+{
+    assert_cnt++;
+}
+
+static bool mode_is_valid (const uint8_t * p_val)
+{
+    return (*p_val < 3);
+}
+
+static void fields_init (void)
+{
+    const config_tlv_field_t mode_field =
+        CONFIG_TLV_FIELD(1, test_cfg_t, mode, mode_is_valid);
+    const config_tlv_field_t interval_field =
+        CONFIG_TLV_FIELD(2, test_cfg_t, interval, NULL);
+
+    fields[0] = mode_field;
+    fields[1] = interval_field;
+    for(uint32_t i = 0; i < BYTE_FIELDS; i++)
+    {
+        fields[2 + i].id = BYTE_ID_BASE + i;
+        fields[2 + i].offset = offsetof(test_cfg_t, bytes) + i;
+        fields[2 + i].len = 1;
+        fields[2 + i].is_valid = NULL;
+    }
+}
+
+/** Check the fields applied and the mask of the ones changed */
+static void test_apply (void)
+{
+    test_cfg_t cfg;
+    uint32_t changed;
+    const uint8_t mode_interval[] = {1, 1, 2,   2, 2, 0x34, 0x12};
+    const uint8_t last_field[] = {BYTE_ID_BASE + BYTE_FIELDS - 1, 1, 0xA5};
+
+    memset (&cfg, 0, sizeof(cfg));
+    CHECK_EQ(config_tlv_apply (fields, CONFIG_TLV_MAX_FIELDS, mode_interval,
+            sizeof(mode_interval), &cfg, &changed), CONFIG_TLV_OK);
+    CHECK_EQ(cfg.mode, 2);
+    CHECK_EQ(cfg.interval, 0x1234);
+    CHECK_EQ(changed, 0x3);
+
+    //The same values again change nothing
+    CHECK_EQ(config_tlv_apply (fields, CONFIG_TLV_MAX_FIELDS, mode_interval,
+            sizeof(mode_interval), &cfg, &changed), CONFIG_TLV_OK);
+    CHECK_EQ(changed, 0);
+
+    //The last field of a full table has the top bit of the mask
+    CHECK_EQ(config_tlv_apply (fields, CONFIG_TLV_MAX_FIELDS, last_field,
+            sizeof(last_field), &cfg, &changed), CONFIG_TLV_OK);
+    CHECK_EQ(cfg.bytes[BYTE_FIELDS - 1], 0xA5);
+    CHECK_EQ(changed, 0x80000000UL);
+
+    //Nothing to apply
+    CHECK_EQ(config_tlv_apply (fields, CONFIG_TLV_MAX_FIELDS, NULL, 0,
+            &cfg, NULL), CONFIG_TLV_OK);
+    CHECK_EQ(assert_cnt, 0);
+}
+
+/** Check that data with an error found after a valid entry changes nothing */
+static void test_errors (void)
+{
+    const struct
+    {
+        uint8_t tlv[8];
+        uint32_t len;
+        config_tlv_err_t err;
+    }cases[] =
+    {
+        {{1, 1, 0,   2}, 4, CONFIG_TLV_ERR_TRUNC},
+        {{1, 1, 0,   2, 2, 0x34}, 6, CONFIG_TLV_ERR_TRUNC},
+        {{1, 1, 0,   0x7F, 1, 0}, 6, CONFIG_TLV_ERR_ID},
+        {{1, 1, 0,   2, 1, 0}, 6, CONFIG_TLV_ERR_LEN},
+        {{2, 2, 0, 0,   1, 1, 3}, 7, CONFIG_TLV_ERR_VALUE},
+    };
+
+    for(uint32_t i = 0; i < sizeof(cases)/sizeof(cases[0]); i++)
+    {
+        test_cfg_t cfg, cfg_before;
+        uint32_t changed = 0xDEAD;
+
+        memset (&cfg, 0x55, sizeof(cfg));
+        memcpy (&cfg_before, &cfg, sizeof(cfg));
+        CHECK_EQ(config_tlv_apply (fields, CONFIG_TLV_MAX_FIELDS, cases[i].tlv,
+                cases[i].len, &cfg, &changed), cases[i].err);
+        CHECK_EQ(memcmp (&cfg, &cfg_before, sizeof(cfg)), 0);
+        CHECK_EQ(changed, 0xDEAD);
+    }
+}
+
+/** Check that random data is either applied in full or changes nothing */
+static void test_random (void)
+{
+    uint32_t ok_cnt = 0;
+
+    srand (42);
+    for(uint32_t run = 0; run < RANDOM_RUNS; run++)
+    {
+        uint8_t tlv[16];
+        uint32_t len = rand () % (sizeof(tlv) + 1);
+        test_cfg_t cfg, cfg_before;
+        uint32_t changed = 0;
+
+        for(uint32_t i = 0; i < len; i++)
+        {
+            //Mostly IDs and lengths which exist, so that some data is valid
+            tlv[i] = ((rand () % 4) == 0) ? rand () : (rand () % 3);
+        }
+        memset (&cfg, 0, sizeof(cfg));
+        memcpy (&cfg_before, &cfg, sizeof(cfg));
+        if(config_tlv_apply (fields, CONFIG_TLV_MAX_FIELDS, tlv, len,
+                &cfg, &changed) == CONFIG_TLV_OK)
+        {
+            uint32_t diff = config_tlv_diff (fields, CONFIG_TLV_MAX_FIELDS,
+                    &cfg_before, &cfg);
+
+            ok_cnt++;
+            //A field written twice can be back to its value before
+            CHECK_EQ(changed & diff, diff);
+        }
+        else
+        {
+            CHECK_EQ(memcmp (&cfg, &cfg_before, sizeof(cfg)), 0);
+        }
+    }
+    CHECK(ok_cnt > RANDOM_RUNS/100);
+}
+
+/** Check the fields found different, up to the last of a full table */
+static void test_diff (void)
+{
+    test_cfg_t cfg_old, cfg_new;
+
+    memset (&cfg_old, 0, sizeof(cfg_old));
+    memcpy (&cfg_new, &cfg_old, sizeof(cfg_new));
+    CHECK_EQ(config_tlv_diff (fields, CONFIG_TLV_MAX_FIELDS, &cfg_old, &cfg_new), 0);
+
+    cfg_new.interval = 1;
+    cfg_new.bytes[BYTE_FIELDS - 1] = 1;
+    CHECK_EQ(config_tlv_diff (fields, CONFIG_TLV_MAX_FIELDS, &cfg_old, &cfg_new),
+            0x80000002UL);
+    CHECK_EQ(assert_cnt, 0);
+
+    //More fields than bits in the mask
+    config_tlv_diff (fields, CONFIG_TLV_MAX_FIELDS + 1, &cfg_old, &cfg_new);
+    CHECK_EQ(assert_cnt, 1);
+    config_tlv_apply (fields, CONFIG_TLV_MAX_FIELDS + 1, NULL, 0, &cfg_new, NULL);
+    CHECK_EQ(assert_cnt, 2);
+}
+
+int main (void)
+{
+    fields_init ();
+    test_apply ();
+    test_errors ();
+    test_random ();
+    test_diff ();
+    return test_util_result ("config_tlv");
+}
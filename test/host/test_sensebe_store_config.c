@@ -0,0 +1,223 @@
+/*
+ *  test_sensebe_store_config.c : Host test of the journal of the SenseBe Tx
+ *  configuration in flash
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "sensebe_store_config.h"
+#include "hal_nvmc.h"
+#include "test_util.h"
+
+/** The page of the configs, mapped at its address in the nRF52810 */
+#define FLASH_PAGE_ADDR     0x27000
+#define FLASH_PAGE_SIZE     0x1000
+/** Words of a slot of a full config in the earlier format */
+#define OLD_SLOT_WORDS      6
+/** Word after the slots of the configs, the end of the journal */
+#define CONFIG_END_WORD     (165*OLD_SLOT_WORDS)
+/** Word with the firmware version, which the module places 8 words after
+ *  the end of the configs */
+#define FW_VER_WORD         (CONFIG_END_WORD + OLD_SLOT_WORDS + 2)
+/** Tag in the upper half word of the header of a record */
+#define RECORD_TAG          0xC5F0UL
+
+/** Words in a record of a config with len bytes */
+#define RECORD_WORDS(len)   (1 + ((len) + 3)/4)
+
+static uint32_t * p_flash;
+static uint32_t words_written;
+static uint32_t pages_erased;
+
+uint32_t hal_nvmc_erase_page (uint32_t page_start_address)
+{
+    CHECK_EQ(page_start_address, FLASH_PAGE_ADDR);
+    memset (p_flash, 0xFF, FLASH_PAGE_SIZE);
+    pages_erased++;
+    return 0;
+}
+
+void hal_nvmc_write_data (void * p_destination, void * p_source, uint32_t size_of_data)
+{
+    uint8_t * p_dest = p_destination;
+    const uint8_t * p_src = p_source;
+
+    CHECK_EQ(((uintptr_t) p_destination) % 4, 0);
+    CHECK((p_dest >= (uint8_t *) p_flash) &&
+          ((p_dest + size_of_data) <= ((uint8_t *) p_flash + FLASH_PAGE_SIZE)));
+    for(uint32_t i = 0; i < size_of_data; i++)
+    {
+        //Flash is written only once after an erase
+        CHECK_EQ(p_dest[i], 0xFF);
+        p_dest[i] &= p_src[i];
+    }
+    words_written += (size_of_data + 3)/4;
+}
+
+/** Erase the page with the firmware version of this build written */
+static void flash_reset (void)
+{
+    memset (p_flash, 0xFF, FLASH_PAGE_SIZE);
+    p_flash[FW_VER_WORD] = FW_VER;
+    words_written = 0;
+    pages_erased = 0;
+}
+
+static void config_default (sensebe_config_t * p_config)
+{
+    memset (p_config, 0, sizeof(sensebe_config_t));
+    p_config->trig_conf = MOTION_ONLY;
+    p_config->cam_trigs[RADIO_ALL].mode = 2;
+    p_config->cam_trigs[RADIO_ALL].larger_value = 30;
+    p_config->speed = FAST;
+    p_config->timer_conf.timer_interval = 50;
+    p_config->ir_tx_conf.is_enable = 1;
+    p_config->ir_tx_conf.ir_tx_speed = 1;
+    p_config->ir_tx_conf.ir_tx_pwr = 2;
+}
+
+static void check_last_config (const sensebe_config_t * p_config)
+{
+    CHECK_EQ(memcmp (sensebe_store_config_get_last_config (), p_config,
+            sizeof(sensebe_config_t)), 0);
+}
+
+/** Check that the first config is written in full and the later ones only
+ *  from the first to the last byte changed */
+static void test_records (void)
+{
+    sensebe_config_t config;
+
+    flash_reset ();
+    sensebe_store_config_check_fw_ver ();
+    CHECK_EQ(sensebe_store_config_is_memory_empty (), true);
+
+    config_default (&config);
+    sensebe_store_config_write (&config);
+    CHECK_EQ(words_written, RECORD_WORDS(sizeof(sensebe_config_t)));
+    CHECK_EQ(p_flash[0] >> 16, RECORD_TAG);
+    check_last_config (&config);
+
+    //One field of 2 bytes
+    words_written = 0;
+    config.timer_conf.timer_interval = 300;
+    sensebe_store_config_write (&config);
+    CHECK_EQ(words_written, RECORD_WORDS(2));
+    check_last_config (&config);
+
+    //Nothing written without a change
+    words_written = 0;
+    sensebe_store_config_write (&config);
+    CHECK_EQ(words_written, 0);
+
+    //The first and the last field
+    config.trig_conf = MOTION_AND_TIMER;
+    config.ir_tx_conf.ir_tx_pwr = 1;
+    sensebe_store_config_write (&config);
+    CHECK_EQ(words_written, RECORD_WORDS(sizeof(sensebe_config_t)));
+    check_last_config (&config);
+    CHECK_EQ(pages_erased, 0);
+}
+
+/** Check that a full journal starts again with the full config */
+static void test_compaction (void)
+{
+    sensebe_config_t config;
+    uint32_t writes = 0;
+
+    flash_reset ();
+    config_default (&config);
+    sensebe_store_config_write (&config);
+    while(pages_erased == 0)
+    {
+        config.timer_conf.timer_interval++;
+        sensebe_store_config_write (&config);
+        check_last_config (&config);
+        writes++;
+    }
+    //Three times the full configs of the earlier format, the last one erases
+    CHECK_EQ(writes, (CONFIG_END_WORD - RECORD_WORDS(sizeof(sensebe_config_t)))
+            /RECORD_WORDS(2) + 1);
+    CHECK_EQ(p_flash[0], (RECORD_TAG << 16) | sizeof(sensebe_config_t));
+    CHECK_EQ(p_flash[FW_VER_WORD], FW_VER);
+
+    config.speed = SLOWMO;
+    sensebe_store_config_write (&config);
+    check_last_config (&config);
+    CHECK_EQ(pages_erased, 1);
+}
+
+/** Check that the last of the configs in the earlier format is kept */
+static void test_old_format (void)
+{
+    sensebe_config_t config;
+
+    flash_reset ();
+    config_default (&config);
+    for(uint32_t slot = 0; slot < 3; slot++)
+    {
+        config.timer_conf.timer_interval = 100 + slot;
+        memcpy (&p_flash[slot*OLD_SLOT_WORDS], &config, sizeof(sensebe_config_t));
+    }
+
+    sensebe_store_config_check_fw_ver ();
+    CHECK_EQ(pages_erased, 1);
+    CHECK_EQ(p_flash[0] >> 16, RECORD_TAG);
+    CHECK_EQ(p_flash[FW_VER_WORD], FW_VER);
+    check_last_config (&config);
+
+    //Converted only once
+    sensebe_store_config_check_fw_ver ();
+    CHECK_EQ(pages_erased, 1);
+    check_last_config (&config);
+}
+
+/** Check that the configs of another major version are erased */
+static void test_fw_major (void)
+{
+    sensebe_config_t config;
+
+    flash_reset ();
+    config_default (&config);
+    sensebe_store_config_write (&config);
+    p_flash[FW_VER_WORD] = FW_VER + 10000;
+
+    sensebe_store_config_check_fw_ver ();
+    CHECK_EQ(pages_erased, 1);
+    CHECK_EQ(sensebe_store_config_is_memory_empty (), true);
+    CHECK_EQ(p_flash[FW_VER_WORD], FW_VER);
+}
+
+int main (void)
+{
+    p_flash = mmap ((void *) FLASH_PAGE_ADDR, FLASH_PAGE_SIZE,
+            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE,
+            -1, 0);
+    if(p_flash != (uint32_t *) FLASH_PAGE_ADDR)
+    {
+        printf ("Flash page can't be mapped at 0x%x\n", FLASH_PAGE_ADDR);
+        return 1;
+    }
+
+    test_records ();
+    test_compaction ();
+    test_old_format ();
+    test_fw_major ();
+    return test_util_result ("sensebe_store_config");
+}
@@ -0,0 +1,284 @@
+/*
+ *  test_time_tracker.c : Host test of the dates and the time log of time_tracker
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "time_tracker.h"
+#include "test_util.h"
+
+/** Days from 1970-01-01 checked, a century and its leap days */
+#define DAYS_CHECKED    (100*365 + 25)
+
+/** Log of the NVM logger simulated with only its last entry */
+typedef struct
+{
+    uint32_t entry_size;
+    uint32_t start_page;
+    uint32_t no_pages;
+    uint32_t total_entries;
+    uint8_t last_entry[16];
+}sim_log_t;
+
+static sim_log_t sim_logs[NVM_LOGGER_MAX_LOGS];
+static uint32_t released_log;
+
+uint32_t nvm_logger_log_init (log_config_t * log_config)
+{
+    sim_log_t * p_log = &sim_logs[log_config->log_id];
+
+    if((p_log->entry_size != log_config->entry_size) ||
+       (p_log->start_page != log_config->start_page))
+    {
+        memset (p_log, 0, sizeof(sim_log_t));
+        p_log->entry_size = log_config->entry_size;
+        p_log->start_page = log_config->start_page;
+        p_log->no_pages = log_config->no_of_pages;
+    }
+    return log_config->log_id;
+}
+
+void nvm_logger_feed_data (uint32_t log_id, void * data)
+{
+    memcpy (sim_logs[log_id].last_entry, data, sim_logs[log_id].entry_size);
+    sim_logs[log_id].total_entries++;
+}
+
+void nvm_logger_fetch_tail_data (uint32_t log_id, void * dest_loc, uint32_t entry_no)
+{
+    memcpy (dest_loc, sim_logs[log_id].last_entry, sim_logs[log_id].entry_size);
+}
+
+bool nvm_logger_is_log_empty (uint32_t log_id)
+{
+    return (sim_logs[log_id].total_entries == 0);
+}
+
+uint32_t nvm_logger_get_entry_size (uint32_t log_id)
+{
+    return sim_logs[log_id].entry_size;
+}
+
+uint32_t nvm_logger_get_log_at_page (uint32_t page_addr)
+{
+    for(uint32_t log_no = 0; log_no < NVM_LOGGER_MAX_LOGS; log_no++)
+    {
+        if((sim_logs[log_no].no_pages != 0) && (sim_logs[log_no].start_page == page_addr))
+        {
+            return log_no;
+        }
+    }
+    return NVM_LOGGER_MAX_LOGS;
+}
+
+void nvm_logger_release_log (uint32_t log_id)
+{
+    memset (&sim_logs[log_id], 0, sizeof(sim_log_t));
+    released_log = log_id;
+}
+
+/** Simulated clocks, with the crystal running as soon as it is requested */
+static bool is_xtal_requested;
+static bool is_lfclk_rc = true;
+static uint32_t cal_started;
+static bool is_cal_done;
+
+void hfclk_xtal_request (hfclk_xtal_user_t user, void (* ready_handler)(void))
+{
+    CHECK_EQ(user, HFCLK_XTAL_USER_TIME_TRACKER);
+    is_xtal_requested = true;
+    ready_handler ();
+}
+
+void hfclk_xtal_release (hfclk_xtal_user_t user)
+{
+    CHECK_EQ(user, HFCLK_XTAL_USER_TIME_TRACKER);
+    is_xtal_requested = false;
+}
+
+bool lfclk_rc_calibration_start (void)
+{
+    if((is_lfclk_rc == false) || (is_xtal_requested == false))
+    {
+        return false;
+    }
+    cal_started++;
+    is_cal_done = false;
+    return true;
+}
+
+bool lfclk_rc_calibration_is_done (void)
+{
+    return is_cal_done;
+}
+
+/** Check the conversions against gmtime() for every day of a century */
+static void test_dates (void)
+{
+    for(uint32_t days = 0; days < DAYS_CHECKED; days++)
+    {
+        time_t t = (time_t) days*TIME_TRACKER_DAY_LEN_S;
+        struct tm * p_tm = gmtime (&t);
+        uint32_t year, month, day;
+
+        CHECK_EQ(time_tracker_days_from_date (p_tm->tm_year + 1900,
+                p_tm->tm_mon + 1, p_tm->tm_mday), days);
+        time_tracker_date_from_days (days, &year, &month, &day);
+        CHECK_EQ(year, p_tm->tm_year + 1900);
+        CHECK_EQ(month, p_tm->tm_mon + 1);
+        CHECK_EQ(day, p_tm->tm_mday);
+    }
+}
+
+/** Check that the current date and time follow the ticks added */
+static void test_update (void)
+{
+    time_tracker_ddmmyy_t date = {.dd = 31, .mm = 12, .yy = 23};
+    time_tracker_ddmmyy_t * p_date;
+
+    memset (sim_logs, 0, sizeof(sim_logs));
+    time_tracker_init (0);
+    CHECK_EQ(time_tracker_get_epoch_s (), TIME_TRACKER_TIME_NOT_SET);
+
+    time_tracker_set_date_time (&date, TIME_TRACKER_DAY_LEN_S - 1);
+    time_tracker_update_time (MS_TIMER_FREQ);
+    p_date = time_tracker_get_current_date ();
+    CHECK_EQ(p_date->dd, 1);
+    CHECK_EQ(p_date->mm, 1);
+    CHECK_EQ(p_date->yy, 24);
+    CHECK_EQ(time_tracker_get_current_time_s (), 0);
+
+    //A day at each update, past the leap day
+    for(uint32_t days = 0; days < 31 + 29; days++)
+    {
+        time_tracker_update_time (TIME_TRACKER_DAY_LEN_S*(uint32_t) MS_TIMER_FREQ);
+    }
+    p_date = time_tracker_get_current_date ();
+    CHECK_EQ(p_date->dd, 1);
+    CHECK_EQ(p_date->mm, 3);
+    CHECK_EQ(p_date->yy, 24);
+}
+
+/** Check that the last time of the log of older firmware is carried over */
+static void test_old_log (void)
+{
+    struct
+    {
+        uint32_t log_time;
+        time_tracker_ddmmyy_t log_date;
+    }old_entry = {.log_time = 3723*MS_TIMER_FREQ, .log_date = {.dd = 29, .mm = 2, .yy = 24}};
+    sim_log_t * p_old = &sim_logs[1];
+    uint32_t id;
+
+    memset (sim_logs, 0, sizeof(sim_logs));
+    released_log = NVM_LOGGER_MAX_LOGS;
+    p_old->entry_size = sizeof(old_entry);
+    p_old->start_page = TIME_TRACKER_OLD_NVM_PAGE_USED_0;
+    p_old->no_pages = 2;
+    p_old->total_entries = 10;
+    memcpy (p_old->last_entry, &old_entry, sizeof(old_entry));
+
+    id = time_tracker_init (1);
+    CHECK_EQ(released_log, 1);
+    CHECK_EQ(id, 1);
+    CHECK_EQ(sim_logs[id].start_page, TIME_TRACKER_NVM_PAGE_USED_0);
+    CHECK_EQ(time_tracker_get_epoch_s (),
+            time_tracker_days_from_date (2024, 2, 29)*TIME_TRACKER_DAY_LEN_S + 3723);
+    //The time carried over is the first entry of the new log
+    CHECK_EQ(nvm_logger_is_log_empty (id), false);
+
+    //Restarting finds only the new log
+    released_log = NVM_LOGGER_MAX_LOGS;
+    time_tracker_init (1);
+    CHECK_EQ(released_log, NVM_LOGGER_MAX_LOGS);
+    CHECK_EQ(time_tracker_get_epoch_s (),
+            time_tracker_days_from_date (2024, 2, 29)*TIME_TRACKER_DAY_LEN_S + 3723);
+}
+
+/** Check that the crystal is requested for a calibration till it is done */
+static void test_calibration (void)
+{
+    const uint32_t interval = MS_TIMER_TICKS_MS(TIME_TRACKER_LFRC_CAL_INTERVAL_S*1000);
+
+    memset (sim_logs, 0, sizeof(sim_logs));
+    time_tracker_init (0);
+    cal_started = 0;
+
+    time_tracker_update_time (interval - 1);
+    CHECK_EQ(cal_started, 0);
+    CHECK_EQ(is_xtal_requested, false);
+    time_tracker_update_time (1);
+    CHECK_EQ(cal_started, 1);
+    CHECK_EQ(is_xtal_requested, true);
+    //Kept till the calibration is found done
+    time_tracker_update_time (interval);
+    CHECK_EQ(is_xtal_requested, true);
+    is_cal_done = true;
+    time_tracker_update_time (1);
+    CHECK_EQ(is_xtal_requested, false);
+    CHECK_EQ(cal_started, 1);
+
+    //Not requested again once the LF clock is found not to be from RC
+    is_lfclk_rc = false;
+    time_tracker_update_time (interval);
+    CHECK_EQ(is_xtal_requested, false);
+    time_tracker_update_time (interval);
+    CHECK_EQ(is_xtal_requested, false);
+    CHECK_EQ(cal_started, 1);
+    is_lfclk_rc = true;
+}
+
+/** Check that the drift is estimated, corrected and restored from the log */
+static void test_drift (void)
+{
+    //An LF clock 20 ppm fast over 2 days
+    const uint32_t days = 2;
+    const uint32_t fast_ticks = (TIME_TRACKER_DAY_LEN_S*(uint32_t) MS_TIMER_FREQ)/50000;
+    uint32_t start_s = time_tracker_days_from_date (2024, 6, 1)*TIME_TRACKER_DAY_LEN_S;
+    int32_t drift;
+
+    memset (sim_logs, 0, sizeof(sim_logs));
+    time_tracker_init (0);
+    time_tracker_set_epoch_s (start_s);
+    for(uint32_t day = 0; day < days; day++)
+    {
+        time_tracker_update_time (TIME_TRACKER_DAY_LEN_S*(uint32_t) MS_TIMER_FREQ + fast_ticks);
+    }
+    CHECK_EQ(time_tracker_get_drift_ppb (), 0);
+    time_tracker_set_epoch_s (start_s + days*TIME_TRACKER_DAY_LEN_S);
+    drift = time_tracker_get_drift_ppb ();
+    CHECK(drift > 19900 && drift < 20100);
+
+    //Restored at init and used to correct the ticks added
+    time_tracker_init (0);
+    CHECK_EQ(time_tracker_get_drift_ppb (), drift);
+    CHECK_EQ(time_tracker_get_epoch_s (), start_s + days*TIME_TRACKER_DAY_LEN_S);
+    time_tracker_update_time (TIME_TRACKER_DAY_LEN_S*(uint32_t) MS_TIMER_FREQ + fast_ticks);
+    CHECK_EQ(time_tracker_get_epoch_s (), start_s + (days + 1)*TIME_TRACKER_DAY_LEN_S);
+}
+
+int main (void)
+{
+    test_dates ();
+    test_update ();
+    test_old_log ();
+    test_calibration ();
+    test_drift ();
+    return test_util_result ("time_tracker");
+}
@@ -0,0 +1,53 @@
+/*
+ *  test_util.h : Checks shared by the host tests
+ *  Copyright (C) 2019  Appiko
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+
+/** Number of checks which failed in the test */
+static unsigned int test_util_failures;
+
+/** Check that two integer values are equal, report where they are not */
+#define CHECK_EQ(actual, expected)                                          \
+    do                                                                      \
+    {                                                                       \
+        long long act_val = (long long) (actual);                           \
+        long long exp_val = (long long) (expected);                         \
+        if(act_val != exp_val)                                              \
+        {                                                                   \
+            if(test_util_failures++ < 20)                                   \
+            {                                                               \
+                printf ("%s:%d: %s is %lld, expected %lld\n", __FILE__,     \
+                        __LINE__, #actual, act_val, exp_val);               \
+            }                                                               \
+        }                                                                   \
+    } while(0)
+
+/** Check that a condition is true */
+#define CHECK(cond)         CHECK_EQ(!!(cond), 1)
+
+/** Print the result of a test and get the exit status of its program */
+static inline int test_util_result (const char * name)
+{
+    printf ("%s: %s\n", name, (test_util_failures == 0) ? "passed" : "FAILED");
+    return (test_util_failures == 0) ? 0 : 1;
+}
+
+#endif /* TEST_UTIL_H */
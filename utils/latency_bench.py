@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+#  latency_bench.py : Trigger latency distributions from a GPIO trace capture
+#  Copyright (C) 2019  Appiko
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+"""Trigger latency benchmark for the SenseBe Rx to SenseBe Tx radio path.
+
+Build the firmwares with the latency trace enabled,
+    sensebe_rx : make LATENCY_TRACE=1 LATENCY_BENCH=1
+    sensebe_tx : make LATENCY_TRACE=1
+and connect a logic analyzer to GPIO1 and GPIO2 of both the boards with a
+common ground. In benchmark mode the SenseBe Rx injects a detection every
+5 s plus a random part of the listen interval. Each stage toggles its own pin:
+    detect   : SenseBe Rx GPIO1, motion detected
+    tx       : SenseBe Rx GPIO2, first radio transmission started
+    rx       : SenseBe Tx GPIO1, packet address matched (PPI, no CPU latency)
+    cam      : SenseBe Tx GPIO2, camera trigger pattern started
+
+Export the capture as CSV with the time in seconds in the first column and
+one column per channel, either one row per sample (sigrok-cli -O csv:time=true)
+or one row per transition (Saleae). Then run
+    latency_bench.py capture.csv --detect 0 --tx 1 --rx 2 --cam 3
+"""
+
+import argparse
+import csv
+import sys
+
+STAGES = ("detect", "tx", "rx", "cam")
+
+
+def read_edges(path, columns):
+    """Return a list of edge times in seconds for each of the given columns"""
+    edges = [[] for _ in columns]
+    last = [None for _ in columns]
+    with open(path, newline="") as fp:
+        for row in csv.reader(fp):
+            if not row or row[0].startswith(";") or row[0].startswith("#"):
+                continue
+            try:
+                time = float(row[0])
+                values = [int(float(row[c + 1])) for c in columns]
+            except (ValueError, IndexError):
+                #Header row
+                continue
+            for i, val in enumerate(values):
+                if last[i] is not None and val != last[i]:
+                    edges[i].append(time)
+                last[i] = val
+    return edges
+
+
+def first_after(edges, start, end, pos):
+    """Return the first edge in [start, end] at or after index pos, and its index"""
+    while pos < len(edges) and edges[pos] < start:
+        pos += 1
+    if pos < len(edges) and edges[pos] <= end:
+        return edges[pos], pos
+    return None, pos
+
+
+def match_trials(edges, timeout):
+    """Follow every detection through the later stages within the timeout"""
+    trials = []
+    pos = [0 for _ in STAGES]
+    for detect in edges[0]:
+        times = [detect]
+        for stage in range(1, len(STAGES)):
+            time, pos[stage] = first_after(edges[stage], times[-1],
+                                           detect + timeout, pos[stage])
+            if time is None:
+                break
+            times.append(time)
+        trials.append(times)
+    return trials
+
+
+def percentile(data, pct):
+    idx = min(len(data) - 1, int(round(pct / 100.0 * (len(data) - 1))))
+    return data[idx]
+
+
+def print_stats(name, data):
+    if not data:
+        print("%-12s %7d" % (name, 0))
+        return
+    data = sorted(data)
+    print("%-12s %7d %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f" % (name, len(data),
+          data[0], sum(data) / len(data), percentile(data, 50),
+          percentile(data, 90), percentile(data, 99), data[-1]))
+
+
+def print_histogram(data, bins):
+    if not data:
+        return
+    low = min(data)
+    width = max((max(data) - low) / bins, 1.0)
+    counts = [0] * bins
+    for val in data:
+        counts[min(bins - 1, int((val - low) / width))] += 1
+    scale = 60.0 / max(counts)
+    print("\nEnd to end latency histogram (us)")
+    for i, cnt in enumerate(counts):
+        print("%9.1f %6d %s" % (low + i * width, cnt, "#" * int(cnt * scale)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", help="CSV export of the logic analyzer")
+    for stage, default in zip(STAGES, range(len(STAGES))):
+        parser.add_argument("--" + stage, type=int, default=default,
+                            help="channel of the %s stage" % stage)
+    parser.add_argument("--timeout", type=float, default=1.0,
+                        help="max time in s from detection to camera trigger")
+    parser.add_argument("--bins", type=int, default=20,
+                        help="number of bins in the histogram")
+    parser.add_argument("--out", help="write the per trial latencies to a CSV")
+    args = parser.parse_args()
+
+    edges = read_edges(args.capture, [getattr(args, s) for s in STAGES])
+    trials = match_trials(edges, args.timeout)
+    if not trials:
+        sys.exit("No detections found in " + args.capture)
+
+    names = ["detect->tx", "tx->rx", "rx->cam", "detect->cam"]
+    deltas = [[] for _ in names]
+    for times in trials:
+        us = [(t - times[0]) * 1e6 for t in times]
+        for stage in range(1, len(us)):
+            deltas[stage - 1].append(us[stage] - us[stage - 1])
+        if len(us) == len(STAGES):
+            deltas[-1].append(us[-1])
+
+    print("Trials %d, complete %d" % (len(trials), len(deltas[-1])))
+    for stage in range(1, len(STAGES)):
+        lost = sum(1 for t in trials if len(t) == stage)
+        print("  lost before %-6s %d" % (STAGES[stage], lost))
+    print("\n%-12s %7s %9s %9s %9s %9s %9s %9s" % ("stage (us)", "count",
+          "min", "mean", "p50", "p90", "p99", "max"))
+    for name, data in zip(names, deltas):
+        print_stats(name, data)
+    print_histogram(deltas[-1], args.bins)
+
+    if args.out:
+        with open(args.out, "w", newline="") as fp:
+            writer = csv.writer(fp)
+            writer.writerow(["detect_s"] + names[:-1])
+            for times in trials:
+                writer.writerow(["%.6f" % times[0]] +
+                    ["%.1f" % ((times[i] - times[i - 1]) * 1e6)
+                     for i in range(1, len(times))])
+
+
+if __name__ == "__main__":
+    main()
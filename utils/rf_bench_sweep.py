@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+#  rf_bench_sweep.py : Sweep of the sub-GHz packet error rate benchmark
+#  Copyright (C) 2019  Appiko
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+"""Packet error rate and throughput sweep for rf_data_tx and rf_data_rx.
+
+For every combination of radio config, payload length and interval both the
+firmwares are built with RF_BENCH=1 and uploaded, the receiver first. The
+transmitter then sends RF_BENCH_PKT_CNT sequence numbered packets. Once the
+run is over the statistics are read from the benchmark characteristic of the
+receiver over BLE, which needs the bleak package.
+
+With two J-Link debuggers,
+    rf_bench_sweep.py --tx-slno 682073614 --rx-slno 682012345 \\
+        --cfg 1 2 3 4 --len 8 32 --interval 250 1000 --out sweep.csv
+Combinations where a packet takes longer on air than the interval are run as
+well, the transmitter then sends the late packets in the next interval.
+"""
+
+import argparse
+import asyncio
+import csv
+import os
+import struct
+import subprocess
+import sys
+import time
+
+#Benchmark characteristic 0xdc73 in the base UUID of the rf_data_rx service
+BENCH_CHAR_UUID = "3c73dc73-07f5-480d-b066-837407fbde0a"
+DEVICE_NAME = "BT"
+
+#Layout of rf_bench_stats_t, little endian and packed
+STATS_FMT = "<6HIII3bB8H"
+STATS_FIELDS = ("rx_cnt", "corrupt_cnt", "lost_cnt", "first_seq", "last_seq",
+                "per_x100", "throughput_bps", "gap_mean_us", "gap_jitter_us",
+                "rssi_mean", "rssi_min", "rssi_max", "payload_len")
+RSSI_BINS = 8
+RSSI_BIN_MIN = -120
+RSSI_BIN_WIDTH = 10
+
+APP_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                       "..", "application")
+
+
+def make(app, slno, bench_args, dry_run):
+    """Build and upload an application with the benchmark settings"""
+    path = os.path.normpath(os.path.join(APP_DIR, app))
+    cmd = ["make", "RF_BENCH=1", "DEBUGGER=JLINK", "SLNO=%d" % slno] + bench_args
+    print("%s: %s" % (app, " ".join(cmd)))
+    if dry_run:
+        return
+    #The Makefiles use PWD for the application name and paths
+    env = dict(os.environ, PWD=path)
+    for target in (["clean"], [], ["upload"]):
+        subprocess.check_call(cmd + target, cwd=path, env=env)
+
+
+def decode_stats(data):
+    vals = struct.unpack(STATS_FMT, bytes(data))
+    stats = dict(zip(STATS_FIELDS, vals))
+    stats["rssi_hist"] = list(vals[len(STATS_FIELDS):])
+    stats["per"] = stats["per_x100"] / 100.0
+    return stats
+
+
+async def read_stats(timeout):
+    try:
+        from bleak import BleakClient, BleakScanner
+    except ImportError:
+        sys.exit("Install bleak to read the statistics over BLE")
+
+    device = await BleakScanner.find_device_by_name(DEVICE_NAME, timeout=timeout)
+    if device is None:
+        sys.exit("Receiver '%s' not found" % DEVICE_NAME)
+    async with BleakClient(device) as client:
+        return decode_stats(await client.read_gatt_char(BENCH_CHAR_UUID))
+
+
+def print_stats(run, stats):
+    print("cfg %d, len %d, interval %d ms" % run)
+    print("  rx %(rx_cnt)d, corrupt %(corrupt_cnt)d, lost %(lost_cnt)d, "
+          "PER %(per).2f %%" % stats)
+    print("  throughput %(throughput_bps)d B/s, gap %(gap_mean_us)d us "
+          "+- %(gap_jitter_us)d us" % stats)
+    print("  RSSI mean %(rssi_mean)d, min %(rssi_min)d, max %(rssi_max)d dBm"
+          % stats)
+    for i, cnt in enumerate(stats["rssi_hist"]):
+        low = RSSI_BIN_MIN + i * RSSI_BIN_WIDTH
+        print("    %4d dBm %6d %s" % (low, cnt, "#" * min(cnt, 60)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--tx-slno", type=int, required=True,
+                        help="J-Link serial number of the transmitter")
+    parser.add_argument("--rx-slno", type=int, required=True,
+                        help="J-Link serial number of the receiver")
+    parser.add_argument("--cfg", type=int, nargs="+", default=[4],
+                        help="radio configs passed to radio_init")
+    parser.add_argument("--len", type=int, nargs="+", default=[16],
+                        help="payload lengths in bytes")
+    parser.add_argument("--interval", type=int, nargs="+", default=[1000],
+                        help="intervals between packets in ms")
+    parser.add_argument("--count", type=int, default=200,
+                        help="number of packets in each run")
+    parser.add_argument("--scan-timeout", type=float, default=20.0,
+                        help="time in s to look for the receiver over BLE")
+    parser.add_argument("--out", help="write the results to a CSV")
+    parser.add_argument("--dry-run", action="store_true",
+                        help="only print the make commands")
+    args = parser.parse_args()
+
+    results = []
+    for cfg in args.cfg:
+        for length in args.len:
+            for interval in args.interval:
+                run = (cfg, length, interval)
+                bench_args = ["RF_BENCH_CFG=%d" % cfg,
+                              "RF_BENCH_LEN=%d" % length,
+                              "RF_BENCH_INTERVAL_MS=%d" % interval,
+                              "RF_BENCH_PKT_CNT=%d" % args.count]
+                make("rf_data_rx", args.rx_slno, bench_args, args.dry_run)
+                make("rf_data_tx", args.tx_slno, bench_args, args.dry_run)
+                if args.dry_run:
+                    continue
+
+                #Margin for the late packets and the BLE update interval
+                time.sleep(args.count * interval / 1000.0 * 1.2 + 3)
+                stats = asyncio.run(read_stats(args.scan_timeout))
+                print_stats(run, stats)
+                results.append((run, stats))
+
+    if args.out and results:
+        with open(args.out, "w", newline="") as fp:
+            writer = csv.writer(fp)
+            writer.writerow(["cfg", "len", "interval_ms"] + list(STATS_FIELDS)
+                + ["rssi_bin_%d" % (RSSI_BIN_MIN + i * RSSI_BIN_WIDTH)
+                   for i in range(RSSI_BINS)])
+            for run, stats in results:
+                writer.writerow(list(run) + [stats[f] for f in STATS_FIELDS]
+                                + stats["rssi_hist"])
+
+
+if __name__ == "__main__":
+    main()